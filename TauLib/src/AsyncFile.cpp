@@ -0,0 +1,789 @@
+///
+/// @file
+/// @brief CPP file for AsyncFile, file reads, writes and stats that overlap (io_uring on Linux).
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "AsyncFile.h"
+#include "Tau_ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <unordered_set>
+#include <thread>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+                //*******************************
+                // The operations
+                //*******************************
+
+static constexpr uintmax_t toEndOfFile = ~uintmax_t(0);
+
+//
+// statSync - the fallback Stat
+//
+static AsyncFileStat statSync(const string& path)
+{
+    AsyncFileStat result;
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+        return result;
+    result.mtime = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return result;
+    result.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    result.ok = true;
+    result.isDirectory = (st.st_mode & S_IFMT) == S_IFDIR;
+    result.size = static_cast<uintmax_t>(st.st_size);
+    return result;
+}
+
+//
+// readSync - the fallback ReadFile
+//
+static AsyncFileData readSync(const string& path, uintmax_t offset, uintmax_t length)
+{
+    AsyncFileData result;
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open())
+        return result;
+    uintmax_t size = static_cast<uintmax_t>(in.tellg());
+    if (offset < size) {
+        length = min(length, size - offset);
+        result.data.resize(static_cast<size_t>(length));
+        in.seekg(static_cast<streamoff>(offset));
+        in.read(result.data.data(), static_cast<streamsize>(length));
+        result.data.resize(static_cast<size_t>(in.gcount()));
+    }
+    result.ok = !in.bad();
+    return result;
+}
+
+//
+// writeSync - the fallback WriteFile
+//
+static bool writeSync(const string& path, const string& data)
+{
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open())
+        return false;
+    out.write(data.data(), static_cast<streamsize>(data.size()));
+    out.close();
+    return !out.fail();
+}
+
+//
+// Op - an operation.  in the ring it's a series of steps: Prepare() fills in a submission for the next step and
+// Complete() gets its result.
+//
+struct AsyncFile::Op {
+    virtual ~Op() {}
+    virtual void RunSync() = 0;
+#if defined(__linux__)
+    virtual void Prepare(io_uring_sqe* sqe) = 0;
+    /// @return true when the operation has finished
+    virtual bool Complete(int result) = 0;
+    /// @brief finish with a failed result, for an operation lost in a ring that broke
+    virtual void Fail() = 0;
+#endif
+};
+
+namespace {
+
+#if defined(__linux__)
+static inline void prepareSqe(io_uring_sqe* sqe, uint8_t opcode, int fd, const void* addr, uint32_t length, uint64_t offset)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->len = length;
+    sqe->off = offset;
+}
+
+// the most a read or write step asks for
+static constexpr uint32_t maxStep = 1u << 30;
+#endif
+
+//
+// StatOp
+//
+struct StatOp : AsyncFile::Op {
+    string path;
+    promise<AsyncFileStat> result;
+
+    void RunSync() override { result.set_value(statSync(path)); }
+
+#if defined(__linux__)
+    struct statx stx {};
+
+    void Prepare(io_uring_sqe* sqe) override {
+        prepareSqe(sqe, IORING_OP_STATX, AT_FDCWD, path.c_str(), STATX_TYPE | STATX_SIZE | STATX_MTIME,
+                   reinterpret_cast<uint64_t>(&stx));
+    }
+
+    bool Complete(int res) override {
+        AsyncFileStat stat;
+        if (res >= 0) {
+            stat.ok = true;
+            stat.isDirectory = (stx.stx_mode & S_IFMT) == S_IFDIR;
+            stat.size = stx.stx_size;
+            stat.mtime = static_cast<int64_t>(stx.stx_mtime.tv_sec) * 1000000000LL + stx.stx_mtime.tv_nsec;
+        }
+        result.set_value(stat);
+        return true;
+    }
+
+    void Fail() override { result.set_value(AsyncFileStat()); }
+#endif
+};
+
+//
+// ReadOp - open, read until done or the end of the file, close
+//
+struct ReadOp : AsyncFile::Op {
+    string path;
+    uintmax_t offset {0};
+    uintmax_t length {toEndOfFile};
+    promise<AsyncFileData> result;
+
+    void RunSync() override {
+#if defined(__linux__)
+        if (fd >= 0)
+            close(fd);          // opened in a ring that then broke
+#endif
+        result.set_value(readSync(path, offset, length));
+    }
+
+#if defined(__linux__)
+    enum class Step { Open, Read, Close } step {Step::Open};
+    int fd {-1};
+    size_t done {0};
+    bool failed {false};
+    string data;
+
+    void Prepare(io_uring_sqe* sqe) override {
+        switch (step) {
+        case Step::Open:
+            prepareSqe(sqe, IORING_OP_OPENAT, AT_FDCWD, path.c_str(), 0, 0);
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            break;
+        case Step::Read:
+            prepareSqe(sqe, IORING_OP_READ, fd, data.data() + done,
+                       static_cast<uint32_t>(min<size_t>(data.size() - done, maxStep)), offset + done);
+            break;
+        case Step::Close:
+            prepareSqe(sqe, IORING_OP_CLOSE, fd, nullptr, 0, 0);
+            break;
+        }
+    }
+
+    bool Complete(int res) override {
+        switch (step) {
+        case Step::Open: {
+            if (res < 0)
+                return Finish(false);
+            fd = res;
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                failed = true;
+                step = Step::Close;
+                return false;
+            }
+            uintmax_t size = static_cast<uintmax_t>(st.st_size);
+            data.resize(offset < size ? static_cast<size_t>(min(length, size - offset)) : 0);
+            step = data.empty() ? Step::Close : Step::Read;
+            return false;
+        }
+        case Step::Read:
+            if (res == -EINTR || res == -EAGAIN)
+                return false;
+            if (res < 0)
+                failed = true;
+            else if (res == 0)
+                data.resize(done);      // the file got shorter
+            else
+                done += static_cast<size_t>(res);
+            if (!failed && done < data.size())
+                return false;
+            step = Step::Close;
+            return false;
+        case Step::Close:
+            return Finish(!failed);
+        }
+        return true;
+    }
+
+    bool Finish(bool ok) {
+        AsyncFileData read;
+        read.ok = ok;
+        if (ok)
+            read.data = move(data);
+        result.set_value(move(read));
+        return true;
+    }
+
+    void Fail() override { result.set_value(AsyncFileData()); }
+#endif
+};
+
+//
+// WriteOp - open (create or truncate), write all of it, close
+//
+struct WriteOp : AsyncFile::Op {
+    string path;
+    string data;
+    promise<bool> result;
+
+    void RunSync() override {
+#if defined(__linux__)
+        if (fd >= 0)
+            close(fd);          // opened in a ring that then broke
+#endif
+        result.set_value(writeSync(path, data));
+    }
+
+#if defined(__linux__)
+    enum class Step { Open, Write, Close } step {Step::Open};
+    int fd {-1};
+    size_t done {0};
+    bool failed {false};
+
+    void Prepare(io_uring_sqe* sqe) override {
+        switch (step) {
+        case Step::Open:
+            prepareSqe(sqe, IORING_OP_OPENAT, AT_FDCWD, path.c_str(), 0666, 0);
+            sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+            break;
+        case Step::Write:
+            prepareSqe(sqe, IORING_OP_WRITE, fd, data.data() + done,
+                       static_cast<uint32_t>(min<size_t>(data.size() - done, maxStep)), done);
+            break;
+        case Step::Close:
+            prepareSqe(sqe, IORING_OP_CLOSE, fd, nullptr, 0, 0);
+            break;
+        }
+    }
+
+    bool Complete(int res) override {
+        switch (step) {
+        case Step::Open:
+            if (res < 0) {
+                result.set_value(false);
+                return true;
+            }
+            fd = res;
+            step = data.empty() ? Step::Close : Step::Write;
+            return false;
+        case Step::Write:
+            if (res == -EINTR || res == -EAGAIN)
+                return false;
+            if (res <= 0)
+                failed = true;
+            else
+                done += static_cast<size_t>(res);
+            if (!failed && done < data.size())
+                return false;
+            step = Step::Close;
+            return false;
+        case Step::Close:
+            result.set_value(!failed && res >= 0);
+            return true;
+        }
+        return true;
+    }
+
+    void Fail() override { result.set_value(false); }
+#endif
+};
+
+} // end anonymous namespace
+
+                //*******************************
+                // The ring
+                //*******************************
+
+#if defined(__linux__)
+
+//
+// Ring - an io_uring and the thread that submits to it and reaps it.  callers queue operations and write to an
+// eventfd; a read of the eventfd is always in the ring so a wakeup ends the thread's wait for completions.
+//
+struct AsyncFile::Ring {
+    ~Ring();
+
+    /// @brief nullptr if io_uring can't be used
+    static unique_ptr<Ring> Create(unsigned int queueDepth);
+
+    void Queue(vector<unique_ptr<Op>> ops);
+
+private:
+    struct WakeOp : Op {
+        uint64_t count {0};
+        int fd {-1};
+        void RunSync() override {}
+        void Prepare(io_uring_sqe* sqe) override { prepareSqe(sqe, IORING_OP_READ, fd, &count, sizeof(count), 0); }
+        bool Complete(int) override { return false; }
+        void Fail() override {}
+    };
+
+    bool Setup(unsigned int queueDepth);
+    void Run();
+    void Reap();
+    void Abandon();
+
+    int ringFd {-1};
+    void* sqMap {MAP_FAILED};
+    size_t sqMapSize {0};
+    void* cqMap {MAP_FAILED};
+    size_t cqMapSize {0};
+    io_uring_sqe* sqes {static_cast<io_uring_sqe*>(MAP_FAILED)};
+    size_t sqesSize {0};
+
+    unsigned* sqHead {nullptr};
+    unsigned* sqTail {nullptr};
+    unsigned* sqArray {nullptr};
+    unsigned sqMask {0};
+    unsigned sqEntries {0};
+    unsigned* cqHead {nullptr};
+    unsigned* cqTail {nullptr};
+    io_uring_cqe* cqes {nullptr};
+    unsigned cqMask {0};
+    unsigned cqEntries {0};
+
+    WakeOp wake;
+    thread runner;
+
+    // the thread's own
+    deque<Op*> ready;           // waiting for a submission slot for their next step
+    unsigned toSubmit {0};
+    size_t inFlight {0};        // submitted and not yet reaped
+    unordered_set<Op*> inKernel;        // the operations in flight, but the wake
+    size_t active {0};          // taken from queued and not yet finished
+
+    // shared with callers
+    mutex lock;
+    vector<unique_ptr<Op>> queued;
+    bool stopping {false};
+    bool broken {false};        // io_uring_enter failed.  operations run on the caller's thread.
+};
+
+static int ioUringSetup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, void* arg, unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+//
+// Create
+//
+unique_ptr<AsyncFile::Ring> AsyncFile::Ring::Create(unsigned int queueDepth)
+{
+    unique_ptr<Ring> ring(new Ring());
+    if (!ring->Setup(queueDepth))
+        return nullptr;
+    ring->runner = thread(&Ring::Run, ring.get());
+    return ring;
+}
+
+//
+// Setup - map the ring and check it can do every operation used
+//
+bool AsyncFile::Ring::Setup(unsigned int queueDepth)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = ioUringSetup(max(queueDepth, 8u), &params);
+    if (ringFd < 0)
+        return false;
+
+    // the operations used, which need 5.6 or later
+    const size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    vector<uint64_t> probeBuffer((probeSize + 7) / 8, 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeBuffer.data());
+    if (ioUringRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        return false;
+    for (uint8_t opcode : { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+        if (opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+            return false;
+    }
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+        sqMapSize = cqMapSize = max(sqMapSize, cqMapSize);
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED)
+        return false;
+    if (!singleMap) {
+        cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED)
+            return false;
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                           ringFd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED)
+        return false;
+
+    char* sq = static_cast<char*>(sqMap);
+    char* cq = static_cast<char*>(singleMap ? sqMap : cqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqEntries = params.cq_entries;
+
+    wake.fd = eventfd(0, EFD_CLOEXEC);
+    return wake.fd >= 0;
+}
+
+//
+// ~Ring - the operations queued finish first
+//
+AsyncFile::Ring::~Ring()
+{
+    if (runner.joinable()) {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        uint64_t one = 1;
+        (void)!write(wake.fd, &one, sizeof(one));
+        runner.join();
+    }
+    if (wake.fd >= 0)
+        close(wake.fd);
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqesSize);
+    if (cqMap != MAP_FAILED)
+        munmap(cqMap, cqMapSize);
+    if (sqMap != MAP_FAILED)
+        munmap(sqMap, sqMapSize);
+    if (ringFd >= 0)
+        close(ringFd);
+}
+
+//
+// Queue - hand operations to the ring thread
+//
+void AsyncFile::Ring::Queue(vector<unique_ptr<Op>> ops)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (!broken) {
+            for (unique_ptr<Op>& op : ops)
+                queued.push_back(move(op));
+            ops.clear();
+        }
+    }
+    for (unique_ptr<Op>& op : ops)
+        op->RunSync();
+    if (ops.size() > 0)
+        return;
+    uint64_t one = 1;
+    (void)!write(wake.fd, &one, sizeof(one));
+}
+
+//
+// Run - the ring thread.  fills submission slots from the ready operations, submits them and waits for at least
+// one completion in the same call, then reaps.
+//
+void AsyncFile::Ring::Run()
+{
+    ready.push_back(&wake);
+    for (;;) {
+        // operations queued by callers
+        bool stop = false;
+        {
+            lock_guard<mutex> guard(lock);
+            for (unique_ptr<Op>& op : queued)
+                ready.push_back(op.release());
+            active += queued.size();
+            queued.clear();
+            stop = stopping;
+        }
+        if (stop && active == 0)
+            break;
+
+        // never more in flight than the completion ring holds
+        unsigned tail = *sqTail;
+        unsigned head = atomic_ref<unsigned>(*sqHead).load(memory_order_acquire);
+        while (!ready.empty() && tail - head < sqEntries && inFlight < cqEntries) {
+            Op* op = ready.front();
+            ready.pop_front();
+            unsigned index = tail & sqMask;
+            op->Prepare(&sqes[index]);
+            sqes[index].user_data = reinterpret_cast<uint64_t>(op);
+            sqArray[index] = index;
+            if (op != &wake)
+                inKernel.insert(op);
+            ++tail;
+            ++toSubmit;
+            ++inFlight;
+        }
+        atomic_ref<unsigned>(*sqTail).store(tail, memory_order_release);
+
+        int submitted = ioUringEnter(ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+                Reap();
+                Abandon();
+                break;
+            }
+        } else {
+            toSubmit -= min(toSubmit, static_cast<unsigned>(submitted));
+        }
+        Reap();
+    }
+}
+
+//
+// Reap - take the completions, finishing operations or readying their next step
+//
+void AsyncFile::Ring::Reap()
+{
+    unsigned head = *cqHead;
+    unsigned tail = atomic_ref<unsigned>(*cqTail).load(memory_order_acquire);
+    for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes[head & cqMask];
+        Op* op = reinterpret_cast<Op*>(cqe.user_data);
+        --inFlight;
+        inKernel.erase(op);
+        if (op == &wake) {
+            ready.push_back(&wake);     // keep a read of the eventfd in the ring
+            continue;
+        }
+        if (op->Complete(cqe.res)) {
+            delete op;
+            --active;
+        } else
+            ready.push_back(op);
+    }
+    atomic_ref<unsigned>(*cqHead).store(head, memory_order_release);
+}
+
+//
+// Abandon - the ring can't be entered.  operations not yet submitted run here instead so no caller waits forever.
+// those in the kernel are given a second to complete, then fail.  a failed one isn't freed: the kernel may still
+// write to it.
+//
+void AsyncFile::Ring::Abandon()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        broken = true;
+    }
+
+    // the kernel still posts completions for what it has, even if it can't be entered
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+    while (!inKernel.empty() && chrono::steady_clock::now() < deadline) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        Reap();
+    }
+    for (Op* op : inKernel)
+        op->Fail();
+    inKernel.clear();
+
+    vector<unique_ptr<Op>> left;
+    {
+        lock_guard<mutex> guard(lock);
+        left = move(queued);
+        queued.clear();
+    }
+    for (Op* op : ready) {
+        if (op != &wake)
+            left.emplace_back(op);
+    }
+    ready.clear();
+    for (unique_ptr<Op>& op : left)
+        op->RunSync();
+}
+
+#else
+
+struct AsyncFile::Ring {
+    static unique_ptr<Ring> Create(unsigned int) { return nullptr; }
+    void Queue(vector<unique_ptr<Op>>) {}
+};
+
+#endif
+
+                //*******************************
+                // AsyncFile
+                //*******************************
+
+//
+// AsyncFile
+//
+AsyncFile::AsyncFile(unsigned int queueDepth, unsigned int fallbackThreads)
+{
+    ring = Ring::Create(queueDepth);
+    if (!ring)
+        pool = make_unique<ThreadPool>(max(fallbackThreads, 1u));
+}
+
+AsyncFile::~AsyncFile()
+{
+    ring.reset();
+    pool.reset();
+}
+
+//
+// Shared
+//
+AsyncFile& AsyncFile::Shared()
+{
+    static AsyncFile shared;
+    return shared;
+}
+
+//
+// Submit - to the ring, or run each operation on the pool
+//
+void AsyncFile::Submit(vector<unique_ptr<Op>> ops)
+{
+    if (ring) {
+        ring->Queue(move(ops));
+        return;
+    }
+    for (unique_ptr<Op>& op : ops) {
+        // std::function needs a copyable target
+        shared_ptr<Op> shared(op.release());
+        pool->Post([shared] { shared->RunSync(); });
+    }
+}
+
+//
+// Stat
+//
+future<AsyncFileStat> AsyncFile::Stat(const string& path)
+{
+    return move(StatFiles({ path })[0]);
+}
+
+//
+// ReadFile
+//
+future<AsyncFileData> AsyncFile::ReadFile(const string& path)
+{
+    return move(ReadFiles({ path })[0]);
+}
+
+//
+// ReadFileRange
+//
+future<AsyncFileData> AsyncFile::ReadFileRange(const string& path, uintmax_t offset, uintmax_t length)
+{
+    auto op = make_unique<ReadOp>();
+    op->path = path;
+    op->offset = offset;
+    op->length = length;
+    future<AsyncFileData> result = op->result.get_future();
+    vector<unique_ptr<Op>> ops;
+    ops.push_back(move(op));
+    Submit(move(ops));
+    return result;
+}
+
+//
+// WriteFile
+//
+future<bool> AsyncFile::WriteFile(const string& path, string data)
+{
+    Strings contents;
+    contents.push_back(move(data));
+    return move(WriteFiles({ path }, move(contents))[0]);
+}
+
+//
+// StatFiles
+//
+vector<future<AsyncFileStat>> AsyncFile::StatFiles(const Strings& paths)
+{
+    vector<future<AsyncFileStat>> results;
+    vector<unique_ptr<Op>> ops;
+    for (const string& path : paths) {
+        auto op = make_unique<StatOp>();
+        op->path = path;
+        results.push_back(op->result.get_future());
+        ops.push_back(move(op));
+    }
+    Submit(move(ops));
+    return results;
+}
+
+//
+// ReadFiles
+//
+vector<future<AsyncFileData>> AsyncFile::ReadFiles(const Strings& paths)
+{
+    vector<future<AsyncFileData>> results;
+    vector<unique_ptr<Op>> ops;
+    for (const string& path : paths) {
+        auto op = make_unique<ReadOp>();
+        op->path = path;
+        results.push_back(op->result.get_future());
+        ops.push_back(move(op));
+    }
+    Submit(move(ops));
+    return results;
+}
+
+//
+// WriteFiles - data[i] is written to paths[i]
+//
+vector<future<bool>> AsyncFile::WriteFiles(const Strings& paths, Strings data)
+{
+    vector<future<bool>> results;
+    vector<unique_ptr<Op>> ops;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto op = make_unique<WriteOp>();
+        op->path = paths[i];
+        if (i < data.size())
+            op->data = move(data[i]);
+        results.push_back(op->result.get_future());
+        ops.push_back(move(op));
+    }
+    Submit(move(ops));
+    return results;
+}
+
+} // end namespace Tau
@@ -0,0 +1,103 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for AsyncFile, file reads, writes and stats that overlap (io_uring on Linux).
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <vector>
+#include <future>
+#include <memory>
+#include <cstdint>
+#include "Str.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+class ThreadPool;
+
+///
+/// @brief AsyncFileStat - the result of AsyncFile::Stat
+///
+struct AsyncFileStat {
+    bool ok {false};            ///< false if the path doesn't exist or can't be read
+    bool isDirectory {false};
+    uintmax_t size {0};
+    int64_t mtime {0};          ///< last write time in nanoseconds since 1970
+};
+
+///
+/// @brief AsyncFileData - the result of AsyncFile::ReadFile
+///
+struct AsyncFileData {
+    bool ok {false};
+    std::string data;
+};
+
+///
+/// @brief AsyncFile - starts file operations that run while the caller carries on.  each returns a future.
+/// @remark On Linux the operations go to the kernel through an io_uring (5.6 or later) so many run at once from one
+///         thread: open, read and close of a whole file are chained in the ring.  A batch (ReadFiles, StatFiles,
+///         WriteFiles) is submitted with one system call.  Without io_uring (older kernels, containers that block it,
+///         Windows) the operations run on a ThreadPool.
+/// @remark The destructor waits for the operations still running.
+/// @code
+///     AsyncFile& io = AsyncFile::Shared();
+///     auto files = io.ReadFiles({ "lang.csv", "theme.ini", "logo.png" });
+///     ...
+///     AsyncFileData ini = files[1].get();
+/// @endcode
+///
+class AsyncFile {
+public:
+    /// @param queueDepth the io_uring size, the most operations in the kernel at once
+    /// @param fallbackThreads the ThreadPool size without io_uring
+    explicit AsyncFile(unsigned int queueDepth = 128, unsigned int fallbackThreads = 4);
+    ~AsyncFile();
+
+    AsyncFile(const AsyncFile&) = delete;
+    AsyncFile& operator = (const AsyncFile&) = delete;
+
+    /// @brief one AsyncFile for the program, made on first use
+    static AsyncFile& Shared();
+
+    /// @brief true if operations go through io_uring
+    bool UsingIoUring() const { return ring != nullptr; }
+
+                //*******************************
+                // One file
+                //*******************************
+
+    std::future<AsyncFileStat> Stat(const std::string& path);
+
+    /// @brief read a whole file
+    std::future<AsyncFileData> ReadFile(const std::string& path);
+
+    /// @brief read part of a file.  less than length at the end of the file.
+    std::future<AsyncFileData> ReadFileRange(const std::string& path, uintmax_t offset, uintmax_t length);
+
+    /// @brief create or replace a file
+    std::future<bool> WriteFile(const std::string& path, std::string data);
+
+                //*******************************
+                // Batches
+                //*******************************
+
+    std::vector<std::future<AsyncFileStat>> StatFiles(const Strings& paths);
+    std::vector<std::future<AsyncFileData>> ReadFiles(const Strings& paths);
+    std::vector<std::future<bool>> WriteFiles(const Strings& paths, Strings data);
+
+    struct Op;
+    struct Ring;
+
+private:
+    void Submit(std::vector<std::unique_ptr<Op>> ops);
+
+    std::unique_ptr<Ring> ring;
+    std::unique_ptr<ThreadPool> pool;
+};
+
+} // end namespace Tau
@@ -0,0 +1,534 @@
+///
+/// @file
+/// @brief CPP file for CsvCache, the binary columnar cache file for CsvFile.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "CsvCache.h"
+#include "CsvFile.h"
+#include "MappedFile.h"
+#include "Tau_Hash.h"
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <string_view>
+#include <limits>
+
+using namespace std;
+using namespace Tau;
+namespace fs = std::filesystem;
+
+//
+// Cache file layout.  All values are native byte order and every section starts on an 8 byte boundary.
+//
+//   CacheHeader
+//   uint32_t rowLengths[rowCount]              number of cells in each row (rows can have different lengths)
+//   CacheColumn columns[columnCount]
+//   column data:
+//     Text:        uint64_t offsets[rowCount + 1], bytes
+//     Dictionary:  uint32_t codes[rowCount], uint64_t offsets[dictCount + 1], bytes
+//     Int64:       int64_t values[rowCount]
+//     Double:      double values[rowCount]
+//
+// A cell that is missing from a short row is "" / code MissingCode / 0 in the column data.
+//
+static const char CacheMagic[8] = { 'T', 'a', 'u', 'C', 's', 'v', 'C', '1' };
+static const uint32_t CacheVersion = 1;
+static const uint32_t ByteOrderMark = 0x01020304;
+static const uint32_t MissingCode = CsvCacheView::MissingCode;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fileSize;
+    uint64_t rowCount;
+    uint64_t columnCount;
+    uint64_t rowLengthsOffset;
+    uint64_t columnsOffset;
+    uint64_t sourceSize;
+    int64_t  sourceMTime;
+    uint64_t sourceHash;
+};
+
+struct CacheColumn {
+    uint32_t encoding;
+    uint32_t dictCount;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(CacheHeader) == 80, "CacheHeader layout");
+static_assert(sizeof(CacheColumn) == 24, "CacheColumn layout");
+
+                //*******************************
+                // CsvCacheKey
+                //*******************************
+
+//
+// FromFile
+//
+bool CsvCacheKey::FromFile(const string& csvFilePath, CsvCacheKey* key, bool withHash)
+{
+    error_code ec;
+    auto size = fs::file_size(csvFilePath, ec);
+    if (ec)
+        return false;
+    auto mtime = fs::last_write_time(csvFilePath, ec);
+    if (ec)
+        return false;
+
+    key->size = size;
+    key->mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    key->hash = 0;
+    if (withHash) {
+        MappedFile file(csvFilePath);
+        if (!file.IsOpen() || file.size() != size)
+            return false;
+        key->hash = XXHash64(file.data(), file.size());
+    }
+    return true;
+}
+
+                //*******************************
+                // CsvCache
+                //*******************************
+
+//
+// DefaultPath
+//
+string CsvCache::DefaultPath(const string& csvFilePath)
+{
+    return csvFilePath + ".taucache";
+}
+
+// append raw values to the cache being built
+template <class T>
+static void appendValue(string* out, const T& value)
+{
+    out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void align8(string* out)
+{
+    out->resize((out->size() + 7) & ~size_t(7), '\0');
+}
+
+// true if the cell is an int64 that to_chars writes back as exactly the same text
+static bool canonicalInt64(string_view cell, int64_t* value)
+{
+    auto [ptr, ec] = from_chars(cell.data(), cell.data() + cell.size(), *value);
+    if (cell.empty() || ec != errc() || ptr != cell.data() + cell.size())
+        return false;
+    char buf[32];
+    auto result = to_chars(buf, buf + sizeof(buf), *value);
+    return string_view(buf, result.ptr - buf) == cell;
+}
+
+// true if the cell is a double that to_chars writes back as exactly the same text
+static bool canonicalDouble(string_view cell, double* value)
+{
+    auto [ptr, ec] = from_chars(cell.data(), cell.data() + cell.size(), *value);
+    if (cell.empty() || ec != errc() || ptr != cell.data() + cell.size())
+        return false;
+    char buf[64];
+    auto result = to_chars(buf, buf + sizeof(buf), *value);
+    return string_view(buf, result.ptr - buf) == cell;
+}
+
+//
+// encodeColumn - picks the smallest encoding that gives back exactly the same strings and appends the column data
+//
+static CacheColumn encodeColumn(const vector<Strings>& rows, size_t col, string* out)
+{
+    const size_t rowCount = rows.size();
+    auto cellAt = [&] (size_t r) -> string_view { return (col < rows[r].size()) ? string_view(rows[r][col]) : string_view(); };
+    auto hasCell = [&] (size_t r) { return col < rows[r].size(); };
+
+    CacheColumn column {};
+    align8(out);
+    column.offset = out->size();
+
+    // numbers
+    vector<int64_t> ints(rowCount, 0);
+    bool allInts = true;
+    for (size_t r = 0; r < rowCount && allInts; ++r)
+        allInts = !hasCell(r) || canonicalInt64(cellAt(r), &ints[r]);
+    if (allInts) {
+        column.encoding = static_cast<uint32_t>(CsvCacheEncoding::Int64);
+        out->append(reinterpret_cast<const char*>(ints.data()), ints.size() * sizeof(int64_t));
+        column.size = out->size() - column.offset;
+        return column;
+    }
+
+    vector<double> doubles(rowCount, 0.0);
+    bool allDoubles = true;
+    for (size_t r = 0; r < rowCount && allDoubles; ++r)
+        allDoubles = !hasCell(r) || canonicalDouble(cellAt(r), &doubles[r]);
+    if (allDoubles) {
+        column.encoding = static_cast<uint32_t>(CsvCacheEncoding::Double);
+        out->append(reinterpret_cast<const char*>(doubles.data()), doubles.size() * sizeof(double));
+        column.size = out->size() - column.offset;
+        return column;
+    }
+
+    // low cardinality strings go in a dictionary
+    unordered_map<string_view, uint32_t> dictionary;
+    vector<string_view> distinct;
+    vector<uint32_t> codes(rowCount, MissingCode);
+    size_t maxDistinct = rowCount / 2;
+    for (size_t r = 0; r < rowCount && distinct.size() <= maxDistinct; ++r) {
+        if (!hasCell(r))
+            continue;
+        auto [it, inserted] = dictionary.try_emplace(cellAt(r), static_cast<uint32_t>(distinct.size()));
+        if (inserted)
+            distinct.push_back(cellAt(r));
+        codes[r] = it->second;
+    }
+    if (distinct.size() <= maxDistinct) {
+        column.encoding = static_cast<uint32_t>(CsvCacheEncoding::Dictionary);
+        column.dictCount = static_cast<uint32_t>(distinct.size());
+        out->append(reinterpret_cast<const char*>(codes.data()), codes.size() * sizeof(uint32_t));
+        align8(out);
+        uint64_t offset = 0;
+        appendValue(out, offset);
+        for (string_view str : distinct) {
+            offset += str.size();
+            appendValue(out, offset);
+        }
+        for (string_view str : distinct)
+            out->append(str);
+        column.size = out->size() - column.offset;
+        return column;
+    }
+
+    // plain text
+    column.encoding = static_cast<uint32_t>(CsvCacheEncoding::Text);
+    uint64_t offset = 0;
+    appendValue(out, offset);
+    for (size_t r = 0; r < rowCount; ++r) {
+        offset += cellAt(r).size();
+        appendValue(out, offset);
+    }
+    for (size_t r = 0; r < rowCount; ++r)
+        out->append(cellAt(r));
+    column.size = out->size() - column.offset;
+    return column;
+}
+
+//
+// Save
+//
+bool CsvCache::Save(const CsvFile& csv, const CsvCacheKey& key, const string& cachePath)
+{
+    const vector<Strings>& rows = csv.rows;
+    size_t columnCount = 0;
+    for (const Strings& row : rows)
+        columnCount = max(columnCount, row.size());
+
+    string out;
+    out.resize(sizeof(CacheHeader), '\0');
+
+    CacheHeader header {};
+    memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.byteOrder = ByteOrderMark;
+    header.rowCount = rows.size();
+    header.columnCount = columnCount;
+    header.sourceSize = key.size;
+    header.sourceMTime = key.mtime;
+    header.sourceHash = key.hash;
+
+    header.rowLengthsOffset = out.size();
+    for (const Strings& row : rows)
+        appendValue(&out, static_cast<uint32_t>(row.size()));
+
+    align8(&out);
+    header.columnsOffset = out.size();
+    out.resize(out.size() + columnCount * sizeof(CacheColumn), '\0');
+
+    vector<CacheColumn> columns;
+    for (size_t col = 0; col < columnCount; ++col)
+        columns.push_back(encodeColumn(rows, col, &out));
+
+    align8(&out);
+    header.fileSize = out.size();
+    memcpy(out.data(), &header, sizeof(header));
+    if (columnCount > 0)
+        memcpy(out.data() + header.columnsOffset, columns.data(), columnCount * sizeof(CacheColumn));
+
+    // write to a temp file and rename it into place so a reader never sees half a cache
+    string tempPath = cachePath + ".tmp";
+    {
+        ofstream ofile(tempPath, ios_base::out | ios_base::binary | ios_base::trunc);
+        if (!ofile.is_open())
+            return false;
+        if (!ofile.write(out.data(), static_cast<streamsize>(out.size()))) {
+            ofile.close();
+            fs::remove(tempPath);
+            return false;
+        }
+    }
+
+    error_code ec;
+    fs::rename(tempPath, cachePath, ec);
+    if (ec)
+        fs::remove(tempPath, ec);
+    return !ec;
+}
+
+// read a value from the mapped cache.  memcpy keeps it legal for any alignment.
+template <class T>
+static T readAt(const char* base, uint64_t offset)
+{
+    T value;
+    memcpy(&value, base + offset, sizeof(T));
+    return value;
+}
+
+//
+// Load
+//
+bool CsvCache::Load(CsvFile* csv, const string& csvFilePath, const string& cachePath, bool verifyHash)
+{
+    CsvCacheView view;
+    if (!view.Open(csvFilePath, cachePath, verifyHash))
+        return false;
+
+    const size_t rowCount = view.RowCount();
+    vector<Strings> rows(rowCount);
+    for (size_t r = 0; r < rowCount; ++r)
+        rows[r].reserve(view.RowLength(r));
+
+    for (unsigned int col = 0; col < view.ColumnCount(); ++col) {
+        // cells are added column by column.  a row gets a cell in this column if it has more than col cells.
+        auto wantsCell = [&] (size_t r) { return view.RowLength(r) > col; };
+
+        switch (view.Encoding(col)) {
+        case CsvCacheEncoding::Int64: {
+            span<const int64_t> values = view.Int64Column(col);
+            char buf[32];
+            for (size_t r = 0; r < rowCount; ++r) {
+                if (!wantsCell(r))
+                    continue;
+                auto result = to_chars(buf, buf + sizeof(buf), values[r]);
+                rows[r].emplace_back(buf, result.ptr);
+            }
+            break;
+        }
+        case CsvCacheEncoding::Double: {
+            span<const double> values = view.DoubleColumn(col);
+            char buf[64];
+            for (size_t r = 0; r < rowCount; ++r) {
+                if (!wantsCell(r))
+                    continue;
+                auto result = to_chars(buf, buf + sizeof(buf), values[r]);
+                rows[r].emplace_back(buf, result.ptr);
+            }
+            break;
+        }
+        default: {
+            string_view text;
+            for (size_t r = 0; r < rowCount; ++r) {
+                if (!wantsCell(r))
+                    continue;
+                if (!view.TextAt(r, col, &text))
+                    return false;       // damaged
+                rows[r].emplace_back(text);
+            }
+            break;
+        }
+        }
+    }
+
+    csv->rows = std::move(rows);
+    csv->RowsChanged();
+    csv->csvFilePath = csvFilePath;
+    csv->opened = true;
+    return true;
+}
+
+                //*******************************
+                // CsvCacheView
+                //*******************************
+
+//
+// Open - check the header and that every column is inside the file.  the cells are checked as they're read.
+//
+bool CsvCacheView::Open(const string& csvFilePath, const string& cachePath, bool verifyHash)
+{
+    Close();
+    if (!file.Open(cachePath != "" ? cachePath : CsvCache::DefaultPath(csvFilePath)) || file.size() < sizeof(CacheHeader)) {
+        Close();
+        return false;
+    }
+
+    const char* base = file.data();
+    const uint64_t cacheSize = file.size();
+    CacheHeader header = readAt<CacheHeader>(base, 0);
+    if (memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.version != CacheVersion ||
+        header.byteOrder != ByteOrderMark || header.fileSize != cacheSize) {
+        Close();
+        return false;
+    }
+
+    // does it still match the csv file
+    CsvCacheKey key;
+    if (!CsvCacheKey::FromFile(csvFilePath, &key, verifyHash) || key.size != header.sourceSize ||
+        key.mtime != header.sourceMTime || (verifyHash && key.hash != header.sourceHash)) {
+        Close();
+        return false;
+    }
+
+    // bounds check everything before using it.  the columns are 8 byte aligned in the file, and so in the mapping.
+    auto inBounds = [&] (uint64_t offset, uint64_t count, uint64_t elementSize) {
+        return offset <= cacheSize && count <= (cacheSize - offset) / elementSize;
+    };
+    const uint64_t columnCount = header.columnCount;
+    bool ok = inBounds(header.rowLengthsOffset, header.rowCount, sizeof(uint32_t)) &&
+              inBounds(header.columnsOffset, columnCount, sizeof(CacheColumn));
+    for (uint64_t col = 0; ok && col < columnCount; ++col) {
+        CacheColumn stored = readAt<CacheColumn>(base, header.columnsOffset + col * sizeof(CacheColumn));
+        Column column;
+        column.encoding = static_cast<CsvCacheEncoding>(stored.encoding);
+        column.dictCount = stored.dictCount;
+        column.size = stored.size;
+        ok = inBounds(stored.offset, stored.size, 1) && stored.offset % 8 == 0;
+        if (ok)
+            column.data = base + stored.offset;
+
+        uint64_t minimumSize = 0;
+        switch (column.encoding) {
+        case CsvCacheEncoding::Int64:
+        case CsvCacheEncoding::Double:
+            minimumSize = header.rowCount * sizeof(int64_t);
+            break;
+        case CsvCacheEncoding::Dictionary:
+            minimumSize = ((header.rowCount * sizeof(uint32_t) + 7) & ~uint64_t(7)) + (uint64_t(column.dictCount) + 1) * sizeof(uint64_t);
+            break;
+        case CsvCacheEncoding::Text:
+            minimumSize = (header.rowCount + 1) * sizeof(uint64_t);
+            break;
+        default:
+            ok = false;
+        }
+        ok = ok && column.size >= minimumSize;
+        columns.push_back(column);
+    }
+    if (!ok) {
+        Close();
+        return false;
+    }
+    rowCount = header.rowCount;
+    rowLengths = base + header.rowLengthsOffset;
+    return true;
+}
+
+void CsvCacheView::Close()
+{
+    file.Close();
+    rowCount = 0;
+    rowLengths = nullptr;
+    columns.clear();
+}
+
+size_t CsvCacheView::RowLength(size_t row) const
+{
+    if (row >= rowCount)
+        return 0;
+    return min<size_t>(readAt<uint32_t>(rowLengths, row * sizeof(uint32_t)), columns.size());
+}
+
+span<const int64_t> CsvCacheView::Int64Column(unsigned int column) const
+{
+    if (column >= columns.size() || columns[column].encoding != CsvCacheEncoding::Int64)
+        return {};
+    return { reinterpret_cast<const int64_t*>(columns[column].data), rowCount };
+}
+
+span<const double> CsvCacheView::DoubleColumn(unsigned int column) const
+{
+    if (column >= columns.size() || columns[column].encoding != CsvCacheEncoding::Double)
+        return {};
+    return { reinterpret_cast<const double*>(columns[column].data), rowCount };
+}
+
+span<const uint32_t> CsvCacheView::DictionaryCodes(unsigned int column) const
+{
+    if (column >= columns.size() || columns[column].encoding != CsvCacheEncoding::Dictionary)
+        return {};
+    return { reinterpret_cast<const uint32_t*>(columns[column].data), rowCount };
+}
+
+size_t CsvCacheView::DictionarySize(unsigned int column) const
+{
+    if (column >= columns.size() || columns[column].encoding != CsvCacheEncoding::Dictionary)
+        return 0;
+    return columns[column].dictCount;
+}
+
+string_view CsvCacheView::DictionaryString(unsigned int column, uint32_t code) const
+{
+    if (code >= DictionarySize(column))
+        return {};
+    const Column& dict = columns[column];
+    uint64_t offsetsStart = (rowCount * sizeof(uint32_t) + 7) & ~uint64_t(7);
+    uint64_t bytesStart = offsetsStart + (uint64_t(dict.dictCount) + 1) * sizeof(uint64_t);
+    uint64_t begin = readAt<uint64_t>(dict.data, offsetsStart + code * sizeof(uint64_t));
+    uint64_t end = readAt<uint64_t>(dict.data, offsetsStart + (code + 1) * sizeof(uint64_t));
+    if (begin > end || end > dict.size - bytesStart)
+        return {};      // damaged
+    return string_view(dict.data + bytesStart + begin, end - begin);
+}
+
+//
+// TextAt - a Text or Dictionary cell.  false if the cache is damaged there.
+//
+bool CsvCacheView::TextAt(size_t row, unsigned int column, string_view* text) const
+{
+    *text = {};
+    if (column >= columns.size() || row >= rowCount)
+        return true;
+    const Column& col = columns[column];
+    if (col.encoding == CsvCacheEncoding::Dictionary) {
+        uint32_t code = readAt<uint32_t>(col.data, row * sizeof(uint32_t));
+        if (code == MissingCode)
+            return true;
+        if (code >= col.dictCount)
+            return false;
+        *text = DictionaryString(column, code);
+        return true;
+    }
+    if (col.encoding == CsvCacheEncoding::Text) {
+        uint64_t bytesStart = (rowCount + 1) * sizeof(uint64_t);
+        uint64_t begin = readAt<uint64_t>(col.data, row * sizeof(uint64_t));
+        uint64_t end = readAt<uint64_t>(col.data, (row + 1) * sizeof(uint64_t));
+        if (begin > end || end > col.size - bytesStart)
+            return false;
+        *text = string_view(col.data + bytesStart + begin, end - begin);
+    }
+    return true;
+}
+
+string_view CsvCacheView::Text(size_t row, unsigned int column) const
+{
+    string_view text;
+    return TextAt(row, column, &text) ? text : string_view();
+}
+
+string CsvCacheView::Cell(size_t row, unsigned int column) const
+{
+    if (row >= rowCount || column >= RowLength(row))
+        return "";
+    char buf[64];
+    switch (columns[column].encoding) {
+    case CsvCacheEncoding::Int64:
+        return string(buf, to_chars(buf, buf + sizeof(buf), Int64Column(column)[row]).ptr);
+    case CsvCacheEncoding::Double:
+        return string(buf, to_chars(buf, buf + sizeof(buf), DoubleColumn(column)[row]).ptr);
+    default:
+        return string(Text(row, column));
+    }
+}
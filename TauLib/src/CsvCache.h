@@ -0,0 +1,133 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for CsvCache, the binary columnar cache file for CsvFile.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include "MappedFile.h"
+
+struct CsvFile;
+
+///
+/// @brief CsvCacheEncoding - how a column is stored in the cache file
+///
+enum class CsvCacheEncoding : uint32_t {
+    Text = 0,           ///< offsets + string bytes
+    Dictionary = 1,     ///< a code per row into a table of the distinct strings.  used for low cardinality columns.
+    Int64 = 2,          ///< binary int64_t per row.  only used when every cell reads back as the exact same text.
+    Double = 3          ///< binary double per row.  only used when every cell reads back as the exact same text.
+};
+
+///
+/// @brief CsvCacheKey - identifies the csv file the cache was made from
+///
+struct CsvCacheKey {
+    uint64_t size {0};          ///< csv file size
+    int64_t  mtime {0};         ///< csv file last write time
+    uint64_t hash {0};          ///< XXHash64 of the csv file contents.  0 if not hashed.
+
+    /// @brief get the key of a csv file.  returns false if the file can't be read.
+    static bool FromFile(const std::string& csvFilePath, CsvCacheKey* key, bool withHash = true);
+};
+
+///
+/// @brief CsvCache - reads and writes a binary columnar "sidecar" file holding the parsed rows of a csv file.
+/// @remark The cache is memory mapped when loaded so the rows are rebuilt without reading or parsing the csv.
+///         CsvCacheView uses the mapped columns as they are, without building rows at all.
+/// @remark The cache is only used if the csv file size and last write time (and optionally content hash) still match.
+///
+struct CsvCache {
+    /// @brief the default cache path for a csv file.  "aaa/foo.csv" -> "aaa/foo.csv.taucache"
+    static std::string DefaultPath(const std::string& csvFilePath);
+
+    ///
+    /// @brief Save - write a cache file of the rows.
+    /// @param csv the rows to cache.  they must be the rows as loaded from the csv file the key was taken from.
+    /// @param key the key of the csv file (taken before the csv file was read)
+    /// @param cachePath the cache file to write.  it is written to a temp file and renamed into place.
+    ///
+    static bool Save(const CsvFile& csv, const CsvCacheKey& key, const std::string& cachePath);
+
+    ///
+    /// @brief Load - replace the rows of csv with the rows in the cache if the cache matches the csv file.
+    /// @param verifyHash also check the content hash of the csv file (reads the whole csv file but doesn't parse it)
+    /// @return false if there is no cache, it doesn't match the csv file, or it is damaged.  csv is unchanged.
+    ///
+    static bool Load(CsvFile* csv, const std::string& csvFilePath, const std::string& cachePath, bool verifyHash = false);
+};
+
+///
+/// @brief CsvCacheView - the columns of a cache file used straight from the mapped file
+/// @remark A warm start without parsing: Open() maps the cache and checks its header, and the Int64, Double and
+///         Dictionary columns are spans over the mapped values.  No rows are built and no numbers formatted.
+/// @remark The spans and string_views are valid until the view is closed.
+/// @code
+///     CsvCacheView view;
+///     if (view.Open(csvPath) && view.Encoding(2) == CsvCacheEncoding::Int64) {
+///         for (int64_t year : view.Int64Column(2))
+///             ...
+///     }
+/// @endcode
+///
+class CsvCacheView {
+public:
+    CsvCacheView() {}
+    CsvCacheView(const CsvCacheView&) = delete;
+    CsvCacheView& operator = (const CsvCacheView&) = delete;
+
+    /// @brief the code of a missing cell (in a short row) in a Dictionary column
+    static constexpr uint32_t MissingCode {UINT32_MAX};
+
+    ///
+    /// @brief Open - map the cache of a csv file
+    /// @param cachePath "" uses CsvCache::DefaultPath(csvFilePath)
+    /// @param verifyHash also check the content hash of the csv file (reads the whole csv file)
+    /// @return false if there is no cache, it doesn't match the csv file, or it is damaged
+    ///
+    bool Open(const std::string& csvFilePath, const std::string& cachePath = "", bool verifyHash = false);
+    void Close();
+    bool IsOpen() const { return file.IsOpen(); }
+
+    size_t RowCount() const { return rowCount; }
+    size_t ColumnCount() const { return columns.size(); }
+    /// @brief the cells in a row.  a row can be shorter than ColumnCount().
+    size_t RowLength(size_t row) const;
+    CsvCacheEncoding Encoding(unsigned int column) const { return columns[column].encoding; }
+
+    /// @brief the values of an Int64 or Double column, one per row (0 in a short row).  empty for another encoding.
+    std::span<const int64_t> Int64Column(unsigned int column) const;
+    std::span<const double> DoubleColumn(unsigned int column) const;
+
+    /// @brief the code of each row's cell in a Dictionary column, and the distinct strings the codes index.
+    ///        empty for another encoding.
+    std::span<const uint32_t> DictionaryCodes(unsigned int column) const;
+    size_t DictionarySize(unsigned int column) const;
+    std::string_view DictionaryString(unsigned int column, uint32_t code) const;       ///< "" for a bad code
+
+    /// @brief a cell of a Text or Dictionary column.  "" if it's missing or the column is another encoding.
+    std::string_view Text(size_t row, unsigned int column) const;
+    /// @brief a cell of any column as the text it was in the csv file
+    std::string Cell(size_t row, unsigned int column) const;
+
+private:
+    friend struct CsvCache;
+
+    struct Column {
+        CsvCacheEncoding encoding {CsvCacheEncoding::Text};
+        uint32_t dictCount {0};
+        const char* data {nullptr};
+        uint64_t size {0};
+    };
+    bool TextAt(size_t row, unsigned int column, std::string_view* text) const;
+
+    Tau::MappedFile file;
+    size_t rowCount {0};
+    const char* rowLengths {nullptr};
+    std::vector<Column> columns;
+};
@@ -6,10 +6,17 @@
 
 #include "CsvFile.h"
 #include "DirFile.h"
+#include "CsvWriter.h"
+#include "CsvCache.h"
+#include "CsvSchema.h"
 #include <assert.h>
 #include <algorithm>
 #include <fstream>
+#include <charconv>
+#include <cmath>
+#include <string_view>
 #include "sep.h"
+#include "Tau_Parallel.h"
 
 using namespace std;
 using namespace Tau;
@@ -24,14 +31,60 @@ bool CsvFile::Load(const string& filepath) {
     csvFilePath = filepath;
 
     Strings fileLines = ReadTextFileAsAStringArray(filepath, /*removeCRLF*/ true);
+    rows.reserve(rows.size() + fileLines.size());
+
+    Strings row;
+    string partial;     // a double quoted cell with line breaks continues on the next line(s)
     for (const string& line : fileLines) {
-        AddString(line);
+        if (partial.empty()) {
+            if (isBlank(line) || isComment(line))
+                continue;
+            if (SplitCsvLine(line, &row))
+                AddRow(row);
+            else
+                partial = line;
+        } else {
+            partial += '\n';
+            partial += line;
+            if (SplitCsvLine(partial, &row)) {
+                AddRow(row);
+                partial.clear();
+            }
+        }
+    }
+    if (!partial.empty()) {
+        SplitCsvLine(partial, &row);    // unterminated quote at the end of the file.  keep what's there.
+        AddRow(row);
     }
 
     opened = true;
     return true;
 }
 
+//
+// LoadCached
+// a warm start maps the cache and rebuilds the rows without reading or parsing the csv file
+// (CsvCacheView uses the mapped columns directly, without building rows)
+//
+bool CsvFile::LoadCached(const string& filepath, const string& cachePath, bool verifyHash)
+{
+    string cache = (cachePath != "") ? cachePath : CsvCache::DefaultPath(filepath);
+
+    Clear();
+    if (CsvCache::Load(this, filepath, cache, verifyHash))
+        return true;
+
+    // take the key before reading the file so a change while loading can't be cached as the new contents
+    CsvCacheKey key;
+    bool haveKey = CsvCacheKey::FromFile(filepath, &key);
+    if (!Load(filepath))
+        return false;
+
+    if (haveKey)
+        CsvCache::Save(*this, key, cache);
+    return true;
+}
+
 //
 // ReLoad
 //
@@ -50,6 +103,7 @@ bool CsvFile::ReLoad()
 void CsvFile::Clear() {
     rows.clear();
     opened = false;
+    RowsChanged();
 }
 
 //
@@ -57,23 +111,32 @@ void CsvFile::Clear() {
 //
 bool CsvFile::SaveAs(const std::string& filepath)
 {
-    ofstream ofile(filepath.c_str(), ofstream::out | ofstream::trunc);
-    if (!ofile.is_open())
+    CsvWriter writer;
+    if (!writer.Open(filepath))
         return false;
 
-    for (const Strings& row : rows) {
-        bool firstItem = true;
-        for (const string& item : row) {
-            if (!firstItem)
-                ofile << ", ";
-            ofile << item;
-            firstItem = false;
-        }
-        ofile << endl;;
-    }
-    ofile.close();
+    writer.WriteRows(rows);
+    return writer.Close();
+}
 
-    return true;
+//
+// Append
+// adds the rows and appends just those rows to the end of the csv file.  the rest of the file is not rewritten.
+//
+bool CsvFile::Append(const vector<Strings>& newRows)
+{
+    if (csvFilePath == "")
+        return false;
+
+    CsvWriter writer;
+    if (!writer.Open(csvFilePath, /*append*/ true))
+        return false;
+
+    for (const Strings& row : newRows) {
+        if (AddRow(row))
+            writer.WriteRow(row);
+    }
+    return writer.Close();
 }
 
 //
@@ -87,6 +150,64 @@ bool CsvFile::Save()
     return SaveAs(csvFilePath);
 }
 
+//
+// SplitCsvLine
+// splits a line at the commas.  cells are trimmed and empty unquoted cells are skipped the same as SplitStringAtCommas().
+// a cell that starts with a double quote can have commas, line breaks and doubled "" quotes inside it.
+// returns false if the line ends inside a double quoted cell.  row has the cells up to there.
+//
+bool CsvFile::SplitCsvLine(const string& line, Strings* row)
+{
+    row->clear();
+    const size_t len = line.size();
+    size_t pos = 0;
+    while (pos <= len) {
+        size_t start = pos;
+        while (pos < len && (line[pos] == ' ' || line[pos] == '\t'))
+            ++pos;
+
+        if (pos < len && line[pos] == '"') {
+            // double quoted cell
+            string cell;
+            bool closed = false;
+            for (++pos; pos < len; ++pos) {
+                if (line[pos] == '"') {
+                    if (pos + 1 < len && line[pos + 1] == '"') {
+                        cell.push_back('"');
+                        ++pos;
+                    } else {
+                        closed = true;
+                        ++pos;
+                        break;
+                    }
+                } else {
+                    cell.push_back(line[pos]);
+                }
+            }
+            if (!closed) {
+                row->emplace_back(std::move(cell));
+                return false;
+            }
+
+            // anything between the closing quote and the comma is kept
+            size_t end = line.find_first_of(",\r\n", pos);
+            if (end == string::npos)
+                end = len;
+            cell.append(trim(line.substr(pos, end - pos)));
+            row->emplace_back(std::move(cell));
+            pos = end + 1;
+        } else {
+            size_t end = line.find_first_of(",\r\n", start);
+            if (end == string::npos)
+                end = len;
+            if (end > start)
+                row->emplace_back(trim(line.substr(start, end - start)));
+            pos = end + 1;
+        }
+    }
+    return true;
+}
+
 //
 // AddString - add a string of comma separated values
 //
@@ -95,7 +216,8 @@ void CsvFile::AddString(const std::string& line)
     if (isBlank(line) || isComment(line))
         return;
 
-    Strings row = SplitStringAtCommas(line, true /*trim*/);
+    Strings row;
+    SplitCsvLine(line, &row);
     AddRow(row);
 }
 
@@ -106,6 +228,7 @@ bool CsvFile::AddRow(const Strings& row)
 {
     if (row.size() > 0) {
         rows.emplace_back(row);
+        RowsChanged();
         return true;
     } else
         return false;
@@ -117,8 +240,10 @@ bool CsvFile::AddRow(const Strings& row)
 void CsvFile::RemoveRow(unsigned int rowIndex)
 {
     assert(rowIndex < rows.size());
-    if (rowIndex < rows.size())
+    if (rowIndex < rows.size()) {
         rows.erase(rows.begin() + rowIndex);
+        RowsChanged();
+    }
 }
 
 //
@@ -137,9 +262,172 @@ bool CsvFile::RemoveRow(const Tau::Strings& searchItems)
     }
 }
 
+//
+// Sort
+// sort the rows by one column
+//
 void CsvFile::Sort(unsigned int column)
 {
-    ranges::sort(rows, [&] (const Strings& row1, const Strings& row2) { return row1[column] < row2[column]; } );
+    Sort(vector<CsvSortKey> { CsvSortKey { column } });
+}
+
+//
+// Sort
+// stable sort of the rows by one or more columns
+//
+void CsvFile::Sort(const vector<CsvSortKey>& keys)
+{
+    ApplyOrder(SortedOrder(keys));
+}
+
+//
+// compare helpers for SortedOrder.  each returns <0, 0, >0.
+//
+static int compareCaseInsensitive(string_view a, string_view b)
+{
+    size_t len = min(a.size(), b.size());
+    for (size_t i = 0; i < len; ++i) {
+        int ca = tolower(static_cast<unsigned char>(a[i]));
+        int cb = tolower(static_cast<unsigned char>(b[i]));
+        if (ca != cb)
+            return ca - cb;
+    }
+    return (a.size() < b.size()) ? -1 : (a.size() > b.size()) ? 1 : 0;
+}
+
+static int compareNatural(string_view a, string_view b)
+{
+    auto isDigit = [] (char ch) { return ch >= '0' && ch <= '9'; };
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (isDigit(a[i]) && isDigit(b[j])) {
+            // compare the digit runs by value: skip leading zeros, then a longer run is a bigger number
+            size_t startA = i, startB = j;
+            while (startA < a.size() && a[startA] == '0') ++startA;
+            while (startB < b.size() && b[startB] == '0') ++startB;
+            size_t endA = startA, endB = startB;
+            while (endA < a.size() && isDigit(a[endA])) ++endA;
+            while (endB < b.size() && isDigit(b[endB])) ++endB;
+            if (endA - startA != endB - startB)
+                return (endA - startA < endB - startB) ? -1 : 1;
+            int cmp = a.substr(startA, endA - startA).compare(b.substr(startB, endB - startB));
+            if (cmp != 0)
+                return cmp;
+            i = endA;
+            j = endB;
+        } else {
+            int ca = tolower(static_cast<unsigned char>(a[i]));
+            int cb = tolower(static_cast<unsigned char>(b[j]));
+            if (ca != cb)
+                return ca - cb;
+            ++i;
+            ++j;
+        }
+    }
+    return (i < a.size()) ? 1 : (j < b.size()) ? -1 : 0;
+}
+
+//
+// ParseNumber
+// parse a cell as a number.  returns NaN if the cell isn't a number.
+//
+double CsvFile::ParseNumber(string_view str)
+{
+    if (!str.empty() && str[0] == '+')
+        str.remove_prefix(1);
+    double value = 0;
+    auto [ptr, ec] = from_chars(str.data(), str.data() + str.size(), value);
+    if (str.empty() || ec != errc() || ptr != str.data() + str.size())
+        return NAN;
+    return value;
+}
+
+//
+// SortedOrder
+// returns the sorted order of the rows without moving them.
+// the key cells are looked up (and numbers parsed) once before sorting so the compare doesn't touch the rows.
+//
+vector<size_t> CsvFile::SortedOrder(const vector<CsvSortKey>& keys) const
+{
+    vector<size_t> order(rows.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    if (keys.empty() || rows.size() < 2)
+        return order;
+
+    struct KeyColumn {
+        CsvSortKey key;
+        vector<string_view> cells;
+        vector<double> numbers;
+    };
+    vector<KeyColumn> keyColumns;
+    for (const CsvSortKey& key : keys) {
+        KeyColumn& kc = keyColumns.emplace_back(KeyColumn { key, {}, {} });
+        kc.cells.resize(rows.size());
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (key.column < rows[r].size())
+                kc.cells[r] = rows[r][key.column];
+        }
+        if (key.type == CsvSortType::Numeric) {
+            kc.numbers.resize(rows.size());
+            for (size_t r = 0; r < rows.size(); ++r)
+                kc.numbers[r] = ParseNumber(kc.cells[r]);
+        }
+    }
+
+    auto compareRows = [&] (size_t r1, size_t r2) -> bool {
+        for (const KeyColumn& kc : keyColumns) {
+            int cmp = 0;
+            switch (kc.key.type) {
+            case CsvSortType::Numeric: {
+                double n1 = kc.numbers[r1];
+                double n2 = kc.numbers[r2];
+                bool isNum1 = !isnan(n1);
+                bool isNum2 = !isnan(n2);
+                if (isNum1 && isNum2)
+                    cmp = (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0;
+                else if (isNum1 != isNum2)
+                    cmp = isNum1 ? 1 : -1;      // non-numbers first
+                else
+                    cmp = kc.cells[r1].compare(kc.cells[r2]);
+                break;
+            }
+            case CsvSortType::CaseInsensitive:
+                cmp = compareCaseInsensitive(kc.cells[r1], kc.cells[r2]);
+                break;
+            case CsvSortType::Natural:
+                cmp = compareNatural(kc.cells[r1], kc.cells[r2]);
+                break;
+            default:
+                cmp = kc.cells[r1].compare(kc.cells[r2]);
+                break;
+            }
+            if (cmp != 0)
+                return kc.key.ascending ? (cmp < 0) : (cmp > 0);
+        }
+        return false;
+    };
+
+    ParallelStableSort(order.begin(), order.end(), compareRows);
+    return order;
+}
+
+//
+// ApplyOrder
+// physically reorder the rows.  the rows are moved, not copied.
+//
+void CsvFile::ApplyOrder(const vector<size_t>& order)
+{
+    assert(order.size() == rows.size());
+    if (order.size() != rows.size())
+        return;
+
+    vector<Strings> sorted;
+    sorted.reserve(rows.size());
+    for (size_t index : order)
+        sorted.emplace_back(std::move(rows[index]));
+    rows = std::move(sorted);
+    RowsChanged();
 }
 
 //
@@ -202,6 +490,131 @@ size_t CsvFile::ExpandToSameNumberOfColumns()
         while (row.size() < numCols)
             row.emplace_back("");
     }
+    RowsChanged();
 
     return numCols;
 }
+
+                //*******************************
+                // Column types
+                //*******************************
+
+//
+// Schema
+//
+const CsvSchema& CsvFile::Schema() const
+{
+    ParseTypedColumns();
+    return schema;
+}
+
+//
+// SetSchema
+//
+void CsvFile::SetSchema(const CsvSchema& newSchema)
+{
+    explicitSchema = newSchema;
+    hasExplicitSchema = true;
+    RowsChanged();
+}
+
+//
+// ClearSchema
+//
+void CsvFile::ClearSchema()
+{
+    explicitSchema = CsvSchema();
+    hasExplicitSchema = false;
+    RowsChanged();
+}
+
+//
+// ParseTypedColumns
+// parse every typed column once.  the rows of each column are parsed in chunks on separate threads.
+//
+void CsvFile::ParseTypedColumns() const
+{
+    if (typedState.ready.load(memory_order_acquire))
+        return;
+    lock_guard<mutex> lock(typedState.lock);
+    if (typedState.ready.load(memory_order_relaxed))
+        return;     // parsed by another thread while this one waited
+
+    schema = hasExplicitSchema ? explicitSchema : CsvSchema::Infer(rows, schemaSampleRows);
+    typedColumns.clear();
+    typedColumns.resize(schema.columns.size());
+
+    for (unsigned int column = 0; column < schema.columns.size(); ++column) {
+        CsvTypedColumn& typed = typedColumns[column];
+        typed.schema = schema.columns[column];
+        if (typed.schema.type == CsvColumnType::String)
+            continue;
+
+        bool hasInts = typed.schema.type != CsvColumnType::Double;
+        if (hasInts)
+            typed.ints.resize(rows.size());
+        typed.doubles.resize(rows.size());
+        typed.valid.resize(rows.size());
+
+        ParallelForChunks(rows.size(), 16384, [&] (unsigned int, size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                int64_t intValue = 0;
+                double doubleValue = NAN;
+                if (column < rows[r].size())
+                    typed.valid[r] = CsvSchema::ParseCell(rows[r][column], typed.schema, &intValue, &doubleValue);
+                if (hasInts)
+                    typed.ints[r] = intValue;
+                typed.doubles[r] = doubleValue;
+            }
+        });
+    }
+    typedState.ready.store(true, memory_order_release);
+}
+
+//
+// TypedColumn
+//
+const CsvTypedColumn* CsvFile::TypedColumn(unsigned int column) const
+{
+    ParseTypedColumns();
+    if (column >= typedColumns.size() || typedColumns[column].schema.type == CsvColumnType::String)
+        return nullptr;
+    return &typedColumns[column];
+}
+
+//
+// typed cell accessors
+//
+int64_t CsvFile::GetInt64(size_t row, unsigned int column) const
+{
+    const CsvTypedColumn* typed = TypedColumn(column);
+    if (typed == nullptr || row >= rows.size() || !typed->valid[row])
+        return 0;
+    if (!typed->ints.empty())
+        return typed->ints[row];
+    return static_cast<int64_t>(typed->doubles[row]);
+}
+
+double CsvFile::GetDouble(size_t row, unsigned int column) const
+{
+    const CsvTypedColumn* typed = TypedColumn(column);
+    if (typed == nullptr || row >= rows.size())
+        return NAN;
+    return typed->doubles[row];
+}
+
+bool CsvFile::GetBool(size_t row, unsigned int column) const
+{
+    return GetInt64(row, column) != 0;
+}
+
+time_t CsvFile::GetTime(size_t row, unsigned int column) const
+{
+    return static_cast<time_t>(GetInt64(row, column));
+}
+
+bool CsvFile::IsValid(size_t row, unsigned int column) const
+{
+    const CsvTypedColumn* typed = TypedColumn(column);
+    return typed != nullptr && row < rows.size() && typed->valid[row] != 0;
+}
@@ -8,7 +8,34 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <string_view>
+#include <span>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+#include <atomic>
+#include <mutex>
 #include "Str.h"
+#include "CsvSchema.h"
+
+///
+/// @brief CsvSortType - how the cells of a sort column are compared
+///
+enum class CsvSortType {
+    Lexical,            ///< plain string compare
+    Numeric,            ///< compared as numbers.  cells that aren't numbers sort before all numbers.
+    CaseInsensitive,    ///< case insensitive string compare
+    Natural             ///< case insensitive and runs of digits compare by value.  ex: "track2" < "track10"
+};
+
+///
+/// @brief CsvSortKey - one column of a multi column sort
+///
+struct CsvSortKey {
+    unsigned int column {0};
+    bool ascending {true};
+    CsvSortType type {CsvSortType::Lexical};
+};
 
 /// 
 /// @brief CsvFile - reads a CSV (Comma Separated Values) file
@@ -22,10 +49,16 @@ struct CsvFile {
     CsvFile(const std::string& filepath) { Load(filepath); };
 
     bool Load(const std::string& filepath);
+
+    // clears and loads the rows from a binary cache file (see CsvCache.h) if it still matches the csv file.
+    // otherwise loads the csv file and writes a new cache.  cachePath "" uses CsvCache::DefaultPath(filepath).
+    // the cache matches if the csv file's size and time do.  verifyHash also compares the contents (reads the file).
+    bool LoadCached(const std::string& filepath, const std::string& cachePath = "", bool verifyHash = false);
     bool ReLoad();
     void Clear();
     bool SaveAs(const std:: string& filepath);
     bool Save();
+    bool Append(const std::vector<Tau::Strings>& newRows);  // add rows and append only them to the end of the csv file
 
     void AddString(const std::string& line);    // add a string of comma separated values
     bool AddRow(const Tau::Strings& row);            // add a row of strings
@@ -33,6 +66,17 @@ struct CsvFile {
     bool RemoveRow(const Tau::Strings& searchItems);    // remove the row where the first items in the row match the passed searchItems
     void Sort(unsigned int column = 0);
 
+    // stable sort of the rows by one or more columns.  the first key is the primary sort column.
+    // a row too short to have a key column sorts as if the cell were "".
+    void Sort(const std::vector<CsvSortKey>& keys);
+
+    // returns the sorted order of the rows without moving them.  rows[order[0]] is the first row in sorted order.
+    // large tables are merge sorted on multiple threads.
+    std::vector<size_t> SortedOrder(const std::vector<CsvSortKey>& keys) const;
+
+    // physically reorder the rows to match an order returned by SortedOrder()
+    void ApplyOrder(const std::vector<size_t>& order);
+
     // finds the first row where the passed rowItems match the first items in the row.
     // it does not fail if there are more items in the row than being passed.
     // returns the index of the first row that matches.  returns -1 if a row was not found with those items.
@@ -44,4 +88,70 @@ struct CsvFile {
     // find the max number of columns used and expand all rows to that size.
     // returns the number of columns
     size_t ExpandToSameNumberOfColumns();
+
+    // splits a csv line into cells.  handles double quoted cells.
+    // returns false if the line ends inside a double quoted cell (the cell continues on the next line).
+    static bool SplitCsvLine(const std::string& line, Tau::Strings* row);
+
+    // parses a cell as a number.  returns NaN if the whole cell isn't a number.
+    static double ParseNumber(std::string_view cell);
+
+                //*******************************
+                // Column types
+                //*******************************
+
+    // the column types.  inferred from schemaSampleRows rows unless set with SetSchema().
+    const CsvSchema& Schema() const;
+    void SetSchema(const CsvSchema& schema);    // use this schema instead of inferring one.  kept over Clear() and ReLoad().
+    void ClearSchema();                         // go back to inferring the schema
+    size_t schemaSampleRows {1000};
+
+    // call after changing rows directly so the typed values are parsed again.  the member functions do this for you.
+    void RowsChanged() { typedState.ready.store(false, std::memory_order_relaxed); }
+    bool TypedColumnsReady() const { return typedState.ready.load(std::memory_order_acquire); }
+
+    // typed values.  each column is parsed once, on separate threads, the first time typed values are used after a load
+    // or change.  a missing, empty or unparseable cell returns 0, NaN, false or 0.  the const accessors can be called
+    // from multiple threads: the first use parses under a lock and the others wait for it.
+    int64_t GetInt64(size_t row, unsigned int column) const;
+    double GetDouble(size_t row, unsigned int column) const;
+    bool GetBool(size_t row, unsigned int column) const;
+    time_t GetTime(size_t row, unsigned int column) const;
+    bool IsValid(size_t row, unsigned int column) const;       // true if the cell parsed as the column type
+
+    // the parsed values of a column, one per row.  empty for a String column (or int64_t of a Double column).
+    // int64_t has Int64, Bool and Time columns.  double has every type but String.
+    template <class T>
+    std::span<const T> ColumnSpan(unsigned int column) const {
+        static_assert(std::is_same_v<T, int64_t> || std::is_same_v<T, double>, "ColumnSpan is int64_t or double");
+        const CsvTypedColumn* typed = TypedColumn(column);
+        if (typed == nullptr)
+            return {};
+        if constexpr (std::is_same_v<T, int64_t>)
+            return typed->ints;
+        else
+            return typed->doubles;
+    }
+
+    // the parsed column.  nullptr for a String column.
+    const CsvTypedColumn* TypedColumn(unsigned int column) const;
+
+private:
+    void ParseTypedColumns() const;
+
+    CsvSchema explicitSchema;
+    bool hasExplicitSchema {false};
+
+    // built on first use by the const accessors, under the lock.  a copy of the CsvFile parses its own.
+    struct TypedState {
+        std::mutex lock;
+        std::atomic<bool> ready {false};
+
+        TypedState() {}
+        TypedState(const TypedState&) {}
+        TypedState& operator = (const TypedState&) { ready.store(false, std::memory_order_relaxed); return *this; }
+    };
+    mutable TypedState typedState;
+    mutable CsvSchema schema;
+    mutable std::vector<CsvTypedColumn> typedColumns;
 };
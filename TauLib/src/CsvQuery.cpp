@@ -0,0 +1,395 @@
+///
+/// @file
+/// @brief CPP file for CsvQuery, filter and aggregate queries over a CsvFile.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "CsvQuery.h"
+#include "CsvFile.h"
+#include "Tau_Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <regex>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+using namespace Tau;
+
+                //*******************************
+                // CsvAggregate
+                //*******************************
+
+//
+// Add - add a cell value.  NaN (not a number) only counts the row.
+//
+void CsvAggregate::Add(double value)
+{
+    ++count;
+    if (isnan(value))
+        return;
+    ++numericCount;
+    sum += value;
+    if (value < min)
+        min = value;
+    if (value > max)
+        max = value;
+}
+
+//
+// Merge - combine the aggregate of another set of rows
+//
+void CsvAggregate::Merge(const CsvAggregate& other)
+{
+    count += other.count;
+    numericCount += other.numericCount;
+    sum += other.sum;
+    if (other.min < min)
+        min = other.min;
+    if (other.max > max)
+        max = other.max;
+}
+
+                //*******************************
+                // Columns and Filters
+                //*******************************
+
+//
+// Column - one column read out of the rows.  text[row] is the cell, numbers[row] is the cell as a number or NaN.
+// numbers are the CsvFile's typed values when it has them, otherwise parsedNumbers.
+//
+struct CsvQuery::Column {
+    vector<string_view> text;
+    vector<double> parsedNumbers;
+    span<const double> numbers;
+    bool hasNumbers {false};
+};
+
+//
+// Filter - removes the rows that don't match from a chunk's list of rows.  one call per chunk, not per row.
+//
+struct CsvQuery::Filter {
+    enum class Kind { Equals, Range, Regex, In };
+
+    Kind kind {Kind::Equals};
+    unsigned int column {0};
+    const Column* data {nullptr};
+
+    string value;                           // Equals
+    double min {0}, max {0};                // Range
+    regex expr;                             // Regex
+    Strings values;                         // In
+    unordered_set<string_view> valueSet;    // In, views of values
+
+    bool NeedsNumbers() const { return kind == Kind::Range; }
+
+    template <class Keep>
+    static void KeepIf(vector<size_t>* chunkRows, Keep keep) {
+        auto end = remove_if(chunkRows->begin(), chunkRows->end(), [&] (size_t row) { return !keep(row); });
+        chunkRows->erase(end, chunkRows->end());
+    }
+
+    void Apply(vector<size_t>* chunkRows) const {
+        const auto& text = data->text;
+        const auto& numbers = data->numbers;
+        switch (kind) {
+        case Kind::Equals:
+            KeepIf(chunkRows, [&] (size_t row) { return text[row] == value; });
+            break;
+        case Kind::Range:
+            KeepIf(chunkRows, [&] (size_t row) { return numbers[row] >= min && numbers[row] <= max; });    // NaN fails both
+            break;
+        case Kind::Regex:
+            KeepIf(chunkRows, [&] (size_t row) { return regex_search(text[row].begin(), text[row].end(), expr); });
+            break;
+        case Kind::In:
+            KeepIf(chunkRows, [&] (size_t row) { return valueSet.count(text[row]) != 0; });
+            break;
+        }
+    }
+};
+
+                //*******************************
+                // CsvQuery
+                //*******************************
+
+CsvQuery::CsvQuery(const CsvFile& _csv) : csv(_csv) {}
+CsvQuery::~CsvQuery() {}
+
+//
+// GetColumn - read a column out of the rows the first time it is used
+//
+CsvQuery::Column& CsvQuery::GetColumn(unsigned int column, bool needNumbers)
+{
+    auto& slot = columns[column];
+    if (!slot) {
+        slot = make_unique<Column>();
+        slot->text.resize(csv.rows.size());
+        ParallelForChunks(csv.rows.size(), minRowsPerThread, [&] (unsigned int, size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                if (column < csv.rows[r].size())
+                    slot->text[r] = csv.rows[r][column];
+            }
+        });
+    }
+    if (needNumbers && !slot->hasNumbers) {
+        // the CsvFile's typed values, parsed now if they haven't been.  a Time column gives time_t seconds, a Bool
+        // column 0 or 1.  only a String column is parsed here.
+        if (csv.TypedColumn(column) != nullptr) {
+            slot->numbers = csv.ColumnSpan<double>(column);
+        } else {
+            slot->parsedNumbers.resize(csv.rows.size());
+            ParallelForChunks(csv.rows.size(), minRowsPerThread, [&] (unsigned int, size_t begin, size_t end) {
+                for (size_t r = begin; r < end; ++r)
+                    slot->parsedNumbers[r] = CsvFile::ParseNumber(slot->text[r]);
+            });
+            slot->numbers = slot->parsedNumbers;
+        }
+        slot->hasNumbers = true;
+    }
+    return *slot;
+}
+
+//
+// AddFilter
+//
+void CsvQuery::AddFilter(unique_ptr<Filter> filter)
+{
+    filters.emplace_back(std::move(filter));
+    matchingRowsValid = false;
+}
+
+CsvQuery& CsvQuery::WhereEquals(unsigned int column, const string& value)
+{
+    auto filter = make_unique<Filter>();
+    filter->kind = Filter::Kind::Equals;
+    filter->column = column;
+    filter->value = value;
+    AddFilter(std::move(filter));
+    return *this;
+}
+
+CsvQuery& CsvQuery::WhereRange(unsigned int column, double min, double max)
+{
+    auto filter = make_unique<Filter>();
+    filter->kind = Filter::Kind::Range;
+    filter->column = column;
+    filter->min = min;
+    filter->max = max;
+    AddFilter(std::move(filter));
+    return *this;
+}
+
+CsvQuery& CsvQuery::WhereRegex(unsigned int column, const string& regularExpression)
+{
+    auto filter = make_unique<Filter>();
+    filter->kind = Filter::Kind::Regex;
+    filter->column = column;
+    filter->expr = regex(regularExpression, regex::optimize);
+    AddFilter(std::move(filter));
+    return *this;
+}
+
+CsvQuery& CsvQuery::WhereIn(unsigned int column, const Strings& values)
+{
+    auto filter = make_unique<Filter>();
+    filter->kind = Filter::Kind::In;
+    filter->column = column;
+    filter->values = values;
+    for (const string& value : filter->values)
+        filter->valueSet.insert(value);
+    AddFilter(std::move(filter));
+    return *this;
+}
+
+CsvQuery& CsvQuery::ClearFilters()
+{
+    filters.clear();
+    matchingRowsValid = false;
+    return *this;
+}
+
+//
+// ForEachChunk - calls fn(chunk, begin, end) for chunks of the matching rows on separate threads
+//
+template <class Fn>
+unsigned int CsvQuery::ForEachChunk(Fn&& fn)
+{
+    const vector<size_t>& rows = Rows();
+    return ParallelForChunks(rows.size(), minRowsPerThread, fn);
+}
+
+//
+// Rows
+// every chunk of rows runs all the filters a column at a time, then the chunk results are joined in order
+//
+const vector<size_t>& CsvQuery::Rows()
+{
+    if (matchingRowsValid)
+        return matchingRows;
+
+    // read out the columns before the threads start
+    for (auto& filter : filters)
+        filter->data = &GetColumn(filter->column, filter->NeedsNumbers());
+
+    const size_t rowCount = csv.rows.size();
+    vector<vector<size_t>> chunkRows(ParallelThreadCount(rowCount, minRowsPerThread));
+    unsigned int chunks = ParallelForChunks(rowCount, minRowsPerThread, [&] (unsigned int chunk, size_t begin, size_t end) {
+        vector<size_t>& rows = chunkRows[chunk];
+        rows.resize(end - begin);
+        iota(rows.begin(), rows.end(), begin);
+        for (const auto& filter : filters) {
+            if (rows.empty())
+                break;
+            filter->Apply(&rows);
+        }
+    });
+
+    matchingRows.clear();
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+        matchingRows.insert(matchingRows.end(), chunkRows[chunk].begin(), chunkRows[chunk].end());
+    matchingRowsValid = true;
+    return matchingRows;
+}
+
+//
+// Select - the matching rows with only the passed columns
+//
+vector<Strings> CsvQuery::Select(const vector<unsigned int>& selectColumns)
+{
+    const vector<size_t>& rows = Rows();
+    vector<Strings> result(rows.size());
+    ParallelForChunks(rows.size(), minRowsPerThread, [&] (unsigned int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Strings& row = csv.rows[rows[i]];
+            result[i].reserve(selectColumns.size());
+            for (unsigned int column : selectColumns)
+                result[i].emplace_back(column < row.size() ? row[column] : string());
+        }
+    });
+    return result;
+}
+
+//
+// Aggregate
+//
+CsvAggregate CsvQuery::Aggregate(unsigned int valueColumn)
+{
+    span<const double> numbers = GetColumn(valueColumn, true).numbers;
+    const vector<size_t>& rows = Rows();
+
+    vector<CsvAggregate> partial(ParallelThreadCount(rows.size(), minRowsPerThread));
+    unsigned int chunks = ForEachChunk([&] (unsigned int chunk, size_t begin, size_t end) {
+        CsvAggregate& agg = partial[chunk];
+        for (size_t i = begin; i < end; ++i)
+            agg.Add(numbers[rows[i]]);
+    });
+
+    CsvAggregate result;
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+        result.Merge(partial[chunk]);
+    return result;
+}
+
+//
+// GroupBy
+// each chunk builds its own hash table of groups.  the tables are merged and sorted by key at the end.
+//
+vector<CsvGroup> CsvQuery::GroupBy(const vector<unsigned int>& keyColumns, unsigned int valueColumn)
+{
+    vector<const vector<string_view>*> keyText;
+    for (unsigned int column : keyColumns)
+        keyText.push_back(&GetColumn(column, false).text);
+    span<const double> numbers = GetColumn(valueColumn, true).numbers;
+    const vector<size_t>& rows = Rows();
+
+    // each key cell is length prefixed, so any bytes in the cells can't make two keys the same
+    using GroupMap = unordered_map<string, CsvAggregate>;
+    vector<GroupMap> partial(ParallelThreadCount(rows.size(), minRowsPerThread));
+    unsigned int chunks = ForEachChunk([&] (unsigned int chunk, size_t begin, size_t end) {
+        GroupMap& groups = partial[chunk];
+        string key;
+        for (size_t i = begin; i < end; ++i) {
+            size_t row = rows[i];
+            key.clear();
+            for (const vector<string_view>* text : keyText) {
+                string_view cell = (*text)[row];
+                uint32_t length = static_cast<uint32_t>(cell.size());
+                key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                key.append(cell);
+            }
+            auto it = groups.find(key);
+            if (it == groups.end())
+                it = groups.emplace(key, CsvAggregate()).first;
+            it->second.Add(numbers[row]);
+        }
+    });
+
+    // sorted by the cells, not the encoded keys
+    map<vector<string>, CsvAggregate> merged;
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk) {
+        for (auto& [key, agg] : partial[chunk]) {
+            vector<string> cells;
+            cells.reserve(keyColumns.size());
+            for (size_t at = 0; at < key.size(); ) {
+                uint32_t length;
+                memcpy(&length, key.data() + at, sizeof(length));
+                at += sizeof(length);
+                cells.emplace_back(key, at, length);
+                at += length;
+            }
+            merged[move(cells)].Merge(agg);
+        }
+    }
+
+    vector<CsvGroup> result;
+    result.reserve(merged.size());
+    for (auto& [keys, agg] : merged) {
+        CsvGroup& group = result.emplace_back();
+        group.keys = keys;
+        group.values = agg;
+    }
+    return result;
+}
+
+//
+// TopK
+// each chunk keeps its own best k, then the best k of those is returned.  ties go to the earlier row.
+//
+vector<size_t> CsvQuery::TopK(unsigned int column, size_t k, bool largest)
+{
+    span<const double> numbers = GetColumn(column, true).numbers;
+    const vector<size_t>& rows = Rows();
+
+    auto better = [&] (size_t row1, size_t row2) {
+        double n1 = numbers[row1];
+        double n2 = numbers[row2];
+        if (n1 != n2)
+            return largest ? (n1 > n2) : (n1 < n2);
+        return row1 < row2;
+    };
+    auto keepBest = [&] (vector<size_t>* candidates) {
+        size_t keep = min(k, candidates->size());
+        partial_sort(candidates->begin(), candidates->begin() + keep, candidates->end(), better);
+        candidates->resize(keep);
+    };
+
+    vector<vector<size_t>> partial(ParallelThreadCount(rows.size(), minRowsPerThread));
+    unsigned int chunks = ForEachChunk([&] (unsigned int chunk, size_t begin, size_t end) {
+        vector<size_t>& candidates = partial[chunk];
+        for (size_t i = begin; i < end; ++i) {
+            if (!isnan(numbers[rows[i]]))
+                candidates.push_back(rows[i]);
+        }
+        keepBest(&candidates);
+    });
+
+    vector<size_t> result;
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+        result.insert(result.end(), partial[chunk].begin(), partial[chunk].end());
+    keepBest(&result);
+    return result;
+}
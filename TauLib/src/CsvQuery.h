@@ -0,0 +1,112 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for CsvQuery, filter and aggregate queries over a CsvFile.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <limits>
+#include "Str.h"
+
+struct CsvFile;
+
+///
+/// @brief CsvAggregate - count/sum/min/max/avg of a numeric column
+///
+struct CsvAggregate {
+    size_t count {0};           ///< matching rows
+    size_t numericCount {0};    ///< matching rows where the cell is a number.  sum/min/max/avg are over these.
+    double sum {0.0};
+    double min { std::numeric_limits<double>::infinity() };
+    double max { -std::numeric_limits<double>::infinity() };
+
+    double Avg() const { return numericCount ? sum / numericCount : 0.0; }
+    void Add(double value);
+    void Merge(const CsvAggregate& other);
+};
+
+///
+/// @brief CsvGroup - one group of a GroupBy
+///
+struct CsvGroup {
+    Tau::Strings keys;          ///< the values of the key columns for this group
+    CsvAggregate values;        ///< aggregate of the value column over the rows in the group
+};
+
+///
+/// @brief CsvQuery - filter, project, group and aggregate the rows of a CsvFile.
+/// @remark Filters are and'ed.  They run a column at a time over chunks of rows, and the chunks run on separate threads.
+/// @remark Each column a query uses is read out of the rows once (and numbers parsed once) when first needed.
+/// @remark Numbers come from the CsvFile's typed columns (see CsvFile::ColumnSpan), parsed if they haven't been.
+///         A Time column is a number of seconds and a Bool column 0 or 1.  A String column's cells are parsed as numbers.
+/// @remark The CsvFile must not change while the query is in use.  A missing cell in a short row is "" and not a number.
+/// @code
+///     CsvQuery query(csv);
+///     query.WhereIn(2, { "snes", "nes" }).WhereRange(5, 1990, 1995);
+///     auto groups = query.GroupBy(2, 7);      // count/sum/min/max/avg of column 7 per value in column 2
+/// @endcode
+///
+struct CsvQuery {
+    CsvQuery(const CsvFile& _csv);
+    ~CsvQuery();
+
+    CsvQuery(const CsvQuery&) = delete;
+    CsvQuery& operator = (const CsvQuery&) = delete;
+
+                //*******************************
+                // Filters
+                //*******************************
+
+    /// @brief rows where the cell equals the value
+    CsvQuery& WhereEquals(unsigned int column, const std::string& value);
+    /// @brief rows where the cell is a number between min and max (inclusive)
+    CsvQuery& WhereRange(unsigned int column, double min, double max);
+    /// @brief rows where the regular expression is found in the cell
+    CsvQuery& WhereRegex(unsigned int column, const std::string& regularExpression);
+    /// @brief rows where the cell is one of the values
+    CsvQuery& WhereIn(unsigned int column, const Tau::Strings& values);
+    /// @brief remove all the filters
+    CsvQuery& ClearFilters();
+
+                //*******************************
+                // Results
+                //*******************************
+
+    /// @brief the indexes of the matching rows in row order
+    const std::vector<size_t>& Rows();
+    /// @brief the number of matching rows
+    size_t Count() { return Rows().size(); }
+    /// @brief the matching rows with only the passed columns (in the passed order)
+    std::vector<Tau::Strings> Select(const std::vector<unsigned int>& columns);
+    /// @brief count/sum/min/max/avg of a column over the matching rows
+    CsvAggregate Aggregate(unsigned int valueColumn);
+    /// @brief aggregate of valueColumn for each distinct combination of the key columns.  sorted by the keys.
+    std::vector<CsvGroup> GroupBy(const std::vector<unsigned int>& keyColumns, unsigned int valueColumn);
+    std::vector<CsvGroup> GroupBy(unsigned int keyColumn, unsigned int valueColumn)
+        { return GroupBy(std::vector<unsigned int> { keyColumn }, valueColumn); }
+    /// @brief the indexes of the k matching rows with the largest (or smallest) numbers in the column.  best first.
+    std::vector<size_t> TopK(unsigned int column, size_t k, bool largest = true);
+
+    size_t minRowsPerThread {16384};    ///< chunk size for spreading the rows over threads
+
+private:
+    struct Column;
+    struct Filter;
+
+    Column& GetColumn(unsigned int column, bool needNumbers);
+    void AddFilter(std::unique_ptr<Filter> filter);
+
+    template <class Fn>
+    unsigned int ForEachChunk(Fn&& fn);
+
+    const CsvFile& csv;
+    std::map<unsigned int, std::unique_ptr<Column>> columns;
+    std::vector<std::unique_ptr<Filter>> filters;
+    std::vector<size_t> matchingRows;
+    bool matchingRowsValid {false};
+};
@@ -0,0 +1,311 @@
+///
+/// @file
+/// @brief CPP file for CsvSchema, the column types of a CsvFile.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "CsvSchema.h"
+#include "CsvFile.h"
+#include "Tau_Time.h"
+#include <algorithm>
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <ctime>
+
+using namespace std;
+using namespace Tau;
+
+//
+// SetColumn
+//
+void CsvSchema::SetColumn(unsigned int column, CsvColumnType type, const string& timeFormat)
+{
+    if (column >= columns.size())
+        columns.resize(column + 1);
+    columns[column] = CsvColumnSchema { type, timeFormat };
+}
+
+//
+// TimeFormats
+//
+const Strings& CsvSchema::TimeFormats()
+{
+    static const Strings formats {
+        "%Y-%m-%d %H:%M:%S",
+        "%Y-%m-%dT%H:%M:%S",
+        "%Y-%m-%d",
+        "%m/%d/%Y %H:%M:%S",
+        "%m/%d/%Y",
+        "",                     // ctime() format.  the Time_t_ToString() default.
+    };
+    return formats;
+}
+
+//
+// parse helpers
+//
+static bool parseBool(string_view cell, bool* value)
+{
+    static const struct { const char* word; bool value; } words[] {
+        { "true", true }, { "false", false }, { "yes", true }, { "no", false }, { "on", true }, { "off", false },
+    };
+    for (const auto& w : words) {
+        string_view word(w.word);
+        if (cell.size() != word.size())
+            continue;
+        size_t i = 0;
+        while (i < cell.size() && tolower(static_cast<unsigned char>(cell[i])) == word[i])
+            ++i;
+        if (i == cell.size()) {
+            *value = w.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseInt64(string_view cell, int64_t* value)
+{
+    if (!cell.empty() && cell[0] == '+')
+        cell.remove_prefix(1);
+    auto [ptr, ec] = from_chars(cell.data(), cell.data() + cell.size(), *value);
+    return !cell.empty() && ec == errc() && ptr == cell.data() + cell.size();
+}
+
+// the fields of a time in the format.  the directives of TimeFormats() are read here, the same as get_time would, without
+// a stream per cell.  false if the format has any other directive (unsupported is set) or the cell doesn't match.
+static bool parseTimeFields(string_view cell, string_view format, tm* fields, bool* unsupported)
+{
+    static const char* const dayNames[] { "sun", "mon", "tue", "wed", "thu", "fri", "sat" };
+    static const char* const monthNames[] { "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec" };
+    auto isSpace = [] (char c) { return isspace(static_cast<unsigned char>(c)) != 0; };
+    auto readNumber = [&] (size_t* pos, int maxDigits, int low, int high, int* value) {
+        while (*pos < cell.size() && isSpace(cell[*pos]))
+            ++*pos;
+        int digits = 0, number = 0;
+        while (digits < maxDigits && *pos < cell.size() && isdigit(static_cast<unsigned char>(cell[*pos]))) {
+            number = number * 10 + (cell[(*pos)++] - '0');
+            ++digits;
+        }
+        *value = number;
+        return digits != 0 && number >= low && number <= high;
+    };
+    auto readName = [&] (size_t* pos, const char* const* names, int count, int* value) {
+        for (int i = 0; i < count; ++i) {
+            if (*pos + 3 <= cell.size() && equal(cell.begin() + *pos, cell.begin() + *pos + 3, names[i],
+                                                  [] (char a, char b) { return tolower(static_cast<unsigned char>(a)) == b; })) {
+                *pos += 3;
+                *value = i;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    *fields = tm {};
+    fields->tm_mday = 1;
+    size_t pos = 0;
+    for (size_t f = 0; f < format.size(); ++f) {
+        char c = format[f];
+        if (isSpace(c)) {
+            while (pos < cell.size() && isSpace(cell[pos]))
+                ++pos;
+            continue;
+        }
+        if (c != '%') {
+            if (pos >= cell.size() || cell[pos] != c)
+                return false;
+            ++pos;
+            continue;
+        }
+        if (++f == format.size()) {
+            *unsupported = true;
+            return false;
+        }
+        int value = 0;
+        bool ok;
+        switch (format[f]) {
+        case 'Y': ok = readNumber(&pos, 4, 0, 9999, &value); fields->tm_year = value - 1900; break;
+        case 'm': ok = readNumber(&pos, 2, 1, 12, &value); fields->tm_mon = value - 1; break;
+        case 'd': ok = readNumber(&pos, 2, 1, 31, &value); fields->tm_mday = value; break;
+        case 'H': ok = readNumber(&pos, 2, 0, 23, &value); fields->tm_hour = value; break;
+        case 'M': ok = readNumber(&pos, 2, 0, 59, &value); fields->tm_min = value; break;
+        case 'S': ok = readNumber(&pos, 2, 0, 60, &value); fields->tm_sec = value; break;
+        case 'a': ok = readName(&pos, dayNames, 7, &value); fields->tm_wday = value; break;
+        case 'b': ok = readName(&pos, monthNames, 12, &value); fields->tm_mon = value; break;
+        default:
+            *unsupported = true;
+            return false;
+        }
+        if (!ok)
+            return false;
+    }
+    while (pos < cell.size() && isSpace(cell[pos]))
+        ++pos;
+    return pos == cell.size();      // no extra text after the time
+}
+
+static bool parseTime(string_view cell, const string& format, time_t* value)
+{
+    // quick reject.  every supported format starts with a digit or a day name.
+    if (cell.empty() || !isalnum(static_cast<unsigned char>(cell[0])))
+        return false;
+
+    tm fields;
+    bool unsupported = false;
+    if (!parseTimeFields(cell, format.empty() ? string_view("%a %b %d %H:%M:%S %Y") : string_view(format), &fields,
+                         &unsupported))
+        return unsupported && StringToTime_t(string(cell), value, format);
+
+    // mktime is slow (it looks up the time zone each call).  the local time of the start of the hour is kept per
+    // thread, and a column of times mostly shares hours.  daylight saving time changes on the hour.
+    struct HourStart {
+        int year {-1}, month {0}, day {0}, hour {0};
+        time_t start {0};
+    };
+    thread_local HourStart last;
+    if (fields.tm_year != last.year || fields.tm_mon != last.month || fields.tm_mday != last.day ||
+        fields.tm_hour != last.hour) {
+        tm hour = fields;
+        hour.tm_min = 0;
+        hour.tm_sec = 0;
+        hour.tm_isdst = -1;     // let mktime work out daylight saving time
+        time_t start = mktime(&hour);
+        if (start == -1)
+            return false;
+        last = HourStart { fields.tm_year, fields.tm_mon, fields.tm_mday, fields.tm_hour, start };
+    }
+    *value = last.start + fields.tm_min * 60 + fields.tm_sec;
+    return true;
+}
+
+//
+// ParseCell
+//
+bool CsvSchema::ParseCell(string_view cell, const CsvColumnSchema& schema, int64_t* intValue, double* doubleValue)
+{
+    *intValue = 0;
+    *doubleValue = NAN;
+    if (cell.empty())
+        return false;
+
+    switch (schema.type) {
+    case CsvColumnType::Int64:
+        if (!parseInt64(cell, intValue))
+            return false;
+        *doubleValue = static_cast<double>(*intValue);
+        return true;
+
+    case CsvColumnType::Double:
+        *doubleValue = CsvFile::ParseNumber(cell);
+        return !isnan(*doubleValue);
+
+    case CsvColumnType::Bool: {
+        bool value = false;
+        if (!parseBool(cell, &value))
+            return false;
+        *intValue = value ? 1 : 0;
+        *doubleValue = static_cast<double>(*intValue);
+        return true;
+    }
+
+    case CsvColumnType::Time: {
+        time_t value = 0;
+        if (!parseTime(cell, schema.timeFormat, &value))
+            return false;
+        *intValue = static_cast<int64_t>(value);
+        *doubleValue = static_cast<double>(*intValue);
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+//
+// Infer
+// each sampled cell is classed as bool, int, number, time or other.  a column gets the one type that covers
+// all its non-empty cells.  a time column keeps the first format that matched every time cell.
+//
+CsvSchema CsvSchema::Infer(const vector<Strings>& rows, size_t sampleRows)
+{
+    struct ColumnGuess {
+        bool sawBool {false}, sawInt {false}, sawDouble {false}, sawTime {false}, sawOther {false};
+        vector<bool> formatOk;      // the time formats that matched every time cell so far
+    };
+
+    size_t sampleCount = (sampleRows == 0 || sampleRows > rows.size()) ? rows.size() : sampleRows;
+    const Strings& formats = TimeFormats();
+    vector<ColumnGuess> guesses;
+
+    for (size_t s = 0; s < sampleCount; ++s) {
+        const Strings& row = rows[s * rows.size() / sampleCount];     // spread over the whole file
+        if (row.size() > guesses.size())
+            guesses.resize(row.size());
+
+        for (size_t column = 0; column < row.size(); ++column) {
+            const string& cell = row[column];
+            ColumnGuess& guess = guesses[column];
+            if (cell.empty() || guess.sawOther)
+                continue;
+
+            bool b;
+            int64_t i;
+            if (parseBool(cell, &b)) {
+                guess.sawBool = true;
+                continue;
+            }
+            if (parseInt64(cell, &i)) {
+                guess.sawInt = true;
+                continue;
+            }
+            if (!isnan(CsvFile::ParseNumber(cell))) {
+                guess.sawDouble = true;
+                continue;
+            }
+
+            if (guess.formatOk.empty())
+                guess.formatOk.assign(formats.size(), true);
+            bool anyFormat = false;
+            for (size_t f = 0; f < formats.size(); ++f) {
+                time_t t;
+                if (guess.formatOk[f])
+                    guess.formatOk[f] = parseTime(cell, formats[f], &t);
+                anyFormat = anyFormat || guess.formatOk[f];
+            }
+            if (anyFormat)
+                guess.sawTime = true;
+            else
+                guess.sawOther = true;
+        }
+    }
+
+    CsvSchema schema;
+    schema.columns.resize(guesses.size());
+    for (size_t column = 0; column < guesses.size(); ++column) {
+        const ColumnGuess& guess = guesses[column];
+        CsvColumnSchema& result = schema.columns[column];
+        bool sawNumber = guess.sawInt || guess.sawDouble;
+
+        if (guess.sawOther)
+            result.type = CsvColumnType::String;
+        else if (guess.sawBool && !sawNumber && !guess.sawTime)
+            result.type = CsvColumnType::Bool;
+        else if (guess.sawInt && !guess.sawDouble && !guess.sawBool && !guess.sawTime)
+            result.type = CsvColumnType::Int64;
+        else if (guess.sawDouble && !guess.sawBool && !guess.sawTime)
+            result.type = CsvColumnType::Double;
+        else if (guess.sawTime && !sawNumber && !guess.sawBool) {
+            result.type = CsvColumnType::Time;
+            for (size_t f = 0; f < formats.size(); ++f) {
+                if (guess.formatOk[f]) {
+                    result.timeFormat = formats[f];
+                    break;
+                }
+            }
+        }
+    }
+    return schema;
+}
@@ -0,0 +1,80 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for CsvSchema, the column types of a CsvFile.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "Str.h"
+
+///
+/// @brief CsvColumnType - the type of the values in a column
+///
+enum class CsvColumnType {
+    String,     ///< anything.  no typed values.
+    Int64,      ///< whole numbers
+    Double,     ///< numbers
+    Bool,       ///< true/false, yes/no, on/off (any case)
+    Time        ///< a local date/time in one of the Tau_Time strftime formats
+};
+
+///
+/// @brief CsvColumnSchema - the type of one column
+///
+struct CsvColumnSchema {
+    CsvColumnType type {CsvColumnType::String};
+    std::string timeFormat;     ///< strftime style format of a Time column.  "" is the ctime() format.
+
+    bool operator == (const CsvColumnSchema& other) const = default;
+};
+
+///
+/// @brief CsvSchema - the types of the columns of a CsvFile.  columns past the end of the schema are String.
+///
+struct CsvSchema {
+    std::vector<CsvColumnSchema> columns;
+
+    bool operator == (const CsvSchema& other) const = default;
+
+    /// @brief the schema of a column.  String if the column isn't in the schema.
+    CsvColumnSchema Column(unsigned int column) const { return (column < columns.size()) ? columns[column] : CsvColumnSchema(); }
+
+    /// @brief set the type of a column.  grows the schema if needed.
+    void SetColumn(unsigned int column, CsvColumnType type, const std::string& timeFormat = "");
+
+    ///
+    /// @brief Infer - guess the column types from a sample of the rows
+    /// @param rows the rows of a CsvFile
+    /// @param sampleRows the number of rows looked at.  they are spread evenly over the file.  0 == all rows.
+    /// @return the narrowest type that fits every non-empty sampled cell of each column: Bool, Int64, Double, Time, else String
+    ///
+    static CsvSchema Infer(const std::vector<Tau::Strings>& rows, size_t sampleRows = 1000);
+
+    ///
+    /// @brief ParseCell - parse a cell as the column type
+    /// @param cell the text of the cell
+    /// @param schema the column type
+    /// @param intValue set for Int64, Bool (0 or 1) and Time (time_t) columns
+    /// @param doubleValue set for every type but String
+    /// @return false if the cell is empty or isn't the column type
+    ///
+    static bool ParseCell(std::string_view cell, const CsvColumnSchema& schema, int64_t* intValue, double* doubleValue);
+
+    /// @brief the time formats tried by Infer, most specific first
+    static const Tau::Strings& TimeFormats();
+};
+
+///
+/// @brief CsvTypedColumn - the parsed values of one column.  one entry per row.
+/// @remark ints has the Int64, Bool and Time values.  doubles has the values of every type but String, NaN where not valid.
+///
+struct CsvTypedColumn {
+    CsvColumnSchema schema;
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    std::vector<uint8_t> valid;     ///< 0 where the cell is missing, empty or doesn't parse
+};
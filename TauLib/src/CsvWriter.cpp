@@ -0,0 +1,227 @@
+///
+/// @file
+/// @brief CPP file for CsvWriter class.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "CsvWriter.h"
+#include <charconv>
+#include <algorithm>
+#include "sep.h"
+#include "Tau_Parallel.h"
+
+using namespace std;
+using namespace Tau;
+
+//
+// Open
+// append = true positions at the end of an existing file.  the existing contents are not rewritten.
+//
+bool CsvWriter::Open(const string& filepath, bool append)
+{
+    Close();
+    writeFailed = false;
+    rowStarted = false;
+    buffer.clear();
+    buffer.reserve(options.bufferSize + 1024);
+
+    // unbuffered.  the full buffers are handed to the OS with one write each.
+    ofile.rdbuf()->pubsetbuf(nullptr, 0);
+    ofile.open(filepath, ios_base::out | ios_base::binary | (append ? ios_base::app : ios_base::trunc));
+    return ofile.is_open();
+}
+
+//
+// Close
+//
+bool CsvWriter::Close()
+{
+    if (!ofile.is_open())
+        return !writeFailed;
+
+    if (rowStarted)
+        EndRow();
+    Flush();
+    ofile.close();
+    return !writeFailed;
+}
+
+//
+// StartCell - add the separator if this isn't the first cell in the row
+//
+void CsvWriter::StartCell()
+{
+    if (rowStarted)
+        buffer.append(options.separator);
+    rowStarted = true;
+}
+
+//
+// Cell
+//
+CsvWriter& CsvWriter::Cell(string_view value)
+{
+    StartCell();
+    AppendCell(&buffer, value);
+    return *this;
+}
+
+CsvWriter& CsvWriter::Cell(int64_t value)
+{
+    StartCell();
+    char buf[32];
+    auto result = to_chars(buf, buf + sizeof(buf), value);
+    buffer.append(buf, result.ptr);
+    return *this;
+}
+
+CsvWriter& CsvWriter::Cell(double value)
+{
+    StartCell();
+    char buf[64];
+    auto result = to_chars(buf, buf + sizeof(buf), value);     // shortest text that reads back as the same double
+    buffer.append(buf, result.ptr);
+    return *this;
+}
+
+//
+// EndRow
+//
+bool CsvWriter::EndRow()
+{
+    buffer.append(lineEnding);
+    rowStarted = false;
+    if (buffer.size() >= options.bufferSize)
+        return Flush();
+    return !writeFailed;
+}
+
+//
+// WriteRow
+//
+bool CsvWriter::WriteRow(const Strings& row)
+{
+    for (const string& item : row)
+        Cell(item);
+    return EndRow();
+}
+
+//
+// FormatRows - format rows [begin, end) onto the end of out
+//
+void CsvWriter::FormatRows(string* out, const vector<Strings>& rows, size_t begin, size_t end) const
+{
+    for (size_t r = begin; r < end; ++r) {
+        bool firstItem = true;
+        for (const string& item : rows[r]) {
+            if (!firstItem)
+                out->append(options.separator);
+            AppendCell(out, item);
+            firstItem = false;
+        }
+        out->append(lineEnding);
+    }
+}
+
+//
+// WriteRows
+// rows are formatted in batches.  each thread formats a contiguous chunk of the batch into its own buffer
+// and the buffers are then written in chunk order, so the file has the rows in their original order.
+//
+bool CsvWriter::WriteRows(const vector<Strings>& rows)
+{
+    if (rowStarted)
+        EndRow();
+    Flush();            // anything written a cell at a time goes first
+
+    unsigned int threads = ParallelThreadCount(rows.size(), options.rowsPerChunk, options.maxThreads);
+    if (threads <= 1) {
+        // no threads.  format straight into the row buffer.
+        for (size_t r = 0; r < rows.size(); ++r) {
+            FormatRows(&buffer, rows, r, r + 1);
+            if (buffer.size() >= options.bufferSize)
+                Flush();
+        }
+        return Flush();
+    }
+
+    if (chunkBuffers.size() < threads)
+        chunkBuffers.resize(threads);
+
+    size_t batchRows = options.rowsPerChunk * threads;
+    for (size_t batchBegin = 0; batchBegin < rows.size() && !writeFailed; batchBegin += batchRows) {
+        size_t batchCount = min(batchRows, rows.size() - batchBegin);
+        unsigned int chunks = ParallelForChunks(batchCount, options.rowsPerChunk, [&] (unsigned int chunk, size_t begin, size_t end) {
+            string& out = chunkBuffers[chunk];
+            out.clear();        // keeps its capacity from the last batch
+            FormatRows(&out, rows, batchBegin + begin, batchBegin + end);
+        }, threads);
+
+        for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+            WriteBuffer(chunkBuffers[chunk]);
+    }
+
+    return !writeFailed;
+}
+
+//
+// Flush
+//
+bool CsvWriter::Flush()
+{
+    WriteBuffer(buffer);
+    buffer.clear();
+    return !writeFailed;
+}
+
+//
+// WriteBuffer - one write call for the whole buffer
+//
+bool CsvWriter::WriteBuffer(const string& buf)
+{
+    if (buf.empty())
+        return !writeFailed;
+    if (!ofile.is_open() || !ofile.write(buf.data(), static_cast<streamsize>(buf.size())))
+        writeFailed = true;
+    return !writeFailed;
+}
+
+//
+// NeedsQuotes
+// true if the cell has a comma, double quote or line break, or would be changed by the trim and comment
+// check CsvFile does when it reads the line.  empty cells are written as "" because CsvFile skips
+// unquoted empty cells.
+//
+bool CsvWriter::NeedsQuotes(string_view value)
+{
+    if (value.empty())
+        return true;
+    if (value.find_first_of(",\"\r\n") != string_view::npos)
+        return true;
+    if (isspace(static_cast<unsigned char>(value.front())) || isspace(static_cast<unsigned char>(value.back())))
+        return true;
+    return value.front() == ';';
+}
+
+//
+// AppendCell
+// appends the cell, double quoting it and doubling any quotes inside it if needed
+//
+void CsvWriter::AppendCell(string* out, string_view value)
+{
+    if (!NeedsQuotes(value)) {
+        out->append(value);
+        return;
+    }
+
+    out->push_back('"');
+    size_t start = 0;
+    size_t quote;
+    while ((quote = value.find('"', start)) != string_view::npos) {
+        out->append(value.substr(start, quote + 1 - start));
+        out->push_back('"');
+        start = quote + 1;
+    }
+    out->append(value.substr(start));
+    out->push_back('"');
+}
@@ -0,0 +1,82 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for CsvWriter class.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "Str.h"
+
+///
+/// @brief CsvWriter - writes CSV (Comma Separated Values) files through large reusable buffers.
+/// @remark Cells are only double quoted when they have to be (empty, a comma, quote, line break, leading/trailing whitespace,
+/// or a leading ';' that CsvFile would read as a comment).  Numbers are formatted with std::to_chars.
+/// @remark The file is opened unbuffered so each full buffer goes to the OS as a single write.
+///
+struct CsvWriter {
+    ///
+    /// @brief CsvWriter options
+    ///
+    struct Options {
+        std::string separator {", "};       ///< put between cells.  ", " matches what CsvFile has always written.
+        size_t bufferSize {1 << 20};        ///< bytes formatted before they are written to the file
+        size_t rowsPerChunk {4096};         ///< WriteRows() formats chunks of this many rows on separate threads
+        unsigned int maxThreads {0};        ///< WriteRows() thread limit.  0 == the number of hardware threads.
+    };
+
+    CsvWriter() {}
+    CsvWriter(const Options& _options) : options(_options) {}
+    CsvWriter(const std::string& filepath, bool append = false) { Open(filepath, append); }
+    ~CsvWriter() { Close(); }
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator = (const CsvWriter&) = delete;
+
+    /// @brief Open the file.  append = true adds to the end of an existing file without rewriting it.
+    bool Open(const std::string& filepath, bool append = false);
+    /// @brief Flush and close the file.  returns false if any write failed.
+    bool Close();
+    bool IsOpen() const { return ofile.is_open(); }
+
+    /// @brief add a cell to the current row
+    CsvWriter& Cell(std::string_view value);
+    CsvWriter& Cell(const char* value) { return Cell(std::string_view(value)); }
+    CsvWriter& Cell(int64_t value);
+    CsvWriter& Cell(int value) { return Cell(static_cast<int64_t>(value)); }
+    CsvWriter& Cell(double value);
+
+    /// @brief finish the current row.  writes the buffer to the file when it is full.
+    bool EndRow();
+
+    /// @brief write one row of strings
+    bool WriteRow(const Tau::Strings& row);
+
+    /// @brief write many rows.  chunks of rows are formatted in parallel and written in their original order.
+    bool WriteRows(const std::vector<Tau::Strings>& rows);
+
+    /// @brief write anything that is buffered to the file
+    bool Flush();
+
+    /// @brief append a cell to a string, double quoting it if needed
+    static void AppendCell(std::string* out, std::string_view value);
+
+    /// @brief returns true if the cell has to be double quoted to read back the same
+    static bool NeedsQuotes(std::string_view value);
+
+private:
+    void StartCell();
+    bool WriteBuffer(const std::string& buf);
+    void FormatRows(std::string* out, const std::vector<Tau::Strings>& rows, size_t begin, size_t end) const;
+
+    Options options;
+    std::ofstream ofile;
+    std::string buffer;                     ///< the row at a time buffer
+    std::vector<std::string> chunkBuffers;  ///< WriteRows() per thread buffers.  kept between calls.
+    bool rowStarted {false};
+    bool writeFailed {false};
+};
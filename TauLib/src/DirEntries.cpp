@@ -0,0 +1,350 @@
+///
+/// @file
+/// @brief CPP file for DirEntries, lazy enumeration of a directory.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "DirEntries.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <vector>
+
+#if defined(_WIN32)
+#include "windows.h"
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+namespace {
+
+//
+// RawEntry - an entry as read from the directory.  name points into the directory read buffer.
+//
+struct RawEntry {
+    const char* name {nullptr};
+    size_t nameLength {0};
+    DirEntryType type {DirEntryType::Unknown};
+    bool isSymlink {false};
+    bool hasStat {false};
+    uintmax_t size {0};
+    int64_t mtime {0};
+};
+
+#if defined(_WIN32)
+
+//
+// fileTimeToNs - FILETIME (100ns since 1601) to ns since 1970
+//
+static int64_t fileTimeToNs(const FILETIME& ft)
+{
+    int64_t t = (static_cast<int64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    return (t - 116444736000000000LL) * 100;
+}
+
+//
+// DirReader - Windows.  FindFirstFileEx gives the size and time with the name.
+//
+class DirReader {
+public:
+    ~DirReader() { if (find != INVALID_HANDLE_VALUE) FindClose(find); }
+
+    bool Open(const DirReader*, const string& path, const char*, bool) {
+        find = FindFirstFileExA((path + sep + "*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+                                FIND_FIRST_EX_LARGE_FETCH);
+        first = true;
+        return find != INVALID_HANDLE_VALUE;
+    }
+
+    bool Next(RawEntry* raw) {
+        for (;;) {
+            if (!first && !FindNextFileA(find, &data))
+                return false;
+            first = false;
+            const char* name = data.cFileName;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+                continue;
+
+            raw->name = name;
+            raw->nameLength = strlen(name);
+            raw->isSymlink = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) &&
+                             (data.dwReserved0 == IO_REPARSE_TAG_SYMLINK || data.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT);
+            raw->type = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? DirEntryType::Directory : DirEntryType::File;
+            raw->hasStat = true;
+            raw->size = raw->type == DirEntryType::File ? (static_cast<uintmax_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow : 0;
+            raw->mtime = fileTimeToNs(data.ftLastWriteTime);
+            return true;
+        }
+    }
+
+    int Fd() const { return -1; }
+    bool Identity(pair<uint64_t, uint64_t>*) const { return false; }   // Windows doesn't follow directory symlinks
+
+private:
+    HANDLE find {INVALID_HANDLE_VALUE};
+    WIN32_FIND_DATAA data;
+    bool first {true};
+};
+
+#else
+
+//
+// typeFromMode
+//
+static DirEntryType typeFromMode(mode_t mode)
+{
+    if (S_ISREG(mode))
+        return DirEntryType::File;
+    if (S_ISDIR(mode))
+        return DirEntryType::Directory;
+    return DirEntryType::Other;
+}
+
+//
+// fromStat - keep the size and time of a stat that was needed for the type anyway
+//
+static void fromStat(const struct stat& st, RawEntry* raw)
+{
+    raw->type = typeFromMode(st.st_mode);
+    raw->hasStat = true;
+    raw->size = S_ISREG(st.st_mode) ? static_cast<uintmax_t>(st.st_size) : 0;
+#if defined(__APPLE__)
+    raw->mtime = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    raw->mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+//
+// DirReader - posix.  readdir on a directory opened relative to its parent.  the DIR stays open while its entries
+// are being enumerated so subdirectories can be opened with openat() and Size() can use fstatat().
+//
+class DirReader {
+public:
+    ~DirReader() { if (dir != nullptr) closedir(dir); }
+
+    bool Open(const DirReader* parent, const string& path, const char* name, bool followSymlinks) {
+        int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+        int fd;
+        if (parent != nullptr) {
+            if (!followSymlinks)
+                flags |= O_NOFOLLOW;
+            fd = openat(parent->Fd(), name, flags);
+        } else {
+            fd = open(path.c_str(), flags);
+        }
+        if (fd < 0)
+            return false;
+        dir = fdopendir(fd);
+        if (dir == nullptr) {
+            close(fd);
+            return false;
+        }
+        return true;
+    }
+
+    bool Next(RawEntry* raw) {
+        while (struct dirent* dirent = readdir(dir)) {
+            const char* name = dirent->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+                continue;
+
+            *raw = RawEntry();
+            raw->name = name;
+            raw->nameLength = strlen(name);
+
+            struct stat st;
+            switch (dirent->d_type) {
+            case DT_REG:
+                raw->type = DirEntryType::File;
+                break;
+            case DT_DIR:
+                raw->type = DirEntryType::Directory;
+                break;
+            case DT_LNK:
+                raw->isSymlink = true;
+                break;
+            case DT_UNKNOWN:        // some file systems don't fill in d_type
+                if (fstatat(Fd(), name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                    if (S_ISLNK(st.st_mode))
+                        raw->isSymlink = true;
+                    else
+                        fromStat(st, raw);
+                }
+                break;
+            default:
+                raw->type = DirEntryType::Other;
+                break;
+            }
+
+            // a symlink has the type of what it points to, the same as DirWalk
+            if (raw->isSymlink && fstatat(Fd(), name, &st, 0) == 0)
+                fromStat(st, raw);
+            return true;
+        }
+        return false;
+    }
+
+    int Fd() const { return dirfd(dir); }
+
+    bool Identity(pair<uint64_t, uint64_t>* id) const {
+        struct stat st;
+        if (fstat(Fd(), &st) != 0)
+            return false;
+        *id = { static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino) };
+        return true;
+    }
+
+private:
+    DIR* dir {nullptr};
+};
+
+#endif
+
+//
+// Level - one open directory in the depth first enumeration.  with sorted the entries are read up front.
+//
+struct Level {
+    DirReader reader;
+    string path;
+    unsigned int depth {0};
+
+    bool sorted {false};
+    vector<RawEntry> items;     // names point into names.  each name is null terminated.
+    string names;
+    size_t next {0};
+
+    bool Open(const Level* parent, const char* name, bool followSymlinks, bool sort) {
+        if (!reader.Open(parent ? &parent->reader : nullptr, path, name, followSymlinks))
+            return false;
+        sorted = sort;
+        if (sorted) {
+            vector<size_t> offsets;
+            RawEntry raw;
+            while (reader.Next(&raw)) {
+                offsets.push_back(names.size());
+                names.append(raw.name, raw.nameLength + 1);    // with the terminator, for openat
+                items.push_back(raw);
+            }
+            for (size_t i = 0; i < items.size(); ++i)
+                items[i].name = names.data() + offsets[i];
+            std::sort(items.begin(), items.end(), [] (const RawEntry& a, const RawEntry& b) {
+                return string_view(a.name, a.nameLength) < string_view(b.name, b.nameLength);
+            });
+        }
+        return true;
+    }
+
+    bool Next(RawEntry* raw) {
+        if (!sorted)
+            return reader.Next(raw);
+        if (next >= items.size())
+            return false;
+        *raw = items[next++];
+        return true;
+    }
+};
+
+} // end anonymous namespace
+
+//
+// DirEntry::StatNow
+//
+void DirEntry::StatNow() const
+{
+    statDone = true;
+    size = 0;
+    mtime = 0;
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (GetFileAttributesExA(FullPath().c_str(), GetFileExInfoStandard, &data)) {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            size = (static_cast<uintmax_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        mtime = fileTimeToNs(data.ftLastWriteTime);
+    }
+#else
+    struct stat st;
+    int ok = (dirFd >= 0) ? fstatat(dirFd, string(name).c_str(), &st, 0) : stat(FullPath().c_str(), &st);
+    if (ok == 0) {
+        RawEntry raw;
+        fromStat(st, &raw);
+        size = raw.size;
+        mtime = raw.mtime;
+    }
+#endif
+}
+
+//
+// DirEntries
+// a coroutine: the parameters are copies so they live as long as the enumeration.
+// one directory is open for each level of the current path, so a recursive enumeration holds depth + 1 handles.
+//
+Generator<const DirEntry&> DirEntries(string dirPath, DirWalkOptions options)
+{
+    // remove separators from the end (but keep a root "/"), the same as DirWalk
+    while (dirPath.size() > 1 && (dirPath.back() == '/' || dirPath.back() == '\\'))
+        dirPath.pop_back();
+    if (dirPath.empty())
+        co_return;
+    size_t rootLength = (dirPath + sep).size();
+
+    vector<unique_ptr<Level>> stack;        // unique_ptr so the entry's string_views stay put when the stack grows
+    set<pair<uint64_t, uint64_t>> visited;  // only used when following symlinks, to stop loops
+
+    auto root = make_unique<Level>();
+    root->path = dirPath;
+    if (!root->Open(nullptr, nullptr, options.followSymlinks, options.sorted))
+        co_return;
+    pair<uint64_t, uint64_t> id;
+    if (options.followSymlinks && root->reader.Identity(&id))
+        visited.insert(id);
+    stack.push_back(std::move(root));
+
+    DirEntry entry;
+    while (!stack.empty()) {
+        Level& level = *stack.back();
+        RawEntry raw;
+        if (!level.Next(&raw)) {
+            stack.pop_back();
+            continue;
+        }
+
+        string_view dir(level.path);
+        entry.dirPath = dir;
+        entry.relativeDir = dir.substr(min(rootLength, dir.size()));
+        entry.name = string_view(raw.name, raw.nameLength);
+        entry.type = raw.type;
+        entry.isSymlink = raw.isSymlink;
+        entry.depth = level.depth;
+        entry.dirFd = level.reader.Fd();
+        entry.statDone = raw.hasStat;
+        entry.size = raw.size;
+        entry.mtime = raw.mtime;
+        co_yield entry;
+
+        // depth first: the directory's contents come next
+        if (!options.recursive || !entry.IsDirectory() || level.depth >= options.maxDepth ||
+            (entry.isSymlink && !options.followSymlinks))
+            continue;
+
+        auto child = make_unique<Level>();
+        child->path = level.path + sep;
+        child->path.append(raw.name, raw.nameLength);
+        child->depth = level.depth + 1;
+        if (!child->Open(&level, raw.name, options.followSymlinks, options.sorted))
+            continue;
+        if (options.followSymlinks && child->reader.Identity(&id) && !visited.insert(id).second)
+            continue;
+        stack.push_back(std::move(child));
+    }
+}
+
+} // end namespace Tau
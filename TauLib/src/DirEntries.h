@@ -0,0 +1,65 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for DirEntries, lazy enumeration of a directory.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <cstdint>
+#include "DirWalk.h"
+#include "Tau_Generator.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief DirEntry - one entry of a DirEntries enumeration.  only valid until the loop moves to the next entry.
+/// @remark The type comes from the directory read (d_type on Linux) so it's free.  The size and last write time
+///         are free on Windows, on other systems they're read with one fstatat() the first time they're asked for
+///         and cached.  A symlink has the type, size and time of what it points to.
+///
+struct DirEntry : DirWalkEntry {
+    /// @brief the file size.  0 for a directory or if it can't be read.
+    uintmax_t Size() const { Stat(); return size; }
+    /// @brief the last write time in nanoseconds since 1970.  0 if it can't be read.
+    int64_t LastWriteTime() const { Stat(); return mtime; }
+
+    // filled in by DirEntries
+    int dirFd {-1};                 ///< the open directory on posix systems
+    mutable bool statDone {false};
+    mutable uintmax_t size {0};
+    mutable int64_t mtime {0};
+
+private:
+    void Stat() const { if (!statDone) StatNow(); }
+    void StatNow() const;
+};
+
+///
+/// @brief DirEntries - enumerates a directory (and optionally its subdirectories) one entry at a time
+/// @param dirPath the directory to read
+/// @param options recursive, followSymlinks, sorted and maxDepth are used.  the enumeration is on the calling thread.
+/// @return a range of const DirEntry&.  nothing if dirPath can't be read.
+/// @remark Entries are produced as the directory is read so breaking out of the loop early skips the rest of the
+///         work.  Recursive enumeration is depth first: a directory is followed by its contents.
+///         With sorted each directory is read in full and sorted by name before its first entry is produced.
+/// @remark Use DirWalk() instead to collect a whole tree, it reads directories on multiple threads.
+/// @code
+///     for (const DirEntry& entry : DirEntries(romsDir, DirWalkOptions()))
+///         if (entry.IsFile() && entry.Size() > 700 * 1024 * 1024)
+///             return entry.FullPath();
+/// @endcode
+///
+Generator<const DirEntry&> DirEntries(std::string dirPath, DirWalkOptions options);
+
+/// @brief DirEntries - enumerates one directory, or the whole tree with recursive
+inline Generator<const DirEntry&> DirEntries(const std::string& dirPath, bool recursive = false) {
+    DirWalkOptions options;
+    options.recursive = recursive;
+    return DirEntries(dirPath, options);
+}
+
+} // end namespace Tau
@@ -5,6 +5,19 @@
 #include <stdio.h>
 #include <assert.h>
 #include "sep.h"
+#include "DirWalk.h"
+#include "DirEntries.h"
+#include "FileCopy.h"
+#include "FileCompare.h"
+#include "FileMatch.h"
+#include "TextFileWriter.h"
+#include "TempFile.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include <iterator>
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -246,14 +259,13 @@ bool CopyFile_SkipExisting(const string& filePathSrc, const string& filePathDest
 
 //
 // copy directories (recursive)
+// files are copied on multiple threads, see FileCopy.h
 //
 bool CopyDir(const string& dirPathSrc, const string& dirPathDest) {
     if (!DirExists(dirPathSrc))
         return false;
 
-    error_code ec;
-    fs::copy(dirPathSrc, dirPathDest, fs::copy_options::recursive | fs::copy_options::overwrite_existing, ec);
-    return !ec;     // return true if successful
+    return CopyTree(dirPathSrc, dirPathDest);     // return true if successful
 }
 
 //
@@ -263,9 +275,9 @@ bool CopyDir_SkipExisting(const string& dirPathSrc, const string& dirPathDest) {
     if (!DirExists(dirPathSrc))
         return false;
 
-    error_code ec;
-    fs::copy(dirPathSrc, dirPathDest, fs::copy_options::recursive | fs::copy_options::skip_existing, ec);
-    return !ec;     // return true if successful
+    CopyOptions options;
+    options.overwriteExisting = false;
+    return CopyTree(dirPathSrc, dirPathDest, options);     // return true if successful
 }
 
                 //*******************************
@@ -287,11 +299,65 @@ Strings GetDirectoryContents(const string& dirPath,
         return result;
 
     if (recursive) {
-        for (auto dir_entry : fs::recursive_directory_iterator(dirPath)) {
-            if (testLambda(dir_entry)) {
-                result.emplace_back(getStringLambda(dir_entry));
+        // the walk finds the directories on multiple threads and hands each one over as it's read.  the lambdas are
+        // the caller's and needn't be thread safe, so they're called here, on this thread, a directory at a time.
+        // the directory_entry objects come from a directory_iterator, so they carry the type the listing returned
+        // and nothing is stat'ed again.  only the directories waiting to be handled are held, not the whole tree.
+        mutex lock;
+        condition_variable ready;
+        deque<string> dirs;
+        bool walkDone = false;
+
+        thread walker([&] {
+            DirWalkOptions options;
+            DirWalkBatches(dirPath, options, [&] (unsigned int, const DirWalkBatch& batch) {
+                lock_guard<mutex> guard(lock);
+                dirs.push_back(batch.dirPath);
+                ready.notify_one();
+            });
+            lock_guard<mutex> guard(lock);
+            walkDone = true;
+            ready.notify_one();
+        });
+        struct JoinWalker {
+            thread& t;
+            ~JoinWalker() { t.join(); }     // also if a lambda throws
+        } joinWalker { walker };
+
+        // each directory's results are kept apart, then put in path order so the result is the same every time
+        vector<pair<string, Strings>> dirResults;
+        vector<fs::directory_entry> entries;
+        for (;;) {
+            string dir;
+            {
+                unique_lock<mutex> guard(lock);
+                ready.wait(guard, [&] { return !dirs.empty() || walkDone; });
+                if (dirs.empty())
+                    break;
+                dir = std::move(dirs.front());
+                dirs.pop_front();
+            }
+
+            error_code ec;
+            entries.clear();
+            for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+                entries.push_back(*it);
+            sort(entries.begin(), entries.end(), [] (const fs::directory_entry& a, const fs::directory_entry& b) {
+                return a.path().filename() < b.path().filename();
+            });
+
+            Strings found;
+            for (auto& dir_entry : entries) {
+                if (testLambda(dir_entry))
+                    found.emplace_back(getStringLambda(dir_entry));
             }
+            if (!found.empty())
+                dirResults.emplace_back(std::move(dir), std::move(found));
         }
+
+        sort(dirResults.begin(), dirResults.end(), [] (const auto& a, const auto& b) { return a.first < b.first; });
+        for (auto& dirResult : dirResults)
+            std::move(dirResult.second.begin(), dirResult.second.end(), back_inserter(result));
     } else {
         for (auto dir_entry : fs::directory_iterator(dirPath)) {
             if (testLambda(dir_entry)) {
@@ -304,118 +370,137 @@ Strings GetDirectoryContents(const string& dirPath,
 }
 
 //
-// 
+// lambdas for DirWalk and DirEntries
+//
+static auto walk_is_file =      [] (const DirWalkEntry& entry) { return entry.IsFile(); };
+static auto walk_is_directory = [] (const DirWalkEntry& entry) { return entry.IsDirectory(); };
+static auto walk_name =         [] (const DirWalkEntry& entry) { return string(entry.name); };
+static auto walk_fullpath =     [] (const DirWalkEntry& entry) { return entry.FullPath(); };
+
+// the _Recursive routines return their results in the same order every time
+static const DirWalkOptions walk_sorted = [] { DirWalkOptions options; options.sorted = true; return options; }();
+
+//
+// collectInDir - proj(entry) for the entries of one directory where pred(entry) is true
+//
+template <class Pred, class Proj>
+static Strings collectInDir(const string& dirPath, Pred pred, Proj proj)
+{
+    Strings result;
+    for (const DirEntry& entry : DirEntries(dirPath)) {
+        if (pred(entry))
+            result.emplace_back(proj(entry));
+    }
+    return result;
+}
+
+//
+// GetFileNamesInDir
 //
 Strings GetFileNamesInDir(const std::string& dirPath)
-    { return GetDirectoryContents(dirPath, is_file, get_name); }
+    { return collectInDir(dirPath, walk_is_file, walk_name); }
 
 //
 // GetFileFullPathsInDir
 //
 Strings GetFileFullPathsInDir(const std::string& dirPath)
-    { return GetDirectoryContents(dirPath, is_file, get_fullpath); }
+    { return collectInDir(dirPath, walk_is_file, walk_fullpath); }
 
 //
 // GetDirNamesInDir
 //
 Strings GetDirNamesInDir(const std::string& dirPath)
-    { return GetDirectoryContents(dirPath, is_directory, get_name); }
-
-//
-// recurseDirs  used by GetSubDirPathsInDir_Recursive to get all the subdirectories in a directory
-//
-static void recurseDirs(Strings* allDirs, const string& pathToSearch) {
-    Strings dirs = GetDirNamesInDir(pathToSearch);
-    for (auto& dir : dirs) {
-        allDirs->push_back(pathToSearch + sep + dir);
-        string fullPath = pathToSearch + sep + dir;
-        recurseDirs(allDirs, fullPath);
-    }
-};
+    { return collectInDir(dirPath, walk_is_directory, walk_name); }
 
 //
 // GetDirFullPathsInDir_Recursive
 //
 Strings GetSubDirFullPathsInDir_Recursive(const std::string& parentPath) {
-    Strings allDirs;
-    recurseDirs(&allDirs, parentPath);
-
-    return allDirs;
+    if (!DirExists(parentPath))
+        return Strings();
+    return DirWalk(parentPath, walk_is_directory, walk_fullpath, walk_sorted);
 }
 
 //
 // GetSubDirPathsInDir_Recursive
+// returns the subdir paths relative to parentPath
 //
 Strings GetSubDirPathsInDir_Recursive(const std::string& parentPath) {
-    Strings allDirs = GetSubDirFullPathsInDir_Recursive(parentPath);
-
-    // strip out the parent parentPath leaving just the relative subdir paths
-    for (auto& dir : allDirs) {
-        filesystem::path fullPath = dir;
-        filesystem::path basePath = parentPath + sep;
-        dir = filesystem::relative(fullPath, basePath).string();
-    }
-    return allDirs;
+    if (!DirExists(parentPath))
+        return Strings();
+    return DirWalk(parentPath, walk_is_directory, [] (const DirWalkEntry& entry) { return entry.RelativePath(); }, walk_sorted);
 }
 
 //
 // GetDirFullPathsInDir
 //
 Strings GetDirFullPathsInDir(const std::string& dirPath)
-    { return GetDirectoryContents(dirPath, is_directory, get_fullpath); }
+    { return collectInDir(dirPath, walk_is_directory, walk_fullpath); }
 
 //
 // GetFileFullPathsInDir_Recursive
 //
-Strings GetFileFullPathsInDir_Recursive(const std::string& dirPath)
-    { return GetDirectoryContents(dirPath, is_file, get_fullpath, true); }
+Strings GetFileFullPathsInDir_Recursive(const std::string& dirPath) {
+    if (!DirExists(dirPath))
+        return Strings();
+    return DirWalk(dirPath, walk_is_file, walk_fullpath, walk_sorted);
+}
 
 //
 // GetFileNamesWithExtInDir
 //
 Strings GetFileNamesWithExtInDir(const std::string& dirPath, std::string ext) {
-    // if no '.' in the front of the extension, add one.
-    if (ext.size() == 0 || ext[0] != '.')
-        ext.insert(ext.begin(), '.');
-    auto is_file_with_ext = [&] (fs::directory_entry& entry)->bool { return entry.is_regular_file() && icompareBool(entry.path().extension().string(), ext); };
-    return GetDirectoryContents(dirPath, is_file_with_ext, get_name);
+    return GetFileNamesMatchingInDir(dirPath, FileNameMatcher({ ext }));
 }
 
 //
 // GetFileNamesWithTheseExtsInDir
+// one pass over the directory for all the extensions
 //
 Strings GetFileNamesWithTheseExtsInDir(const std::string& dirPath, Strings extensions) {
-    Strings filenames;
-    for (const auto& ext : extensions) {
-        Strings more = GetFileNamesWithExtInDir(dirPath, ext);
-        filenames.insert(filenames.end(), more.begin(), more.end());
-    }
-
-    return filenames;
+    return GetFileNamesMatchingInDir(dirPath, FileNameMatcher(extensions));
 }
 
 //
 // GetFileFullPathsWithExtInDir_Recursive
 //
 Strings GetFileFullPathsWithExtInDir_Recursive(const std::string& dirPath, std::string ext) {
-    // if no '.' in the front of the extension, add one.
-    if (ext.size() == 0 || ext[0] != '.')
-        ext.insert(ext.begin(), '.');
-    auto is_file_with_ext = [&] (fs::directory_entry& entry)->bool { return entry.is_regular_file() && icompareBool(entry.path().extension().string(), ext); };
-    return GetDirectoryContents(dirPath, is_file_with_ext, get_fullpath, true);
+    return GetFileFullPathsMatchingInDir_Recursive(dirPath, FileNameMatcher({ ext }));
 }
 
 //
 // GetFileFullPathsWitThesehExtsInDir_Recursive
+// one walk of the tree for all the extensions
 //
 Strings GetFileFullPathsWithTheseExtsInDir_Recursive(const std::string& dirPath, Strings extensions) {
-    Strings filenames;
-    for (const auto& ext : extensions) {
-        Strings more = GetFileFullPathsWithExtInDir_Recursive(dirPath, ext);
-        filenames.insert(filenames.end(), more.begin(), more.end());
-    }
+    return GetFileFullPathsMatchingInDir_Recursive(dirPath, FileNameMatcher(extensions));
+}
 
-    return filenames;
+//
+// GetFileNamesMatchingInDir
+//
+Strings GetFileNamesMatchingInDir(const std::string& dirPath, const Strings& patterns) {
+    return GetFileNamesMatchingInDir(dirPath, FileNameMatcher(Strings(), patterns));
+}
+
+Strings GetFileNamesMatchingInDir(const std::string& dirPath, const FileNameMatcher& matcher) {
+    if (matcher.Empty())
+        return Strings();
+    return collectInDir(dirPath, [&] (const DirWalkEntry& entry) { return entry.IsFile() && matcher.Matches(entry.name); },
+                        walk_name);
+}
+
+//
+// GetFileFullPathsMatchingInDir_Recursive
+//
+Strings GetFileFullPathsMatchingInDir_Recursive(const std::string& dirPath, const Strings& patterns) {
+    return GetFileFullPathsMatchingInDir_Recursive(dirPath, FileNameMatcher(Strings(), patterns));
+}
+
+Strings GetFileFullPathsMatchingInDir_Recursive(const std::string& dirPath, const FileNameMatcher& matcher) {
+    if (matcher.Empty() || !DirExists(dirPath))
+        return Strings();
+    return DirWalk(dirPath, [&] (const DirWalkEntry& entry) { return entry.IsFile() && matcher.Matches(entry.name); }, walk_fullpath, walk_sorted);
 }
 
                 //*******************************
@@ -426,20 +511,15 @@ Strings GetFileFullPathsWithTheseExtsInDir_Recursive(const std::string& dirPath,
 // Do NOT delete this directory, but create temporary files and dirs inside it.
 // 
 string GetTempDir() {
-    string tempDirPath = filesystem::temp_directory_path().string();
-    return tempDirPath;
+    return TempDirPath();   // looked up once
 }
 
 //
 // Get the full path of a unique filename you can use for creating a temporary file or dir.
+// the name is random, nothing is created.  see TempFile.h to create one safely.
 //
 string GetATempFilename() {
-    char buf[L_tmpnam_s];
-    int ret = tmpnam_s(buf, L_tmpnam_s);    // ret == 0 on success
-    if (ret == 0)
-        return buf;
-    else
-        return "";
+    return UniqueTempPath();
 }
 
                 //*******************************
@@ -480,18 +560,12 @@ Strings ReadTextFileAsAStringArray(const string& filePath, bool removeCRLF) {
 // true for success
 // 
 bool WriteStringsToTextFile(const Strings& strings, const std::string& filePath, bool appendLineEnding) {
-    ofstream os(filePath, ios_base::trunc);
-    if (!os.is_open())
+    TextFileWriter writer;
+    if (!writer.Open(filePath))
         return false;
 
-    for (const string& s : strings) {
-        if (appendLineEnding)
-            os << s << endl;
-        else
-            os << s;
-    }
-    os << flush;
-    return true;
+    writer.WriteLines(strings, appendLineEnding);
+    return writer.Close();
 }
 
 //
@@ -499,44 +573,43 @@ bool WriteStringsToTextFile(const Strings& strings, const std::string& filePath,
 // returns true for success
 // 
 bool AppendStringsToTextFile(const Strings& strings, const std::string& filePath, bool appendLineEnding) {
-    ofstream os(filePath, ios_base::ate);   // position at end of file
-    if (!os.is_open())
+    TextFileWriter writer;
+    if (!writer.Open(filePath, /*append*/ true))
         return false;
 
-    for (const string& s : strings) {
-        if (appendLineEnding)
-            os << s << endl;
-        else
-            os << s;
-    }
-    os << flush;
-    return true;
+    writer.WriteLines(strings, appendLineEnding);
+    return writer.Close();
 }
 
                 //*******************************
                 // Compare Text Files
                 //*******************************
 
+// emptyOrUnreadable - the line by line CompareFiles read a missing or unreadable file as no lines
+static bool emptyOrUnreadable(const string& filePath) {
+    error_code ec;
+    uintmax_t size = fs::file_size(filePath, ec);
+    if (ec || size == 0)
+        return true;
+    ifstream file(filePath, ios::binary);
+    return !file.is_open();
+}
+
 // CompareFiles
-// returns true if the file strings are the same (considering ignoreCRLF flag)
+// returns true if the files are the same (considering ignoreCRLF flag)
+// compares bytes, not lines, see FileCompare.h
 bool CompareFiles(const string& filePath1, const string& filePath2, bool ignoreCRLF) {
-    Strings file1 = ReadTextFileAsAStringArray(filePath1, ignoreCRLF);
-    Strings file2 = ReadTextFileAsAStringArray(filePath2, ignoreCRLF);
-
-    if (file1.size() != file2.size())
-        return false;   // different file size
-
-    for (int i=0; i < file1.size(); ++i) {
-        auto a = file1[i];
-        auto b = file2[i];
-        if (file1[i] != file2[i]) {
-            cout << '"' << file1[i] << '"' << endl;
-            cout << '"' << file2[i] << '"' << endl;
-            return false;   // different content
-        }
-    }
+    return CompareFiles(filePath1, filePath2, ignoreCRLF, nullptr);
+}
 
-    return true;    // files are equal
+bool CompareFiles(const string& filePath1, const string& filePath2, bool ignoreCRLF, FileCompareResult* result) {
+    if (CompareFileContents(filePath1, filePath2, ignoreCRLF, result))
+        return true;
+    if (!emptyOrUnreadable(filePath1) || !emptyOrUnreadable(filePath2))
+        return false;
+    if (result)
+        result->equal = true;
+    return true;
 }
 
                 //*******************************
@@ -2,6 +2,8 @@
 #include <string>
 #include "TauLib.h"
 #include "Str.h"
+#include "FileMatch.h"
+#include "FileCompare.h"
 #include <filesystem>
 #include <functional>
 
@@ -234,6 +236,7 @@ bool CopyFile_SkipExisting(const std::string& filePathSrc, const std::string& fi
 /// @param dirPathSrc the file being copied
 /// @param dirPathDest the file it's being copied to
 /// @remark if the destination file already exists, the copy is overwritten
+/// @remark files are copied on multiple threads.  CopyTree() (FileCopy.h) has options for times, permissions and progress.
 /// @return true if successful
 /// 
 bool CopyDir(const std::string& dirPathSrc, const std::string& dirPathDest);
@@ -269,6 +272,10 @@ inline auto get_fullpath = [] (fs::directory_entry& entry)->std::string { return
 /// @param getStringLambda What string you wish to return from the entry if it passed your test.
 /// @param recursive True to recursively read the entire directory hierarchy.
 /// @return A vector of strings of file names, dir names, or full file/dir paths.
+/// @remark With recursive the directories are found on multiple threads (see DirWalk.h), but the lambdas are called
+///         on the calling thread, a directory at a time as each is found, in name order within the directory.  The
+///         result is in the order of DirWalkOptions::sorted.  DirWalk() with DirWalkEntry lambdas is faster.
+/// @remark To stop at the first match or handle entries as they're read, loop over DirEntries() (DirEntries.h) instead.
 Strings GetDirectoryContents(const std::string& dirPath, 
                              std::function<bool (fs::directory_entry&)> testLambda,
                              std::function<std::string (fs::directory_entry&)> getStringLambda,
@@ -336,7 +343,7 @@ Strings GetFileNamesWithExtInDir(const std::string& dirPath, std::string ext);
 /// @param dirPath The directory path to open.
 /// @param extensions a vector fo the extensions to search for
 /// @return A vector of strings containing file names with that file extension.
-/// @note The file extensions are compared case insensitive.
+/// @note The file extensions are compared case insensitive.  The directory is read once for all the extensions.
 Strings GetFileNamesWithTheseExtsInDir(const std::string& dirPath, Strings extensions);
 
 /// @brief GetFileFullPathsWithExtInDir_Recursive Return the list of file name full paths with a particular extension in a directory.
@@ -352,9 +359,27 @@ Strings GetFileFullPathsWithExtInDir_Recursive(const std::string& dirPath, std::
 /// @param dirPath The directory path to open.
 /// @param extensions vector of externsion to search for
 /// @return A vector of strings containing file name full paths.
+/// @note The directory tree is walked once for all the extensions.
 /// 
 Strings GetFileFullPathsWithTheseExtsInDir_Recursive(const std::string& dirPath, Strings extensions);
 
+/// @brief GetFileNamesMatchingInDir Return the list of file names in a directory that match any of a list of glob patterns.
+/// @param dirPath The directory path to open.
+/// @param patterns glob patterns.  ex: "*.bin", "track??.*", "[ab]*.iso".  see FileMatch.h
+/// @return A vector of strings containing file names.
+/// @note The patterns are compared case insensitive.  The directory is read once for all the patterns.
+Strings GetFileNamesMatchingInDir(const std::string& dirPath, const Strings& patterns);
+Strings GetFileNamesMatchingInDir(const std::string& dirPath, const FileNameMatcher& matcher);
+
+/// @brief GetFileFullPathsMatchingInDir_Recursive Return the list of file name full paths that match any of a list of glob patterns.
+/// Same as GetFileNamesMatchingInDir but it continues through the entire sub-directory hierarchy and returns the full path.
+/// @param dirPath The directory path to open.
+/// @param patterns glob patterns.  see FileMatch.h
+/// @return A vector of strings containing file name full paths.
+///
+Strings GetFileFullPathsMatchingInDir_Recursive(const std::string& dirPath, const Strings& patterns);
+Strings GetFileFullPathsMatchingInDir_Recursive(const std::string& dirPath, const FileNameMatcher& matcher);
+
                 //*******************************
                 // Temp Directory and Temp File
                 //*******************************
@@ -371,6 +396,8 @@ std::string GetTempDir();
 /// @brief Get a full path filename for creating a temporary file.
 /// @param none
 /// @return The full path of a unique filename you can use for creating a temporary file or dir.
+/// @remark Nothing is created, so another process could take the name first.  TempFile and TempDirectory
+///         (TempFile.h) create the file or dir safely and delete it when done.
 ///
 std::string GetATempFilename();
 
@@ -397,6 +424,7 @@ Strings ReadTextFileAsAStringArray(const std::string& filePath, bool removeCRLF)
 /// @param filePath The File to write to
 /// @param appendLineEnding Wether to append crlf for Windows or lf for Linux at the end of each line.
 /// @return true for success
+/// @remark To keep a file open, sync it or replace it atomically use TextFileWriter.
 /// 
 bool WriteStringsToTextFile(const Strings& strings, const std::string& filePath, bool appendLineEnding);
 
@@ -416,9 +444,14 @@ bool AppendStringsToTextFile(const Strings& strings, const std::string& filePath
 /// @brief CompareFiles
 /// @param filePath1 fullpath to file1
 /// @param filePath2 fullpath to file2
-/// @param ignoreCRLF true to ignore CR/LF's when comparing
-/// @return true if the file strings are the same (considering ignoreCRLF flag)
+/// @param ignoreCRLF true to compare CR LF the same as LF and ignore line endings at the end of the files
+/// @param result if passed, where the files first differ (offset and line).  see FileCompare.h
+/// @return true if the files are the same (considering ignoreCRLF flag)
+/// @remark The files are compared byte by byte in large blocks and the compare stops at the first difference.
+/// @remark A missing or unreadable file compares the same as an empty file, so two missing files are equal, as they
+///         always have been.  CompareFileContents() (FileCompare.h) reports them as openFailed and unequal instead.
 bool CompareFiles(const std::string& filePath1, const std::string& filePath2, bool ignoreCRLF=false);
+bool CompareFiles(const std::string& filePath1, const std::string& filePath2, bool ignoreCRLF, FileCompareResult* result);
 
                 //*******************************
                 // Space Available
@@ -0,0 +1,781 @@
+///
+/// @file
+/// @brief CPP file for DirIndex, an in memory index of a directory tree.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "DirIndex.h"
+#include "MappedFile.h"
+#include "Tau_Parallel.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+                //*******************************
+                // helpers
+                //*******************************
+
+//
+// statPath - size, last write time (ns) and inode of a path.  follows symlinks.
+//
+static bool statPath(const string& path, uint64_t* size, int64_t* mtime, uint64_t* inode)
+{
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+        return false;
+    *mtime = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+    *inode = 0;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    *mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    *inode = static_cast<uint64_t>(st.st_ino);
+#endif
+    *size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+//
+// normalizePath - use the OS separator and remove separators from the end
+//
+static string normalizePath(string path)
+{
+    for (char& ch : path) {
+        if (ch == '/' || ch == '\\')
+            ch = separator;
+    }
+    while (path.size() > 1 && path.back() == separator)
+        path.pop_back();
+    return path;
+}
+
+//
+// childKey - the key of an entry in the directory with key parentKey
+//
+static string childKey(const string& parentKey, string_view name)
+{
+    if (parentKey.empty())
+        return string(name);
+    string key = parentKey;
+    key += separator;
+    key.append(name);
+    return key;
+}
+
+//
+// eraseSubtree - remove a directory and everything under it
+//
+template <class Map>
+static void eraseSubtree(Map* dirs, const string& key)
+{
+    if (key.empty()) {
+        dirs->clear();
+        return;
+    }
+    dirs->erase(key);
+    string prefix = key + separator;
+    auto it = dirs->lower_bound(prefix);
+    while (it != dirs->end() && it->first.compare(0, prefix.size(), prefix) == 0)
+        it = dirs->erase(it);
+}
+
+//
+// batchToEntries - the entries of a walked directory with their sizes and times
+//
+static vector<DirIndexEntry> batchToEntries(const DirWalkBatch& batch)
+{
+    vector<DirIndexEntry> entries;
+    entries.reserve(batch.size());
+    string path = batch.dirPath + sep;
+    size_t dirLength = path.size();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        DirWalkEntry walked = batch[i];
+        DirIndexEntry& entry = entries.emplace_back();
+        entry.name = walked.name;
+        entry.type = walked.type;
+        entry.isSymlink = walked.isSymlink;
+
+        path.resize(dirLength);
+        path.append(walked.name);
+        uint64_t size = 0;
+        if (statPath(path, &size, &entry.mtime, &entry.inode) && entry.IsFile())
+            entry.size = size;
+    }
+    return entries;     // the batch is sorted by name
+}
+
+                //*******************************
+                // Build and Scan
+                //*******************************
+
+DirIndex::DirIndex() {}
+
+DirIndex::~DirIndex()
+{
+    CloseWatch();
+}
+
+//
+// FullPath
+//
+string DirIndex::FullPath(const string& key) const
+{
+    return key.empty() ? root : root + sep + key;
+}
+
+//
+// ScanDir - read one directory
+//
+bool DirIndex::ScanDir(const string& key, Dir* dir) const
+{
+    string path = FullPath(key);
+    uint64_t size = 0;
+    if (!statPath(path, &size, &dir->mtime, &dir->inode))
+        return false;
+
+    DirWalkOptions options;
+    options.recursive = false;
+    options.sorted = true;
+    bool read = false;
+    DirWalkBatches(path, options, [&] (unsigned int, const DirWalkBatch& batch) {
+        dir->entries = batchToEntries(batch);
+        read = true;
+    });
+    return read;
+}
+
+//
+// ScanTree - read a directory and everything under it.  the directories are read on multiple threads.
+//
+bool DirIndex::ScanTree(const string& key, DirMap* out) const
+{
+    string path = FullPath(key);
+    DirWalkOptions options;
+    options.sorted = true;
+
+    vector<vector<pair<string, Dir>>> workerDirs(DirWalkThreadCount(options));
+    DirWalkBatches(path, options, [&] (unsigned int worker, const DirWalkBatch& batch) {
+        string_view relativeDir = string_view(batch.dirPath).substr(min(batch.relativeStart, batch.dirPath.size()));
+        string dirKey = key;
+        if (!relativeDir.empty())
+            dirKey = childKey(key, relativeDir);
+
+        Dir dir;
+        uint64_t size = 0;
+        statPath(batch.dirPath, &size, &dir.mtime, &dir.inode);
+        dir.entries = batchToEntries(batch);
+        workerDirs[worker].emplace_back(std::move(dirKey), std::move(dir));
+    });
+
+    bool found = false;
+    for (auto& worker : workerDirs) {
+        for (auto& [dirKey, dir] : worker) {
+            found = found || dirKey == key;
+            (*out)[dirKey] = std::move(dir);
+        }
+    }
+    return found;
+}
+
+//
+// Build
+//
+bool DirIndex::Build(const string& rootPath)
+{
+    lock_guard<mutex> refresh(refreshLock);
+    CloseWatch();
+
+    string newRoot = normalizePath(rootPath);
+    DirMap newDirs;
+    {
+        unique_lock<shared_mutex> lock(dataLock);
+        root = newRoot;
+        dirs.clear();
+    }
+    if (!ScanTree("", &newDirs))
+        return false;
+
+    unique_lock<shared_mutex> lock(dataLock);
+    dirs = std::move(newDirs);
+    return true;
+}
+
+                //*******************************
+                // Refresh
+                //*******************************
+
+//
+// Refresh
+//
+size_t DirIndex::Refresh(bool restatFiles)
+{
+    lock_guard<mutex> refresh(refreshLock);
+
+    vector<string> allKeys;
+    {
+        shared_lock<shared_mutex> lock(dataLock);
+        if (root.empty())
+            return 0;
+        allKeys.reserve(dirs.size());
+        for (const auto& [key, dir] : dirs)
+            allKeys.push_back(key);
+    }
+
+    vector<string> changedKeys;
+    bool overflow = false;
+    if (restatFiles) {
+        changedKeys = allKeys;
+    } else if (IsWatching() && ReadWatchEvents(&changedKeys, &overflow) && !overflow) {
+        // only the directories with events
+    } else {
+        // check the last write time of every directory
+        vector<uint8_t> changed(allKeys.size(), 0);
+        ParallelForChunks(allKeys.size(), 256, [&] (unsigned int, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint64_t size = 0, inode = 0;
+                int64_t mtime = 0;
+                bool exists = statPath(FullPath(allKeys[i]), &size, &mtime, &inode);
+                shared_lock<shared_mutex> lock(dataLock);
+                auto it = dirs.find(allKeys[i]);
+                changed[i] = !exists || it == dirs.end() || it->second.mtime != mtime || it->second.inode != inode;
+            }
+        });
+        changedKeys.clear();
+        for (size_t i = 0; i < allKeys.size(); ++i) {
+            if (changed[i])
+                changedKeys.push_back(allKeys[i]);
+        }
+    }
+    return Rescan(changedKeys, restatFiles);
+}
+
+//
+// Rescan - read the changed directories again.  new subdirectories are read in full.  removed ones are dropped.
+//
+size_t DirIndex::Rescan(const vector<string>& changedKeys, bool restatFiles)
+{
+    if (changedKeys.empty())
+        return 0;
+
+    struct Result {
+        bool exists {false};
+        Dir dir;
+        DirMap newSubtrees;
+        vector<string> removedSubdirs;
+    };
+    vector<Result> results(changedKeys.size());
+
+    ParallelForChunks(changedKeys.size(), restatFiles ? 64 : 1, [&] (unsigned int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const string& key = changedKeys[i];
+            Result& result = results[i];
+            result.exists = ScanDir(key, &result.dir);
+            if (!result.exists)
+                continue;
+
+            // compare the subdirectories with what the index had.  one removed and made again since (another inode),
+            // or one that lost its watch, is read again in full: its own changes weren't seen.
+            vector<DirIndexEntry> oldSubdirs;
+            {
+                shared_lock<shared_mutex> lock(dataLock);
+                auto it = dirs.find(key);
+                if (it != dirs.end()) {
+                    for (const auto& entry : it->second.entries) {
+                        if (entry.IsDirectory() && !entry.isSymlink)
+                            oldSubdirs.push_back(entry);
+                    }
+                }
+            }
+            for (const auto& entry : result.dir.entries) {
+                if (!entry.IsDirectory() || entry.isSymlink)
+                    continue;
+                string subKey = childKey(key, entry.name);
+                auto old = find_if(oldSubdirs.begin(), oldSubdirs.end(),
+                                   [&] (const DirIndexEntry& oldEntry) { return oldEntry.name == entry.name; });
+                if (old != oldSubdirs.end()) {
+                    bool same = old->inode == entry.inode && (!IsWatching() || watchedDirs.count(subKey) != 0);
+                    oldSubdirs.erase(old);
+                    if (same)
+                        continue;
+                    result.removedSubdirs.push_back(subKey);
+                }
+                ScanTree(subKey, &result.newSubtrees);
+            }
+            for (const auto& oldEntry : oldSubdirs)
+                result.removedSubdirs.push_back(childKey(key, oldEntry.name));
+        }
+    });
+
+    DirMap addedDirs;
+    {
+        unique_lock<shared_mutex> lock(dataLock);
+        for (size_t i = 0; i < changedKeys.size(); ++i) {
+            Result& result = results[i];
+            if (!result.exists) {
+                eraseSubtree(&dirs, changedKeys[i]);
+                continue;
+            }
+            for (const string& removed : result.removedSubdirs)
+                eraseSubtree(&dirs, removed);
+            dirs[changedKeys[i]] = std::move(result.dir);
+            for (auto& [key, dir] : result.newSubtrees) {
+                if (IsWatching())
+                    addedDirs[key] = Dir();
+                dirs[key] = std::move(dir);
+            }
+        }
+    }
+    if (!addedDirs.empty())
+        AddWatches(addedDirs);
+    return changedKeys.size();
+}
+
+                //*******************************
+                // Watch (inotify)
+                //*******************************
+
+//
+// Watch
+//
+bool DirIndex::Watch()
+{
+#if defined(__linux__)
+    lock_guard<mutex> refresh(refreshLock);
+    if (IsWatching())
+        return true;
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchFd < 0)
+        return false;
+
+    DirMap keys;
+    {
+        shared_lock<shared_mutex> lock(dataLock);
+        for (const auto& [key, dir] : dirs)
+            keys[key] = Dir();
+    }
+    AddWatches(keys);
+    if (!IsWatching())
+        return false;       // ran out of watches (fs.inotify.max_user_watches).  Refresh() checks times instead.
+    return true;
+#else
+    return false;
+#endif
+}
+
+//
+// StopWatching
+//
+void DirIndex::StopWatching()
+{
+    lock_guard<mutex> refresh(refreshLock);
+    CloseWatch();
+}
+
+void DirIndex::CloseWatch()
+{
+    int fd = watchFd.exchange(-1);
+#if !defined(_WIN32)
+    if (fd >= 0)
+        close(fd);
+#else
+    (void) fd;
+#endif
+    watchKeys.clear();
+    watchedDirs.clear();
+}
+
+//
+// AddWatches
+//
+void DirIndex::AddWatches(const DirMap& newDirs)
+{
+#if defined(__linux__)
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                          IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    for (const auto& [key, dir] : newDirs) {
+        int wd = inotify_add_watch(watchFd, FullPath(key).c_str(), mask);
+        if (wd < 0) {
+            if (errno == ENOSPC || errno == ENOMEM) {
+                CloseWatch();
+                return;
+            }
+            continue;   // the directory went away
+        }
+        watchKeys[wd] = key;
+        watchedDirs[key] = wd;
+    }
+#else
+    (void) newDirs;
+#endif
+}
+
+//
+// ReadWatchEvents - the keys of the directories with events since the last call
+//
+bool DirIndex::ReadWatchEvents(vector<string>* changedKeys, bool* overflow)
+{
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t bytes = read(watchFd, buffer, sizeof(buffer));
+        if (bytes <= 0)
+            break;
+        for (ssize_t pos = 0; pos < bytes; ) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                *overflow = true;
+                continue;
+            }
+            auto it = watchKeys.find(event->wd);
+            if (it == watchKeys.end())
+                continue;
+            changedKeys->push_back(it->second);
+            if (event->mask & IN_IGNORED) {
+                // the directory is gone.  one made again under the name has its own watch by now, keep that
+                auto watched = watchedDirs.find(it->second);
+                if (watched != watchedDirs.end() && watched->second == event->wd)
+                    watchedDirs.erase(watched);
+                watchKeys.erase(it);
+            }
+        }
+    }
+
+    // drop duplicates and directories no longer in the index
+    sort(changedKeys->begin(), changedKeys->end());
+    changedKeys->erase(unique(changedKeys->begin(), changedKeys->end()), changedKeys->end());
+    shared_lock<shared_mutex> lock(dataLock);
+    changedKeys->erase(remove_if(changedKeys->begin(), changedKeys->end(),
+                                 [&] (const string& key) { return dirs.find(key) == dirs.end(); }),
+                       changedKeys->end());
+    return true;
+#else
+    (void) changedKeys;
+    (void) overflow;
+    return false;
+#endif
+}
+
+                //*******************************
+                // Save and Load
+                //*******************************
+
+//
+// Snapshot layout.  native byte order, no padding.
+//
+//   char magic[8], uint32_t version, uint32_t byteOrder, uint64_t dirCount, uint32_t rootLength, root
+//   for each dir:   uint32_t keyLength, key, int64_t mtime, uint64_t inode, uint32_t entryCount
+//     for each entry:  uint32_t nameLength, name, uint8_t type, uint8_t isSymlink, uint64_t size, int64_t mtime, uint64_t inode
+//
+static const char SnapshotMagic[8] = { 'T', 'a', 'u', 'D', 'i', 'r', 'I', '1' };
+static const uint32_t SnapshotVersion = 1;
+static const uint32_t ByteOrderMark = 0x01020304;
+
+template <class T>
+static void appendValue(string* out, const T& value)
+{
+    out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void appendString(string* out, string_view str)
+{
+    appendValue(out, static_cast<uint32_t>(str.size()));
+    out->append(str);
+}
+
+//
+// SnapshotReader - bounds checked reads from the mapped snapshot
+//
+struct SnapshotReader {
+    const char* data;
+    size_t size;
+    size_t pos {0};
+    bool ok {true};
+
+    template <class T>
+    T Read() {
+        T value {};
+        if (!ok || size - pos < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    string ReadString() {
+        uint32_t length = Read<uint32_t>();
+        if (!ok || size - pos < length) {
+            ok = false;
+            return string();
+        }
+        string str(data + pos, length);
+        pos += length;
+        return str;
+    }
+};
+
+//
+// Save
+//
+bool DirIndex::Save(const string& snapshotPath) const
+{
+    string out;
+    {
+        shared_lock<shared_mutex> lock(dataLock);
+        out.append(SnapshotMagic, sizeof(SnapshotMagic));
+        appendValue(&out, SnapshotVersion);
+        appendValue(&out, ByteOrderMark);
+        appendValue(&out, static_cast<uint64_t>(dirs.size()));
+        appendString(&out, root);
+        for (const auto& [key, dir] : dirs) {
+            appendString(&out, key);
+            appendValue(&out, dir.mtime);
+            appendValue(&out, dir.inode);
+            appendValue(&out, static_cast<uint32_t>(dir.entries.size()));
+            for (const auto& entry : dir.entries) {
+                appendString(&out, entry.name);
+                appendValue(&out, static_cast<uint8_t>(entry.type));
+                appendValue(&out, static_cast<uint8_t>(entry.isSymlink));
+                appendValue(&out, entry.size);
+                appendValue(&out, entry.mtime);
+                appendValue(&out, entry.inode);
+            }
+        }
+    }
+
+    // write to a temp file and rename it into place so a reader never sees half a snapshot
+    string tempPath = snapshotPath + ".tmp";
+    {
+        ofstream ofile(tempPath, ios_base::out | ios_base::binary | ios_base::trunc);
+        if (!ofile.is_open())
+            return false;
+        if (!ofile.write(out.data(), static_cast<streamsize>(out.size()))) {
+            ofile.close();
+            fs::remove(tempPath);
+            return false;
+        }
+    }
+    error_code ec;
+    fs::rename(tempPath, snapshotPath, ec);
+    if (ec)
+        fs::remove(tempPath, ec);
+    return !ec;
+}
+
+//
+// Load
+//
+bool DirIndex::Load(const string& snapshotPath)
+{
+    MappedFile file(snapshotPath);
+    if (!file.IsOpen() || file.size() < sizeof(SnapshotMagic))
+        return false;
+
+    SnapshotReader in { file.data(), file.size() };
+    if (memcmp(file.data(), SnapshotMagic, sizeof(SnapshotMagic)) != 0)
+        return false;
+    in.pos = sizeof(SnapshotMagic);
+    if (in.Read<uint32_t>() != SnapshotVersion || in.Read<uint32_t>() != ByteOrderMark)
+        return false;
+
+    uint64_t dirCount = in.Read<uint64_t>();
+    string newRoot = in.ReadString();
+    DirMap newDirs;
+    for (uint64_t d = 0; d < dirCount && in.ok; ++d) {
+        string key = in.ReadString();
+        Dir& dir = newDirs[key];
+        dir.mtime = in.Read<int64_t>();
+        dir.inode = in.Read<uint64_t>();
+        uint32_t entryCount = in.Read<uint32_t>();
+        if (!in.ok || entryCount > (in.size - in.pos) / 30)     // 30 == smallest entry
+            return false;
+        dir.entries.resize(entryCount);
+        for (auto& entry : dir.entries) {
+            entry.name = in.ReadString();
+            entry.type = static_cast<DirEntryType>(in.Read<uint8_t>());
+            entry.isSymlink = in.Read<uint8_t>() != 0;
+            entry.size = in.Read<uint64_t>();
+            entry.mtime = in.Read<int64_t>();
+            entry.inode = in.Read<uint64_t>();
+        }
+    }
+    if (!in.ok || newRoot.empty())
+        return false;
+
+    lock_guard<mutex> refresh(refreshLock);
+    CloseWatch();
+    unique_lock<shared_mutex> lock(dataLock);
+    root = std::move(newRoot);
+    dirs = std::move(newDirs);
+    return true;
+}
+
+                //*******************************
+                // Queries
+                //*******************************
+
+//
+// KeyOf - the key of a path under the root or relative to it
+//
+bool DirIndex::KeyOf(const string& path, string* key) const
+{
+    string p = normalizePath(path);
+    if (p == root) {
+        key->clear();
+        return true;
+    }
+    string rootWithSep = root + sep;
+    if (p.compare(0, rootWithSep.size(), rootWithSep) == 0) {
+        *key = p.substr(rootWithSep.size());
+        return true;
+    }
+    bool absolute = (!p.empty() && p[0] == separator) || (p.size() > 1 && p[1] == ':');
+    if (absolute || p.empty())
+        return false;
+    *key = p;
+    return true;
+}
+
+//
+// Find - the entry for a path.  call with dataLock held.
+//
+const DirIndexEntry* DirIndex::Find(const string& path) const
+{
+    string key;
+    if (!KeyOf(path, &key) || key.empty())
+        return nullptr;
+
+    size_t split = key.rfind(separator);
+    string parentKey = (split == string::npos) ? string() : key.substr(0, split);
+    string_view name = (split == string::npos) ? string_view(key) : string_view(key).substr(split + 1);
+
+    auto it = dirs.find(parentKey);
+    if (it == dirs.end())
+        return nullptr;
+    const auto& entries = it->second.entries;
+    auto entry = lower_bound(entries.begin(), entries.end(), name,
+                             [] (const DirIndexEntry& e, string_view n) { return string_view(e.name) < n; });
+    if (entry == entries.end() || entry->name != name)
+        return nullptr;
+    return &*entry;
+}
+
+string DirIndex::RootPath() const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    return root;
+}
+
+size_t DirIndex::DirCount() const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    return dirs.size();
+}
+
+size_t DirIndex::EntryCount() const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    size_t count = 0;
+    for (const auto& [key, dir] : dirs)
+        count += dir.entries.size();
+    return count;
+}
+
+bool DirIndex::FileExists(const string& path) const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    const DirIndexEntry* entry = Find(path);
+    return entry != nullptr && entry->IsFile();
+}
+
+bool DirIndex::DirExists(const string& path) const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    string key;
+    if (KeyOf(path, &key) && dirs.count(key))
+        return true;
+    const DirIndexEntry* entry = Find(path);
+    return entry != nullptr && entry->IsDirectory();
+}
+
+uintmax_t DirIndex::GetFileSize(const string& path) const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    const DirIndexEntry* entry = Find(path);
+    return (entry != nullptr) ? entry->size : 0;
+}
+
+bool DirIndex::GetEntry(const string& path, DirIndexEntry* entry) const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    const DirIndexEntry* found = Find(path);
+    if (found == nullptr)
+        return false;
+    *entry = *found;
+    return true;
+}
+
+vector<DirIndexEntry> DirIndex::GetEntriesInDir(const string& dirPath) const
+{
+    shared_lock<shared_mutex> lock(dataLock);
+    string key;
+    if (!KeyOf(dirPath, &key))
+        return {};
+    auto it = dirs.find(key);
+    return (it != dirs.end()) ? it->second.entries : vector<DirIndexEntry>();
+}
+
+Strings DirIndex::GetFileNamesInDir(const string& dirPath) const
+{
+    Strings names;
+    shared_lock<shared_mutex> lock(dataLock);
+    string key;
+    if (!KeyOf(dirPath, &key))
+        return names;
+    auto it = dirs.find(key);
+    if (it != dirs.end()) {
+        for (const auto& entry : it->second.entries) {
+            if (entry.IsFile())
+                names.push_back(entry.name);
+        }
+    }
+    return names;
+}
+
+Strings DirIndex::GetDirNamesInDir(const string& dirPath) const
+{
+    Strings names;
+    shared_lock<shared_mutex> lock(dataLock);
+    string key;
+    if (!KeyOf(dirPath, &key))
+        return names;
+    auto it = dirs.find(key);
+    if (it != dirs.end()) {
+        for (const auto& entry : it->second.entries) {
+            if (entry.IsDirectory())
+                names.push_back(entry.name);
+        }
+    }
+    return names;
+}
+
+} // end namespace Tau
@@ -0,0 +1,136 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for DirIndex, an in memory index of a directory tree.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <cstdint>
+#include "Str.h"
+#include "DirWalk.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief DirIndexEntry - one file or directory in a DirIndex
+///
+struct DirIndexEntry {
+    std::string name;
+    DirEntryType type {DirEntryType::Unknown};
+    bool isSymlink {false};
+    uint64_t size {0};          ///< file size.  0 for a directory.
+    int64_t mtime {0};          ///< last write time in nanoseconds since 1970
+    uint64_t inode {0};         ///< 0 on Windows
+
+    bool IsFile() const { return type == DirEntryType::File; }
+    bool IsDirectory() const { return type == DirEntryType::Directory; }
+};
+
+///
+/// @brief DirIndex - keeps the names, types, sizes and times of a directory tree in memory so lookups don't touch the disk.
+/// @remark Build() walks the tree once (see DirWalk).  Save() and Load() keep a snapshot between runs.
+/// @remark Refresh() brings the index up to date.  With Watch() (Linux inotify) only the directories that had events
+///         are read again.  Otherwise every directory's last write time is checked and only the changed ones are read again.
+///         A directory's time changes when entries are added, removed or renamed, not when a file's contents change,
+///         so without Watch() pass restatFiles to pick up changed file sizes and times.
+/// @remark Paths passed to the queries are either under the root path as passed to Build() or relative to the root.
+/// @remark The queries can be called from multiple threads, also while a Refresh() is running.
+/// @code
+///     DirIndex index;
+///     if (!index.Load(snapshot))
+///         index.Build(romsDir);
+///     index.Watch();
+///     ...
+///     index.Refresh();
+///     Strings names = index.GetFileNamesInDir(romsDir + sep + "snes");
+/// @endcode
+///
+class DirIndex {
+public:
+    DirIndex();
+    ~DirIndex();
+
+    DirIndex(const DirIndex&) = delete;
+    DirIndex& operator = (const DirIndex&) = delete;
+
+                //*******************************
+                // Build, Save, Load, Refresh
+                //*******************************
+
+    /// @brief index the directory tree.  returns false if rootPath isn't a directory.
+    bool Build(const std::string& rootPath);
+
+    /// @brief write a snapshot of the index.  written to a temp file and renamed into place.
+    bool Save(const std::string& snapshotPath) const;
+
+    /// @brief read a snapshot.  call Refresh() after to pick up changes made since it was saved.
+    bool Load(const std::string& snapshotPath);
+
+    ///
+    /// @brief Refresh - update the index from the file system
+    /// @param restatFiles also read the size and time of every file (only needed without Watch())
+    /// @return the number of directories read again
+    ///
+    size_t Refresh(bool restatFiles = false);
+
+    /// @brief watch the tree for changes with inotify so Refresh() only reads what changed.  false if not available.
+    bool Watch();
+    void StopWatching();
+    bool IsWatching() const { return watchFd >= 0; }
+
+                //*******************************
+                // Queries
+                //*******************************
+
+    std::string RootPath() const;
+    size_t DirCount() const;
+    size_t EntryCount() const;
+
+    bool FileExists(const std::string& path) const;
+    bool DirExists(const std::string& path) const;
+    uintmax_t GetFileSize(const std::string& path) const;              ///< 0 if not found
+    bool GetEntry(const std::string& path, DirIndexEntry* entry) const;
+
+    Strings GetFileNamesInDir(const std::string& dirPath) const;        ///< sorted by name
+    Strings GetDirNamesInDir(const std::string& dirPath) const;         ///< sorted by name
+    std::vector<DirIndexEntry> GetEntriesInDir(const std::string& dirPath) const;
+
+private:
+    struct Dir {
+        int64_t mtime {0};
+        uint64_t inode {0};
+        std::vector<DirIndexEntry> entries;     // sorted by name
+    };
+    using DirMap = std::map<std::string, Dir>;  // key is the path relative to the root.  "" for the root.
+
+    bool KeyOf(const std::string& path, std::string* key) const;
+    const DirIndexEntry* Find(const std::string& path) const;
+    std::string FullPath(const std::string& key) const;
+    bool ScanTree(const std::string& key, DirMap* out) const;
+    bool ScanDir(const std::string& key, Dir* dir) const;
+    size_t Rescan(const std::vector<std::string>& changedKeys, bool restatFiles);
+    void AddWatches(const DirMap& newDirs);
+    void CloseWatch();
+    bool ReadWatchEvents(std::vector<std::string>* changedKeys, bool* overflow);
+
+    std::string root;
+    DirMap dirs;
+    mutable std::shared_mutex dataLock;     // shared for queries, unique while the index changes
+    std::mutex refreshLock;                 // one Build/Load/Refresh at a time
+
+    std::atomic<int> watchFd {-1};                     // inotify fd.  changed under refreshLock, read by IsWatching()
+    std::unordered_map<int, std::string> watchKeys;    // inotify watch descriptor -> dir key.  guarded by refreshLock
+    std::unordered_map<std::string, int> watchedDirs;  // dir key -> its live watch descriptor.  guarded by refreshLock
+};
+
+} // end namespace Tau
@@ -0,0 +1,440 @@
+///
+/// @file
+/// @brief CPP file for DirWalk, a parallel directory tree walker.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "DirWalk.h"
+#include <atomic>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#if defined(_WIN32)
+#include "windows.h"
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+                //*******************************
+                // Reading one directory
+                //*******************************
+
+namespace {
+
+//
+// OpenDir - a directory fd that subdirectories can be opened relative to (openat).  closed when the last child is opened.
+//
+struct OpenDir {
+    int fd {-1};
+    ~OpenDir();
+};
+
+//
+// WorkItem - a directory waiting to be read
+//
+struct WorkItem {
+    string path;
+    unsigned int depth {0};
+    shared_ptr<OpenDir> parent;     // the parent directory if it's still open
+    uint32_t nameOffset {0};        // the directory name in path
+};
+
+static atomic<int> heldDirFds {0};
+static constexpr int maxHeldDirFds = 512;     // past this subdirectories are opened by full path
+
+#if defined(_WIN32)
+
+OpenDir::~OpenDir() {}
+
+//
+// readDir - Windows.  FindFirstFileEx with the basic info level and large fetch.
+//
+static bool readDir(const WorkItem& item, const DirWalkOptions&, DirWalkBatch* batch, shared_ptr<OpenDir>*, vector<char>*)
+{
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileExA((item.path + sep + "*").c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+                                   FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE)
+        return false;
+
+    do {
+        const char* name = data.cFileName;
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+            continue;
+
+        DirWalkBatch::Item entry;
+        entry.nameOffset = static_cast<uint32_t>(batch->names.size());
+        entry.nameLength = static_cast<uint32_t>(strlen(name));
+        entry.isSymlink = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) &&
+                          (data.dwReserved0 == IO_REPARSE_TAG_SYMLINK || data.dwReserved0 == IO_REPARSE_TAG_MOUNT_POINT);
+        entry.type = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? DirEntryType::Directory : DirEntryType::File;
+        batch->names.append(name, entry.nameLength);
+        batch->items.push_back(entry);
+    } while (FindNextFileA(find, &data));
+
+    FindClose(find);
+    return true;
+}
+
+#else
+
+OpenDir::~OpenDir()
+{
+    if (fd >= 0) {
+        close(fd);
+        --heldDirFds;
+    }
+}
+
+//
+// typeFromMode
+//
+static DirEntryType typeFromMode(mode_t mode)
+{
+    if (S_ISREG(mode))
+        return DirEntryType::File;
+    if (S_ISDIR(mode))
+        return DirEntryType::Directory;
+    return DirEntryType::Other;
+}
+
+//
+// addEntry - fill in the type of one entry.  d_type saves a stat call for almost every entry.
+//
+static void addEntry(int dirFd, const char* name, unsigned char d_type, DirWalkBatch* batch)
+{
+    if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+        return;
+
+    DirWalkBatch::Item entry;
+    entry.nameOffset = static_cast<uint32_t>(batch->names.size());
+    entry.nameLength = static_cast<uint32_t>(strlen(name));
+
+    struct stat st;
+    switch (d_type) {
+    case DT_REG:
+        entry.type = DirEntryType::File;
+        break;
+    case DT_DIR:
+        entry.type = DirEntryType::Directory;
+        break;
+    case DT_LNK:
+        entry.isSymlink = true;
+        break;
+    case DT_UNKNOWN:        // some file systems (ex: older xfs, some NFS) don't fill in d_type
+        if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            if (S_ISLNK(st.st_mode))
+                entry.isSymlink = true;
+            else
+                entry.type = typeFromMode(st.st_mode);
+        }
+        break;
+    default:
+        entry.type = DirEntryType::Other;
+        break;
+    }
+
+    // a symlink has the type of what it points to the same as fs::directory_entry::is_regular_file()
+    if (entry.isSymlink && fstatat(dirFd, name, &st, 0) == 0)
+        entry.type = typeFromMode(st.st_mode);
+
+    batch->names.append(name, entry.nameLength);
+    batch->items.push_back(entry);
+}
+
+//
+// openDir - open relative to the parent directory if it's still open.  saves the kernel walking the whole path again.
+//
+static int openDir(const WorkItem& item, const DirWalkOptions& options)
+{
+    int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+    if (!options.followSymlinks && item.depth > 0)
+        flags |= O_NOFOLLOW;
+    if (item.parent && item.parent->fd >= 0)
+        return openat(item.parent->fd, item.path.c_str() + item.nameOffset, flags);
+    return open(item.path.c_str(), flags);
+}
+
+//
+// readDir - Linux uses getdents64 into a per thread buffer.  other posix systems use readdir.
+//
+static bool readDir(const WorkItem& item, const DirWalkOptions& options, DirWalkBatch* batch, shared_ptr<OpenDir>* dirOut,
+                    vector<char>* buffer)
+{
+    int fd = openDir(item, options);
+    if (fd < 0)
+        return false;
+
+#if defined(__linux__)
+    struct linux_dirent64 {
+        uint64_t        d_ino;
+        int64_t         d_off;
+        unsigned short  d_reclen;
+        unsigned char   d_type;
+        char            d_name[1];
+    };
+    for (;;) {
+        long bytes = syscall(SYS_getdents64, fd, buffer->data(), buffer->size());
+        if (bytes <= 0)
+            break;
+        for (long pos = 0; pos < bytes; ) {
+            auto* dirent = reinterpret_cast<linux_dirent64*>(buffer->data() + pos);
+            addEntry(fd, dirent->d_name, dirent->d_type, batch);
+            pos += dirent->d_reclen;
+        }
+    }
+#else
+    (void) buffer;
+    int readFd = dup(fd);       // closedir closes the fd it's given
+    DIR* dir = (readFd >= 0) ? fdopendir(readFd) : nullptr;
+    if (dir == nullptr) {
+        if (readFd >= 0)
+            close(readFd);
+        close(fd);
+        return false;
+    }
+    while (struct dirent* dirent = readdir(dir))
+        addEntry(fd, dirent->d_name, dirent->d_type, batch);
+    closedir(dir);
+#endif
+
+    // keep the fd open for opening the subdirectories with openat, within a limit
+    if (heldDirFds.load(memory_order_relaxed) < maxHeldDirFds) {
+        ++heldDirFds;
+        *dirOut = make_shared<OpenDir>();
+        (*dirOut)->fd = fd;
+    } else {
+        close(fd);
+    }
+    return true;
+}
+
+#endif
+
+                //*******************************
+                // Work stealing walker
+                //*******************************
+
+//
+// Walker - each worker has its own queue of directories.  a worker takes from the back of its own queue (depth first,
+// warm caches) and when it runs out it steals from the front of another worker's queue (the biggest unwalked subtrees).
+//
+struct Walker {
+    struct Queue {
+        mutex lock;
+        deque<WorkItem> items;
+    };
+
+    const DirWalkOptions& options;
+    const function<void (unsigned int, const DirWalkBatch&)>& onBatch;
+    size_t rootLength {0};
+    vector<unique_ptr<Queue>> queues;
+
+    atomic<size_t> pending {0};     // directories queued or being read
+    atomic<size_t> queued {0};      // directories queued
+    atomic<int> idleWorkers {0};
+    mutex idleLock;
+    condition_variable idleWake;
+
+    // directories already walked.  only used when following symlinks, to stop loops.
+    mutex visitedLock;
+    set<pair<uint64_t, uint64_t>> visited;
+
+    Walker(const DirWalkOptions& _options, const function<void (unsigned int, const DirWalkBatch&)>& _onBatch, unsigned int workers)
+        : options(_options), onBatch(_onBatch)
+    {
+        for (unsigned int i = 0; i < workers; ++i)
+            queues.emplace_back(make_unique<Queue>());
+    }
+
+    void Push(unsigned int worker, WorkItem&& item) {
+        ++pending;
+        {
+            lock_guard<mutex> guard(queues[worker]->lock);
+            queues[worker]->items.emplace_back(std::move(item));
+        }
+        ++queued;
+        if (idleWorkers.load() > 0) {
+            lock_guard<mutex> guard(idleLock);      // an idle worker is either waiting already or will see queued > 0
+            idleWake.notify_one();
+        }
+    }
+
+    bool Pop(unsigned int worker, WorkItem* item) {
+        // own queue first, newest first
+        {
+            Queue& own = *queues[worker];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.items.empty()) {
+                *item = std::move(own.items.back());
+                own.items.pop_back();
+                --queued;
+                return true;
+            }
+        }
+        // steal the oldest from the others
+        for (size_t i = 1; i < queues.size(); ++i) {
+            Queue& other = *queues[(worker + i) % queues.size()];
+            lock_guard<mutex> guard(other.lock);
+            if (!other.items.empty()) {
+                *item = std::move(other.items.front());
+                other.items.pop_front();
+                --queued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Done() {
+        if (--pending == 0) {
+            lock_guard<mutex> guard(idleLock);
+            idleWake.notify_all();
+        }
+    }
+
+    bool FirstVisit(const WorkItem& item, const shared_ptr<OpenDir>& dir) {
+#if defined(_WIN32)
+        // the directory a symlink or junction leads to, by volume and file index
+        (void) dir;
+        HANDLE handle = CreateFileA(item.path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;   // can't tell if it's been walked, so don't risk a loop
+        BY_HANDLE_FILE_INFORMATION info;
+        BOOL ok = GetFileInformationByHandle(handle, &info);
+        CloseHandle(handle);
+        if (!ok)
+            return false;
+        uint64_t fileIndex = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+        lock_guard<mutex> guard(visitedLock);
+        return visited.emplace(static_cast<uint64_t>(info.dwVolumeSerialNumber), fileIndex).second;
+#else
+        struct stat st;
+        int ok = (dir && dir->fd >= 0) ? fstat(dir->fd, &st) : stat(item.path.c_str(), &st);
+        if (ok != 0)
+            return true;
+        lock_guard<mutex> guard(visitedLock);
+        return visited.emplace(static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino)).second;
+#endif
+    }
+
+    void Process(unsigned int worker, WorkItem& item, vector<char>* buffer) {
+        DirWalkBatch batch;
+        shared_ptr<OpenDir> dir;
+        if (!readDir(item, options, &batch, &dir, buffer))
+            return;
+        item.parent.reset();        // the parent fd can close once all its children are open
+
+        if (options.followSymlinks && !FirstVisit(item, dir))
+            return;
+
+        batch.dirPath = std::move(item.path);
+        batch.relativeStart = rootLength;
+        batch.depth = item.depth;
+        if (options.sorted) {
+            const string& names = batch.names;
+            sort(batch.items.begin(), batch.items.end(), [&] (const DirWalkBatch::Item& a, const DirWalkBatch::Item& b) {
+                return string_view(names).substr(a.nameOffset, a.nameLength) < string_view(names).substr(b.nameOffset, b.nameLength);
+            });
+        }
+
+        onBatch(worker, batch);
+
+        if (!options.recursive || batch.depth >= options.maxDepth)
+            return;
+        for (const auto& entry : batch.items) {
+            if (entry.type != DirEntryType::Directory || (entry.isSymlink && !options.followSymlinks))
+                continue;
+            WorkItem child;
+            child.path = batch.dirPath + sep;
+            child.nameOffset = static_cast<uint32_t>(child.path.size());
+            child.path.append(batch.names, entry.nameOffset, entry.nameLength);
+            child.depth = batch.depth + 1;
+            child.parent = dir;
+            Push(worker, std::move(child));
+        }
+    }
+
+    void Run(unsigned int worker) {
+        vector<char> buffer(64 * 1024);
+        WorkItem item;
+        for (;;) {
+            if (Pop(worker, &item)) {
+                Process(worker, item, &buffer);
+                item = WorkItem();
+                Done();
+                continue;
+            }
+
+            unique_lock<mutex> lock(idleLock);
+            ++idleWorkers;
+            idleWake.wait(lock, [&] { return pending.load() == 0 || queued.load() > 0; });
+            --idleWorkers;
+            if (pending.load() == 0)
+                return;
+        }
+    }
+};
+
+} // end anonymous namespace
+
+//
+// DirWalkThreadCount
+//
+unsigned int DirWalkThreadCount(const DirWalkOptions& options)
+{
+    if (!options.recursive)
+        return 1;
+    unsigned int threads = max(1u, thread::hardware_concurrency());
+    threads = min(threads, 8u);     // more than this just queues up in the file system
+    if (options.maxThreads > 0)
+        threads = min(threads, options.maxThreads);
+    return threads;
+}
+
+//
+// DirWalkBatches
+//
+void DirWalkBatches(const string& rootPath, const DirWalkOptions& options,
+                    const function<void (unsigned int worker, const DirWalkBatch& batch)>& onBatch)
+{
+    // remove separators from the end (but keep a root "/")
+    string root = rootPath;
+    while (root.size() > 1 && (root.back() == '/' || root.back() == '\\'))
+        root.pop_back();
+    if (root.empty())
+        return;
+
+    unsigned int workers = DirWalkThreadCount(options);
+    Walker walker(options, onBatch, workers);
+    walker.rootLength = (root + sep).size();
+
+    WorkItem rootItem;
+    rootItem.path = root;
+    walker.Push(0, std::move(rootItem));
+
+    vector<thread> threads;
+    for (unsigned int worker = 1; worker < workers; ++worker)
+        threads.emplace_back([&walker, worker] { walker.Run(worker); });
+    walker.Run(0);
+    for (auto& t : threads)
+        t.join();
+}
+
+} // end namespace Tau
@@ -0,0 +1,165 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for DirWalk, a parallel directory tree walker.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <climits>
+#include <cstdint>
+#include "sep.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief DirEntryType - the type of a directory entry.  a symlink has the type of what it points to.
+///
+enum class DirEntryType : uint8_t {
+    Unknown,        ///< couldn't be determined (ex: a broken symlink)
+    File,           ///< regular file
+    Directory,
+    Other           ///< device, fifo, socket, etc.
+};
+
+///
+/// @brief DirWalkEntry - one entry of a directory.  only valid during the callback it's passed to.
+///
+struct DirWalkEntry {
+    std::string_view dirPath;       ///< the directory the entry is in.  starts with the root path passed to DirWalk.
+    std::string_view relativeDir;   ///< dirPath relative to the root.  "" for entries directly in the root.
+    std::string_view name;          ///< the file or directory name
+    DirEntryType type {DirEntryType::Unknown};
+    bool isSymlink {false};
+    unsigned int depth {0};         ///< 0 for entries directly in the root
+
+    bool IsFile() const { return type == DirEntryType::File; }
+    bool IsDirectory() const { return type == DirEntryType::Directory; }
+
+    /// @brief the full path.  dirPath + sep + name
+    std::string FullPath() const { return std::string(dirPath) + sep + std::string(name); }
+
+    /// @brief the path relative to the root.  relativeDir + sep + name
+    std::string RelativePath() const { return relativeDir.empty() ? std::string(name) : std::string(relativeDir) + sep + std::string(name); }
+};
+
+///
+/// @brief DirWalkOptions - controls a DirWalk
+///
+struct DirWalkOptions {
+    bool recursive {true};              ///< false to only list the root directory
+    bool followSymlinks {false};        ///< true to walk into symlinked directories.  loops are detected.
+    bool sorted {false};                ///< true for a repeatable order: the entries of each directory are sorted by name and the directories by path
+    unsigned int maxThreads {0};        ///< 0 == the number of hardware threads, at most 8
+    unsigned int maxDepth {UINT_MAX};   ///< the deepest level of subdirectories walked into.  0 == only the root.
+};
+
+///
+/// @brief DirWalkBatch - the entries of one directory
+///
+struct DirWalkBatch {
+    struct Item {
+        uint32_t nameOffset {0};
+        uint32_t nameLength {0};
+        DirEntryType type {DirEntryType::Unknown};
+        bool isSymlink {false};
+    };
+
+    std::string dirPath;
+    size_t relativeStart {0};       ///< where the path relative to the root starts in dirPath
+    unsigned int depth {0};
+    std::string names;              ///< all the entry names.  items index into it.
+    std::vector<Item> items;
+
+    size_t size() const { return items.size(); }
+    DirWalkEntry operator [] (size_t i) const {
+        const Item& item = items[i];
+        std::string_view dir(dirPath);
+        return DirWalkEntry { dir, dir.substr(std::min(relativeStart, dir.size())),
+                              std::string_view(names).substr(item.nameOffset, item.nameLength), item.type, item.isSymlink, depth };
+    }
+};
+
+///
+/// @brief DirWalkThreadCount - the number of threads a DirWalk with these options uses
+///
+unsigned int DirWalkThreadCount(const DirWalkOptions& options);
+
+///
+/// @brief DirWalkBatches - walks a directory tree and calls onBatch once for each directory read
+/// @param rootPath the directory to walk
+/// @param options see DirWalkOptions
+/// @param onBatch called with (worker index, batch).  called on up to DirWalkThreadCount() threads at once.  must not throw.
+/// @remark Directories are shared out between threads with work stealing.  Directories that can't be read are skipped.
+/// @remark On Linux a directory is read with getdents64() and subdirectories are opened with openat() relative to their parent.
+///
+void DirWalkBatches(const std::string& rootPath, const DirWalkOptions& options,
+                    const std::function<void (unsigned int worker, const DirWalkBatch& batch)>& onBatch);
+
+///
+/// @brief DirWalk - walks a directory tree on multiple threads and returns proj(entry) for each entry where pred(entry) is true
+/// @param rootPath the directory to walk
+/// @param pred bool (const DirWalkEntry&).  called on multiple threads.
+/// @param proj T (const DirWalkEntry&).  called on multiple threads.
+/// @param options see DirWalkOptions.  the order of the results is only repeatable with options.sorted.
+/// @return std::vector<T>
+/// @code
+///     Strings files = DirWalk(path, [] (const DirWalkEntry& e) { return e.IsFile(); },
+///                                   [] (const DirWalkEntry& e) { return e.FullPath(); });
+/// @endcode
+///
+template <class Pred, class Proj>
+auto DirWalk(const std::string& rootPath, Pred&& pred, Proj&& proj, const DirWalkOptions& options = DirWalkOptions())
+{
+    using Result = std::decay_t<std::invoke_result_t<Proj&, const DirWalkEntry&>>;
+
+    // each worker keeps its own results so the threads don't share anything while walking
+    unsigned int workers = DirWalkThreadCount(options);
+    std::vector<std::vector<Result>> workerResults(workers);
+    std::vector<std::vector<std::pair<std::string, std::vector<Result>>>> workerDirs(options.sorted ? workers : 0);
+
+    DirWalkBatches(rootPath, options, [&] (unsigned int worker, const DirWalkBatch& batch) {
+        std::vector<Result>* out = &workerResults[worker];
+        if (options.sorted)
+            out = &workerDirs[worker].emplace_back(batch.dirPath, std::vector<Result>()).second;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            DirWalkEntry entry = batch[i];
+            if (pred(entry))
+                out->emplace_back(proj(entry));
+        }
+    });
+
+    std::vector<Result> results;
+    if (options.sorted) {
+        std::vector<std::pair<std::string, std::vector<Result>>*> dirs;
+        for (auto& worker : workerDirs) {
+            for (auto& dir : worker)
+                dirs.push_back(&dir);
+        }
+        std::sort(dirs.begin(), dirs.end(), [] (const auto* a, const auto* b) { return a->first < b->first; });
+        for (auto* dir : dirs)
+            std::move(dir->second.begin(), dir->second.end(), std::back_inserter(results));
+    } else {
+        size_t total = 0;
+        for (auto& worker : workerResults)
+            total += worker.size();
+        if (workers == 1)
+            return std::move(workerResults[0]);
+        results.reserve(total);
+        for (auto& worker : workerResults)
+            std::move(worker.begin(), worker.end(), std::back_inserter(results));
+    }
+    return results;
+}
+
+} // end namespace Tau
@@ -0,0 +1,244 @@
+///
+/// @file
+/// @brief CPP file for CompareFileContents, a streaming byte by byte file comparison.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "FileCompare.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+namespace {
+
+static constexpr size_t blockSize = 1024 * 1024;
+
+//
+// FileBlocks - a file a block at a time, memory mapped or read.  optionally with CR LF converted to LF and the
+// line endings at the end of the file left off.
+//
+class FileBlocks {
+public:
+    bool Open(const string& filePath, bool _normalize) {
+        normalize = _normalize;
+        if (mapped.Open(filePath))
+            return true;
+        stream.open(filePath, ios::binary);
+        if (!stream.is_open())
+            return false;
+        readBuffer.resize(blockSize);
+        return true;
+    }
+
+    /// @brief the next block.  never empty.  false at the end of the file.
+    bool Next(string_view* block) {
+        if (!normalize)
+            return NextRaw(block);
+
+        string_view raw;
+        while (NextRaw(&raw)) {
+            out.assign(heldLF ? 1 : 0, '\n');     // the line ending held back from the end of the last block
+            heldLF = false;
+            size_t i = 0;
+            if (pendingCR) {
+                pendingCR = false;
+                if (raw[0] != '\n')
+                    out += '\r';
+            }
+            for (; i < raw.size(); ++i) {
+                char ch = raw[i];
+                if (ch == '\r') {
+                    if (i + 1 == raw.size())
+                        pendingCR = true;   // CR LF might be split across blocks
+                    else if (raw[i + 1] != '\n')
+                        out += ch;
+                } else {
+                    out += ch;
+                }
+            }
+            if (HoldLastLF())
+                continue;
+            *block = out;
+            return true;
+        }
+        if (pendingCR) {
+            // a CR on its own at the end of the file is compared, and then the held line ending isn't the last
+            pendingCR = false;
+            out.assign(heldLF ? "\n\r" : "\r");
+            heldLF = false;
+            *block = out;
+            return true;
+        }
+        return false;       // at the end the held line ending is left off
+    }
+
+private:
+    // hold back the line ending at the end of out in case it's the end of the file.  only the one that ends the
+    // last line is left off, so "a\n" matches "a" but "a\n\n" doesn't match "a\n", and "\n" doesn't match "".
+    // true if nothing is left in out.
+    bool HoldLastLF() {
+        if (out.empty())
+            return true;
+        if (out.back() == '\n') {
+            int before = (out.size() > 1) ? static_cast<unsigned char>(out[out.size() - 2]) : lastChar;
+            if (before != '\n' && before != -1) {
+                out.pop_back();
+                heldLF = true;
+            }
+        }
+        if (out.empty())
+            return true;
+        lastChar = static_cast<unsigned char>(out.back());
+        return false;
+    }
+
+    bool NextRaw(string_view* block) {
+        if (mapped.IsOpen()) {
+            if (mappedPos >= mapped.size())
+                return false;
+            size_t length = min(blockSize, mapped.size() - mappedPos);
+            *block = string_view(mapped.data() + mappedPos, length);
+            mappedPos += length;
+            return true;
+        }
+        stream.read(readBuffer.data(), static_cast<streamsize>(readBuffer.size()));
+        size_t length = static_cast<size_t>(stream.gcount());
+        if (length == 0)
+            return false;
+        *block = string_view(readBuffer.data(), length);
+        return true;
+    }
+
+    MappedFile mapped;
+    size_t mappedPos {0};
+    ifstream stream;
+    vector<char> readBuffer;
+
+    bool normalize {false};
+    string out;
+    bool pendingCR {false};
+    bool heldLF {false};
+    int lastChar {-1};          // the last byte given out, -1 before the first
+};
+
+//
+// locate - the offset in the file and the line of a byte found by its offset in the compared (maybe normalized) bytes
+//
+static void locate(const string& filePath, bool normalize, uintmax_t comparedOffset, uintmax_t* offset, uintmax_t* line)
+{
+    FileBlocks file;
+    uintmax_t raw = 0;
+    uintmax_t compared = 0;
+    uintmax_t lines = 1;
+    bool pendingCR = false;
+    string_view block;
+
+    if (file.Open(filePath, false)) {
+        while (file.Next(&block)) {
+            for (char ch : block) {
+                if (pendingCR) {
+                    pendingCR = false;
+                    if (ch != '\n') {       // a CR on its own is compared
+                        if (compared == comparedOffset) {
+                            *offset = raw - 1;
+                            *line = lines;
+                            return;
+                        }
+                        ++compared;
+                    }
+                }
+                if (normalize && ch == '\r') {
+                    pendingCR = true;
+                    ++raw;
+                    continue;
+                }
+                if (compared == comparedOffset) {
+                    *offset = raw;
+                    *line = lines;
+                    return;
+                }
+                if (ch == '\n')
+                    ++lines;
+                ++compared;
+                ++raw;
+            }
+        }
+    }
+    *offset = (pendingCR && compared == comparedOffset) ? raw - 1 : raw;
+    *line = lines;
+}
+
+} // end anonymous namespace
+
+//
+// CompareFileContents
+//
+bool CompareFileContents(const string& filePath1, const string& filePath2, bool ignoreCRLF, FileCompareResult* result)
+{
+    FileCompareResult ignored;
+    if (result == nullptr)
+        result = &ignored;
+    *result = FileCompareResult();
+
+    // the same file
+    error_code ec;
+    if (fs::equivalent(filePath1, filePath2, ec) && !ec) {
+        result->equal = true;
+        return true;
+    }
+
+    // different sizes.  only when where they differ isn't wanted.
+    if (!ignoreCRLF && result == &ignored) {
+        error_code ec1, ec2;
+        uintmax_t size1 = fs::file_size(filePath1, ec1);
+        uintmax_t size2 = fs::file_size(filePath2, ec2);
+        if (!ec1 && !ec2 && size1 != size2)
+            return false;
+    }
+
+    FileBlocks file1, file2;
+    if (!file1.Open(filePath1, ignoreCRLF) || !file2.Open(filePath2, ignoreCRLF)) {
+        result->openFailed = true;
+        return false;
+    }
+
+    // a block at a time.  the blocks of the two files don't line up with ignoreCRLF.
+    string_view block1, block2;
+    uintmax_t compared = 0;
+    for (;;) {
+        bool more1 = !block1.empty() || file1.Next(&block1);
+        bool more2 = !block2.empty() || file2.Next(&block2);
+        if (!more1 || !more2) {
+            result->equal = (more1 == more2);
+            break;
+        }
+
+        size_t length = min(block1.size(), block2.size());
+        if (memcmp(block1.data(), block2.data(), length) != 0) {
+            auto diff = mismatch(block1.begin(), block1.begin() + length, block2.begin());
+            compared += static_cast<uintmax_t>(diff.first - block1.begin());
+            break;
+        }
+        compared += length;
+        block1.remove_prefix(length);
+        block2.remove_prefix(length);
+    }
+
+    if (!result->equal && result != &ignored) {
+        uintmax_t line2 = 0;
+        locate(filePath1, ignoreCRLF, compared, &result->offset1, &result->line);
+        locate(filePath2, ignoreCRLF, compared, &result->offset2, &line2);
+    }
+    return result->equal;
+}
+
+} // end namespace Tau
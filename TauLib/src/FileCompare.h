@@ -0,0 +1,42 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for CompareFileContents, a streaming byte by byte file comparison.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <cstdint>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief FileCompareResult - where two files first differ
+///
+struct FileCompareResult {
+    bool equal {false};
+    bool openFailed {false};    ///< one of the files couldn't be opened.  equal is false.
+    uintmax_t offset1 {0};      ///< the first byte that differs in file 1.  its size if file 1 is the shorter one.
+    uintmax_t offset2 {0};      ///< the same byte in file 2.  only differs from offset1 with ignoreCRLF.
+    uintmax_t line {0};         ///< the line it's on, from 1
+};
+
+///
+/// @brief CompareFileContents - compares two files byte by byte
+/// @param filePath1 fullpath to file1
+/// @param filePath2 fullpath to file2
+/// @param ignoreCRLF true to compare CR LF the same as LF, and to ignore the line ending at the end of the last line
+/// @param result if not null, where the files first differ.  finding it can mean reading past a size difference.
+/// @return true if the files are the same
+/// @remark Two paths to the same file are equal without reading it.  Without ignoreCRLF and result, files of
+///         different sizes are unequal without reading them.
+/// @remark The files are memory mapped (read in 1MB blocks if they can't be) and compared a block at a time with
+///         memcmp, stopping at the first block that differs.  ignoreCRLF converts CR LF to LF as the blocks are read.
+///
+bool CompareFileContents(const std::string& filePath1, const std::string& filePath2, bool ignoreCRLF = false,
+                         FileCompareResult* result = nullptr);
+
+} // end namespace Tau
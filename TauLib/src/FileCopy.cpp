@@ -0,0 +1,536 @@
+///
+/// @file
+/// @brief CPP file for CopyTree, a parallel file and directory tree copy.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "FileCopy.h"
+#include "DirWalk.h"
+#include "Tau_ThreadPool.h"
+#include "sep.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+namespace {
+
+enum class FileCopyStatus { Copied, Cloned, Skipped, Failed };
+
+//
+// Copier - the shared state of one copy: the options, the chunk pool, counters and progress
+//
+struct Copier {
+    const CopyOptions& options;
+    ThreadPool* chunkPool {nullptr};
+
+    size_t filesTotal {0};
+    uintmax_t bytesTotal {0};
+    atomic<size_t> filesDone {0};
+    atomic<size_t> filesCopied {0};
+    atomic<size_t> filesCloned {0};
+    atomic<size_t> filesSkipped {0};
+    atomic<uintmax_t> bytesCopied {0};
+    atomic<uintmax_t> bytesSkipped {0};
+
+    mutex failedLock;
+    Strings failedPaths;
+
+    mutex progressLock;
+    chrono::steady_clock::time_point lastReport;
+
+    explicit Copier(const CopyOptions& _options) : options(_options) {}
+
+    void AddBytes(uintmax_t bytes) {
+        bytesCopied += bytes;
+        Report(false);
+    }
+
+    void FileDone(FileCopyStatus status, const string& srcPath, uintmax_t size) {
+        switch (status) {
+        case FileCopyStatus::Cloned:
+            ++filesCloned;
+            [[fallthrough]];
+        case FileCopyStatus::Copied:
+            ++filesCopied;
+            break;
+        case FileCopyStatus::Skipped:
+            ++filesSkipped;
+            bytesSkipped += size;
+            break;
+        case FileCopyStatus::Failed: {
+            lock_guard<mutex> guard(failedLock);
+            failedPaths.push_back(srcPath);
+            break;
+        }
+        }
+        ++filesDone;
+        Report(false);
+    }
+
+    // at most every 50ms, one call at a time
+    void Report(bool final) {
+        if (!options.progress)
+            return;
+        auto now = chrono::steady_clock::now();
+        unique_lock<mutex> guard(progressLock, defer_lock);
+        if (final)
+            guard.lock();
+        else if (!guard.try_lock() || now - lastReport < chrono::milliseconds(50))
+            return;
+        lastReport = now;
+
+        CopyProgress progress;
+        progress.filesDone = filesDone;
+        progress.filesTotal = filesTotal;
+        progress.bytesDone = bytesCopied + bytesSkipped;
+        progress.bytesTotal = bytesTotal;
+        options.progress(progress);
+    }
+};
+
+                //*******************************
+                // Copying one file
+                //*******************************
+
+#if defined(__linux__)
+
+static constexpr size_t stepBytes = 8 * 1024 * 1024;        // per kernel copy call, so progress moves
+static constexpr size_t bufferBytes = 1024 * 1024;          // read/write fallback
+
+static vector<char>& copyBuffer()
+{
+    thread_local vector<char> buffer(bufferBytes);
+    return buffer;
+}
+
+//
+// writeAll - write or pwrite the whole buffer.  offset < 0 writes at the file position.
+//
+static bool writeAll(int fd, const char* data, size_t length, off_t offset)
+{
+    while (length > 0) {
+        ssize_t n = (offset < 0) ? write(fd, data, length) : pwrite(fd, data, length, offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+        if (offset >= 0)
+            offset += n;
+    }
+    return true;
+}
+
+//
+// copyStream - copy a whole file at the file positions.  each method carries on from where the one before stopped.
+//
+static bool copyStream(int in, int out, uintmax_t size, Copier& copier)
+{
+    uintmax_t done = 0;
+
+    // in kernel.  server side on NFS 4.2 and SMB, shared extents on some file systems.
+    while (done < size) {
+        ssize_t n = copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(min<uintmax_t>(size - done, stepBytes)), 0);
+        if (n <= 0)
+            break;      // not supported here (ENOSYS, EXDEV, EINVAL, ...) or the file shrank
+        done += static_cast<uintmax_t>(n);
+        copier.AddBytes(static_cast<uintmax_t>(n));
+    }
+
+    // in kernel through the page cache
+    while (done < size) {
+        ssize_t n = sendfile(out, in, nullptr, static_cast<size_t>(min<uintmax_t>(size - done, stepBytes)));
+        if (n <= 0)
+            break;
+        done += static_cast<uintmax_t>(n);
+        copier.AddBytes(static_cast<uintmax_t>(n));
+    }
+
+    // read and write to the end of the file
+    vector<char>& buffer = copyBuffer();
+    for (;;) {
+        ssize_t n = read(in, buffer.data(), buffer.size());
+        if (n == 0)
+            return true;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (!writeAll(out, buffer.data(), static_cast<size_t>(n), -1))
+            return false;
+        copier.AddBytes(static_cast<uintmax_t>(n));
+    }
+}
+
+//
+// copyChunk - copy part of a file at explicit offsets so chunks can be copied at once
+//
+static bool copyChunk(int in, int out, uintmax_t offset, uintmax_t length, Copier& copier)
+{
+    uintmax_t done = 0;
+    loff_t inOffset = static_cast<loff_t>(offset);
+    loff_t outOffset = static_cast<loff_t>(offset);
+    while (done < length) {
+        ssize_t n = copy_file_range(in, &inOffset, out, &outOffset, static_cast<size_t>(min<uintmax_t>(length - done, stepBytes)), 0);
+        if (n <= 0)
+            break;
+        done += static_cast<uintmax_t>(n);
+        copier.AddBytes(static_cast<uintmax_t>(n));
+    }
+
+    vector<char>& buffer = copyBuffer();
+    while (done < length) {
+        ssize_t n = pread(in, buffer.data(), static_cast<size_t>(min<uintmax_t>(length - done, buffer.size())),
+                          static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;   // an error, or the file shrank
+        if (!writeAll(out, buffer.data(), static_cast<size_t>(n), static_cast<off_t>(offset + done)))
+            return false;
+        done += static_cast<uintmax_t>(n);
+        copier.AddBytes(static_cast<uintmax_t>(n));
+    }
+    return true;
+}
+
+//
+// copyChunked - a large file split into chunks on the chunk pool
+//
+static bool copyChunked(int in, int out, uintmax_t size, Copier& copier)
+{
+    if (ftruncate(out, static_cast<off_t>(size)) != 0)
+        return false;
+
+    uintmax_t chunkSize = max<uintmax_t>(copier.options.chunkSize, bufferBytes);
+    vector<future<bool>> chunks;
+    for (uintmax_t offset = 0; offset < size; offset += chunkSize) {
+        uintmax_t length = min(chunkSize, size - offset);
+        chunks.push_back(copier.chunkPool->Submit([in, out, offset, length, &copier] {
+            return copyChunk(in, out, offset, length, copier);
+        }));
+    }
+    bool ok = true;
+    for (auto& chunk : chunks)
+        ok = chunk.get() && ok;     // wait for all of them, the fds are closed after
+    return ok;
+}
+
+//
+// copyFile - Linux
+//
+static FileCopyStatus copyFile(const string& srcPath, const string& destPath, Copier& copier)
+{
+    const CopyOptions& options = copier.options;
+
+    int in = open(srcPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+        return FileCopyStatus::Failed;
+    struct stat st;
+    if (fstat(in, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(in);
+        return FileCopyStatus::Failed;
+    }
+
+    // O_TRUNC on the source itself would lose it
+    struct stat destSt;
+    if (options.overwriteExisting && stat(destPath.c_str(), &destSt) == 0 && destSt.st_dev == st.st_dev && destSt.st_ino == st.st_ino) {
+        close(in);
+        return FileCopyStatus::Failed;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (options.overwriteExisting ? O_TRUNC : O_EXCL);
+    int out = open(destPath.c_str(), flags, st.st_mode & 0777);
+    if (out < 0) {
+        int error = errno;
+        close(in);
+        return (error == EEXIST && !options.overwriteExisting) ? FileCopyStatus::Skipped : FileCopyStatus::Failed;
+    }
+
+    uintmax_t size = static_cast<uintmax_t>(st.st_size);
+    bool cloned = ioctl(out, FICLONE, in) == 0;
+    bool ok = cloned;
+    if (cloned)
+        copier.AddBytes(size);
+    else if (copier.chunkPool != nullptr && size >= options.largeFileSize)
+        ok = copyChunked(in, out, size, copier);
+    else
+        ok = copyStream(in, out, size, copier);
+
+    if (ok && options.preservePermissions)
+        ok = fchmod(out, st.st_mode & 07777) == 0;
+    if (ok && options.preserveTimes) {
+        struct timespec times[2] = { st.st_atim, st.st_mtim };
+        ok = futimens(out, times) == 0;
+    }
+    if (close(out) != 0)        // delayed write errors (ex: NFS) show up here
+        ok = false;
+    close(in);
+
+    if (!ok) {
+        unlink(destPath.c_str());
+        return FileCopyStatus::Failed;
+    }
+    return cloned ? FileCopyStatus::Cloned : FileCopyStatus::Copied;
+}
+
+#else
+
+//
+// copyFile - std::filesystem
+//
+static FileCopyStatus copyFile(const string& srcPath, const string& destPath, Copier& copier)
+{
+    const CopyOptions& options = copier.options;
+    error_code ec;
+    if (!options.overwriteExisting && fs::exists(destPath, ec))
+        return FileCopyStatus::Skipped;
+
+    uintmax_t size = fs::file_size(srcPath, ec);
+    if (ec || !fs::copy_file(srcPath, destPath, fs::copy_options::overwrite_existing, ec) || ec)
+        return FileCopyStatus::Failed;
+    copier.AddBytes(size);
+
+    if (options.preservePermissions)
+        fs::permissions(destPath, fs::status(srcPath, ec).permissions(), ec);
+    if (!ec && options.preserveTimes)
+        fs::last_write_time(destPath, fs::last_write_time(srcPath, ec), ec);
+    return ec ? FileCopyStatus::Failed : FileCopyStatus::Copied;
+}
+
+#endif
+
+//
+// copySymlink - recreate a symlink
+//
+static FileCopyStatus copySymlink(const string& srcPath, const string& destPath, bool overwriteExisting)
+{
+    error_code ec;
+    if (fs::symlink_status(destPath, ec).type() != fs::file_type::not_found) {
+        if (!overwriteExisting)
+            return FileCopyStatus::Skipped;
+        fs::remove(destPath, ec);
+    }
+    fs::copy_symlink(srcPath, destPath, ec);
+    return ec ? FileCopyStatus::Failed : FileCopyStatus::Copied;
+}
+
+//
+// copyDirAttributes - after the contents are in, so the time isn't changed again
+//
+static bool copyDirAttributes(const string& srcPath, const string& destPath, const CopyOptions& options)
+{
+    error_code ec;
+    if (options.preserveTimes)
+        fs::last_write_time(destPath, fs::last_write_time(srcPath, ec), ec);
+    if (!ec && options.preservePermissions)
+        fs::permissions(destPath, fs::status(srcPath, ec).permissions(), ec);
+    return !ec;
+}
+
+//
+// fileThreadCount
+//
+static unsigned int fileThreadCount(const CopyOptions& options, size_t fileCount)
+{
+    unsigned int threads = options.maxThreads;
+    if (threads == 0)
+        threads = min(max(1u, thread::hardware_concurrency()), 8u);
+    return static_cast<unsigned int>(clamp<size_t>(fileCount, 1, threads));
+}
+
+//
+// PlanItem - one entry of the source tree
+//
+struct PlanItem {
+    string relativePath;
+    DirEntryType type {DirEntryType::Unknown};
+    bool isSymlink {false};
+    uintmax_t size {0};
+};
+
+//
+// planTree - walk the source.  without copySymlinks a symlinked directory is walked on its own so a directory
+// reached by two paths is copied to both, the same as fs::copy.  a symlink to one of its own parents is a loop and fails.
+//
+static void planTree(const string& srcDir, const string& prefix, const CopyOptions& options, vector<PlanItem>* items)
+{
+    DirWalkOptions walkOptions;
+    walkOptions.followSymlinks = false;
+    vector<PlanItem> walked = DirWalk(srcDir, [] (const DirWalkEntry&) { return true; },
+        [&prefix] (const DirWalkEntry& entry) {
+            PlanItem item { prefix.empty() ? entry.RelativePath() : prefix + sep + entry.RelativePath(), entry.type, entry.isSymlink, 0 };
+            if (entry.IsFile()) {
+                error_code ec;
+                item.size = fs::file_size(entry.FullPath(), ec);      // for the progress total
+            }
+            return item;
+        }, walkOptions);
+
+    size_t first = items->size();
+    items->insert(items->end(), make_move_iterator(walked.begin()), make_move_iterator(walked.end()));
+    if (options.copySymlinks)
+        return;
+
+    for (size_t i = first; i < items->size(); ++i) {
+        if (!(*items)[i].isSymlink || (*items)[i].type != DirEntryType::Directory)
+            continue;
+        string relativePath = (*items)[i].relativePath;     // copied, items grows below
+        string linkPath = srcDir + sep + relativePath.substr(prefix.empty() ? 0 : prefix.size() + 1);
+        error_code ec;
+        string target = fs::canonical(linkPath, ec).string();
+        string parent = fs::canonical(fs::path(linkPath).parent_path(), ec).string();
+        if (ec || parent == target || parent.starts_with(target + sep)) {
+            (*items)[i].type = DirEntryType::Unknown;       // a loop
+            continue;
+        }
+        planTree(linkPath, relativePath, options, items);
+    }
+}
+
+} // end anonymous namespace
+
+//
+// CopyTree
+//
+bool CopyTree(const string& srcDir, const string& destDir, const CopyOptions& options, CopyResult* result)
+{
+    CopyResult ignored;
+    if (result == nullptr)
+        result = &ignored;
+    *result = CopyResult();
+
+    error_code ec;
+    if (!fs::is_directory(srcDir, ec))
+        return false;
+    bool created = fs::create_directories(destDir, ec);
+    if (ec)
+        return false;
+    if (created)
+        result->dirsCreated++;
+
+    vector<PlanItem> items;
+    planTree(srcDir, string(), options, &items);
+
+    // parents before children
+    sort(items.begin(), items.end(), [] (const PlanItem& a, const PlanItem& b) { return a.relativePath < b.relativePath; });
+
+    Copier copier(options);
+    vector<const PlanItem*> files;
+    vector<const PlanItem*> dirs;
+    bool anyLarge = false;
+    for (const PlanItem& item : items) {
+        string srcPath = srcDir + sep + item.relativePath;
+        string destPath = destDir + sep + item.relativePath;
+
+        if (item.isSymlink && options.copySymlinks) {
+            FileCopyStatus status = copySymlink(srcPath, destPath, options.overwriteExisting);
+            if (status == FileCopyStatus::Failed)
+                result->failedPaths.push_back(srcPath);
+            else if (status == FileCopyStatus::Skipped)
+                result->filesSkipped++;
+            else
+                result->filesCopied++;
+        } else if (item.type == DirEntryType::Directory) {
+            if (fs::create_directory(destPath, srcPath, ec))
+                result->dirsCreated++;
+            else if (ec || !fs::is_directory(destPath, ec))
+                result->failedPaths.push_back(srcPath);
+            dirs.push_back(&item);
+        } else if (item.type == DirEntryType::File) {
+            files.push_back(&item);
+            copier.bytesTotal += item.size;
+            anyLarge = anyLarge || item.size >= options.largeFileSize;
+        } else {
+            result->failedPaths.push_back(srcPath);     // broken symlink, device, fifo, ...
+        }
+    }
+    copier.filesTotal = files.size();
+
+    // the files.  large files share out their chunks on a second pool so a file thread never waits on its own pool.
+    {
+        unsigned int fileThreads = fileThreadCount(options, files.size());
+        ThreadPool filePool(fileThreads);
+        unique_ptr<ThreadPool> chunkPool;
+        if (anyLarge) {
+            chunkPool = make_unique<ThreadPool>(options.maxChunkThreads > 0 ? options.maxChunkThreads : fileThreadCount(options, SIZE_MAX));
+            copier.chunkPool = chunkPool.get();
+        }
+        for (const PlanItem* item : files) {
+            filePool.Post([item, &srcDir, &destDir, &copier] {
+                string srcPath = srcDir + sep + item->relativePath;
+                FileCopyStatus status = copyFile(srcPath, destDir + sep + item->relativePath, copier);
+                copier.FileDone(status, srcPath, item->size);
+            });
+        }
+        filePool.Wait();
+    }
+    copier.Report(true);
+
+    // directory times and permissions, deepest first so a read only parent doesn't stop its children
+    for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+        if ((options.preserveTimes || options.preservePermissions) &&
+            !copyDirAttributes(srcDir + sep + (*it)->relativePath, destDir + sep + (*it)->relativePath, options))
+            result->failedPaths.push_back(srcDir + sep + (*it)->relativePath);
+    }
+    if ((options.preserveTimes || options.preservePermissions) && !copyDirAttributes(srcDir, destDir, options))
+        result->failedPaths.push_back(srcDir);
+
+    result->filesCopied += copier.filesCopied;
+    result->filesCloned += copier.filesCloned;
+    result->filesSkipped += copier.filesSkipped;
+    result->bytesCopied = copier.bytesCopied;
+    result->failedPaths.insert(result->failedPaths.end(), copier.failedPaths.begin(), copier.failedPaths.end());
+    result->filesFailed = result->failedPaths.size();
+    return result->failedPaths.empty();
+}
+
+//
+// CopyFileWithOptions
+//
+bool CopyFileWithOptions(const string& filePathSrc, const string& filePathDest, const CopyOptions& options)
+{
+    Copier copier(options);
+    error_code ec;
+    copier.filesTotal = 1;
+    copier.bytesTotal = fs::file_size(filePathSrc, ec);
+    if (ec)
+        return false;
+
+    unique_ptr<ThreadPool> chunkPool;
+    if (copier.bytesTotal >= options.largeFileSize) {
+        chunkPool = make_unique<ThreadPool>(options.maxChunkThreads > 0 ? options.maxChunkThreads : fileThreadCount(options, SIZE_MAX));
+        copier.chunkPool = chunkPool.get();
+    }
+    FileCopyStatus status = copyFile(filePathSrc, filePathDest, copier);
+    copier.FileDone(status, filePathSrc, copier.bytesTotal);
+    copier.Report(true);
+    return status != FileCopyStatus::Failed;
+}
+
+} // end namespace Tau
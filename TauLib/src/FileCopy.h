@@ -0,0 +1,80 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for CopyTree, a parallel file and directory tree copy.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <functional>
+#include <cstdint>
+#include "Str.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief CopyProgress - passed to CopyOptions::progress
+///
+struct CopyProgress {
+    size_t filesDone {0};           ///< copied, skipped or failed
+    size_t filesTotal {0};
+    uintmax_t bytesDone {0};        ///< skipped files count as done
+    uintmax_t bytesTotal {0};
+};
+
+///
+/// @brief CopyOptions - controls CopyTree and CopyFileWithOptions
+///
+struct CopyOptions {
+    bool overwriteExisting {true};      ///< false to skip files that already exist in the destination
+    bool copySymlinks {false};          ///< true to copy symlinks as symlinks.  false copies what they point to.
+    bool preserveTimes {false};         ///< give the copies the last write (and access) times of the originals
+    bool preservePermissions {false};   ///< give the copies the exact permissions of the originals, not masked by the umask
+    unsigned int maxThreads {0};        ///< files copied at once.  0 == the number of hardware threads, at most 8
+    unsigned int maxChunkThreads {0};   ///< chunks of large files copied at once.  0 == same as the file threads
+    uintmax_t largeFileSize {64 * 1024 * 1024};     ///< files this big or bigger are copied in chunks on the chunk threads
+    uintmax_t chunkSize {16 * 1024 * 1024};
+
+    /// @brief called as the copy goes.  called on the copy threads, one call at a time, at most every 50ms and once at the end.
+    std::function<void (const CopyProgress&)> progress;
+};
+
+///
+/// @brief CopyResult - what a CopyTree did
+///
+struct CopyResult {
+    size_t filesCopied {0};
+    size_t filesCloned {0};         ///< of filesCopied, the ones that share storage with the original (reflinks)
+    size_t filesSkipped {0};
+    size_t filesFailed {0};
+    size_t dirsCreated {0};
+    uintmax_t bytesCopied {0};
+    Strings failedPaths;            ///< source paths that couldn't be copied
+};
+
+///
+/// @brief CopyTree - copies a directory and everything in it
+/// @param srcDir the directory to copy
+/// @param destDir where to copy it.  created if needed.  the contents of srcDir go directly in destDir.
+/// @param options see CopyOptions
+/// @param result if not null, counts of what was done
+/// @return true if every file and directory was copied or skipped
+/// @remark The tree is walked with DirWalk, the directories are created and then the files are copied on a pool of
+///         threads.  Files of options.largeFileSize or more are split into chunks copied on a second pool.
+/// @remark On Linux each file is copied by the first of these that works: a FICLONE reflink (btrfs, xfs, ...; no data
+///         is copied), copy_file_range (in kernel, server side on NFS and SMB), sendfile, then read and write with
+///         a large buffer.  Elsewhere std::filesystem::copy_file is used (CopyFile2 on Windows, which clones on ReFS).
+///
+bool CopyTree(const std::string& srcDir, const std::string& destDir, const CopyOptions& options = CopyOptions(),
+              CopyResult* result = nullptr);
+
+///
+/// @brief CopyFileWithOptions - copies one file the same way CopyTree copies each file
+/// @return true if the file was copied, or skipped because it exists and options.overwriteExisting is false
+///
+bool CopyFileWithOptions(const std::string& filePathSrc, const std::string& filePathDest, const CopyOptions& options = CopyOptions());
+
+} // end namespace Tau
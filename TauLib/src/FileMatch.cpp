@@ -0,0 +1,207 @@
+///
+/// @file
+/// @brief CPP file for FileNameMatcher, matching file names against extensions and glob patterns.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "FileMatch.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace Tau {
+
+//
+// lower - ascii lower case
+//
+static inline char lower(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+//
+// extensionOf - the extension of a file name without the ".".  same rules as fs::path::extension():
+// the text after the last "." unless the only "." is the first char (ex: ".bashrc" has no extension).
+// returns false if there isn't an extension.
+//
+static bool extensionOf(string_view filename, string_view* ext)
+{
+    size_t dot = filename.rfind('.');
+    if (dot == string_view::npos || dot == 0 || filename == "..")
+        return false;
+    *ext = filename.substr(dot + 1);
+    return true;
+}
+
+//
+// packExtension - lower cased extension of up to 7 chars in a word.  the length goes in the top byte so "a" != "a\0".
+//
+static constexpr size_t maxPackedExt = 7;
+
+static inline uint64_t packExtension(string_view ext)
+{
+    uint64_t packed = 0;
+    for (size_t i = 0; i < ext.size(); ++i)
+        packed |= static_cast<uint64_t>(static_cast<unsigned char>(lower(ext[i]))) << (i * 8);
+    return packed | (static_cast<uint64_t>(ext.size()) << 56);
+}
+
+//
+// AddExtension
+//
+void FileNameMatcher::AddExtension(string ext)
+{
+    if (!ext.empty() && ext[0] == '.')
+        ext.erase(0, 1);
+    for (char& ch : ext)
+        ch = lower(ch);
+
+    if (ext.size() <= maxPackedExt) {
+        uint64_t packed = packExtension(ext);
+        if (find(shortExts.begin(), shortExts.end(), packed) == shortExts.end())
+            shortExts.push_back(packed);
+    } else if (find(longExts.begin(), longExts.end(), ext) == longExts.end()) {
+        longExts.push_back(ext);
+    }
+}
+
+void FileNameMatcher::AddExtensions(const Strings& extensions)
+{
+    for (const string& ext : extensions)
+        AddExtension(ext);
+}
+
+//
+// AddPattern
+//
+void FileNameMatcher::AddPattern(const string& pattern)
+{
+    // "*.ext" with no other wildcards is just an extension
+    if (pattern.size() > 2 && pattern[0] == '*' && pattern[1] == '.' &&
+        pattern.find_first_of("*?[.", 2) == string::npos) {
+        AddExtension(pattern.substr(1));
+        return;
+    }
+    globs.push_back(pattern);
+}
+
+void FileNameMatcher::AddPatterns(const Strings& patterns)
+{
+    for (const string& pattern : patterns)
+        AddPattern(pattern);
+}
+
+//
+// Matches
+//
+bool FileNameMatcher::Matches(string_view filename) const
+{
+    string_view ext;
+    if (extensionOf(filename, &ext)) {
+        if (ext.size() <= maxPackedExt) {
+            uint64_t packed = packExtension(ext);
+            for (uint64_t e : shortExts) {
+                if (e == packed)
+                    return true;
+            }
+        } else {
+            for (const string& e : longExts) {
+                if (e.size() == ext.size() && equal(e.begin(), e.end(), ext.begin(), [] (char a, char b) { return a == lower(b); }))
+                    return true;
+            }
+        }
+    }
+
+    for (const string& glob : globs) {
+        if (GlobMatch(glob, filename))
+            return true;
+    }
+    return false;
+}
+
+//
+// matchSet - match one char against a [...] set.  pos is just past the "[".  returns the position after the "]".
+// returns npos if the set isn't closed (then the "[" is an ordinary char).
+//
+static size_t matchSet(string_view pattern, size_t pos, char ch, bool* matched)
+{
+    bool negate = pos < pattern.size() && (pattern[pos] == '!' || pattern[pos] == '^');
+    if (negate)
+        ++pos;
+
+    bool found = false;
+    bool first = true;
+    while (pos < pattern.size() && (pattern[pos] != ']' || first)) {
+        char lo = lower(pattern[pos]);
+        char hi = lo;
+        if (pos + 2 < pattern.size() && pattern[pos + 1] == '-' && pattern[pos + 2] != ']') {
+            hi = lower(pattern[pos + 2]);
+            pos += 2;
+        }
+        if (ch >= lo && ch <= hi)
+            found = true;
+        ++pos;
+        first = false;
+    }
+    if (pos >= pattern.size())
+        return string_view::npos;
+    *matched = (found != negate);
+    return pos + 1;
+}
+
+//
+// GlobMatch
+// single pass with backtracking to the last "*" only.  linear for patterns with one "*".
+//
+bool FileNameMatcher::GlobMatch(string_view pattern, string_view name)
+{
+    size_t p = 0, n = 0;
+    size_t starP = string_view::npos, starN = 0;
+
+    while (n < name.size()) {
+        char ch = lower(name[n]);
+        if (p < pattern.size()) {
+            char pc = pattern[p];
+            if (pc == '*') {
+                starP = ++p;
+                starN = n;
+                continue;
+            }
+            if (pc == '?') {
+                ++p;
+                ++n;
+                continue;
+            }
+            if (pc == '[') {
+                bool matched = false;
+                size_t next = matchSet(pattern, p + 1, ch, &matched);
+                if (next != string_view::npos) {
+                    if (matched) {
+                        p = next;
+                        ++n;
+                        continue;
+                    }
+                } else if (ch == '[') {
+                    ++p;
+                    ++n;
+                    continue;
+                }
+            } else if (lower(pc) == ch) {
+                ++p;
+                ++n;
+                continue;
+            }
+        }
+        // mismatch.  let the last "*" take one more char.
+        if (starP == string_view::npos)
+            return false;
+        p = starP;
+        n = ++starN;
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
+
+} // end namespace Tau
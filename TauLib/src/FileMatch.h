@@ -0,0 +1,62 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for FileNameMatcher, matching file names against extensions and glob patterns.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "Str.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief FileNameMatcher - matches a file name against a set of extensions and glob patterns, case insensitive.
+/// @remark Built once and then used for every entry of a directory walk.  Matches() doesn't allocate.
+/// @remark Extensions up to 7 chars are lower cased and packed into a 64 bit word so checking a name is one
+///         extension extract and a compare against a small table of words.  Longer extensions are compared as strings.
+/// @remark Glob patterns: * any chars, ? one char, [abc] [a-z] [!abc] one char from (or not from) a set.
+///         Patterns match the file name only, not the path.  "*.ext" patterns go in the extension table.
+/// @code
+///     FileNameMatcher matcher;
+///     matcher.AddExtensions({ "bin", ".cue", "ISO" });
+///     matcher.AddPattern("track??.wav");
+///     if (matcher.Matches("Game.Cue")) ...
+/// @endcode
+///
+class FileNameMatcher {
+public:
+    FileNameMatcher() {}
+    FileNameMatcher(const Strings& extensions, const Strings& patterns = Strings())
+        { AddExtensions(extensions); AddPatterns(patterns); }
+
+    /// @brief add an extension.  with or without the leading ".".  ex: "dat" or ".dat"
+    void AddExtension(std::string ext);
+    void AddExtensions(const Strings& extensions);
+
+    /// @brief add a glob pattern.  ex: "*.dat", "track??.*", "[ab]*.iso"
+    void AddPattern(const std::string& pattern);
+    void AddPatterns(const Strings& patterns);
+
+    /// @brief true if nothing has been added
+    bool Empty() const { return shortExts.empty() && longExts.empty() && globs.empty(); }
+
+    /// @brief true if the file name has one of the extensions or matches one of the patterns
+    bool Matches(std::string_view filename) const;
+
+    /// @brief glob match of a whole name, case insensitive
+    static bool GlobMatch(std::string_view pattern, std::string_view name);
+
+private:
+    std::vector<uint64_t> shortExts;    // lower case extensions (without the ".") of up to 7 chars packed in a word
+    Strings longExts;                   // lower case extensions longer than 7 chars
+    Strings globs;
+};
+
+} // end namespace Tau
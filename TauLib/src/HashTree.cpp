@@ -0,0 +1,504 @@
+///
+/// @file
+/// @brief CPP file for HashTree, content hashes of directory trees for finding duplicate and changed files.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "HashTree.h"
+#include "DirWalk.h"
+#include "MappedFile.h"
+#include "Tau_Hash.h"
+#include "Tau_Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+
+#include <sys/stat.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+static constexpr uintmax_t partialBytes = 64 * 1024;        // the first block, for the partial hash
+static constexpr uintmax_t chunkBytes = 4 * 1024 * 1024;    // bigger files are hashed in chunks of this
+
+                //*******************************
+                // helpers
+                //*******************************
+
+//
+// statKey - the cache key of a file.  follows symlinks.
+//
+template <class Key>
+static bool statKey(const string& path, Key* key)
+{
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0 || (st.st_mode & _S_IFREG) == 0)
+        return false;
+    key->device = 0;
+    key->inode = XXHash64(fs::absolute(path).string());
+    key->mtime = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+    key->device = static_cast<uint64_t>(st.st_dev);
+    key->inode = static_cast<uint64_t>(st.st_ino);
+    key->mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    key->size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+//
+// hashRange - XXHash64 of part of a file
+//
+static bool hashRange(const string& path, uintmax_t offset, uintmax_t length, uint64_t* hash)
+{
+    thread_local vector<char> buffer;
+    buffer.resize(static_cast<size_t>(length));
+    ifstream file(path, ios::binary);
+    if (!file.is_open() || !file.seekg(static_cast<streamoff>(offset)) ||
+        !file.read(buffer.data(), static_cast<streamsize>(length)))
+        return false;
+    *hash = XXHash64(buffer.data(), buffer.size());
+    return true;
+}
+
+                //*******************************
+                // Hashing
+                //*******************************
+
+//
+// WalkFiles - the files in a tree with their cache keys
+//
+vector<HashTree::FileInfo> HashTree::WalkFiles(const string& dirPath)
+{
+    vector<FileInfo> files = DirWalk(dirPath, [] (const DirWalkEntry& entry) { return entry.IsFile(); },
+        [] (const DirWalkEntry& entry) {
+            FileInfo file;
+            file.path = entry.FullPath();
+            file.relativePath = entry.RelativePath();
+            file.ok = statKey(file.path, &file.key);      // on the walk threads
+            return file;
+        });
+    stats.files += files.size();
+    return files;
+}
+
+//
+// StatFiles - the cache keys of files passed by path
+//
+void HashTree::StatFiles(vector<FileInfo>* files)
+{
+    ParallelForChunks(files->size(), 256, [&] (unsigned int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            (*files)[i].ok = statKey((*files)[i].path, &(*files)[i].key);
+    }, maxThreads);
+    stats.files += files->size();
+}
+
+//
+// HashStage - the partial or full hashes of files.  from the cache if it has them, otherwise the files are split
+// into units (the first block, a whole small file or one chunk of a big file) that are hashed on multiple threads.
+//
+void HashTree::HashStage(const vector<FileInfo*>& files, bool partial)
+{
+    struct Unit {
+        FileInfo* file;
+        uintmax_t offset;
+        uintmax_t length;
+    };
+    vector<Unit> units;
+    vector<pair<FileInfo*, size_t>> misses;     // file and its first unit
+
+    {
+        lock_guard<mutex> guard(cacheLock);
+        for (FileInfo* file : files) {
+            if (!file->ok)
+                continue;
+            auto it = cache.find(file->key);
+            if (it != cache.end() && (partial ? it->second.hasPartial : it->second.hasFull)) {
+                (partial ? file->partialHash : file->fullHash) = partial ? it->second.partialHash : it->second.fullHash;
+                stats.cacheHits++;
+                continue;
+            }
+            // up to partialBytes the partial hash is the full hash
+            if (!partial && file->key.size <= partialBytes && it != cache.end() && it->second.hasPartial) {
+                file->fullHash = it->second.partialHash;
+                stats.cacheHits++;
+                continue;
+            }
+
+            misses.emplace_back(file, units.size());
+            uintmax_t size = file->key.size;
+            if (partial || size <= chunkBytes) {
+                units.push_back({ file, 0, partial ? min(size, partialBytes) : size });
+            } else {
+                for (uintmax_t offset = 0; offset < size; offset += chunkBytes)
+                    units.push_back({ file, offset, min(chunkBytes, size - offset) });
+            }
+        }
+    }
+
+    // hash the units
+    vector<uint64_t> unitHashes(units.size());
+    unique_ptr<atomic<bool>[]> unitFailed(new atomic<bool>[units.size()]);
+    atomic<uintmax_t> bytesRead {0};
+    ParallelForChunks(units.size(), 1, [&] (unsigned int, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            unitFailed[i] = !hashRange(units[i].file->path, units[i].offset, units[i].length, &unitHashes[i]);
+            bytesRead += units[i].length;
+        }
+    }, maxThreads);
+    stats.bytesRead += bytesRead;
+    (partial ? stats.partialHashes : stats.fullHashes) += misses.size();
+
+    // combine the chunks of each file and remember them
+    lock_guard<mutex> guard(cacheLock);
+    for (size_t m = 0; m < misses.size(); ++m) {
+        FileInfo* file = misses[m].first;
+        size_t first = misses[m].second;
+        size_t last = (m + 1 < misses.size()) ? misses[m + 1].second : units.size();
+        for (size_t i = first; i < last; ++i)
+            file->ok = file->ok && !unitFailed[i];
+        if (!file->ok)
+            continue;
+
+        uint64_t hash = (last - first == 1) ? unitHashes[first]
+                                            : XXHash64(unitHashes.data() + first, (last - first) * sizeof(uint64_t), file->key.size);
+        CacheEntry& entry = cache[file->key];
+        if (partial) {
+            file->partialHash = entry.partialHash = hash;
+            entry.hasPartial = true;
+            if (file->key.size <= partialBytes) {
+                file->fullHash = entry.fullHash = hash;
+                entry.hasFull = true;
+            }
+        } else {
+            file->fullHash = entry.fullHash = hash;
+            entry.hasFull = true;
+        }
+    }
+}
+
+//
+// FindDuplicates
+//
+vector<Strings> HashTree::FindDuplicates(const Strings& dirPaths, uintmax_t minSize)
+{
+    stats = HashTreeStats();
+    vector<FileInfo> files;
+    for (const string& dirPath : dirPaths) {
+        vector<FileInfo> walked = WalkFiles(dirPath);
+        files.insert(files.end(), make_move_iterator(walked.begin()), make_move_iterator(walked.end()));
+    }
+    // overlapping trees
+    sort(files.begin(), files.end(), [] (const FileInfo& a, const FileInfo& b) { return a.path < b.path; });
+    files.erase(unique(files.begin(), files.end(), [] (const FileInfo& a, const FileInfo& b) { return a.path == b.path; }), files.end());
+
+    // groups of files that could still be the same.  a group of one is done.
+    using Group = vector<FileInfo*>;
+    auto regroup = [] (const vector<Group>& groups, auto keyOf) {
+        vector<Group> result;
+        for (const Group& group : groups) {
+            map<uint64_t, Group> split;
+            for (FileInfo* file : group) {
+                if (file->ok)
+                    split[keyOf(*file)].push_back(file);
+            }
+            for (auto& [key, sub] : split) {
+                if (sub.size() > 1)
+                    result.push_back(std::move(sub));
+            }
+        }
+        return result;
+    };
+    auto flatten = [] (const vector<Group>& groups) {
+        Group all;
+        for (const Group& group : groups)
+            all.insert(all.end(), group.begin(), group.end());
+        return all;
+    };
+
+    Group all;
+    for (FileInfo& file : files) {
+        if (file.ok && file.key.size >= minSize)
+            all.push_back(&file);
+    }
+    vector<Group> groups = regroup({ all }, [] (const FileInfo& file) { return file.key.size; });
+
+    HashStage(flatten(groups), true);
+    groups = regroup(groups, [] (const FileInfo& file) { return file.partialHash; });
+
+    HashStage(flatten(groups), false);
+    groups = regroup(groups, [] (const FileInfo& file) { return file.fullHash; });
+
+    vector<Strings> result;
+    for (const Group& group : groups) {
+        Strings& paths = result.emplace_back();
+        for (const FileInfo* file : group)
+            paths.push_back(file->path);
+        sort(paths.begin(), paths.end());
+    }
+    sort(result.begin(), result.end(), [] (const Strings& a, const Strings& b) { return a[0] < b[0]; });
+    return result;
+}
+
+//
+// HashFiles
+//
+vector<HashedFile> HashTree::HashFiles(const Strings& filePaths)
+{
+    stats = HashTreeStats();
+    vector<FileInfo> files(filePaths.size());
+    for (size_t i = 0; i < files.size(); ++i)
+        files[i].path = filePaths[i];
+    StatFiles(&files);
+
+    vector<FileInfo*> pointers;
+    for (FileInfo& file : files)
+        pointers.push_back(&file);
+    HashStage(pointers, false);
+
+    vector<HashedFile> result;
+    for (const FileInfo& file : files)
+        result.push_back({ file.path, file.key.size, file.key.mtime, file.fullHash, file.ok });
+    return result;
+}
+
+//
+// Scan
+//
+vector<HashedFile> HashTree::Scan(const string& dirPath)
+{
+    stats = HashTreeStats();
+    vector<FileInfo> files = WalkFiles(dirPath);
+    vector<FileInfo*> pointers;
+    for (FileInfo& file : files)
+        pointers.push_back(&file);
+    HashStage(pointers, false);
+
+    vector<HashedFile> result;
+    for (const FileInfo& file : files)
+        result.push_back({ file.relativePath, file.key.size, file.key.mtime, file.fullHash, file.ok });
+    sort(result.begin(), result.end(), [] (const HashedFile& a, const HashedFile& b) { return a.path < b.path; });
+    return result;
+}
+
+//
+// Diff - both are sorted by path
+//
+HashTreeChanges HashTree::Diff(const vector<HashedFile>& before, const vector<HashedFile>& after)
+{
+    HashTreeChanges changes;
+    size_t b = 0, a = 0;
+    while (b < before.size() || a < after.size()) {
+        if (a == after.size() || (b < before.size() && before[b].path < after[a].path)) {
+            changes.removed.push_back(before[b++].path);
+        } else if (b == before.size() || after[a].path < before[b].path) {
+            changes.added.push_back(after[a++].path);
+        } else {
+            if (before[b].size != after[a].size || before[b].hash != after[a].hash || !before[b].ok || !after[a].ok)
+                changes.changed.push_back(after[a].path);
+            ++a;
+            ++b;
+        }
+    }
+    return changes;
+}
+
+//
+// CompareTrees - by size, then the first block, then the whole file
+//
+HashTreeChanges HashTree::CompareTrees(const string& dirPath1, const string& dirPath2)
+{
+    stats = HashTreeStats();
+    vector<FileInfo> files1 = WalkFiles(dirPath1);
+    vector<FileInfo> files2 = WalkFiles(dirPath2);
+    auto byPath = [] (const FileInfo& a, const FileInfo& b) { return a.relativePath < b.relativePath; };
+    sort(files1.begin(), files1.end(), byPath);
+    sort(files2.begin(), files2.end(), byPath);
+
+    HashTreeChanges changes;
+    vector<pair<FileInfo*, FileInfo*>> same;        // same path and size
+    size_t i1 = 0, i2 = 0;
+    while (i1 < files1.size() || i2 < files2.size()) {
+        if (i2 == files2.size() || (i1 < files1.size() && files1[i1].relativePath < files2[i2].relativePath)) {
+            changes.removed.push_back(files1[i1++].relativePath);
+        } else if (i1 == files1.size() || files2[i2].relativePath < files1[i1].relativePath) {
+            changes.added.push_back(files2[i2++].relativePath);
+        } else {
+            FileInfo& file1 = files1[i1++];
+            FileInfo& file2 = files2[i2++];
+            if (file1.ok && file2.ok && file1.key.size == file2.key.size)
+                same.emplace_back(&file1, &file2);
+            else
+                changes.changed.push_back(file1.relativePath);
+        }
+    }
+
+    // one stage for both trees at a time so all the threads are busy
+    auto stage = [&] (bool partial) {
+        vector<FileInfo*> files;
+        for (auto& [file1, file2] : same) {
+            files.push_back(file1);
+            files.push_back(file2);
+        }
+        HashStage(files, partial);
+        vector<pair<FileInfo*, FileInfo*>> stillSame;
+        for (auto& [file1, file2] : same) {
+            uint64_t hash1 = partial ? file1->partialHash : file1->fullHash;
+            uint64_t hash2 = partial ? file2->partialHash : file2->fullHash;
+            if (!file1->ok || !file2->ok || hash1 != hash2)
+                changes.changed.push_back(file1->relativePath);
+            else if (!partial || file1->key.size > partialBytes)
+                stillSame.emplace_back(file1, file2);
+        }
+        same = std::move(stillSame);
+    };
+    stage(true);
+    stage(false);
+
+    sort(changes.changed.begin(), changes.changed.end());
+    return changes;
+}
+
+                //*******************************
+                // Cache
+                //*******************************
+
+//
+// Cache file layout.  native byte order, no padding.
+//
+//   char magic[8], uint32_t version, uint32_t byteOrder, uint64_t partialBytes, uint64_t chunkBytes, uint64_t count
+//   for each:  uint64_t device, uint64_t inode, uint64_t size, int64_t mtime, uint64_t partialHash, uint64_t fullHash, uint8_t flags
+//
+static const char CacheMagic[8] = { 'T', 'a', 'u', 'H', 'a', 's', 'h', '1' };
+static const uint32_t CacheVersion = 1;
+static const uint32_t ByteOrderMark = 0x01020304;
+static const size_t CacheEntryBytes = 6 * 8 + 1;
+
+template <class T>
+static void appendValue(string* out, const T& value)
+{
+    out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static T readValue(const char* data, size_t* pos)
+{
+    T value;
+    memcpy(&value, data + *pos, sizeof(T));
+    *pos += sizeof(T);
+    return value;
+}
+
+//
+// SaveCache
+//
+bool HashTree::SaveCache(const string& cachePath) const
+{
+    string out;
+    {
+        lock_guard<mutex> guard(cacheLock);
+        out.reserve(48 + cache.size() * CacheEntryBytes);
+        out.append(CacheMagic, sizeof(CacheMagic));
+        appendValue(&out, CacheVersion);
+        appendValue(&out, ByteOrderMark);
+        appendValue(&out, static_cast<uint64_t>(partialBytes));
+        appendValue(&out, static_cast<uint64_t>(chunkBytes));
+        appendValue(&out, static_cast<uint64_t>(cache.size()));
+        for (const auto& [key, entry] : cache) {
+            appendValue(&out, key.device);
+            appendValue(&out, key.inode);
+            appendValue(&out, key.size);
+            appendValue(&out, key.mtime);
+            appendValue(&out, entry.partialHash);
+            appendValue(&out, entry.fullHash);
+            appendValue(&out, static_cast<uint8_t>((entry.hasPartial ? 1 : 0) | (entry.hasFull ? 2 : 0)));
+        }
+    }
+
+    // write to a temp file and rename it into place so a reader never sees half a cache
+    string tempPath = cachePath + ".tmp";
+    {
+        ofstream ofile(tempPath, ios_base::out | ios_base::binary | ios_base::trunc);
+        if (!ofile.is_open())
+            return false;
+        if (!ofile.write(out.data(), static_cast<streamsize>(out.size()))) {
+            ofile.close();
+            fs::remove(tempPath);
+            return false;
+        }
+    }
+    error_code ec;
+    fs::rename(tempPath, cachePath, ec);
+    if (ec)
+        fs::remove(tempPath, ec);
+    return !ec;
+}
+
+//
+// LoadCache - adds to what's already cached
+//
+bool HashTree::LoadCache(const string& cachePath)
+{
+    MappedFile file(cachePath);
+    const size_t headerBytes = sizeof(CacheMagic) + 4 + 4 + 8 + 8 + 8;
+    if (!file.IsOpen() || file.size() < headerBytes || memcmp(file.data(), CacheMagic, sizeof(CacheMagic)) != 0)
+        return false;
+
+    const char* data = file.data();
+    size_t pos = sizeof(CacheMagic);
+    if (readValue<uint32_t>(data, &pos) != CacheVersion || readValue<uint32_t>(data, &pos) != ByteOrderMark ||
+        readValue<uint64_t>(data, &pos) != partialBytes || readValue<uint64_t>(data, &pos) != chunkBytes)
+        return false;
+    uint64_t count = readValue<uint64_t>(data, &pos);
+    if (count > (file.size() - pos) / CacheEntryBytes)
+        return false;
+
+    lock_guard<mutex> guard(cacheLock);
+    cache.reserve(cache.size() + static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count; ++i) {
+        Key key;
+        key.device = readValue<uint64_t>(data, &pos);
+        key.inode = readValue<uint64_t>(data, &pos);
+        key.size = readValue<uint64_t>(data, &pos);
+        key.mtime = readValue<int64_t>(data, &pos);
+        CacheEntry entry;
+        entry.partialHash = readValue<uint64_t>(data, &pos);
+        entry.fullHash = readValue<uint64_t>(data, &pos);
+        uint8_t flags = readValue<uint8_t>(data, &pos);
+        entry.hasPartial = (flags & 1) != 0;
+        entry.hasFull = (flags & 2) != 0;
+        cache[key] = entry;
+    }
+    return true;
+}
+
+//
+// ClearCache
+//
+void HashTree::ClearCache()
+{
+    lock_guard<mutex> guard(cacheLock);
+    cache.clear();
+}
+
+//
+// CacheSize
+//
+size_t HashTree::CacheSize() const
+{
+    lock_guard<mutex> guard(cacheLock);
+    return cache.size();
+}
+
+} // end namespace Tau
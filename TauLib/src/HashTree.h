@@ -0,0 +1,153 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for HashTree, content hashes of directory trees for finding duplicate and changed files.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "Str.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief HashedFile - a file and the hash of its contents
+///
+struct HashedFile {
+    std::string path;           ///< relative to the directory scanned, or as passed to HashFiles()
+    uintmax_t size {0};
+    int64_t mtime {0};          ///< last write time in nanoseconds since 1970
+    uint64_t hash {0};
+    bool ok {false};            ///< false if the file couldn't be read
+};
+
+///
+/// @brief HashTreeChanges - the differences between two trees, as relative paths.  each list is sorted.
+///
+struct HashTreeChanges {
+    Strings added;              ///< only in the second tree
+    Strings removed;            ///< only in the first tree
+    Strings changed;            ///< in both with different contents
+
+    bool Empty() const { return added.empty() && removed.empty() && changed.empty(); }
+};
+
+///
+/// @brief HashTreeStats - the work the last call did
+///
+struct HashTreeStats {
+    size_t files {0};           ///< files looked at
+    size_t partialHashes {0};   ///< files whose first block was read
+    size_t fullHashes {0};      ///< files read in full
+    size_t cacheHits {0};       ///< hashes taken from the cache
+    uintmax_t bytesRead {0};
+};
+
+///
+/// @brief HashTree - hashes files on multiple threads, in stages so most files are never read, with a cache of hashes
+/// @remark Duplicates are found in stages: files are grouped by size, then by the hash of their first 64KB, and
+///         only files still matching another are hashed in full.  A file with a unique size is never opened.
+/// @remark A file's hash is XXHash64 (Tau_Hash.h) of its contents up to 4MB.  Bigger files are hashed in 4MB chunks
+///         on multiple threads and the hash is the XXHash64 of the chunk hashes.
+/// @remark The cache is keyed by device, inode, size and last write time so a file is hashed again only when it
+///         changes.  SaveCache() and LoadCache() keep it between runs.  On Windows the full path is used instead of
+///         the device and inode.
+/// @code
+///     HashTree hasher;
+///     hasher.LoadCache(cachePath);
+///     for (const Strings& copies : hasher.FindDuplicates({ romsDir }))
+///         ...
+///     HashTreeChanges changes = hasher.CompareTrees(installedDir, deployDir);
+///     hasher.SaveCache(cachePath);
+/// @endcode
+///
+class HashTree {
+public:
+    HashTree() {}
+
+    HashTree(const HashTree&) = delete;
+    HashTree& operator = (const HashTree&) = delete;
+
+    unsigned int maxThreads {0};    ///< 0 == the number of hardware threads
+
+                //*******************************
+                // Hashing
+                //*******************************
+
+    /// @brief full path lists of files with the same contents.  each list is sorted, the lists are sorted by their first path.
+    /// @param dirPaths the trees to search (recursive).
+    /// @param minSize files smaller than this are left out.  empty files are all the same.
+    std::vector<Strings> FindDuplicates(const Strings& dirPaths, uintmax_t minSize = 1);
+
+    /// @brief the hash of each file.  in the order passed.
+    std::vector<HashedFile> HashFiles(const Strings& filePaths);
+
+    /// @brief the hash of every file in a tree.  paths are relative to dirPath and sorted.
+    std::vector<HashedFile> Scan(const std::string& dirPath);
+
+    /// @brief the differences between two Scan()s
+    static HashTreeChanges Diff(const std::vector<HashedFile>& before, const std::vector<HashedFile>& after);
+
+    /// @brief the differences between two trees.  files of different sizes or first blocks aren't read in full.
+    HashTreeChanges CompareTrees(const std::string& dirPath1, const std::string& dirPath2);
+
+    /// @brief what the last FindDuplicates, HashFiles, Scan or CompareTrees did
+    HashTreeStats LastStats() const { return stats; }
+
+                //*******************************
+                // Cache
+                //*******************************
+
+    bool LoadCache(const std::string& cachePath);
+    bool SaveCache(const std::string& cachePath) const;
+    void ClearCache();
+    size_t CacheSize() const;
+
+private:
+    // the cache key and entry
+    struct Key {
+        uint64_t device {0};
+        uint64_t inode {0};
+        uint64_t size {0};
+        int64_t mtime {0};
+        bool operator == (const Key&) const = default;
+    };
+    struct KeyHash {
+        size_t operator () (const Key& key) const {
+            return static_cast<size_t>((key.inode * 0x9E3779B97F4A7C15ULL) ^ static_cast<uint64_t>(key.mtime) ^ key.size);
+        }
+    };
+    struct CacheEntry {
+        uint64_t partialHash {0};
+        uint64_t fullHash {0};
+        bool hasPartial {false};
+        bool hasFull {false};
+    };
+
+    // a file being hashed
+    struct FileInfo {
+        std::string path;
+        std::string relativePath;   // when walked
+        Key key;
+        uint64_t partialHash {0};
+        uint64_t fullHash {0};
+        bool ok {true};
+    };
+
+    void HashStage(const std::vector<FileInfo*>& files, bool partial);
+    void StatFiles(std::vector<FileInfo>* files);
+    std::vector<FileInfo> WalkFiles(const std::string& dirPath);
+
+    std::unordered_map<Key, CacheEntry, KeyHash> cache;
+    mutable std::mutex cacheLock;
+    HashTreeStats stats;
+};
+
+} // end namespace Tau
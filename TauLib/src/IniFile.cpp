@@ -3,6 +3,7 @@
 #include "Str.h"
 #include "Sep.h"
 #include "DirFile.h"
+#include "TextFileWriter.h"
 #include <assert.h>
 #include <iostream>
 #include <fstream>
@@ -275,8 +276,11 @@ bool IniFile::Save() {
 // IniFile::SaveAs
 //
 bool IniFile::SaveAs(const string& filePath) {
-    ofstream ofile(filePath.c_str(), ofstream::out | ofstream::trunc);
-    if (!ofile.is_open())
+    // replaced atomically so a crash while saving doesn't lose the settings
+    TextFileWriter::Options options;
+    options.atomicReplace = true;
+    TextFileWriter ofile(options);
+    if (!ofile.Open(filePath))
         return false;
 
     SortSectionKeys();  // sort the keys in each section
@@ -285,22 +289,21 @@ bool IniFile::SaveAs(const string& filePath) {
     auto it = FindSectionName("");  // find any "" theme
     if (it != iniSections.end()) {
         for(const auto& iniLine : it->iniLines) {
-            ofile << iniLine.RebuildLine() << endl;
+            ofile.WriteLine(iniLine.RebuildLine());
         }
     }
 
     for (const auto& section : iniSections) {
         if (section.sectionName != "") {
-            ofile << section.sectionLine.RebuildLine() << endl;
+            ofile.WriteLine(section.sectionLine.RebuildLine());
 
             for(const auto& iniLine : section.iniLines) {
-                ofile << iniLine.RebuildLine() << endl;
+                ofile.WriteLine(iniLine.RebuildLine());
             }
         }
     }
-    ofile.close();
 
-    return true;
+    return ofile.Close();
 }
 
 //
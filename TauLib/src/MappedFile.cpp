@@ -0,0 +1,127 @@
+///
+/// @file
+/// @brief CPP file for MappedFile class.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "MappedFile.h"
+#include <utility>
+
+#if defined(_WIN32)
+#include "windows.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+//
+// move assignment
+//
+MappedFile& MappedFile::operator = (MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        Close();
+        isOpen = exchange(other.isOpen, false);
+        mappedData = exchange(other.mappedData, nullptr);
+        mappedSize = exchange(other.mappedSize, 0);
+#if defined(_WIN32)
+        fileHandle = exchange(other.fileHandle, nullptr);
+        mappingHandle = exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+//
+// Open
+//
+bool MappedFile::Open(const string& filePath)
+{
+    Close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+    if (mappedSize > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            Close();
+            return false;
+        }
+        mappingHandle = mapping;
+        mappedData = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (mappedData == nullptr) {
+            Close();
+            return false;
+        }
+    }
+#else
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+    mappedSize = static_cast<size_t>(st.st_size);
+
+    if (mappedSize > 0) {
+        void* addr = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            mappedSize = 0;
+            return false;
+        }
+        madvise(addr, mappedSize, MADV_WILLNEED);
+        mappedData = static_cast<const char*>(addr);
+    }
+    close(fd);      // the mapping keeps the file open
+#endif
+
+    isOpen = true;
+    return true;
+}
+
+//
+// Close
+//
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+    if (mappedData != nullptr)
+        UnmapViewOfFile(mappedData);
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mappedData != nullptr)
+        munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+    mappedData = nullptr;
+    mappedSize = 0;
+    isOpen = false;
+}
+
+} // end namespace Tau
@@ -0,0 +1,53 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for MappedFile class.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief MappedFile - maps a whole file read only into memory.  the file is unmapped when the object goes away.
+/// @remark an empty file opens successfully with size() == 0 and data() == nullptr.
+///
+class MappedFile {
+public:
+    MappedFile() {}
+    MappedFile(const std::string& filePath) { Open(filePath); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator = (MappedFile&& other) noexcept;
+
+    /// @brief Open - map the file.  returns false if the file can't be opened or mapped.
+    bool Open(const std::string& filePath);
+
+    /// @brief Close - unmap the file
+    void Close();
+
+    bool IsOpen() const { return isOpen; }
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+    std::string_view view() const { return { mappedData, mappedSize }; }
+
+private:
+    bool isOpen {false};
+    const char* mappedData {nullptr};
+    size_t mappedSize {0};
+#if defined(_WIN32)
+    void* fileHandle {nullptr};
+    void* mappingHandle {nullptr};
+#endif
+};
+
+} // end namespace Tau
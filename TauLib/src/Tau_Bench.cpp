@@ -0,0 +1,438 @@
+///
+/// @file
+/// @brief CPP file for Bench, a benchmark harness with baselines to catch regressions.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_Bench.h"
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <ostream>
+#include <thread>
+#include "json.hpp"
+
+#if defined(_WIN32)
+#include "windows.h"
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace Tau {
+
+                //*******************************
+                // CPU
+                //*******************************
+
+//
+// CpuPin - runs the current thread on one CPU until destroyed
+//
+class CpuPin {
+public:
+    explicit CpuPin(int cpu) {
+        if (cpu < 0)
+            return;
+#if defined(_WIN32)
+        if (cpu < 64) {
+            previous = SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+            pinned = previous != 0;
+        }
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pinned = pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) == 0 &&
+                 pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+    }
+
+    ~CpuPin() {
+        if (!pinned)
+            return;
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), previous);
+#elif defined(__linux__)
+        pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+#endif
+    }
+
+    bool Pinned() const { return pinned; }
+
+private:
+    bool pinned {false};
+#if defined(_WIN32)
+    DWORD_PTR previous {0};
+#elif defined(__linux__)
+    cpu_set_t previous;
+#endif
+};
+
+#if defined(__linux__)
+// the first line of a /sys file, "" if it can't be read
+static string readSysFile(const string& path)
+{
+    ifstream file(path);
+    string line;
+    getline(file, line);
+    return line;
+}
+#endif
+
+//
+// MachineNotes
+//
+string Bench::MachineNotes() const
+{
+    string notes = format("cpus: {}\n", thread::hardware_concurrency());
+    notes += options.pinCpu >= 0 ? format("pinned to cpu {}\n", options.pinCpu) : "not pinned to a cpu\n";
+    int cpu = max(options.pinCpu, 0);
+#if defined(_WIN32)
+    DWORD mhz = 0;
+    DWORD size = sizeof(mhz);
+    if (RegGetValueA(HKEY_LOCAL_MACHINE, format("HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\{}", cpu).c_str(),
+                     "~MHz", RRF_RT_REG_DWORD, nullptr, &mhz, &size) == ERROR_SUCCESS)
+        notes += format("cpu {} rated MHz: {}\n", cpu, mhz);
+    notes += "check the power plan is High performance, times vary with Balanced\n";
+#elif defined(__linux__)
+    string cpufreq = format("/sys/devices/system/cpu/cpu{}/cpufreq/", cpu);
+    string governor = readSysFile(cpufreq + "scaling_governor");
+    if (governor.empty()) {
+        notes += "no cpufreq, the clock can't be checked (a VM?)\n";
+    } else {
+        notes += format("cpu {} governor: {}\n", cpu, governor);
+        if (governor != "performance")
+            notes += "the governor isn't performance, times vary with the clock\n";
+        string current = readSysFile(cpufreq + "scaling_cur_freq");
+        string highest = readSysFile(cpufreq + "scaling_max_freq");
+        if (!current.empty() && !highest.empty())
+            notes += format("cpu {} MHz: {} of {}\n", cpu, stoll(current) / 1000, stoll(highest) / 1000);
+    }
+    string noTurbo = readSysFile("/sys/devices/system/cpu/intel_pstate/no_turbo");
+    string boost = readSysFile("/sys/devices/system/cpu/cpufreq/boost");
+    if (noTurbo == "0" || boost == "1")
+        notes += "turbo is on, times vary with temperature\n";
+    else if (noTurbo == "1" || boost == "0")
+        notes += "turbo is off\n";
+#endif
+    return notes;
+}
+
+                //*******************************
+                // Running
+                //*******************************
+
+// the benchmarks TAU_BENCH registered
+static vector<pair<string, Bench::Loop>>& registered()
+{
+    static vector<pair<string, Bench::Loop>> benchmarks;
+    return benchmarks;
+}
+
+//
+// Bench
+//
+Bench::Bench(const BenchOptions& _options)
+    : options(_options)
+{
+}
+
+//
+// Add
+//
+void Bench::Add(const string& name, Op op)
+{
+    entries.push_back({ name, [op = move(op)](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i)
+            op();
+    } });
+}
+
+//
+// AddLoop
+//
+void Bench::AddLoop(const string& name, Loop loop)
+{
+    entries.push_back({ name, move(loop) });
+}
+
+//
+// Register
+//
+void Bench::Register(const string& name, Loop loop)
+{
+    registered().emplace_back(name, move(loop));
+}
+
+//
+// AddRegistered
+//
+void Bench::AddRegistered()
+{
+    for (auto& [name, loop] : registered())
+        AddLoop(name, loop);
+}
+
+//
+// Names
+//
+vector<string> Bench::Names() const
+{
+    vector<string> names;
+    for (const Entry& entry : entries)
+        names.push_back(entry.name);
+    return names;
+}
+
+// ns to run iterations iterations
+static double timeLoop(const Bench::Loop& loop, uint64_t iterations)
+{
+    auto start = chrono::steady_clock::now();
+    loop(iterations);
+    return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+}
+
+// the middle value.  values is sorted.
+static double median(const vector<double>& values)
+{
+    size_t middle = values.size() / 2;
+    return values.size() % 2 != 0 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+//
+// RunOne
+//
+BenchResult Bench::RunOne(const string& name, const Loop& loop, const BenchOptions& options)
+{
+    BenchResult result;
+    result.name = name;
+    CpuPin pin(options.pinCpu);
+
+    // warm up, growing the iteration count until a run takes a sample's time
+    uint64_t minIterations = max<uint64_t>(options.minIterations, 1);
+    uint64_t maxIterations = max(options.maxIterations, minIterations);
+    double sampleNs = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(options.sampleTime).count());
+    uint64_t iterations = minIterations;
+    auto warmupEnd = chrono::steady_clock::now() + options.warmup;
+    double ns = 0.0;
+    do {
+        ns = timeLoop(loop, iterations);
+        if (ns < sampleNs && iterations < maxIterations)
+            iterations = min(iterations * 2, maxIterations);
+    } while (chrono::steady_clock::now() < warmupEnd);
+
+    // then size it to a sample's time from a warm run
+    ns = timeLoop(loop, iterations);
+    if (ns > 0.0)
+        iterations = static_cast<uint64_t>(clamp(static_cast<double>(iterations) * sampleNs / ns,
+                                                 static_cast<double>(minIterations), static_cast<double>(maxIterations)));
+    result.iterations = iterations;
+
+    vector<double> times;
+    for (int sample = 0; sample < max(options.samples, 1); ++sample)
+        times.push_back(timeLoop(loop, iterations) / static_cast<double>(iterations));
+    sort(times.begin(), times.end());
+
+    // drop the outliers: further from the median than outlierMads median absolute deviations (scaled to a stddev)
+    double middle = median(times);
+    if (options.outlierMads > 0.0 && times.size() > 2) {
+        vector<double> deviations;
+        for (double time : times)
+            deviations.push_back(fabs(time - middle));
+        sort(deviations.begin(), deviations.end());
+        double limit = options.outlierMads * 1.4826 * median(deviations);
+        if (limit > 0.0) {
+            size_t before = times.size();
+            erase_if(times, [&](double time) { return fabs(time - middle) > limit; });
+            result.rejected = static_cast<int>(before - times.size());
+        }
+    }
+
+    result.samples = static_cast<int>(times.size());
+    result.minNs = times.front();
+    result.maxNs = times.back();
+    result.medianNs = median(times);
+    double total = 0.0;
+    for (double time : times)
+        total += time;
+    result.meanNs = total / static_cast<double>(times.size());
+    if (times.size() > 1) {
+        double squares = 0.0;
+        for (double time : times)
+            squares += (time - result.meanNs) * (time - result.meanNs);
+        result.stddevNs = sqrt(squares / static_cast<double>(times.size() - 1));
+    }
+    return result;
+}
+
+// a row of ToText()
+static string textLine(const BenchResult& result)
+{
+    return format("{:<40} {:>12} {:>8} {:>8} {:>12.2f} {:>12.2f} {:>12.2f} {:>12.2f} {:>10.2f}\n",
+                  result.name, result.iterations, result.samples, result.rejected,
+                  result.minNs, result.medianNs, result.meanNs, result.maxNs, result.stddevNs);
+}
+
+static string textHeading()
+{
+    return format("{:<40} {:>12} {:>8} {:>8} {:>12} {:>12} {:>12} {:>12} {:>10}\n",
+                  "benchmark", "iterations", "samples", "outliers", "min ns", "median ns", "mean ns", "max ns", "stddev");
+}
+
+//
+// Run
+//
+const vector<BenchResult>& Bench::Run(ostream* progress)
+{
+    results.clear();
+    if (progress != nullptr)
+        *progress << MachineNotes() << "\n" << textHeading() << flush;
+    for (const Entry& entry : entries) {
+        if (!options.filter.empty() && entry.name.find(options.filter) == string::npos)
+            continue;
+        results.push_back(RunOne(entry.name, entry.loop, options));
+        if (progress != nullptr)
+            *progress << textLine(results.back()) << flush;
+    }
+    return results;
+}
+
+                //*******************************
+                // Output
+                //*******************************
+
+//
+// ToText
+//
+string Bench::ToText() const
+{
+    string text = textHeading();
+    for (const BenchResult& result : results)
+        text += textLine(result);
+    return text;
+}
+
+//
+// ToJson
+//
+string Bench::ToJson() const
+{
+    json notes = json::array();
+    string text = MachineNotes();
+    for (size_t start = 0, end; (end = text.find('\n', start)) != string::npos; start = end + 1)
+        notes.push_back(text.substr(start, end - start));
+
+    json benchmarks = json::array();
+    for (const BenchResult& result : results) {
+        benchmarks.push_back({
+            { "name", result.name },
+            { "iterations", result.iterations },
+            { "samples", result.samples },
+            { "rejected", result.rejected },
+            { "minNs", result.minNs },
+            { "medianNs", result.medianNs },
+            { "meanNs", result.meanNs },
+            { "maxNs", result.maxNs },
+            { "stddevNs", result.stddevNs },
+        });
+    }
+    json out = { { "machine", notes }, { "results", benchmarks } };
+    return out.dump(2);
+}
+
+//
+// SaveBaseline
+//
+bool Bench::SaveBaseline(const string& path) const
+{
+    ofstream file(path, ios::binary | ios::trunc);
+    file << ToJson() << "\n";
+    return static_cast<bool>(file);
+}
+
+//
+// Compare
+//
+vector<BenchComparison> Bench::Compare(const string& baselinePath, double threshold, bool* ok) const
+{
+    vector<BenchComparison> comparisons;
+    if (ok != nullptr)
+        *ok = false;
+
+    json baseline;
+    try {
+        ifstream file(baselinePath, ios::binary);
+        if (!file)
+            return comparisons;
+        baseline = json::parse(file);
+    }
+    catch (const json::exception&) {
+        return comparisons;
+    }
+    const json& baselineResults = baseline.contains("results") ? baseline["results"] : json::array();
+
+    bool regressed = false;
+    vector<bool> matched(baselineResults.size(), false);
+    for (const BenchResult& result : results) {
+        BenchComparison comparison;
+        comparison.name = result.name;
+        comparison.currentNs = result.medianNs;
+        comparison.missing = true;
+        for (size_t i = 0; i < baselineResults.size(); ++i) {
+            const json& old = baselineResults[i];
+            if (!old.is_object() || old.value("name", "") != result.name)
+                continue;
+            matched[i] = true;
+            comparison.missing = false;
+            comparison.baselineNs = old.value("medianNs", 0.0);
+            if (comparison.baselineNs > 0.0)
+                comparison.change = comparison.currentNs / comparison.baselineNs - 1.0;
+            comparison.regressed = comparison.change > threshold;
+            regressed = regressed || comparison.regressed;
+            break;
+        }
+        comparisons.push_back(comparison);
+    }
+
+    // the baseline's benchmarks that weren't run, leaving out those the filter skipped
+    for (size_t i = 0; i < baselineResults.size(); ++i) {
+        const json& old = baselineResults[i];
+        if (matched[i] || !old.is_object())
+            continue;
+        string name = old.value("name", "");
+        if (!options.filter.empty() && name.find(options.filter) == string::npos)
+            continue;
+        BenchComparison comparison;
+        comparison.name = name;
+        comparison.baselineNs = old.value("medianNs", 0.0);
+        comparison.missing = true;
+        comparisons.push_back(comparison);
+    }
+
+    if (ok != nullptr)
+        *ok = !regressed;
+    return comparisons;
+}
+
+//
+// ComparisonText
+//
+string Bench::ComparisonText(const vector<BenchComparison>& comparisons)
+{
+    string text = format("{:<40} {:>14} {:>14} {:>9}\n", "benchmark", "baseline ns", "current ns", "change");
+    for (const BenchComparison& comparison : comparisons) {
+        string change;
+        if (comparison.missing)
+            change = comparison.currentNs > 0.0 ? "new" : "not run";
+        else
+            change = format("{:+.1f}%{}", comparison.change * 100.0, comparison.regressed ? "  REGRESSED" : "");
+        text += format("{:<40} {:>14.2f} {:>14.2f} {:>9}\n", comparison.name, comparison.baselineNs, comparison.currentNs, change);
+    }
+    return text;
+}
+
+} // end namespace Tau
@@ -0,0 +1,175 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for Bench, a benchmark harness with baselines to catch regressions.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief how Bench runs each benchmark
+///
+struct BenchOptions {
+    std::chrono::milliseconds warmup {200};         ///< run for this long first, unmeasured
+    std::chrono::milliseconds sampleTime {20};      ///< the iteration count is picked so a sample takes about this long
+    int samples {25};                               ///< samples per benchmark
+    uint64_t minIterations {1};                     ///< per sample
+    uint64_t maxIterations {1'000'000'000};         ///< per sample
+    double outlierMads {3.0};                       ///< samples further than this many MADs from the median are dropped.  0 keeps them all.
+    int pinCpu {-1};                                ///< run on this CPU only.  -1 doesn't pin.
+    std::string filter;                             ///< only the benchmarks with names containing this
+};
+
+///
+/// @brief what one benchmark measured.  times are ns per iteration over the samples kept.
+///
+struct BenchResult {
+    std::string name;
+    uint64_t iterations {0};        ///< per sample
+    int samples {0};                ///< kept
+    int rejected {0};               ///< dropped as outliers
+    double minNs {0.0};
+    double medianNs {0.0};
+    double meanNs {0.0};
+    double maxNs {0.0};
+    double stddevNs {0.0};
+};
+
+///
+/// @brief a result against its baseline
+///
+struct BenchComparison {
+    std::string name;
+    double baselineNs {0.0};        ///< median
+    double currentNs {0.0};         ///< median
+    double change {0.0};            ///< current / baseline - 1.  0.1 is 10% slower.
+    bool regressed {false};         ///< change is over the threshold
+    bool missing {false};           ///< in the baseline but not run, or run but not in the baseline
+};
+
+///
+/// @brief keep the compiler from optimizing a value, and the work that made it, away
+///
+template <class T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+    volatile char sink = *reinterpret_cast<const volatile char*>(&value);
+    (void)sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+///
+/// @brief Bench - runs benchmarks and compares them to a saved baseline
+/// @remark Each benchmark is warmed up, then its iteration count is found by doubling until a run takes sampleTime.
+///         It's then run samples times.  Samples more than outlierMads median absolute deviations from the median
+///         (a context switch, a page fault storm) are dropped before the stats are worked out.
+/// @remark A loop benchmark is passed the iteration count and loops itself, so setup can be outside the timing and
+///         the per iteration cost isn't a std::function call.  Use it for anything under 10ns or so.
+/// @remark Pin to a CPU and fix the clock (performance governor, turbo off) for numbers that repeat.  MachineNotes()
+///         says what the clock was doing, and is saved in the baseline.
+/// @code
+///     Bench bench;
+///     bench.Add("trim", [] { DoNotOptimize(trim("  text  ")); });
+///     bench.AddLoop("XXHash64 4KB", [](uint64_t iterations) {
+///         string data(4096, 'x');
+///         for (uint64_t i = 0; i < iterations; ++i)
+///             DoNotOptimize(XXHash64(data));
+///     });
+///     bench.Run(&cout);
+///     bench.SaveBaseline("baseline.json");
+///     ...
+///     bool ok;
+///     cout << Bench::ComparisonText(bench.Compare("baseline.json", 0.10, &ok));
+/// @endcode
+///
+class Bench {
+public:
+    using Op = std::function<void ()>;
+    using Loop = std::function<void (uint64_t iterations)>;
+
+    explicit Bench(const BenchOptions& options = BenchOptions());
+
+    /// @brief a benchmark called once per iteration
+    void Add(const std::string& name, Op op);
+    /// @brief a benchmark that runs iterations iterations itself
+    void AddLoop(const std::string& name, Loop loop);
+
+    /// @brief the benchmarks registered by TAU_BENCH in every file linked in
+    static void Register(const std::string& name, Loop loop);
+    void AddRegistered();
+
+    /// @brief the benchmarks added, the filter aside
+    std::vector<std::string> Names() const;
+
+    /// @brief run the benchmarks that match the filter.  a line per benchmark to progress as it finishes.
+    const std::vector<BenchResult>& Run(std::ostream* progress = nullptr);
+    /// @brief run one benchmark with these options
+    static BenchResult RunOne(const std::string& name, const Loop& loop, const BenchOptions& options);
+
+    const std::vector<BenchResult>& Results() const { return results; }
+    BenchOptions& Options() { return options; }
+
+    /// @brief the results as a table, and as JSON with the machine notes
+    std::string ToText() const;
+    std::string ToJson() const;
+
+    /// @brief save ToJson() as a baseline
+    bool SaveBaseline(const std::string& path) const;
+
+    /// @brief compare the results to a baseline.  ok is false if any regressed by more than threshold (0.1 = 10%).
+    /// @remark an empty result if the baseline can't be read, with ok false.
+    std::vector<BenchComparison> Compare(const std::string& baselinePath, double threshold, bool* ok = nullptr) const;
+    static std::string ComparisonText(const std::vector<BenchComparison>& comparisons);
+
+    /// @brief the CPU count, the CPU pinned to and what its clock is doing (governor, MHz, turbo) as text lines
+    std::string MachineNotes() const;
+
+private:
+    struct Entry {
+        std::string name;
+        Loop loop;
+    };
+
+    BenchOptions options;
+    std::vector<Entry> entries;
+    std::vector<BenchResult> results;
+};
+
+} // end namespace Tau
+
+#define TAU_BENCH_CONCAT2(a, b) a##b
+#define TAU_BENCH_CONCAT(a, b) TAU_BENCH_CONCAT2(a, b)
+
+///
+/// @brief register a loop benchmark at startup for Bench::AddRegistered()
+/// @code
+///     TAU_BENCH("lowerCase 64 chars", iterations) {
+///         string text(64, 'A');
+///         for (uint64_t i = 0; i < iterations; ++i)
+///             Tau::DoNotOptimize(Tau::lowerCase(text));
+///     }
+/// @endcode
+///
+#define TAU_BENCH(name, iterations) \
+    static void TAU_BENCH_CONCAT(tauBench, __LINE__)(uint64_t iterations); \
+    static const bool TAU_BENCH_CONCAT(tauBenchRegistered, __LINE__) = \
+        (Tau::Bench::Register(name, TAU_BENCH_CONCAT(tauBench, __LINE__)), true); \
+    static void TAU_BENCH_CONCAT(tauBench, __LINE__)(uint64_t iterations)
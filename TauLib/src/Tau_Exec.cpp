@@ -5,12 +5,14 @@
 /// 
 
 #include "Tau_Exec.h"
+#include "Tau_Process.h"
 #include "DirFile.h"
 #include "Str.h"
 #include <algorithm>
+#if defined(_WIN32)
 #include "windows.h"
+#endif
 #include <iostream>
-#include "DirStack.h"
 
 using namespace std;
 using namespace Tau;
@@ -25,150 +27,40 @@ namespace Tau {
 int ExecuteCmd(std::string command, bool waitToFinish, Tau::Strings arguments)
     { return ExecuteInCmdDir(command, waitToFinish, arguments); }
 
-// this will save the current dir, change to the command's path, execute the command and restore the working dir.
+// execute the command in the command's directory
 int ExecuteInCmdDir(std::string command, bool waitToFinish, Tau::Strings arguments) {
     return ExecuteInPassedDir(GetParentPath(command), command, waitToFinish, arguments);
 }
 
-// this will save the current dir, change to the passed workingdir, execute the command and restore the working dir.
-int ExecuteInPassedDir(string workingDir, string command, bool waitToFinish, vector<string> arguments) {
-    DirStack dirStack(workingDir);              // save and restore the current dir
-    int ret = ExecuteInCurrentDir(command, waitToFinish, arguments);
-
-    return ret;
-}
-
-// Execute a program in new process
+// execute - run the program in workingDir (empty == ours).  only the child's directory is set so it's safe to call
+// from many threads at once.
 // Returns the exit code of the process, or -1 if the process could not be started.
-int ExecuteInCurrentDir(string command, bool waitToFinish, vector<string> arguments) {
-
-#if defined(_WIN32)
-    string moduleName;
-
-    if (icompareBool(GetFileExtensionWithoutDot(command), "bat")) {
-        //
-        // if batch file, change the command to "c:\\Windows\\System32\\cmd.exe /c command.bat arguments"
-        //
-        arguments.insert(begin(arguments), command);
-        arguments.insert(begin(arguments), "/c");
-        char cmdbuf[200];
-        GetEnvironmentVariable("ComSpec", cmdbuf, sizeof(cmdbuf));
-        command = cmdbuf;
-        //moduleName = cmdbuf;  // pass NULL instead
-    }
-    else {  
-        //
-        // not a batch file
-        //
+// returns 0 without waiting if waitToFinish is false.
+static int execute(const string& workingDir, const string& command, bool waitToFinish, const vector<string>& arguments) {
+    ProcessOptions options;
+    options.workingDir = workingDir;
+    Process process;
+    if (!process.Start(command, arguments, options)) {
+        cerr << "Unable to run " << command << endl;
+        return -1;
     }
 
-    // add double quotes around any strings that have a space
-    DoubleQuoteStringIfSpace(&moduleName);
-    DoubleQuoteStringIfSpace(&command);
-    ranges::for_each(arguments, [&] (string& s) { DoubleQuoteStringIfSpace(&s); } );
-
-    // concat the command and the arguments
-    string cmdline = command;
-    for (const string& arg : arguments) {
-        cmdline.append(" ");
-        cmdline.append(arg);
-    };
-
-#if 1
-    cout << "moduleName: " << moduleName << endl;
-    cout << "cmdline: " << cmdline << endl;
-#endif
-
-	STARTUPINFO startInfo;
-	ZeroMemory(&startInfo, sizeof(startInfo));
-	startInfo.cb = sizeof(startInfo);
-	startInfo.dwFlags = STARTF_USESTDHANDLES;
-
-	PROCESS_INFORMATION procInfo;
-    procInfo.hProcess = INVALID_HANDLE_VALUE;
-    procInfo.hThread  = INVALID_HANDLE_VALUE;
-    procInfo.dwProcessId = 0;
-    procInfo.dwThreadId = 0;
-
-    DWORD procFlags = CREATE_DEFAULT_ERROR_MODE | 
-                      CREATE_NO_WINDOW |
-                      CREATE_NEW_PROCESS_GROUP;
-
-    int ret = CreateProcess(
-        (moduleName.empty() ? NULL : moduleName.c_str()),                   // module name
-        (cmdline.empty() ? NULL : const_cast<char*>(cmdline.c_str())), 	    // Command line
-        NULL, 											                    // Process handle not inheritable
-        NULL, 											                    // Thread handle not inheritable
-        false, 											                    // handle inheritance
-        procFlags, 										                    // creation flags
-        NULL, 											                    // Use parent's environment block
-        NULL, 											                    // starting directory 
-        &startInfo, 									                    // Pointer to STARTUPINFO structure
-        &procInfo 										                    // Pointer to PROCESS_INFORMATION structure
-    );
-
-    // if error
-    if (ret == 0)
-	{
-		int lasterror = GetLastError();
-
-		LPTSTR strErrorMessage = NULL;
-		
-		// the next line was taken from GitHub
-		FormatMessage(
-			FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_ALLOCATE_BUFFER,
-			NULL,
-			lasterror,
-			0,
-			(LPTSTR)(&strErrorMessage),
-			0,
-			NULL);
-
-		cerr << "CreateProcess failed with error " << dec << lasterror << ": " << strErrorMessage << endl;
-		return -1;
-	}
-
-    if (waitToFinish) {
-        // Wait until child process exits.
-	    WaitForSingleObject(procInfo.hProcess, INFINITE);
-
-	    DWORD exitCode;
-	    GetExitCodeProcess(procInfo.hProcess, &exitCode);
-
-	    // Close process and thread handles.
-	    CloseHandle(procInfo.hProcess);
-	    CloseHandle(procInfo.hThread);
-    	return exitCode;
-    }
-    else
+    if (!waitToFinish) {
+        process.Detach();
         return 0;
+    }
+    return process.Wait().exitCode;
 }
-#else
-    vector<const char *> argvNew;
-
-    string link = command;
-    argvNew.push_back(link.c_str());
-    for (const string& arg : arguments)
-        argvNew.push_back(arg.c_str());
-    argvNew.push_back(nullptr);
 
-#if 1
-    cout << "CMD line to execute: ";
-    for (const char *s:argvNew) {
-        if (s != nullptr) {
-            cout << s << " ";
-        }
-    }
-    cout << endl;
-#endif
+// execute the command in the passed workingdir.  the current dir isn't changed.
+int ExecuteInPassedDir(string workingDir, string command, bool waitToFinish, vector<string> arguments) {
+    return execute(workingDir, command, waitToFinish, arguments);
+}
 
-    int pid = fork();
-    if (!pid) {
-        execvp(link.c_str(), (char **) argvNew.data());
-    }
-    waitpid(pid, NULL, 0);
-    Sleep_MilliSeconds(300);
-#endif
+// Execute a program in new process
+int ExecuteInCurrentDir(string command, bool waitToFinish, vector<string> arguments) {
+    return execute("", command, waitToFinish, arguments);
+}
 
     //*******************************
     // ExecuteFile
@@ -181,9 +73,7 @@ int ExecuteInCurrentDir(string command, bool waitToFinish, vector<string> argume
         auto hinstance = ShellExecute(NULL, "open", urlOrFilePath.c_str(), NULL, NULL, SW_SHOWNORMAL);
         return (hinstance != nullptr);
     #else
-        string cmd = "xdg-open " + url;
-        int ret = system(cmd.c_str());
-        return (ret == 0);
+        return Process::Run("xdg-open", { urlOrFilePath }).exitCode == 0;
     #endif
     }
 
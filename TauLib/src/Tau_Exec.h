@@ -25,20 +25,22 @@ namespace Tau {
 int ExecuteCmd(std::string command, bool waitToFinish = true, Tau::Strings arguments = {});
 
 ///
-/// @brief ExecuteInCmdDir - this will save the current dir, change to the command's path, execute the command and restore the working dir.
+/// @brief ExecuteInCmdDir - execute the command with the command's path as its working dir.
 /// 
 int ExecuteInCmdDir(std::string command, bool waitToFinish = true, Tau::Strings arguments = {});
 
 ///
-/// @brief ExecuteInPassedDir - this will save the current dir, change to the passed workingdir, execute the command and restore the working dir.
+/// @brief ExecuteInPassedDir - execute the command with the passed workingdir as its working dir.
+/// Only the new process's dir is set.  Ours isn't changed so it can be called from many threads at once.
 /// 
 int ExecuteInPassedDir(std::string workingDir, std::string command, bool waitToFinish = true, Tau::Strings arguments = {});
 
 ///
 /// @brief ExecuteInCurrentDir - Execute a program in another process.  
-/// The other Execute routines all call this one.
+/// ExecuteCmd and ExecuteInCmdDir go through ExecuteInPassedDir, which runs the program the same way as this one.
+/// See Tau_Process.h for capturing the output.
 /// 
-// Returns the exit code of the process, or -1 if the process could not be started.
+// Returns the exit code of the process, or -1 if the process could not be started.  0 if waitToFinish is false.
 // note: we purposely pass by value so the routine can modify the args if needed
 // do not enclose the command or arguments in double quotes.  the routine will take care of that if needed.
 int ExecuteInCurrentDir(std::string command, bool waitToFinish = true, Tau::Strings arguments = {});
@@ -0,0 +1,128 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for Generator, a lazy range produced by a C++20 coroutine.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief Generator - a single pass range whose values are produced on demand by a coroutine with co_yield
+/// @remark The coroutine runs up to its next co_yield each time the iterator is incremented, so stopping the loop
+///         early (break, return) stops the work.  Destroying the Generator destroys the coroutine and its locals.
+/// @remark A yielded value is referenced, not copied.  It's only valid until the iterator is incremented.
+/// @remark An exception thrown in the coroutine is rethrown from begin() or operator++.
+/// @code
+///     Generator<int> Count(int n) {
+///         for (int i = 0; i < n; ++i)
+///             co_yield i;
+///     }
+///     for (int i : Count(10)) ...
+/// @endcode
+///
+template <class T>
+class Generator {
+public:
+    using value_type = std::remove_cvref_t<T>;
+    using reference = std::conditional_t<std::is_reference_v<T>, T, const T&>;
+    using pointer = std::add_pointer_t<reference>;
+
+    struct promise_type {
+        pointer value {nullptr};
+        std::exception_ptr exception;
+
+        Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(reference v) noexcept { value = std::addressof(v); return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        // co_await isn't allowed in a generator
+        template <class U>
+        std::suspend_never await_transform(U&&) = delete;
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Generator::value_type;
+        using reference = Generator::reference;
+        using pointer = Generator::pointer;
+
+        iterator() {}
+        explicit iterator(Handle _coroutine) : coroutine(_coroutine) {}
+
+        reference operator * () const { return static_cast<reference>(*coroutine.promise().value); }
+        pointer operator -> () const { return coroutine.promise().value; }
+
+        iterator& operator ++ () {
+            coroutine.resume();
+            Rethrow();
+            return *this;
+        }
+        void operator ++ (int) { ++*this; }
+
+        bool operator == (std::default_sentinel_t) const { return !coroutine || coroutine.done(); }
+
+    private:
+        friend class Generator;
+        void Rethrow() {
+            if (coroutine.done() && coroutine.promise().exception)
+                std::rethrow_exception(std::exchange(coroutine.promise().exception, nullptr));
+        }
+
+        Handle coroutine {nullptr};
+    };
+
+    Generator() {}
+    Generator(Generator&& other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+    Generator& operator = (Generator&& other) noexcept {
+        if (this != &other) {
+            Destroy();
+            coroutine = std::exchange(other.coroutine, nullptr);
+        }
+        return *this;
+    }
+    ~Generator() { Destroy(); }
+
+    Generator(const Generator&) = delete;
+    Generator& operator = (const Generator&) = delete;
+
+    /// @brief runs the coroutine to its first co_yield.  only call once.
+    iterator begin() {
+        iterator it(coroutine);
+        if (coroutine) {
+            coroutine.resume();
+            it.Rethrow();
+        }
+        return it;
+    }
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+private:
+    explicit Generator(Handle _coroutine) : coroutine(_coroutine) {}
+    void Destroy() {
+        if (coroutine)
+            coroutine.destroy();
+        coroutine = nullptr;
+    }
+
+    Handle coroutine {nullptr};
+};
+
+} // end namespace Tau
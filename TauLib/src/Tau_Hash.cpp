@@ -0,0 +1,101 @@
+///
+/// @file
+/// @brief CPP file for hash routines.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_Hash.h"
+#include <cstring>
+
+namespace Tau {
+
+                //*******************************
+                // XXHash64
+                //*******************************
+
+// see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// unaligned little endian reads
+static inline uint64_t read64(const unsigned char* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+static inline uint32_t read32(const unsigned char* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+static inline uint64_t round64(uint64_t acc, uint64_t input)
+{
+    acc += input * Prime2;
+    acc = rotl64(acc, 31);
+    return acc * Prime1;
+}
+
+static inline uint64_t mergeRound64(uint64_t acc, uint64_t val)
+{
+    acc ^= round64(0, val);
+    return acc * Prime1 + Prime4;
+}
+
+//
+// XXHash64
+//
+uint64_t XXHash64(const void* data, size_t length, uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t h;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + Prime1 + Prime2;
+        uint64_t v2 = seed + Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = mergeRound64(h, v1);
+        h = mergeRound64(h, v2);
+        h = mergeRound64(h, v3);
+        h = mergeRound64(h, v4);
+    } else {
+        h = seed + Prime5;
+    }
+
+    h += static_cast<uint64_t>(length);
+
+    while (p + 8 <= end) {
+        h ^= round64(0, read64(p));
+        h = rotl64(h, 27) * Prime1 + Prime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read32(p)) * Prime1;
+        h = rotl64(h, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * Prime5;
+        h = rotl64(h, 11) * Prime1;
+        ++p;
+    }
+
+    // avalanche
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // end namespace Tau
@@ -0,0 +1,31 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for hash routines.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief XXHash64 - 64 bit xxHash (XXH64) of a block of memory.  Fast non-cryptographic hash for change detection.
+/// @param data the bytes to hash
+/// @param length the number of bytes
+/// @param seed optional seed
+/// @return the hash.  the same as the reference XXH64() implementation.
+///
+uint64_t XXHash64(const void* data, size_t length, uint64_t seed = 0);
+
+///
+/// @brief XXHash64 of a string
+///
+inline uint64_t XXHash64(std::string_view str, uint64_t seed = 0) { return XXHash64(str.data(), str.size(), seed); }
+
+} // end namespace Tau
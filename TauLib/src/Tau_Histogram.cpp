@@ -0,0 +1,315 @@
+///
+/// @file
+/// @brief CPP file for Histogram, log linear (HDR style) latency histograms with percentiles.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_Histogram.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <thread>
+
+using namespace std;
+
+namespace Tau {
+
+// the percentiles the dumps show
+static const double dumpPercentiles[] = { 50.0, 75.0, 90.0, 95.0, 99.0, 99.9, 99.99 };
+
+                //*******************************
+                // HistogramCounts
+                //*******************************
+
+//
+// HistogramCounts
+//
+HistogramCounts::HistogramCounts(int _subBucketBits)
+    : subBucketBits(clamp(_subBucketBits, 1, 16))
+{
+}
+
+//
+// BucketCount
+//
+size_t HistogramCounts::BucketCount(int subBucketBits)
+{
+    return static_cast<size_t>(66 - subBucketBits) << (subBucketBits - 1);
+}
+
+//
+// BucketOf
+//
+size_t HistogramCounts::BucketOf(uint64_t value, int subBucketBits)
+{
+    uint64_t exact = uint64_t(1) << subBucketBits;
+    if (value < exact)
+        return static_cast<size_t>(value);
+    uint64_t half = exact / 2;
+    int exponent = static_cast<int>(bit_width(value)) - 1;
+    int shift = exponent - (subBucketBits - 1);
+    return static_cast<size_t>(exact + static_cast<uint64_t>(exponent - subBucketBits) * half + ((value >> shift) - half));
+}
+
+//
+// BucketValue
+//
+uint64_t HistogramCounts::BucketValue(size_t bucket, int subBucketBits)
+{
+    uint64_t exact = uint64_t(1) << subBucketBits;
+    if (bucket < exact)
+        return bucket;
+    uint64_t half = exact / 2;
+    uint64_t above = bucket - exact;
+    int exponent = static_cast<int>(above / half) + subBucketBits;
+    int shift = exponent - (subBucketBits - 1);
+    return ((above % half + half) << shift) + ((uint64_t(1) << shift) / 2);
+}
+
+//
+// Record
+//
+void HistogramCounts::Record(uint64_t value, uint64_t times)
+{
+    if (times == 0)
+        return;
+    if (counts.empty())
+        counts.resize(BucketCount());
+    counts[BucketOf(value, subBucketBits)] += times;
+    count += times;
+    total += value * times;
+    min = std::min(min, value);
+    max = std::max(max, value);
+}
+
+//
+// Merge
+//
+bool HistogramCounts::Merge(const HistogramCounts& other)
+{
+    if (other.subBucketBits != subBucketBits)
+        return false;
+    if (other.count == 0)
+        return true;
+    if (counts.empty())
+        counts.resize(BucketCount());
+    for (size_t bucket = 0; bucket < other.counts.size(); ++bucket)
+        counts[bucket] += other.counts[bucket];
+    count += other.count;
+    total += other.total;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    return true;
+}
+
+//
+// Reset
+//
+void HistogramCounts::Reset()
+{
+    counts.clear();
+    count = 0;
+    total = 0;
+    min = UINT64_MAX;
+    max = 0;
+}
+
+//
+// Percentile - the middle of the bucket the value is in, kept within min and max
+//
+uint64_t HistogramCounts::Percentile(double percent) const
+{
+    if (count == 0)
+        return 0;
+    double wanted = ceil(clamp(percent, 0.0, 100.0) / 100.0 * static_cast<double>(count));
+    uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(wanted), 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank)
+            return clamp(BucketValue(bucket, subBucketBits), Min(), std::max(Min(), max));
+    }
+    return max;
+}
+
+//
+// ToText
+//
+string HistogramCounts::ToText(const string& name, const string& unit) const
+{
+    string suffix = unit.empty() ? "" : " " + unit;
+    string text = format("{}{}count={} min={}{} mean={:.1f}{} max={}{}\n", name, name.empty() ? "" : ": ",
+                         count, Min(), suffix, Mean(), suffix, max, suffix);
+    text += format("{:>10} {:>20} {:>12}\n", "percentile", "value", "count");
+    for (double percent : dumpPercentiles) {
+        uint64_t rank = static_cast<uint64_t>(ceil(percent / 100.0 * static_cast<double>(count)));
+        text += format("{:>10} {:>20} {:>12}\n", format("{:g}", percent), Percentile(percent), rank);
+    }
+    text += format("{:>10} {:>20} {:>12}\n", "100", max, count);
+    return text;
+}
+
+//
+// ToJson
+//
+string HistogramCounts::ToJson(const string& name, const string& unit) const
+{
+    // names and units are expected to be plain text, only quotes and backslashes are escaped
+    auto quoted = [](const string& text) {
+        string out = "\"";
+        for (char ch : text) {
+            if (ch == '"' || ch == '\\')
+                out.push_back('\\');
+            out.push_back(ch);
+        }
+        return out + "\"";
+    };
+    string json = format("{{\"name\":{},\"unit\":{},\"count\":{},\"min\":{},\"max\":{},\"mean\":{:.3f},\"total\":{},"
+                         "\"percentiles\":{{", quoted(name), quoted(unit), count, Min(), max, Mean(), total);
+    bool first = true;
+    for (double percent : dumpPercentiles) {
+        json += format("{}\"{:g}\":{}", first ? "" : ",", percent, Percentile(percent));
+        first = false;
+    }
+    json += "},\"buckets\":[";
+    first = true;
+    for (size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        if (counts[bucket] == 0)
+            continue;
+        json += format("{}[{},{}]", first ? "" : ",", BucketValue(bucket, subBucketBits), counts[bucket]);
+        first = false;
+    }
+    return json + "]}";
+}
+
+                //*******************************
+                // Histogram
+                //*******************************
+
+//
+// Shard - the counts one group of threads records into.  on its own cache lines.
+//
+struct alignas(64) Histogram::Shard {
+    atomic<atomic<uint64_t>*> counts {nullptr};      // allocated by the first Record()
+    atomic<uint64_t> total {0};
+    atomic<uint64_t> min {UINT64_MAX};
+    atomic<uint64_t> max {0};
+
+    ~Shard() { delete[] counts.load(); }
+};
+
+//
+// Histogram
+//
+Histogram::Histogram(const string& _name, const string& _unit, int _subBucketBits)
+    : name(_name), unit(_unit), subBucketBits(clamp(_subBucketBits, 1, 16)),
+      bucketCount(HistogramCounts::BucketCount(subBucketBits))
+{
+    size_t shardCount = bit_ceil(clamp<size_t>(thread::hardware_concurrency(), 1, 64));
+    shards = make_unique<Shard[]>(shardCount);
+    shardMask = shardCount - 1;
+}
+
+Histogram::~Histogram()
+{
+}
+
+//
+// Record
+//
+void Histogram::Record(uint64_t value)
+{
+    // threads take shards in turn the first time they record
+    static atomic<size_t> nextShard {0};
+    thread_local size_t threadShard = nextShard.fetch_add(1, memory_order_relaxed);
+    Shard& shard = shards[threadShard & shardMask];
+
+    atomic<uint64_t>* counts = shard.counts.load(memory_order_acquire);
+    if (counts == nullptr) {
+        auto* fresh = new atomic<uint64_t>[bucketCount]();
+        if (shard.counts.compare_exchange_strong(counts, fresh, memory_order_acq_rel))
+            counts = fresh;
+        else
+            delete[] fresh;
+    }
+    counts[HistogramCounts::BucketOf(value, subBucketBits)].fetch_add(1, memory_order_relaxed);
+    shard.total.fetch_add(value, memory_order_relaxed);
+
+    uint64_t seen = shard.min.load(memory_order_relaxed);
+    while (value < seen && !shard.min.compare_exchange_weak(seen, value, memory_order_relaxed))
+        ;
+    seen = shard.max.load(memory_order_relaxed);
+    while (value > seen && !shard.max.compare_exchange_weak(seen, value, memory_order_relaxed))
+        ;
+}
+
+//
+// Merge - add up the shards, emptying them if reset
+//
+HistogramCounts Histogram::Merge(bool reset) const
+{
+    HistogramCounts merged(subBucketBits);
+    for (size_t i = 0; i <= shardMask; ++i) {
+        Shard& shard = shards[i];
+        atomic<uint64_t>* counts = shard.counts.load(memory_order_acquire);
+        if (counts == nullptr)
+            continue;
+        uint64_t shardCount = 0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            uint64_t n = reset ? counts[bucket].exchange(0, memory_order_relaxed)
+                               : counts[bucket].load(memory_order_relaxed);
+            if (n == 0)
+                continue;
+            if (merged.counts.empty())
+                merged.counts.resize(bucketCount);
+            merged.counts[bucket] += n;
+            shardCount += n;
+        }
+        if (shardCount == 0)
+            continue;
+        merged.count += shardCount;
+        merged.total += reset ? shard.total.exchange(0, memory_order_relaxed) : shard.total.load(memory_order_relaxed);
+        merged.min = std::min(merged.min, reset ? shard.min.exchange(UINT64_MAX, memory_order_relaxed)
+                                                : shard.min.load(memory_order_relaxed));
+        merged.max = std::max(merged.max, reset ? shard.max.exchange(0, memory_order_relaxed)
+                                                : shard.max.load(memory_order_relaxed));
+    }
+    // a value being recorded can be in its bucket but not yet in min and max
+    if (merged.count != 0 && merged.min > merged.max) {
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            if (merged.counts[bucket] != 0) {
+                merged.min = min(merged.min, HistogramCounts::BucketValue(bucket, subBucketBits));
+                break;
+            }
+        }
+        merged.max = max(merged.max, merged.min);
+    }
+    return merged;
+}
+
+//
+// Snapshot
+//
+HistogramCounts Histogram::Snapshot() const
+{
+    return Merge(false);
+}
+
+//
+// SnapshotAndReset
+//
+HistogramCounts Histogram::SnapshotAndReset()
+{
+    return Merge(true);
+}
+
+//
+// Reset
+//
+void Histogram::Reset()
+{
+    Merge(true);
+}
+
+} // end namespace Tau
@@ -0,0 +1,139 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for Histogram, log linear (HDR style) latency histograms with percentiles.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief HistogramCounts - the counts of a Histogram.  what Snapshot() returns.  not thread safe.
+/// @remark Values below 2^subBucketBits are counted exactly.  Above that each power of 2 is split into
+///         2^(subBucketBits-1) buckets, so a value is off by at most 1 / 2^(subBucketBits-1): 1.6% for the default 7,
+///         6% for 5.  The whole uint64_t range is covered in (66 - subBucketBits) * 2^(subBucketBits-1) buckets.
+///
+class HistogramCounts {
+public:
+    explicit HistogramCounts(int subBucketBits = 7);
+
+    /// @brief count value times times
+    void Record(uint64_t value, uint64_t times = 1);
+    /// @brief add other's counts.  both must have the same subBucketBits.
+    bool Merge(const HistogramCounts& other);
+    void Reset();
+
+    uint64_t Count() const { return count; }
+    uint64_t Total() const { return total; }
+    uint64_t Min() const { return count != 0 ? min : 0; }
+    uint64_t Max() const { return max; }
+    double Mean() const { return count != 0 ? static_cast<double>(total) / static_cast<double>(count) : 0.0; }
+
+    /// @brief the value percent (0 to 100) of the values are at or below.  99.9 for p999.
+    uint64_t Percentile(double percent) const;
+
+    /// @brief count, min, mean, max and the usual percentiles on a line, then the percentile table
+    std::string ToText(const std::string& name = "", const std::string& unit = "") const;
+    /// @brief the same as an object, with the non empty buckets as [value, count] pairs
+    std::string ToJson(const std::string& name = "", const std::string& unit = "") const;
+
+    int SubBucketBits() const { return subBucketBits; }
+    size_t BucketCount() const { return BucketCount(subBucketBits); }
+    static size_t BucketCount(int subBucketBits);
+    /// @brief the bucket value falls in, and the middle of a bucket
+    static size_t BucketOf(uint64_t value, int subBucketBits);
+    static uint64_t BucketValue(size_t bucket, int subBucketBits);
+
+private:
+    friend class Histogram;
+
+    int subBucketBits;
+    std::vector<uint64_t> counts;       // empty until the first Record()
+    uint64_t count {0};
+    uint64_t total {0};
+    uint64_t min {UINT64_MAX};
+    uint64_t max {0};
+};
+
+///
+/// @brief Histogram - a latency histogram any number of threads record into at once
+/// @remark Threads record into shards (one per hardware thread, picked per thread) with relaxed atomics, so
+///         threads don't contend and Record() takes no lock.  Snapshot() merges the shards.
+/// @remark Values are in whatever unit the caller uses.  RecordDuration() and HistogramTimer record ns.
+/// @code
+///     Histogram frameTimes("frame", "ns");
+///     while (running) {
+///         HistogramTimer timer(frameTimes);
+///         RenderFrame();
+///     }
+///     cout << frameTimes.ToText();
+///     HistogramCounts last = frameTimes.SnapshotAndReset();
+///     uint64_t p99 = last.Percentile(99);
+/// @endcode
+///
+class Histogram {
+public:
+    explicit Histogram(const std::string& name = "", const std::string& unit = "ns", int subBucketBits = 7);
+    ~Histogram();
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator = (const Histogram&) = delete;
+
+    void Record(uint64_t value);
+    template <class Rep, class Period>
+    void RecordDuration(std::chrono::duration<Rep, Period> duration) {
+        Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    }
+
+    /// @brief the counts so far
+    HistogramCounts Snapshot() const;
+    /// @brief the counts so far, and start again.  nothing recorded at the same time is lost.
+    HistogramCounts SnapshotAndReset();
+    void Reset();
+
+    std::string ToText() const { return Snapshot().ToText(name, unit); }
+    std::string ToJson() const { return Snapshot().ToJson(name, unit); }
+
+    const std::string& Name() const { return name; }
+    const std::string& Unit() const { return unit; }
+
+private:
+    struct Shard;
+    HistogramCounts Merge(bool reset) const;
+
+    std::string name;
+    std::string unit;
+    int subBucketBits;
+    size_t bucketCount;
+    std::unique_ptr<Shard[]> shards;
+    size_t shardMask;
+};
+
+///
+/// @brief HistogramTimer - records the ns from its construction to its destruction into a Histogram
+///
+class HistogramTimer {
+public:
+    explicit HistogramTimer(Histogram& _histogram) : histogram(_histogram), start(std::chrono::steady_clock::now()) {}
+    ~HistogramTimer() { histogram.RecordDuration(std::chrono::steady_clock::now() - start); }
+
+    HistogramTimer(const HistogramTimer&) = delete;
+    HistogramTimer& operator = (const HistogramTimer&) = delete;
+
+private:
+    Histogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+} // end namespace Tau
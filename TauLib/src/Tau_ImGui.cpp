@@ -526,23 +526,47 @@ namespace Tau { // to avoid conflict with other libraries
     //
     // ImGui_Render
     // 
-    void ImGui_Render(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer) {
+    void ImGui_Render(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer, FramePacer* pacer) {
         ImGui::Render();
         ImGui_ImplSDLRenderer_RenderDrawData(ImGui::GetDrawData());
+        if (pacer)
+            pacer->Wait();
         SDL_RenderPresent(renderer);
     }
 
     //
     // ImGui_Render_Clear
     // 
-    void ImGui_Render_Clear(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer, const ImVec4& clearColor) {
+    void ImGui_Render_Clear(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer, const ImVec4& clearColor, FramePacer* pacer) {
         ImGui::Render();
         SDL_SetRenderDrawColor(renderer, (Uint8)(clearColor.x * 255), (Uint8)(clearColor.y * 255), (Uint8)(clearColor.z * 255), (Uint8)(clearColor.w * 255));
         SDL_RenderClear(renderer);
         ImGui_ImplSDLRenderer_RenderDrawData(ImGui::GetDrawData());
+        if (pacer)
+            pacer->Wait();
         SDL_RenderPresent(renderer);
     }
 
+    //
+    // ImGui_FrameStats
+    // display a FramePacer's stats and a plot of the recent frame times on the current ImGui window
+    // 
+    void ImGui_FrameStats(const FramePacer& pacer) {
+        FrameStats stats = pacer.Stats();
+        if (stats.rateHz > 0.0)
+            ImGui::Text("%.1f Hz, %.3f ms a frame", stats.rateHz, 1000.0 / stats.rateHz);
+        else
+            ImGui::Text("unpaced");
+        ImGui::Text("frame %.3f ms mean, %.3f p50, %.3f p99, %.3f max, jitter %.3f ms", stats.meanMs, stats.p50Ms, stats.p99Ms, stats.maxMs, stats.jitterMs);
+        if (stats.rateHz > 0.0)
+            ImGui::Text("missed %llu of %llu, late %.3f ms mean, margin %.3f ms, spin %.1f%%", (unsigned long long)stats.missed,
+                        (unsigned long long)stats.frames, stats.lateMeanMs, stats.marginMs, stats.spinFraction * 100.0);
+
+        vector<float> times = pacer.RecentFrameTimes();
+        float target = stats.rateHz > 0.0 ? (float)(1000.0 / stats.rateHz) : (float)stats.meanMs;
+        ImGui::PlotLines("frame ms", times.data(), (int)times.size(), 0, nullptr, 0.0f, target * 2.0f, ImVec2(0, 60));
+    }
+
     //
     // ImGui_Image(texture, size)
     // display the image on the current ImGui line in progress.
@@ -7,6 +7,7 @@
 #include <optional>
 #include "Tau_Rect.h"
 #include "Tau_Color.h"
+#include "Tau_Time.h"
 
 extern ImGuiContext* TauImGuiContext;
 
@@ -174,9 +175,16 @@ void ImGui_PopupFile(bool* done, const std::string& title, const std::string& fi
 
 ///
 /// @brief ImGui_Render
+/// @param pacer - if given, its Wait() is called just before SDL_RenderPresent, to present at its rate
 /// 
-void ImGui_Render(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer);
-void ImGui_Render_Clear(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer, const ImVec4& clearColor);
+void ImGui_Render(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer, FramePacer* pacer = nullptr);
+void ImGui_Render_Clear(SDL_Shared<SDL_Window> window, SDL_Shared<SDL_Renderer> renderer, const ImVec4& clearColor, FramePacer* pacer = nullptr);
+
+///
+/// @brief ImGui_FrameStats
+/// display a FramePacer's stats and a plot of the recent frame times on the current ImGui window
+/// 
+void ImGui_FrameStats(const FramePacer& pacer);
 
 ///
 /// @brief ImGui_Image
@@ -61,6 +61,13 @@ namespace Tau {
         bool show_another_window = false;
         ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
+        // pace to the display's refresh rate, or only measure if the renderer waits for vsync
+        SDL_RendererInfo info;
+        SDL_DisplayMode mode;
+        bool vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+        int refreshRate = SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate != 0 ? mode.refresh_rate : 60;
+        FramePacer pacer(vsync ? 0.0 : refreshRate);
+
         // Main loop
         bool done = false;
         while (!done)
@@ -107,6 +114,7 @@ namespace Tau {
                 ImGui::Text("counter = %d", counter);
 
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+                ImGui_FrameStats(pacer);
                 ImGui::End();
             }
 
@@ -121,7 +129,7 @@ namespace Tau {
             }
 
             // Rendering
-            ImGui_Render(window, renderer);
+            ImGui_Render(window, renderer, &pacer);
         }
 
         ImGui_Quit();
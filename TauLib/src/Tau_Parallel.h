@@ -0,0 +1,138 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for simple fork/join parallel helpers.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+                //*******************************
+                // Thread count
+                //*******************************
+
+///
+/// @brief ParallelThreadCount - how many threads are worth using for a job
+/// @param itemCount the number of items to process
+/// @param minItemsPerThread don't start another thread for less than this many items
+/// @param maxThreads upper limit.  0 == the number of hardware threads
+/// @return 1 or more
+///
+inline unsigned int ParallelThreadCount(size_t itemCount, size_t minItemsPerThread, unsigned int maxThreads = 0) {
+    unsigned int hw = std::max(1u, std::thread::hardware_concurrency());
+    if (maxThreads == 0 || maxThreads > hw)
+        maxThreads = hw;
+    if (minItemsPerThread == 0)
+        minItemsPerThread = 1;
+    size_t wanted = itemCount / minItemsPerThread;
+    return static_cast<unsigned int>(std::clamp<size_t>(wanted, 1, maxThreads));
+}
+
+                //*******************************
+                // ParallelForChunks
+                //*******************************
+
+///
+/// @brief ParallelForChunks - splits [0, count) into contiguous chunks and calls fn(chunkIndex, begin, end) for each chunk.
+/// @param count the number of items
+/// @param minChunk the smallest chunk worth giving to its own thread
+/// @param fn called once per chunk.  chunk 0 runs on the calling thread.
+/// @param maxThreads upper limit.  0 == the number of hardware threads
+/// @return the number of chunks used.  chunk indexes are 0 to return-1 in item order.
+/// @note fn must be safe to call concurrently.  chunks never overlap.
+///
+template <class Fn>
+unsigned int ParallelForChunks(size_t count, size_t minChunk, Fn&& fn, unsigned int maxThreads = 0) {
+    unsigned int numChunks = ParallelThreadCount(count, minChunk, maxThreads);
+    if (numChunks <= 1) {
+        fn(0u, size_t(0), count);
+        return 1;
+    }
+
+    size_t chunkSize = (count + numChunks - 1) / numChunks;
+    std::vector<std::thread> threads;
+    threads.reserve(numChunks - 1);
+    for (unsigned int chunk = 1; chunk < numChunks; ++chunk) {
+        size_t begin = std::min(count, chunk * chunkSize);
+        size_t end = std::min(count, begin + chunkSize);
+        threads.emplace_back([&fn, chunk, begin, end] { fn(chunk, begin, end); });
+    }
+    fn(0u, size_t(0), std::min(count, chunkSize));
+
+    for (auto& t : threads)
+        t.join();
+    return numChunks;
+}
+
+                //*******************************
+                // ParallelStableSort
+                //*******************************
+
+///
+/// @brief ParallelStableSort - a stable merge sort that sorts chunks on separate threads and then merges pairs of chunks in parallel.
+/// @param first, last random access range to sort
+/// @param cmp strict weak ordering
+/// @param minParallel ranges smaller than this are sorted with std::stable_sort on the calling thread
+///
+template <class RandomIt, class Compare>
+void ParallelStableSort(RandomIt first, RandomIt last, Compare cmp, size_t minParallel = 1 << 14) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    size_t count = static_cast<size_t>(last - first);
+
+    // use a power of two number of runs so the merge passes pair up evenly
+    unsigned int threads = ParallelThreadCount(count, minParallel);
+    unsigned int numRuns = 1;
+    while (numRuns * 2 <= threads)
+        numRuns *= 2;
+    if (numRuns <= 1) {
+        std::stable_sort(first, last, cmp);
+        return;
+    }
+
+    std::vector<size_t> bounds(numRuns + 1);
+    for (unsigned int i = 0; i <= numRuns; ++i)
+        bounds[i] = count * i / numRuns;
+
+    // sort each run
+    ParallelForChunks(numRuns, 1, [&] (unsigned int, size_t begin, size_t end) {
+        for (size_t run = begin; run < end; ++run)
+            std::stable_sort(first + bounds[run], first + bounds[run + 1], cmp);
+    }, numRuns);
+
+    // merge neighbouring runs, ping-ponging between the range and a buffer.
+    // std::merge takes from the left run first on ties which keeps the sort stable.
+    std::vector<Value> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    bool dataInBuffer = true;
+    for (unsigned int width = 1; width < numRuns; width *= 2) {
+        unsigned int numMerges = numRuns / (width * 2);
+        ParallelForChunks(numMerges, 1, [&] (unsigned int, size_t begin, size_t end) {
+            for (size_t m = begin; m < end; ++m) {
+                size_t lo  = bounds[m * width * 2];
+                size_t mid = bounds[m * width * 2 + width];
+                size_t hi  = bounds[m * width * 2 + width * 2];
+                if (dataInBuffer)
+                    std::merge(std::make_move_iterator(buffer.begin() + lo), std::make_move_iterator(buffer.begin() + mid),
+                               std::make_move_iterator(buffer.begin() + mid), std::make_move_iterator(buffer.begin() + hi),
+                               first + lo, cmp);
+                else
+                    std::merge(std::make_move_iterator(first + lo), std::make_move_iterator(first + mid),
+                               std::make_move_iterator(first + mid), std::make_move_iterator(first + hi),
+                               buffer.begin() + lo, cmp);
+            }
+        }, numMerges);
+        dataInBuffer = !dataInBuffer;
+    }
+
+    if (dataInBuffer)
+        std::move(buffer.begin(), buffer.end(), first);
+}
+
+} // end namespace Tau
@@ -0,0 +1,745 @@
+///
+/// @file
+/// @brief CPP file for Process, runs a program with its exit code and optionally its output.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_Process.h"
+#include "DirFile.h"
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32)
+#include "windows.h"
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+extern char** environ;
+
+// posix_spawn_file_actions_addchdir_np came with glibc 2.29
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define TAU_SPAWN_ADDCHDIR 1
+#else
+#define TAU_SPAWN_ADDCHDIR 0
+#endif
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+#if defined(_WIN32)
+
+                //*******************************
+                // Windows
+                //*******************************
+
+//
+// commandLine - the command and arguments quoted for CreateProcess.  a batch file is run by cmd.exe /c.
+//
+static string commandLine(string command, Strings arguments)
+{
+    if (icompareBool(GetFileExtensionWithoutDot(command), "bat")) {
+        arguments.insert(begin(arguments), command);
+        arguments.insert(begin(arguments), "/c");
+        char cmdbuf[MAX_PATH];
+        GetEnvironmentVariable("ComSpec", cmdbuf, sizeof(cmdbuf));
+        command = cmdbuf;
+    }
+
+    // add double quotes around any strings that have a space
+    DoubleQuoteStringIfSpace(&command);
+    string cmdline = command;
+    for (string& arg : arguments) {
+        DoubleQuoteStringIfSpace(&arg);
+        cmdline.append(" ");
+        cmdline.append(arg);
+    }
+    return cmdline;
+}
+
+//
+// readPipe - read until the other end is closed
+//
+static void readPipe(HANDLE pipe, string* out)
+{
+    for (;;) {
+        size_t used = out->size();
+        if (out->capacity() - used < 16384)
+            out->reserve(max<size_t>(65536, out->capacity() * 2));
+        out->resize(out->capacity());
+        DWORD bytesRead = 0;
+        BOOL ok = ReadFile(pipe, out->data() + used, static_cast<DWORD>(out->size() - used), &bytesRead, NULL);
+        out->resize(used + bytesRead);
+        if (!ok || bytesRead == 0)
+            break;
+    }
+    CloseHandle(pipe);
+}
+
+//
+// writePipe - write all of data and close the pipe so the program sees the end of file
+//
+static void writePipe(HANDLE pipe, string data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        DWORD bytesWritten = 0;
+        DWORD length = static_cast<DWORD>(min<size_t>(data.size() - written, 1 << 20));
+        if (!WriteFile(pipe, data.data() + written, length, &bytesWritten, NULL))
+            break;
+        written += bytesWritten;
+    }
+    CloseHandle(pipe);
+}
+
+//
+// Start
+//
+bool Process::Start(const string& command, const Strings& arguments, const ProcessOptions& options)
+{
+    if (running)
+        return false;
+    result = ProcessResult();
+
+    // the pipes aren't inheritable.  the child's ends are made so, and handed to it alone in a handle list: a handle
+    // that any CreateProcess could inherit would go to programs started on other threads too, which would hold a
+    // pipe's write end open and its reader would never see the end of file.
+    HANDLE inputRead = NULL, inputWrite = NULL;
+    HANDLE outputRead = NULL, outputWrite = NULL;
+    HANDLE errorRead = NULL, errorWrite = NULL;
+    auto makePipe = [&](HANDLE* read, HANDLE* write, bool parentReads) {
+        if (!CreatePipe(read, write, NULL, 0))
+            return false;
+        SetHandleInformation(parentReads ? *write : *read, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+        return true;
+    };
+    bool captureOutput = options.captureOutput;
+    bool captureErrors = options.captureErrors && !(options.mergeErrors && captureOutput);
+    bool piped = (!options.pipeInput || makePipe(&inputRead, &inputWrite, false)) &&
+                 (!captureOutput || makePipe(&outputRead, &outputWrite, true)) &&
+                 (!captureErrors || makePipe(&errorRead, &errorWrite, true));
+
+	STARTUPINFOEX startInfo;
+	ZeroMemory(&startInfo, sizeof(startInfo));
+	startInfo.StartupInfo.cb = sizeof(startInfo);
+	startInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    bool redirected = options.pipeInput || captureOutput || captureErrors;
+    vector<HANDLE> inherited;
+    if (redirected) {
+        STARTUPINFO& info = startInfo.StartupInfo;
+        info.hStdInput = options.pipeInput ? inputRead : GetStdHandle(STD_INPUT_HANDLE);
+        info.hStdOutput = captureOutput ? outputWrite : GetStdHandle(STD_OUTPUT_HANDLE);
+        info.hStdError = captureErrors ? errorWrite
+                       : (options.mergeErrors && captureOutput) ? outputWrite : GetStdHandle(STD_ERROR_HANDLE);
+        // our own std handles go too if they can be inherited.  a handle can only be in the list once.
+        for (HANDLE handle : { info.hStdInput, info.hStdOutput, info.hStdError }) {
+            DWORD flags = 0;
+            if (handle != NULL && handle != INVALID_HANDLE_VALUE && GetHandleInformation(handle, &flags) &&
+                (flags & HANDLE_FLAG_INHERIT) != 0 && find(inherited.begin(), inherited.end(), handle) == inherited.end())
+                inherited.push_back(handle);
+        }
+    }
+
+	PROCESS_INFORMATION procInfo;
+    ZeroMemory(&procInfo, sizeof(procInfo));
+    DWORD procFlags = CREATE_DEFAULT_ERROR_MODE |
+                      CREATE_NO_WINDOW |
+                      CREATE_NEW_PROCESS_GROUP;
+
+    vector<char> attributeBuffer;
+    if (!inherited.empty()) {
+        SIZE_T size = 0;
+        InitializeProcThreadAttributeList(NULL, 1, 0, &size);
+        attributeBuffer.resize(size);
+        auto attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeBuffer.data());
+        if (InitializeProcThreadAttributeList(attributes, 1, 0, &size)) {
+            startInfo.lpAttributeList = attributes;
+            if (!UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited.data(),
+                                           inherited.size() * sizeof(HANDLE), NULL, NULL))
+                piped = false;
+        } else {
+            piped = false;
+        }
+        procFlags |= EXTENDED_STARTUPINFO_PRESENT;
+    }
+
+    // CreateProcess looks for a relative command from our directory, not the child's.  look in the child's first
+    // so it's found the same as if we'd changed to it.
+    string program = command;
+    if (!options.workingDir.empty() && fs::path(command).is_relative()) {
+        error_code ec;
+        for (const char* extension : { "", ".exe" }) {
+            fs::path inWorkingDir = fs::path(options.workingDir) / (command + extension);
+            if (fs::is_regular_file(inWorkingDir, ec)) {
+                program = inWorkingDir.string();
+                break;
+            }
+        }
+    }
+
+    string cmdline = commandLine(program, arguments);
+    BOOL created = piped && CreateProcess(
+        NULL,                                   // module name from the command line, searched for in PATH
+        cmdline.data(),                         // Command line
+        NULL,                                   // Process handle not inheritable
+        NULL,                                   // Thread handle not inheritable
+        !inherited.empty(),                     // inherit the handles in the list, no others
+        procFlags,                              // creation flags
+        NULL,                                   // Use parent's environment block
+        options.workingDir.empty() ? NULL : options.workingDir.c_str(),     // starting directory
+        &startInfo.StartupInfo,                 // Pointer to STARTUPINFOEX structure
+        &procInfo                               // Pointer to PROCESS_INFORMATION structure
+    );
+    if (startInfo.lpAttributeList != NULL)
+        DeleteProcThreadAttributeList(startInfo.lpAttributeList);
+
+    // the child's ends
+    for (HANDLE handle : { inputRead, outputWrite, errorWrite }) {
+        if (handle != NULL)
+            CloseHandle(handle);
+    }
+    if (!created) {
+        for (HANDLE handle : { inputWrite, outputRead, errorRead }) {
+            if (handle != NULL)
+                CloseHandle(handle);
+        }
+        return false;
+    }
+
+    CloseHandle(procInfo.hThread);
+    {
+        lock_guard<mutex> guard(handleLock);
+        processHandle = procInfo.hProcess;
+        running = true;
+    }
+    if (inputWrite != NULL)
+        inputWriter = thread(writePipe, inputWrite, options.input);
+    if (outputRead != NULL)
+        outputReader = thread(readPipe, outputRead, &result.output);
+    if (errorRead != NULL)
+        errorReader = thread(readPipe, errorRead, &result.errors);
+    result.started = true;
+    return true;
+}
+
+//
+// Pump - wait up to timeoutMs (-1 == forever) for the program to end.  true when it has.
+//
+bool Process::Pump(int timeoutMs)
+{
+    if (WaitForSingleObject(processHandle, timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs)) != WAIT_OBJECT_0)
+        return false;
+    Finish();
+    return true;
+}
+
+//
+// Finish - the program has ended
+//
+void Process::Finish()
+{
+    for (thread* worker : { &inputWriter, &outputReader, &errorReader }) {
+        if (worker->joinable())
+            worker->join();
+    }
+    lock_guard<mutex> guard(handleLock);
+    DWORD exitCode = 0;
+    GetExitCodeProcess(processHandle, &exitCode);
+    result.exitCode = static_cast<int>(exitCode);
+    CloseHandle(processHandle);
+    processHandle = nullptr;
+    running = false;
+}
+
+//
+// Kill
+//
+bool Process::Kill()
+{
+    lock_guard<mutex> guard(handleLock);
+    return running && TerminateProcess(processHandle, 1) != 0;
+}
+
+//
+// Detach
+//
+void Process::Detach()
+{
+    if (!running)
+        return;
+    // stop the pipe threads blocked on the program
+    for (thread* worker : { &inputWriter, &outputReader, &errorReader }) {
+        if (worker->joinable()) {
+            CancelSynchronousIo(worker->native_handle());
+            worker->join();
+        }
+    }
+    lock_guard<mutex> guard(handleLock);
+    CloseHandle(processHandle);
+    processHandle = nullptr;
+    running = false;
+}
+
+#else
+
+                //*******************************
+                // Linux
+                //*******************************
+
+//
+// readPipe - read what's there straight into out.  false at the end of file.
+//
+static bool readPipe(int fd, string* out)
+{
+    for (;;) {
+        size_t used = out->size();
+        if (out->capacity() - used < 16384)
+            out->reserve(max<size_t>(65536, out->capacity() * 2));
+        out->resize(out->capacity());
+        ssize_t bytesRead = read(fd, out->data() + used, out->size() - used);
+        out->resize(used + static_cast<size_t>(max<ssize_t>(bytesRead, 0)));
+        if (bytesRead > 0)
+            continue;
+        if (bytesRead == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN;
+    }
+}
+
+//
+// writeNoSigpipe - write to a pipe whose reader may be gone.  SIGPIPE is blocked in this thread for the write and a
+// SIGPIPE it caused is taken off, so the process's handling of SIGPIPE is left alone.
+//
+static ssize_t writeNoSigpipe(int fd, const char* data, size_t length)
+{
+    sigset_t pipeSignal, oldMask, pending;
+    sigemptyset(&pipeSignal);
+    sigaddset(&pipeSignal, SIGPIPE);
+    sigpending(&pending);
+    bool wasPending = sigismember(&pending, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+
+    ssize_t written = write(fd, data, length);
+    int error = errno;
+    if (written < 0 && error == EPIPE && !wasPending) {
+        timespec noWait {0, 0};
+        sigtimedwait(&pipeSignal, nullptr, &noWait);
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+    errno = error;
+    return written;
+}
+
+static void closeFd(int* fd)
+{
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+#if !TAU_SPAWN_ADDCHDIR
+//
+// forkSpawn - spawn() for a C library without posix_spawn_file_actions_addchdir_np.  the child changes directory
+// between fork and exec and sends back errno down a close on exec pipe if it can't run the program.
+//
+static int forkSpawn(pid_t* pid, const char* file, char* const* argv, const int childFds[3], const string& workingDir,
+                     bool searchPath)
+{
+    int errorPipe[2];
+    if (pipe2(errorPipe, O_CLOEXEC) != 0)
+        return errno;
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);     // no handlers run in the child before it's set up
+    *pid = fork();
+    if (*pid == 0) {
+        // only async signal safe calls from here
+        for (int i = 0; i < 3; ++i) {
+            if (childFds[i] >= 0)
+                dup2(childFds[i], i);
+        }
+        signal(SIGPIPE, SIG_DFL);
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        if (chdir(workingDir.c_str()) == 0) {
+            if (searchPath)
+                execvp(file, argv);
+            else
+                execv(file, argv);
+        }
+        int error = errno;
+        (void)!write(errorPipe[1], &error, sizeof(error));
+        _exit(127);
+    }
+    int error = (*pid < 0) ? errno : 0;
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    close(errorPipe[1]);
+    if (*pid > 0) {
+        ssize_t got;
+        while ((got = read(errorPipe[0], &error, sizeof(error))) < 0 && errno == EINTR)
+            ;
+        if (got == sizeof(error))
+            waitpid(*pid, nullptr, 0);
+        else
+            error = 0;
+    }
+    close(errorPipe[0]);
+    return error;
+}
+#endif
+
+//
+// spawn - start file with argv.  the child has childFds as its stdin, stdout and stderr and runs in workingDir
+// (empty == ours).  returns 0 or an errno.
+//
+static int spawn(pid_t* pid, const char* file, char* const* argv, const int childFds[3], const string& workingDir,
+                 bool searchPath)
+{
+#if !TAU_SPAWN_ADDCHDIR
+    if (!workingDir.empty())
+        return forkSpawn(pid, file, argv, childFds, workingDir, searchPath);
+#endif
+
+    // dup2 clears the close on exec of the child's ends
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (int i = 0; i < 3; ++i) {
+        if (childFds[i] >= 0)
+            posix_spawn_file_actions_adddup2(&actions, childFds[i], i);
+    }
+#if TAU_SPAWN_ADDCHDIR
+    // the child changes directory, not us, so other threads' relative paths are unaffected
+    if (!workingDir.empty())
+        posix_spawn_file_actions_addchdir_np(&actions, workingDir.c_str());
+#endif
+
+    // the child starts with no signals blocked and SIGPIPE back to the default
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigaddset(&signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    int error = searchPath ? posix_spawnp(pid, file, &actions, &attributes, argv, environ)
+                           : posix_spawn(pid, file, &actions, &attributes, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    return error;
+}
+
+// programs detached and not yet waited for.  reaped by later Start()s so they don't stay zombies.
+static mutex detachedLock;
+static vector<pid_t> detached;
+
+static void reapDetached()
+{
+    lock_guard<mutex> guard(detachedLock);
+    erase_if(detached, [](pid_t pid) { return waitpid(pid, nullptr, WNOHANG) != 0; });
+}
+
+//
+// Start
+//
+bool Process::Start(const string& command, const Strings& arguments, const ProcessOptions& options)
+{
+    if (running)
+        return false;
+    result = ProcessResult();
+    reapDetached();
+
+    bool captureOutput = options.captureOutput;
+    bool captureErrors = options.captureErrors && !(options.mergeErrors && captureOutput);
+    int inputPipe[2] = { -1, -1 };
+    int outputPipe[2] = { -1, -1 };
+    int errorPipe[2] = { -1, -1 };
+    bool piped = (!options.pipeInput || pipe2(inputPipe, O_CLOEXEC) == 0) &&
+                 (!captureOutput || pipe2(outputPipe, O_CLOEXEC) == 0) &&
+                 (!captureErrors || pipe2(errorPipe, O_CLOEXEC) == 0);
+
+    // the child's ends become its stdin, stdout and stderr.  -1 == the caller's.
+    int childFds[3] = { inputPipe[0], outputPipe[1],
+                        captureErrors ? errorPipe[1] : (options.mergeErrors && captureOutput) ? outputPipe[1] : -1 };
+
+    vector<char*> argv;
+    argv.push_back(const_cast<char*>(command.c_str()));
+    for (const string& arg : arguments)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    int spawnError = EPIPE;
+    if (piped)
+        spawnError = spawn(&pid, command.c_str(), argv.data(), childFds, options.workingDir, options.searchPath);
+
+    closeFd(&inputPipe[0]);
+    closeFd(&outputPipe[1]);
+    closeFd(&errorPipe[1]);
+    inputFd = inputPipe[1];
+    outputFd = outputPipe[0];
+    errorFd = errorPipe[0];
+    if (spawnError != 0) {
+        pid = -1;
+        Reset();
+        return false;
+    }
+
+#if defined(SYS_pidfd_open)
+    pidFd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#endif
+    for (int fd : { inputFd, outputFd, errorFd }) {
+        if (fd >= 0)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    input = options.input;
+    inputWritten = 0;
+    if (input.empty())
+        closeFd(&inputFd);
+    result.started = true;
+    lock_guard<mutex> guard(handleLock);
+    running = true;
+    return true;
+}
+
+//
+// Pump - move input and output through the pipes until the program ends or timeoutMs (-1 == forever) passes.
+// true when it has ended.
+//
+bool Process::Pump(int timeoutMs)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(max(timeoutMs, 0));
+    for (;;) {
+        pollfd fds[4];
+        int count = 0;
+        int pidIndex = -1, inputIndex = -1, outputIndex = -1, errorIndex = -1;
+        if (pidFd >= 0) {
+            pidIndex = count;
+            fds[count++] = { pidFd, POLLIN, 0 };
+        }
+        if (inputFd >= 0) {
+            inputIndex = count;
+            fds[count++] = { inputFd, POLLOUT, 0 };
+        }
+        if (outputFd >= 0) {
+            outputIndex = count;
+            fds[count++] = { outputFd, POLLIN, 0 };
+        }
+        if (errorFd >= 0) {
+            errorIndex = count;
+            fds[count++] = { errorFd, POLLIN, 0 };
+        }
+
+        // without a pidfd (before Linux 5.3) the end is seen by waitpid() once the pipes close
+        if (pidFd < 0 && count == 0) {
+            if (Reap(timeoutMs < 0))
+                return true;
+            if (chrono::steady_clock::now() >= deadline)
+                return false;
+            this_thread::sleep_for(chrono::milliseconds(1));
+            continue;
+        }
+
+        int wait = -1;
+        if (timeoutMs >= 0) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            wait = static_cast<int>(max<long long>(left, 0));
+        }
+        int ready = poll(fds, static_cast<nfds_t>(count), wait);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready == 0 && timeoutMs >= 0 && chrono::steady_clock::now() >= deadline)
+            return false;
+
+        if (inputIndex >= 0 && fds[inputIndex].revents != 0)
+            PumpInput();
+        if (outputIndex >= 0 && fds[outputIndex].revents != 0)
+            PumpOutput(false);
+        if (errorIndex >= 0 && fds[errorIndex].revents != 0)
+            PumpOutput(true);
+        if (pidIndex >= 0 && fds[pidIndex].revents != 0) {
+            Reap(true);
+            return true;
+        }
+        if (timeoutMs >= 0 && chrono::steady_clock::now() >= deadline)
+            return false;
+    }
+}
+
+//
+// PumpInput - write what the pipe will take.  closed when it's all written or the program stops reading.
+//
+void Process::PumpInput()
+{
+    ssize_t written = writeNoSigpipe(inputFd, input.data() + inputWritten, input.size() - inputWritten);
+    if (written > 0)
+        inputWritten += static_cast<size_t>(written);
+    if ((written < 0 && errno != EAGAIN && errno != EINTR) || inputWritten == input.size())
+        closeFd(&inputFd);
+}
+
+//
+// PumpOutput - read what's in the stdout or stderr pipe.  closed at the end of file.
+//
+void Process::PumpOutput(bool errors)
+{
+    int* fd = errors ? &errorFd : &outputFd;
+    if (*fd >= 0 && !readPipe(*fd, errors ? &result.errors : &result.output))
+        closeFd(fd);
+}
+
+//
+// Reap - wait for the program to end (or see if it has) and take its exit code.  true when it has ended.
+// the output still in the pipes is read, but a child it left holding them isn't waited for.
+//
+bool Process::Reap(bool block)
+{
+    // wait without reaping, so Kill() can't signal a pid that's been reaped and reused while the lock is held for it
+    if (block) {
+        siginfo_t info {};
+        while (waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOWAIT) < 0 && errno == EINTR)
+            ;
+    }
+    lock_guard<mutex> guard(handleLock);
+    int status = 0;
+    pid_t ended;
+    do {
+        ended = waitpid(pid, &status, WNOHANG);
+    } while (ended < 0 && errno == EINTR);
+    if (ended == 0)
+        return false;
+
+    PumpOutput(false);
+    PumpOutput(true);
+    if (ended == pid) {
+        result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        result.signal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    }
+    Finish();
+    return true;
+}
+
+//
+// Finish - the program has ended and been waited for
+//
+void Process::Finish()
+{
+    Reset();
+    pid = -1;
+    running = false;
+}
+
+//
+// Reset - close the descriptors
+//
+void Process::Reset()
+{
+    closeFd(&pidFd);
+    closeFd(&inputFd);
+    closeFd(&outputFd);
+    closeFd(&errorFd);
+    input.clear();
+}
+
+//
+// Kill
+//
+bool Process::Kill()
+{
+    // the pid can't be reused before it's waited for
+    lock_guard<mutex> guard(handleLock);
+    return running && kill(pid, SIGKILL) == 0;
+}
+
+//
+// Detach - the pipes are closed, so a program still writing to captured output gets SIGPIPE
+//
+void Process::Detach()
+{
+    if (!running)
+        return;
+    {
+        lock_guard<mutex> guard(detachedLock);
+        detached.push_back(pid);
+    }
+    Reset();
+    lock_guard<mutex> guard(handleLock);
+    pid = -1;
+    running = false;
+}
+
+#endif
+
+                //*******************************
+                // Both
+                //*******************************
+
+//
+// ~Process
+//
+Process::~Process()
+{
+    if (running)
+        Pump(-1);
+}
+
+//
+// Wait
+//
+ProcessResult Process::Wait()
+{
+    if (running)
+        Pump(-1);
+    ProcessResult ended = move(result);
+    result = ProcessResult();
+    return ended;
+}
+
+//
+// WaitFor
+//
+bool Process::WaitFor(chrono::milliseconds timeout, ProcessResult* _result)
+{
+    if (running && !Pump(static_cast<int>(min<long long>(timeout.count(), INT32_MAX))))
+        return false;
+    *_result = move(result);
+    result = ProcessResult();
+    return true;
+}
+
+//
+// IsRunning
+//
+bool Process::IsRunning()
+{
+    if (running)
+        Pump(0);
+    return running;
+}
+
+//
+// Run
+//
+ProcessResult Process::Run(const string& command, const Strings& arguments, const ProcessOptions& options)
+{
+    Process process;
+    process.Start(command, arguments, options);
+    return process.Wait();
+}
+
+} // end namespace Tau
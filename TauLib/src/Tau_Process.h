@@ -0,0 +1,123 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for Process, runs a program with its exit code and optionally its output.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "Str.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief ProcessOptions - how a Process is started
+///
+struct ProcessOptions {
+    bool captureOutput {false};     ///< stdout goes to ProcessResult::output
+    bool captureErrors {false};     ///< stderr goes to ProcessResult::errors
+    bool mergeErrors {false};       ///< stderr goes to ProcessResult::output (needs captureOutput)
+    bool pipeInput {false};         ///< stdin reads input, then end of file.  otherwise stdin is the caller's.
+    std::string input;
+    bool searchPath {true};         ///< look for a command without a directory in PATH
+    std::string workingDir;         ///< the program's current directory.  empty == ours.  a relative command is
+                                    ///< found from here.  ours isn't changed, so programs can be started from many
+                                    ///< threads at once.
+};
+
+///
+/// @brief ProcessResult - how a Process ended
+///
+struct ProcessResult {
+    bool started {false};           ///< false if the program couldn't be run.  exitCode is -1.
+    int exitCode {-1};              ///< killed by a signal: 128 + the signal, the same as a shell
+    int signal {0};                 ///< the signal that killed it (Linux)
+    std::string output;
+    std::string errors;
+};
+
+///
+/// @brief Process - runs a program and waits for it without polling or sleeping
+/// @remark On Linux the program is started with posix_spawn (vfork + exec, no copy of the parent's memory) and waited
+///         for with poll() on a pidfd along with the output pipes.  On Windows it's CreateProcess and
+///         WaitForSingleObject, with a thread per pipe.
+/// @remark Output is read straight into the ProcessResult strings as it comes so a chatty program never blocks on a
+///         full pipe.
+/// @remark The destructor waits for a program still running unless Detach() was called.
+/// @remark Kill() can be called from another thread while one waits.  Other calls belong to one thread at a time.
+/// @code
+///     ProcessOptions options;
+///     options.captureOutput = true;
+///     ProcessResult result = Process::Run("git", { "rev-parse", "HEAD" }, options);
+///     if (result.exitCode == 0)
+///         commit = result.output;
+/// @endcode
+///
+class Process {
+public:
+    Process() {}
+    ~Process();
+
+    Process(const Process&) = delete;
+    Process& operator = (const Process&) = delete;
+
+    /// @brief start the program.  don't double quote the command or arguments.
+    /// @return false if it couldn't be started
+    bool Start(const std::string& command, const Strings& arguments = {}, const ProcessOptions& options = {});
+
+    /// @brief wait for the program to end
+    ProcessResult Wait();
+
+    /// @brief wait at most timeout for the program to end
+    /// @return false if it's still running.  the output so far is kept for the next wait.
+    bool WaitFor(std::chrono::milliseconds timeout, ProcessResult* result);
+
+    /// @brief true until the program ends
+    bool IsRunning();
+
+    /// @brief end the program now (SIGKILL, TerminateProcess).  Wait() for its result.
+    bool Kill();
+
+    /// @brief let the program run on after this object goes away.  its exit code is lost.
+    void Detach();
+
+    /// @brief start a program and wait for it
+    static ProcessResult Run(const std::string& command, const Strings& arguments = {}, const ProcessOptions& options = {});
+
+private:
+    bool Pump(int timeoutMs);
+    void Finish();
+
+    ProcessResult result;
+    bool running {false};
+    std::mutex handleLock;          // Kill() from another thread against the wait that closes the handle or reaps the pid
+#if defined(_WIN32)
+    void* processHandle {nullptr};
+    std::thread inputWriter;
+    std::thread outputReader;
+    std::thread errorReader;
+#else
+    int pid {-1};
+    int pidFd {-1};                 // -1 before Linux 5.3
+    int inputFd {-1};
+    int outputFd {-1};
+    int errorFd {-1};
+    std::string input;
+    size_t inputWritten {0};
+
+    void PumpInput();
+    void PumpOutput(bool errors);
+    bool Reap(bool block);
+    void Reset();
+#endif
+
+    friend class ProcessPool;
+};
+
+} // end namespace Tau
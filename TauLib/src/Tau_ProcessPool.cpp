@@ -0,0 +1,466 @@
+///
+/// @file
+/// @brief CPP file for ProcessPool, runs many programs at once with timeouts, cancellation and output callbacks.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_ProcessPool.h"
+#include "Tau_ThreadPool.h"
+#include <algorithm>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+//
+// Job - a job and its program
+//
+struct ProcessPool::Job {
+    uint64_t id {0};
+    ProcessJob spec;
+    promise<ProcessJobResult> done;
+    ProcessJobResult result;
+    Process process;
+    chrono::steady_clock::time_point submitted;
+    chrono::steady_clock::time_point started;
+    chrono::steady_clock::time_point deadline {chrono::steady_clock::time_point::max()};
+    bool killed {false};
+
+    // start the program.  false if it couldn't be.
+    bool Start() {
+        ProcessOptions options = spec.options;
+        if (spec.onOutput)
+            options.captureOutput = true;
+        if (spec.onErrors)
+            options.captureErrors = true;
+        started = chrono::steady_clock::now();
+        result.queued = started - submitted;
+        if (spec.timeout.count() > 0)
+            deadline = started + spec.timeout;
+        return process.Start(spec.command, spec.arguments, options);
+    }
+
+    // hand new output to the callbacks
+    void Stream(ProcessResult* processResult) {
+        if (spec.onOutput && !processResult->output.empty()) {
+            spec.onOutput(processResult->output);
+            processResult->output.clear();
+        }
+        if (spec.onErrors && !processResult->errors.empty()) {
+            spec.onErrors(processResult->errors);
+            processResult->errors.clear();
+        }
+    }
+
+    // the program has ended
+    void Ended() {
+        result.process = process.Wait();
+        Stream(&result.process);
+        result.elapsed = chrono::steady_clock::now() - started;
+    }
+
+    void Kill(bool timedOut) {
+        if (killed)
+            return;
+        killed = true;
+        if (timedOut)
+            result.timedOut = true;
+        else
+            result.cancelled = true;
+        process.Kill();
+    }
+};
+
+//
+// ProcessPool
+//
+ProcessPool::ProcessPool(unsigned int _maxParallel)
+    : maxParallel(_maxParallel != 0 ? _maxParallel : max(thread::hardware_concurrency(), 1u))
+{
+#if defined(_WIN32)
+    workers = make_unique<ThreadPool>(maxParallel);
+#else
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.u64 = 0;                         // job ids start at 1
+    if (epollFd < 0 || wakeFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) != 0) {
+        broken = true;                          // out of descriptors.  every job fails.
+        return;
+    }
+    runner = thread(&ProcessPool::Run, this);
+#endif
+}
+
+//
+// ~ProcessPool - the jobs finish first
+//
+ProcessPool::~ProcessPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+#if defined(_WIN32)
+    workers.reset();
+#else
+    if (runner.joinable()) {
+        Wake();
+        runner.join();
+    }
+    if (wakeFd >= 0)
+        close(wakeFd);
+    if (epollFd >= 0)
+        close(epollFd);
+#endif
+}
+
+//
+// Submit
+//
+future<ProcessJobResult> ProcessPool::Submit(ProcessJob spec, uint64_t* jobId)
+{
+    auto job = make_unique<Job>();
+    job->spec = move(spec);
+    job->submitted = chrono::steady_clock::now();
+    future<ProcessJobResult> result = job->done.get_future();
+    {
+        lock_guard<mutex> guard(lock);
+        job->id = nextId++;
+        if (jobId != nullptr)
+            *jobId = job->id;
+        if (!broken) {
+            active.insert(job->id);
+            ++pending;
+            queued.push_back(move(job));
+        }
+    }
+    if (job) {
+        job->result.failed = true;
+        job->done.set_value(move(job->result));
+        return result;
+    }
+#if defined(_WIN32)
+    // each task runs the job at the front of the queue, if one hasn't been cancelled
+    workers->Post([this] {
+        unique_ptr<Job> next;
+        {
+            lock_guard<mutex> guard(lock);
+            if (queued.empty())
+                return;
+            next = move(queued.front());
+            queued.pop_front();
+        }
+        RunJob(next.get());
+        Complete(move(next));
+    });
+#else
+    Wake();
+#endif
+    return result;
+}
+
+//
+// Cancel
+//
+bool ProcessPool::Cancel(uint64_t jobId)
+{
+    unique_ptr<Job> notStarted;
+    {
+        lock_guard<mutex> guard(lock);
+        if (active.count(jobId) == 0)
+            return false;
+        auto it = find_if(queued.begin(), queued.end(), [&](const unique_ptr<Job>& job) { return job->id == jobId; });
+        if (it != queued.end()) {
+            notStarted = move(*it);
+            queued.erase(it);
+        } else {
+#if defined(_WIN32)
+            auto runningJob = find_if(running.begin(), running.end(), [&](Job* job) { return job->id == jobId; });
+            if (runningJob != running.end()) {
+                (*runningJob)->Kill(false);
+                return true;
+            }
+#endif
+            cancelled.push_back(jobId);     // starting.  killed once it has.
+        }
+    }
+    if (notStarted) {
+        notStarted->result.cancelled = true;
+        Complete(move(notStarted));
+    }
+#if !defined(_WIN32)
+    else {
+        Wake();
+    }
+#endif
+    return true;
+}
+
+//
+// CancelAll
+//
+void ProcessPool::CancelAll()
+{
+    vector<uint64_t> ids;
+    {
+        lock_guard<mutex> guard(lock);
+        ids.assign(active.begin(), active.end());
+    }
+    for (uint64_t id : ids)
+        Cancel(id);
+}
+
+//
+// Wait
+//
+void ProcessPool::Wait()
+{
+    unique_lock<mutex> guard(lock);
+    allDone.wait(guard, [this] { return pending == 0; });
+}
+
+//
+// Pending
+//
+size_t ProcessPool::Pending() const
+{
+    lock_guard<mutex> guard(lock);
+    return pending;
+}
+
+//
+// Complete - hand over the result
+//
+void ProcessPool::Complete(unique_ptr<Job> job)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        active.erase(job->id);
+        erase(cancelled, job->id);
+        if (--pending == 0)
+            allDone.notify_all();
+    }
+    job->done.set_value(move(job->result));
+}
+
+#if defined(_WIN32)
+
+//
+// RunJob - on a worker thread
+//
+void ProcessPool::RunJob(Job* job)
+{
+    if (!job->Start()) {
+        job->Ended();
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        running.insert(job);
+        if (find(cancelled.begin(), cancelled.end(), job->id) != cancelled.end())
+            job->Kill(false);
+    }
+
+    if (job->spec.timeout.count() > 0) {
+        ProcessResult unused;
+        if (!job->process.WaitFor(job->spec.timeout, &unused)) {
+            lock_guard<mutex> guard(lock);
+            job->Kill(true);
+        } else {
+            job->process.result = move(unused);     // Ended() takes it from the process
+        }
+    }
+    job->Ended();
+    lock_guard<mutex> guard(lock);
+    running.erase(job);
+}
+
+#else
+
+// what an epoll event is for, in the low bits under the job id.  the id rather than the Job pointer because an event
+// can still come after the descriptor is closed: a program being started holds its copy until exec closes it.
+enum : uint64_t { pidEvent = 0, inputEvent = 1, outputEvent = 2, errorEvent = 3, eventMask = 3, eventBits = 2 };
+
+static void watch(int epollFd, int fd, uint32_t events, uint64_t jobId, uint64_t kind)
+{
+    if (fd < 0)
+        return;
+    epoll_event event {};
+    event.events = events;
+    event.data.u64 = (jobId << eventBits) | kind;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+//
+// Fail - epoll can't be used.  the running jobs are killed, and they and the queued ones finish with failed set.
+// later jobs fail in Submit().
+//
+void ProcessPool::Fail(vector<unique_ptr<Job>>* running)
+{
+    deque<unique_ptr<Job>> notStarted;
+    {
+        lock_guard<mutex> guard(lock);
+        broken = true;
+        notStarted.swap(queued);
+    }
+    for (unique_ptr<Job>& job : *running) {
+        job->killed = true;
+        job->process.Kill();
+        if (job->process.running)
+            job->process.Reap(true);
+        job->Ended();
+        job->result.failed = true;
+        Complete(move(job));
+    }
+    running->clear();
+    for (unique_ptr<Job>& job : notStarted) {
+        job->result.failed = true;
+        Complete(move(job));
+    }
+}
+
+//
+// Wake - the pool's thread
+//
+void ProcessPool::Wake()
+{
+    uint64_t one = 1;
+    if (wakeFd >= 0)
+        (void)!write(wakeFd, &one, sizeof(one));
+}
+
+//
+// Run - the pool's thread.  starts jobs, moves their input and output, and kills the ones past their time.
+//
+void ProcessPool::Run()
+{
+    vector<unique_ptr<Job>> running;
+    vector<epoll_event> events(64);
+
+    for (;;) {
+        // start queued jobs and take cancellations
+        vector<unique_ptr<Job>> starting;
+        vector<uint64_t> toKill;
+        bool stop = false;
+        {
+            lock_guard<mutex> guard(lock);
+            while (running.size() + starting.size() < maxParallel && !queued.empty()) {
+                starting.push_back(move(queued.front()));
+                queued.pop_front();
+            }
+            toKill.swap(cancelled);
+            stop = stopping;
+        }
+        for (unique_ptr<Job>& job : starting) {
+            if (!job->Start()) {
+                job->Ended();
+                Complete(move(job));
+                continue;
+            }
+            watch(epollFd, job->process.pidFd, EPOLLIN, job->id, pidEvent);
+            watch(epollFd, job->process.inputFd, EPOLLOUT, job->id, inputEvent);
+            watch(epollFd, job->process.outputFd, EPOLLIN, job->id, outputEvent);
+            watch(epollFd, job->process.errorFd, EPOLLIN, job->id, errorEvent);
+            running.push_back(move(job));
+        }
+        for (uint64_t id : toKill) {
+            for (auto& job : running) {
+                if (job->id == id)
+                    job->Kill(false);
+            }
+        }
+        if (stop && running.empty()) {
+            lock_guard<mutex> guard(lock);
+            if (queued.empty())
+                break;
+            continue;
+        }
+
+        // sleep until an event or the next deadline.  without pidfds (before Linux 5.3) check every 10ms.
+        auto now = chrono::steady_clock::now();
+        auto next = chrono::steady_clock::time_point::max();
+        bool unwatched = false;
+        for (auto& job : running) {
+            if (!job->killed)
+                next = min(next, job->deadline);
+            unwatched |= job->process.pidFd < 0;
+        }
+        int timeoutMs = -1;
+        if (next != chrono::steady_clock::time_point::max())
+            timeoutMs = static_cast<int>(max<long long>(chrono::ceil<chrono::milliseconds>(next - now).count(), 0));
+        if (unwatched)
+            timeoutMs = (timeoutMs < 0) ? 10 : min(timeoutMs, 10);
+
+        int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), timeoutMs);
+        if (count < 0 && errno != EINTR) {
+            Fail(&running);
+            return;
+        }
+
+        // the pipes first, so a job isn't gone when its pipe event is handled.  events for a job that's gone or a
+        // descriptor it has closed are ignored.
+        vector<Job*> ended;
+        for (int i = 0; i < count; ++i) {
+            uint64_t data = events[i].data.u64;
+            if (data == 0) {
+                uint64_t value;
+                (void)!read(wakeFd, &value, sizeof(value));
+                continue;
+            }
+            uint64_t id = data >> eventBits;
+            auto it = find_if(running.begin(), running.end(), [&](const unique_ptr<Job>& job) { return job->id == id; });
+            if (it == running.end())
+                continue;
+            Job* job = it->get();
+            switch (data & eventMask) {
+            case pidEvent:
+                ended.push_back(job);
+                break;
+            case inputEvent:
+                if (job->process.inputFd >= 0)
+                    job->process.PumpInput();
+                break;
+            case outputEvent:
+                job->process.PumpOutput(false);
+                job->Stream(&job->process.result);
+                break;
+            case errorEvent:
+                job->process.PumpOutput(true);
+                job->Stream(&job->process.result);
+                break;
+            }
+        }
+        for (auto& job : running) {
+            if (job->process.pidFd < 0 && job->process.running && job->process.Reap(false))
+                ended.push_back(job.get());
+        }
+        for (Job* job : ended) {
+            if (job->process.running)
+                job->process.Reap(true);    // closing the descriptors takes them out of the epoll set
+            job->Ended();
+            auto it = find_if(running.begin(), running.end(), [&](const unique_ptr<Job>& j) { return j.get() == job; });
+            Complete(move(*it));
+            running.erase(it);
+        }
+
+        now = chrono::steady_clock::now();
+        for (auto& job : running) {
+            if (!job->killed && now >= job->deadline)
+                job->Kill(true);
+        }
+    }
+}
+
+#endif
+
+} // end namespace Tau
@@ -0,0 +1,134 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for ProcessPool, runs many programs at once with timeouts, cancellation and output callbacks.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "Tau_Process.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+class ThreadPool;
+
+///
+/// @brief ProcessJob - a program for a ProcessPool to run
+///
+struct ProcessJob {
+    std::string command;
+    Strings arguments;
+    ProcessOptions options;
+    std::chrono::milliseconds timeout {0};      ///< killed if it runs longer.  0 == no limit.
+
+    /// @brief stdout as it arrives, in chunks (not lines).  what's passed isn't kept in the result.  sets captureOutput.
+    std::function<void (std::string_view)> onOutput;
+    /// @brief the same for stderr.  sets captureErrors.
+    std::function<void (std::string_view)> onErrors;
+};
+
+///
+/// @brief ProcessJobResult - how a ProcessJob went
+///
+struct ProcessJobResult {
+    ProcessResult process;
+    bool timedOut {false};                      ///< killed for running past its timeout
+    bool cancelled {false};                     ///< cancelled before it started (process.started is false) or killed
+    bool failed {false};                        ///< the pool couldn't run it (see ProcessPool).  killed if it had started.
+    std::chrono::nanoseconds queued {0};        ///< from Submit() to the start
+    std::chrono::nanoseconds elapsed {0};       ///< from the start to the end
+};
+
+///
+/// @brief ProcessPool - runs queued programs, up to maxParallel at once
+/// @remark On Linux one thread runs every job: it waits with epoll on each program's pidfd and pipes, so ending,
+///         output and timeouts all wake it and nothing is polled.  On Windows each running job has a thread.
+/// @remark The callbacks are called on the pool's thread.  They should be quick and must not Wait() on the pool.
+///         On Windows they're called once with all the output when the program ends.
+/// @remark The destructor waits for the jobs queued and running.  CancelAll() first to stop them.
+/// @remark If the pool can't make its epoll and eventfd descriptors, or epoll_wait fails, it stops running jobs:
+///         the jobs it has and any submitted later finish with failed set, so Wait() and the futures never hang.
+/// @code
+///     ProcessPool pool(8);
+///     vector<future<ProcessJobResult>> results;
+///     for (const string& rom : roms) {
+///         ProcessJob job { converter, { rom, "-o", outDir } };
+///         job.timeout = chrono::seconds(30);
+///         results.push_back(pool.Submit(job));
+///     }
+///     pool.Wait();
+/// @endcode
+///
+class ProcessPool {
+public:
+    /// @param maxParallel the most programs running at once.  0 == the number of hardware threads.
+    explicit ProcessPool(unsigned int maxParallel = 0);
+    ~ProcessPool();
+
+    ProcessPool(const ProcessPool&) = delete;
+    ProcessPool& operator = (const ProcessPool&) = delete;
+
+    /// @brief queue a job
+    /// @param jobId if not null, the job's id for Cancel()
+    std::future<ProcessJobResult> Submit(ProcessJob job, uint64_t* jobId = nullptr);
+
+    /// @brief a queued job isn't started.  a running job is killed.
+    /// @return false if the job has already finished
+    bool Cancel(uint64_t jobId);
+    void CancelAll();
+
+    /// @brief wait until every job has finished
+    void Wait();
+
+    /// @brief jobs queued or running
+    size_t Pending() const;
+
+    unsigned int MaxParallel() const { return maxParallel; }
+
+    struct Job;
+
+private:
+    void Complete(std::unique_ptr<Job> job);
+#if defined(_WIN32)
+    void RunJob(Job* job);
+#else
+    void Run();
+    void Fail(std::vector<std::unique_ptr<Job>>* running);
+    void Wake();
+#endif
+
+    unsigned int maxParallel;
+    uint64_t nextId {1};
+    std::deque<std::unique_ptr<Job>> queued;
+    std::unordered_set<uint64_t> active;        // queued or running
+    std::vector<uint64_t> cancelled;            // running jobs to kill
+    size_t pending {0};
+    bool stopping {false};
+    bool broken {false};                        // can't run jobs.  they fail.
+    mutable std::mutex lock;
+    std::condition_variable allDone;
+#if defined(_WIN32)
+    std::unique_ptr<ThreadPool> workers;
+    std::unordered_set<Job*> running;
+#else
+    int epollFd {-1};
+    int wakeFd {-1};
+    std::thread runner;
+#endif
+};
+
+} // end namespace Tau
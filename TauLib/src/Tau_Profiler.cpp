@@ -0,0 +1,432 @@
+///
+/// @file
+/// @brief CPP file for Profiler, scoped zones timed into per thread rings and summed into a call tree.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_Profiler.h"
+#include "Tau_Histogram.h"
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#include "windows.h"
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+                //*******************************
+                // Clock
+                //*******************************
+
+//
+// ProfileClock - when the profiler started and how long a tick is
+//
+struct ProfileClock {
+    uint64_t ticks0 {Profiler::Now()};
+    chrono::steady_clock::time_point time0 {chrono::steady_clock::now()};
+    atomic<double> nsPerTick {0.0};
+};
+
+static ProfileClock& profileClock()
+{
+    static ProfileClock clock;
+    return clock;
+}
+
+//
+// calibrate - the TSC's rate against steady_clock.  measured once, over the first 10ms or more of the run.  until
+// then it's estimated over the run so far each time, without waiting.
+//
+static double calibrate()
+{
+    ProfileClock& clock = profileClock();
+    double nsPerTick = clock.nsPerTick.load(memory_order_relaxed);
+    if (nsPerTick != 0.0)
+        return nsPerTick;
+#if TAU_PROFILER_TSC
+    uint64_t ticks = Profiler::Now();
+    auto elapsed = chrono::steady_clock::now() - clock.time0;
+    nsPerTick = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()) /
+                static_cast<double>(max<uint64_t>(ticks - clock.ticks0, 1));
+    if (elapsed < chrono::milliseconds(10))
+        return nsPerTick;
+#else
+    nsPerTick = 1e9 * chrono::steady_clock::period::num / chrono::steady_clock::period::den;
+#endif
+    double unset = 0.0;
+    if (!clock.nsPerTick.compare_exchange_strong(unset, nsPerTick, memory_order_relaxed))
+        return unset;       // another thread measured it first
+    return nsPerTick;
+}
+
+//
+// TicksToNs
+//
+uint64_t Profiler::TicksToNs(uint64_t ticks)
+{
+    ProfileClock& clock = profileClock();
+    double nsPerTick = calibrate();
+    return (ticks > clock.ticks0) ? static_cast<uint64_t>(static_cast<double>(ticks - clock.ticks0) * nsPerTick) : 0;
+}
+
+                //*******************************
+                // Zones and threads
+                //*******************************
+
+static mutex zoneLock;
+static vector<ProfileZoneInfo> zones;
+static unordered_map<string, uint32_t> zoneIds;
+
+//
+// RegisterZone
+//
+uint32_t Profiler::RegisterZone(const string& name, const string& file, int line)
+{
+    string key = name + '\0' + file + '\0' + to_string(line);
+    lock_guard<mutex> guard(zoneLock);
+    auto found = zoneIds.find(key);
+    if (found != zoneIds.end())
+        return found->second;
+    if (zones.size() >= maxZones - 1) {
+        if (zones.size() == maxZones - 1)
+            zones.push_back({ "(more zones)", "", 0 });
+        return static_cast<uint32_t>(maxZones - 1);
+    }
+    uint32_t zone = static_cast<uint32_t>(zones.size());
+    zones.push_back({ name, file, line });
+    zoneIds.emplace(move(key), zone);
+    return zone;
+}
+
+//
+// Zone
+//
+ProfileZoneInfo Profiler::Zone(uint32_t zone)
+{
+    lock_guard<mutex> guard(zoneLock);
+    return (zone < zones.size()) ? zones[zone] : ProfileZoneInfo();
+}
+
+static mutex ringLock;
+static vector<shared_ptr<ProfileRing>> rings;       // threads whose rings haven't been drained for the last time
+static vector<ProfileThreadInfo> threads;           // every thread that has recorded
+static uint64_t droppedByGone {0};
+static atomic<size_t> ringCapacity {16384};
+
+//
+// ProfileRing
+//
+ProfileRing::ProfileRing(size_t capacity)
+    : records(make_unique<ProfileRecord[]>(capacity)), mask(capacity - 1)
+{
+}
+
+//
+// ThreadRingOwner - tells Collect() the thread has exited so its ring can go once it's drained
+//
+struct ThreadRingOwner {
+    shared_ptr<ProfileRing> ring;
+    ~ThreadRingOwner() {
+        if (ring)
+            ring->finished.store(true, memory_order_release);
+    }
+};
+
+//
+// AttachThread - the first zone on a thread
+//
+ProfileRing* Profiler::AttachThread()
+{
+    thread_local ThreadRingOwner owner;
+    if (!owner.ring) {
+        profileClock();
+        owner.ring = make_shared<ProfileRing>(ringCapacity.load());
+        ProfileThreadInfo info;
+#if defined(_WIN32)
+        info.osId = GetCurrentThreadId();
+#elif defined(__linux__)
+        info.osId = static_cast<uint64_t>(syscall(SYS_gettid));
+#else
+        info.osId = hash<thread::id>()(this_thread::get_id());
+#endif
+        lock_guard<mutex> guard(ringLock);
+        info.index = static_cast<uint32_t>(threads.size());
+        owner.ring->thread = info.index;
+        threads.push_back(info);
+        rings.push_back(owner.ring);
+    }
+    return owner.ring.get();
+}
+
+//
+// SetThreadName
+//
+void Profiler::SetThreadName(const string& name)
+{
+    ProfileRing* ring = ThreadRing();
+    lock_guard<mutex> guard(ringLock);
+    threads[ring->thread].name = name;
+}
+
+//
+// Threads
+//
+vector<ProfileThreadInfo> Profiler::Threads()
+{
+    lock_guard<mutex> guard(ringLock);
+    return threads;
+}
+
+//
+// SetRingCapacity
+//
+void Profiler::SetRingCapacity(size_t records)
+{
+    ringCapacity.store(bit_ceil(max<size_t>(records, 64)));
+}
+
+//
+// Dropped
+//
+uint64_t Profiler::Dropped()
+{
+    lock_guard<mutex> guard(ringLock);
+    uint64_t dropped = droppedByGone;
+    for (auto& ring : rings)
+        dropped += ring->dropped.load(memory_order_relaxed);
+    return dropped;
+}
+
+                //*******************************
+                // Call tree
+                //*******************************
+
+//
+// ProfileNode - a zone at one place in the call tree
+//
+struct ProfileNode {
+    uint32_t zone {0};
+    vector<uint32_t> children;
+    HistogramCounts times {5};      // ns.  16 buckets per power of 2, within 6%
+};
+
+//
+// ThreadState - Collect()'s view of a thread
+//
+struct ThreadState {
+    shared_ptr<ProfileRing> ring;
+};
+
+static mutex collectLock;
+static vector<ProfileNode> nodes(1);                // [0] is the root
+static vector<ThreadState> threadStates;
+static vector<shared_ptr<ProfileSink>> sinks;
+
+//
+// childNode - the node for zone under parent, added the first time
+//
+static uint32_t childNode(uint32_t parent, uint32_t zone)
+{
+    for (uint32_t child : nodes[parent].children) {
+        if (nodes[child].zone == zone)
+            return child;
+    }
+    uint32_t child = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back().zone = zone;
+    nodes[parent].children.push_back(child);
+    return child;
+}
+
+//
+// Collect
+//
+size_t Profiler::Collect()
+{
+    lock_guard<mutex> collectGuard(collectLock);
+    {
+        lock_guard<mutex> guard(ringLock);
+        for (size_t i = threadStates.size(); i < rings.size(); ++i)
+            threadStates.push_back({ rings[i] });
+    }
+    double nsPerTick = calibrate();
+    uint64_t ticks0 = profileClock().ticks0;
+
+    vector<ProfileEvent> events;
+    vector<uint32_t> recordNodes;
+    bool anyFinished = false;
+    for (ThreadState& state : threadStates) {
+        ProfileRing& ring = *state.ring;
+        bool finished = ring.finished.load(memory_order_acquire);      // before head, so nothing is missed
+        uint64_t tail = ring.tail.load(memory_order_relaxed);
+        uint64_t head = ring.head.load(memory_order_acquire);
+
+        // the zones still open on the thread are the parents of the records whose parents haven't ended.  they're
+        // read again if a zone ends meanwhile, so they go with head.  (a thread that never stops ending zones can
+        // still get a record put under a newer zone at the same depth.)
+        uint32_t open[ProfileRing::maxOpen];
+        for (int attempt = 0; ; ++attempt) {
+            for (uint32_t d = 0; d < ProfileRing::maxOpen; ++d)
+                open[d] = ring.open[d].load(memory_order_acquire);
+            uint64_t again = ring.head.load(memory_order_acquire);
+            if (again == head || attempt == 3)
+                break;
+            head = again;
+        }
+
+        // a record's parent is the first record after it one level up, or the zone still open there.  newest
+        // first, so the parents are seen before their children.
+        uint32_t ended[ProfileRing::maxOpen];           // the zone of the last record seen at each depth
+        uint32_t endedDepths = 0;                       // ended[] is valid below this
+        recordNodes.resize(static_cast<size_t>(head - tail));
+        for (uint64_t at = head; at-- > tail; ) {
+            const ProfileRecord& record = ring.records[at & ring.mask];
+            uint32_t depth = min(record.depth, ProfileRing::maxOpen - 1);
+            uint32_t node = 0;
+            for (uint32_t d = 0; d < depth; ++d)
+                node = childNode(node, (d < endedDepths) ? ended[d] : open[d]);
+            recordNodes[at - tail] = childNode(node, record.zone);
+            // the deeper records seen so far ended after this one, so they can't be the parents of older records
+            for (uint32_t d = endedDepths; d < depth; ++d)
+                ended[d] = open[d];
+            ended[depth] = record.zone;
+            endedDepths = depth + 1;
+        }
+
+        for (uint64_t at = tail; at < head; ++at) {
+            const ProfileRecord& record = ring.records[at & ring.mask];
+            ProfileEvent event;
+            event.startNs = (record.start > ticks0) ? static_cast<uint64_t>((record.start - ticks0) * nsPerTick) : 0;
+            event.durationNs = static_cast<uint64_t>((record.end - record.start) * nsPerTick);
+            event.zone = record.zone;
+            event.thread = ring.thread;
+            event.depth = record.depth;
+            nodes[recordNodes[at - tail]].times.Record(event.durationNs);
+            events.push_back(event);
+        }
+        ring.tail.store(head, memory_order_release);
+        anyFinished |= finished;
+    }
+
+    // threads that have exited have been drained for the last time
+    if (anyFinished) {
+        lock_guard<mutex> guard(ringLock);
+        erase_if(threadStates, [](const ThreadState& state) {
+            if (!state.ring->finished.load(memory_order_acquire) ||
+                state.ring->tail.load(memory_order_relaxed) != state.ring->head.load(memory_order_acquire))
+                return false;
+            droppedByGone += state.ring->dropped.load(memory_order_relaxed);
+            erase(rings, state.ring);
+            return true;
+        });
+    }
+
+    if (!events.empty()) {
+        for (auto& sink : sinks)
+            sink->Consume(events);
+    }
+    return events.size();
+}
+
+//
+// AddSink
+//
+void Profiler::AddSink(shared_ptr<ProfileSink> sink)
+{
+    lock_guard<mutex> guard(collectLock);
+    sinks.push_back(move(sink));
+}
+
+//
+// RemoveSink
+//
+void Profiler::RemoveSink(const shared_ptr<ProfileSink>& sink)
+{
+    lock_guard<mutex> guard(collectLock);
+    erase(sinks, sink);
+}
+
+//
+// Report
+//
+vector<ProfileNodeStats> Profiler::Report()
+{
+    Collect();
+    lock_guard<mutex> guard(collectLock);
+    vector<ProfileNodeStats> report;
+
+    // a node is shown if it or a zone under it has ended since the last Reset()
+    vector<uint64_t> subtreeCount(nodes.size(), 0);
+    function<uint64_t (uint32_t)> countUnder = [&](uint32_t node) {
+        uint64_t count = nodes[node].times.Count();
+        for (uint32_t child : nodes[node].children)
+            count += countUnder(child);
+        return subtreeCount[node] = count;
+    };
+    countUnder(0);
+
+    function<void (uint32_t, int)> visit = [&](uint32_t parent, int depth) {
+        for (uint32_t child : nodes[parent].children) {
+            const ProfileNode& node = nodes[child];
+            if (subtreeCount[child] == 0)
+                continue;
+            ProfileNodeStats stats;
+            stats.zone = node.zone;
+            stats.name = Zone(node.zone).name;
+            stats.depth = depth;
+            stats.count = node.times.Count();
+            if (stats.count != 0) {
+                stats.totalNs = node.times.Total();
+                stats.minNs = node.times.Min();
+                stats.maxNs = node.times.Max();
+                stats.meanNs = stats.totalNs / stats.count;
+                stats.p50Ns = node.times.Percentile(50);
+                stats.p90Ns = node.times.Percentile(90);
+                stats.p99Ns = node.times.Percentile(99);
+            }
+            report.push_back(move(stats));
+            visit(child, depth + 1);
+        }
+    };
+    visit(0, 0);
+    return report;
+}
+
+//
+// ReportText
+//
+string Profiler::ReportText()
+{
+    auto ms = [](uint64_t ns) { return static_cast<double>(ns) / 1'000'000.0; };
+    string text = format("{:<48} {:>10} {:>12} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+                         "zone", "calls", "total ms", "mean ms", "min ms", "max ms", "p50 ms", "p90 ms", "p99 ms");
+    for (const ProfileNodeStats& stats : Report()) {
+        string name = string(stats.depth * 2, ' ') + stats.name;
+        text += format("{:<48} {:>10} {:>12.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}\n",
+                       name, stats.count, ms(stats.totalNs), ms(stats.meanNs), ms(stats.minNs), ms(stats.maxNs),
+                       ms(stats.p50Ns), ms(stats.p90Ns), ms(stats.p99Ns));
+    }
+    return text;
+}
+
+//
+// Reset
+//
+void Profiler::Reset()
+{
+    lock_guard<mutex> guard(collectLock);
+    for (ProfileNode& node : nodes)
+        node.times.Reset();
+}
+
+} // end namespace Tau
@@ -0,0 +1,273 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for Profiler, scoped zones timed into per thread rings and summed into a call tree.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define TAU_PROFILER_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TAU_PROFILER_TSC 1
+#else
+#define TAU_PROFILER_TSC 0
+#endif
+
+///
+/// @brief TAU_PROFILER_ENABLED - define as 0 to compile TAU_PROFILE_ZONE / TAU_PROFILE_FUNCTION and Tau_Timer's
+/// recording out.  on in debug and release.
+///
+#if !defined(TAU_PROFILER_ENABLED)
+#define TAU_PROFILER_ENABLED 1
+#endif
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief ProfileEvent - a zone that has ended, as handed to a ProfileSink
+///
+struct ProfileEvent {
+    uint64_t startNs {0};           ///< since the profiler started
+    uint64_t durationNs {0};
+    uint32_t zone {0};              ///< Profiler::Zone() has its name
+    uint32_t thread {0};            ///< Profiler::Threads() index
+    uint32_t depth {0};             ///< zones open on the thread when it started
+};
+
+///
+/// @brief ProfileZoneInfo - where a zone is
+///
+struct ProfileZoneInfo {
+    std::string name;
+    std::string file;
+    int line {0};
+};
+
+///
+/// @brief ProfileThreadInfo - a thread that has recorded zones
+///
+struct ProfileThreadInfo {
+    uint32_t index {0};             ///< 0, 1, 2... in the order threads first record
+    uint64_t osId {0};              ///< gettid() or GetCurrentThreadId()
+    std::string name;               ///< Profiler::SetThreadName().  empty if not set.
+};
+
+///
+/// @brief ProfileNodeStats - a zone at one place in the call tree, summed over every thread
+///
+struct ProfileNodeStats {
+    uint32_t zone {0};
+    std::string name;
+    int depth {0};                  ///< 0 == called outside any zone
+    uint64_t count {0};
+    uint64_t totalNs {0};
+    uint64_t minNs {0};
+    uint64_t maxNs {0};
+    uint64_t meanNs {0};
+    uint64_t p50Ns {0};             ///< percentiles are within about 6%
+    uint64_t p90Ns {0};
+    uint64_t p99Ns {0};
+};
+
+///
+/// @brief ProfileSink - gets every ProfileEvent Profiler::Collect() drains
+///
+class ProfileSink {
+public:
+    virtual ~ProfileSink() {}
+
+    /// @brief called by Collect() on the thread calling it, one thread at a time
+    virtual void Consume(const std::vector<ProfileEvent>& events) = 0;
+};
+
+///
+/// @brief ProfileRecord - a zone that has ended, as a thread writes it.  one per zone.
+///
+struct ProfileRecord {
+    uint64_t start;
+    uint64_t end;
+    uint32_t zone;
+    uint32_t depth;
+};
+
+///
+/// @brief ProfileRing - one thread's records waiting for Collect().  one writer (the thread), one reader.
+///
+struct ProfileRing {
+    explicit ProfileRing(size_t capacity);
+
+    /// @brief add a record.  dropped (and counted) if Collect() hasn't kept up.
+    void Push(uint64_t start, uint64_t end, uint32_t zone, uint32_t depth) {
+        uint64_t at = head.load(std::memory_order_relaxed);
+        if (at - tail.load(std::memory_order_acquire) > mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        records[at & mask] = { start, end, zone, depth };
+        head.store(at + 1, std::memory_order_release);
+    }
+
+    /// @brief the depths of zones Collect() places in the call tree.  deeper zones are put at the deepest one.
+    static constexpr uint32_t maxOpen {64};
+
+    std::unique_ptr<ProfileRecord[]> records;
+    uint64_t mask;
+    uint32_t depth {0};                                 // zones open on the thread
+    std::atomic<uint32_t> open[maxOpen];                // the zone open at each depth, for Collect()
+    uint32_t thread {0};                                // Profiler::Threads() index
+    alignas(64) std::atomic<uint64_t> head {0};         // written by the thread
+    alignas(64) std::atomic<uint64_t> tail {0};         // written by Collect()
+    std::atomic<uint64_t> dropped {0};
+    std::atomic<bool> finished {false};                 // the thread has exited
+};
+
+///
+/// @brief Profiler - times zones with almost no cost to the code being timed
+/// @remark A zone records its TSC (x86) or steady_clock start and end into its thread's ring as one record when it
+///         ends, with no locks, allocation or string work, so it costs a few ns.  Collect() drains the rings, sums
+///         each zone's times where it sits in the call tree and hands the raw events to the sinks.  Call it every so often (once a
+///         frame, or from a thread) so the rings don't fill up.  Report() collects first.
+/// @remark Define TAU_PROFILER_ENABLED as 0 to compile the macros out.  SetEnabled(false) turns them off at run time.
+/// @code
+///     void LoadGames() {
+///         TAU_PROFILE_FUNCTION();
+///         for (auto& game : games) {
+///             TAU_PROFILE_ZONE("LoadGame");
+///             ...
+///         }
+///     }
+///
+///     cout << Profiler::ReportText();
+/// @endcode
+///
+class Profiler {
+public:
+    /// @brief the id for a zone.  the same name, file and line always get the same id.  the macros call it once per zone.
+    /// @remark there are at most maxZones.  after that every new zone gets the one id named "(more zones)", so names
+    ///         made at run time can't grow the registry forever.
+    static uint32_t RegisterZone(const std::string& name, const std::string& file = "", int line = 0);
+    static constexpr size_t maxZones {4096};
+    static ProfileZoneInfo Zone(uint32_t zone);
+
+    static void SetEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /// @brief name the calling thread in reports and traces
+    static void SetThreadName(const std::string& name);
+    static std::vector<ProfileThreadInfo> Threads();
+
+    /// @brief records per thread ring (rounded up to a power of 2).  for threads that haven't recorded yet.
+    static void SetRingCapacity(size_t records);
+
+    /// @brief drain every thread's ring into the call tree and the sinks
+    /// @return the number of zones that ended
+    static size_t Collect();
+
+    static void AddSink(std::shared_ptr<ProfileSink> sink);
+    static void RemoveSink(const std::shared_ptr<ProfileSink>& sink);
+
+    /// @brief the call tree depth first, children in the order first seen.  collects first.
+    static std::vector<ProfileNodeStats> Report();
+    /// @brief the call tree as a table in ms, indented by depth
+    static std::string ReportText();
+
+    /// @brief clear the call tree's times.  zones, threads and sinks are kept.
+    static void Reset();
+
+    /// @brief records lost because a ring was full
+    static uint64_t Dropped();
+
+    /// @brief the time a zone records.  ticks, see TicksToNs().
+    static uint64_t Now() {
+#if TAU_PROFILER_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+    /// @brief ticks since the profiler started in ns
+    static uint64_t TicksToNs(uint64_t ticks);
+
+    /// @brief the calling thread's ring
+    static ProfileRing* ThreadRing() {
+        thread_local ProfileRing* ring = nullptr;
+        if (ring == nullptr)
+            ring = AttachThread();
+        return ring;
+    }
+
+private:
+    static ProfileRing* AttachThread();
+
+    static inline std::atomic<bool> enabled {true};
+};
+
+///
+/// @brief ProfileScope - times the scope it's in as a zone.  see TAU_PROFILE_ZONE.
+///
+class ProfileScope {
+public:
+    /// @brief a zone that isn't recorded
+    static constexpr uint32_t noZone {UINT32_MAX};
+
+    explicit ProfileScope(uint32_t _zone) {
+        if (_zone != noZone && Profiler::IsEnabled()) {
+            ring = Profiler::ThreadRing();
+            zone = _zone;
+            depth = ring->depth++;
+            if (depth < ProfileRing::maxOpen)
+                ring->open[depth].store(zone, std::memory_order_release);
+            start = Profiler::Now();
+        }
+    }
+    ~ProfileScope() {
+        if (ring != nullptr) {
+            uint64_t end = Profiler::Now();
+            --ring->depth;
+            ring->Push(start, end, zone, depth);
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator = (const ProfileScope&) = delete;
+
+private:
+    ProfileRing* ring {nullptr};
+    uint64_t start {0};
+    uint32_t zone {0};
+    uint32_t depth {0};
+};
+
+} // end namespace Tau
+
+#define TAU_PROFILE_CONCAT2(a, b) a##b
+#define TAU_PROFILE_CONCAT(a, b) TAU_PROFILE_CONCAT2(a, b)
+
+#if TAU_PROFILER_ENABLED
+///
+/// @brief TAU_PROFILE_ZONE - time from here to the end of the scope as the zone name (a string literal)
+///
+#define TAU_PROFILE_ZONE(name) \
+    static const uint32_t TAU_PROFILE_CONCAT(tauZone, __LINE__) = ::Tau::Profiler::RegisterZone(name, __FILE__, __LINE__); \
+    ::Tau::ProfileScope TAU_PROFILE_CONCAT(tauScope, __LINE__)(TAU_PROFILE_CONCAT(tauZone, __LINE__))
+#else
+#define TAU_PROFILE_ZONE(name) ((void)0)
+#endif
+
+///
+/// @brief TAU_PROFILE_FUNCTION - time the function as a zone named after it
+///
+#define TAU_PROFILE_FUNCTION() TAU_PROFILE_ZONE(__FUNCTION__)
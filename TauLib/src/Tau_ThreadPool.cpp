@@ -0,0 +1,99 @@
+///
+/// @file
+/// @brief CPP file for ThreadPool, a fixed set of worker threads running queued tasks.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace Tau {
+
+//
+// ThreadPool
+//
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+    threads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        threads.emplace_back([this] { Run(); });
+}
+
+//
+// ~ThreadPool - finish what's queued, then join
+//
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+//
+// Post
+//
+void ThreadPool::Post(function<void ()> task)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        tasks.emplace_back(std::move(task));
+        ++pending;
+    }
+    taskReady.notify_one();
+}
+
+//
+// Wait
+//
+void ThreadPool::Wait()
+{
+    unique_lock<mutex> guard(lock);
+    allDone.wait(guard, [this] { return pending == 0; });
+}
+
+//
+// Pending
+//
+size_t ThreadPool::Pending() const
+{
+    lock_guard<mutex> guard(lock);
+    return pending;
+}
+
+//
+// Run - a worker thread
+//
+void ThreadPool::Run()
+{
+    for (;;) {
+        function<void ()> task;
+        {
+            unique_lock<mutex> guard(lock);
+            taskReady.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;     // stopping and nothing left
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+
+        bool idle;
+        {
+            lock_guard<mutex> guard(lock);
+            idle = (--pending == 0);
+        }
+        if (idle)
+            allDone.notify_all();
+    }
+}
+
+} // end namespace Tau
@@ -0,0 +1,80 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for ThreadPool, a fixed set of worker threads running queued tasks.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief ThreadPool - runs queued tasks on a fixed number of threads
+/// @remark Tasks run in the order they're queued, as threads become free.  The destructor runs the tasks still
+///         queued and then joins the threads.
+/// @remark A task must not Wait() on its own pool, and must not block on a future of a task queued on its own pool
+///         when every thread could be doing the same.  Use a second pool for sub tasks (see CopyTree).
+/// @code
+///     ThreadPool pool(4);
+///     auto size = pool.Submit([&] { return GetFileSize(path); });
+///     pool.Post([] { ... });
+///     pool.Wait();
+///     uintmax_t bytes = size.get();
+/// @endcode
+///
+class ThreadPool {
+public:
+    /// @brief start the threads.  0 == the number of hardware threads.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    /// @brief queue a task that returns nothing.  an exception thrown by it ends the program, the same as a std::thread.
+    void Post(std::function<void ()> task);
+
+    /// @brief queue a task.  the future has its result or the exception it threw.
+    template <class Fn>
+    auto Submit(Fn&& fn) -> std::future<std::invoke_result_t<std::decay_t<Fn>&>> {
+        using Result = std::invoke_result_t<std::decay_t<Fn>&>;
+        // std::function needs a copyable target so the packaged_task is shared
+        auto task = std::make_shared<std::packaged_task<Result ()>>(std::forward<Fn>(fn));
+        std::future<Result> result = task->get_future();
+        Post([task] { (*task)(); });
+        return result;
+    }
+
+    /// @brief wait until every queued task has finished
+    void Wait();
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(threads.size()); }
+
+    /// @brief tasks queued or running
+    size_t Pending() const;
+
+private:
+    void Run();
+
+    std::vector<std::thread> threads;
+    std::deque<std::function<void ()>> tasks;
+    mutable std::mutex lock;
+    std::condition_variable taskReady;
+    std::condition_variable allDone;
+    size_t pending {0};         // queued + running
+    bool stopping {false};
+};
+
+} // end namespace Tau
@@ -1,4 +1,21 @@
 #include "Tau_Time.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+#if defined(_WIN32)
+#include "windows.h"
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 ///
 /// @file
 /// @brief CPP file for time routines.
@@ -25,10 +42,25 @@ time_t CurrentTimeAsTime_t()
 //
 // CurrentTimeAsTime_point
 //
-chrono::system_clock::time_point CurrentTimeAsTime_point()
+chrono::system_clock::time_point CurrentTimeAsTime_point(bool coarse)
 {
-    auto current = chrono::system_clock::now();
-    return current;
+    if (!coarse)
+        return chrono::system_clock::now();
+#if defined(_WIN32)
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    // 100ns since 1601 to since 1970
+    int64_t ticks = ((static_cast<int64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime) - 116444736000000000LL;
+    return chrono::system_clock::time_point(
+        chrono::duration_cast<chrono::system_clock::duration>(chrono::duration<int64_t, ratio<1, 10'000'000>>(ticks)));
+#elif defined(CLOCK_REALTIME_COARSE)
+    timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    return chrono::system_clock::time_point(
+        chrono::duration_cast<chrono::system_clock::duration>(chrono::seconds(now.tv_sec) + chrono::nanoseconds(now.tv_nsec)));
+#else
+    return chrono::system_clock::now();
+#endif
 }
 
 //
@@ -41,23 +73,18 @@ string Time_t_ToString(time_t t, const string& format)
 
     char buf[200];
     if (format != "") {
-        struct tm tm_buf;
-        auto err_no = localtime_s(&tm_buf, &t);
-        if (err_no == 0) {
-            if (strftime(buf, sizeof(buf), format.c_str(), &tm_buf))
-                return buf;
-            else {
-                ctime_s(buf, sizeof(buf), &t);   // error with the format, use default
-                return buf;
-            }
-        } else {
-            ctime_s(buf, sizeof(buf), &t);   // error with the format, use default
-            return buf;
-        }
-    } else {
-        ctime_s(buf, sizeof(buf), &t);   // error with the format, use default
-        return buf;
+        // a program uses a few formats, each is compiled once a thread
+        thread_local unordered_map<string, TimeFormatter> formatters;
+        if (formatters.size() >= 32)
+            formatters.clear();
+        const TimeFormatter& formatter = formatters.try_emplace(format, format).first->second;
+
+        size_t length = formatter.Format(t, buf, sizeof(buf));
+        if (length != 0 && length < sizeof(buf))
+            return string(buf, length);
     }
+    ctime_s(buf, sizeof(buf), &t);   // error with the time or the format, use default
+    return buf;
 }
 
 //
@@ -68,6 +95,275 @@ string CurrentTime_ToString(const string& format)
     return Time_t_ToString(CurrentTimeAsTime_t(), format);
 }
 
+                //*******************************
+                //           TimeFormatter
+                //*******************************
+
+//
+// SecondText - the text of a second, with the places the sub-second digits go
+//
+struct TimeFormatter::SecondText {
+    uint64_t formatter {0};
+    int64_t second {0};
+    bool valid {false};
+    string text;
+    vector<pair<size_t, Op::Kind>> inserts;
+};
+
+//
+// TimeFormatter
+//
+TimeFormatter::TimeFormatter(const string& _format)
+    : format(_format)
+{
+    static atomic<uint64_t> nextId {1};
+    id = nextId.fetch_add(1, memory_order_relaxed);
+
+    auto text = [&](const string& more) {
+        if (!ops.empty() && ops.back().kind == Op::Text)
+            ops.back().text += more;
+        else
+            ops.push_back({ Op::Text, more });
+    };
+    auto op = [&](Op::Kind kind) { ops.push_back({ kind, "" }); };
+
+    string pattern = format.empty() ? "%a %b %e %H:%M:%S %Y\n" : format;     // ctime()'s
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%' || i + 1 == pattern.size()) {
+            text(string(1, pattern[i]));
+            continue;
+        }
+        char conversion = pattern[++i];
+        switch (conversion) {
+            case 'Y': op(Op::Year); break;
+            case 'y': op(Op::Year2); break;
+            case 'm': op(Op::Month); break;
+            case 'd': op(Op::Day); break;
+            case 'e': op(Op::DaySpace); break;
+            case 'H': op(Op::Hour); break;
+            case 'I': op(Op::Hour12); break;
+            case 'M': op(Op::Minute); break;
+            case 'S': op(Op::Second); break;
+            case 'j': op(Op::DayOfYear); break;
+            case 'F': op(Op::Year); text("-"); op(Op::Month); text("-"); op(Op::Day); break;
+            case 'T': op(Op::Hour); text(":"); op(Op::Minute); text(":"); op(Op::Second); break;
+            case 'R': op(Op::Hour); text(":"); op(Op::Minute); break;
+            case 'D': op(Op::Month); text("/"); op(Op::Day); text("/"); op(Op::Year2); break;
+            case 'L': op(Op::Millis); break;
+            case 'f': op(Op::Micros); break;
+            case 'N': op(Op::Nanos); break;
+            case '%': text("%"); break;
+            case 'n': text("\n"); break;
+            case 't': text("\t"); break;
+            case 'E':
+            case 'O':       // %Ec, %Oy and the like
+                if (i + 1 < pattern.size()) {
+                    ops.push_back({ Op::Strftime, string("%") + conversion + pattern[++i] });
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                ops.push_back({ Op::Strftime, string("%") + conversion });
+                break;
+        }
+    }
+}
+
+// value in width digits, padded with pad
+static void appendNumber(string* text, int value, int width, char pad)
+{
+    char digits[16];
+    int count = 0;
+    unsigned int rest = static_cast<unsigned int>(value < 0 ? -value : value);
+    do {
+        digits[count++] = static_cast<char>('0' + rest % 10);
+        rest /= 10;
+    } while (rest != 0);
+    if (value < 0)
+        text->push_back('-');
+    for (int i = count; i < width; ++i)
+        text->push_back(pad);
+    while (count > 0)
+        text->push_back(digits[--count]);
+}
+
+//
+// Render - the thread's text of second, made again if it's for another second or formatter
+//
+const TimeFormatter::SecondText* TimeFormatter::Render(int64_t second) const
+{
+    thread_local SecondText cache[4];
+    SecondText& entry = cache[id % 4];
+    if (entry.formatter == id && entry.second == second)
+        return &entry;
+    entry.formatter = id;
+    entry.second = second;
+    entry.text.clear();
+    entry.inserts.clear();
+
+    time_t t = static_cast<time_t>(second);
+    struct tm tm_buf;
+#if defined(_WIN32)
+    entry.valid = localtime_s(&tm_buf, &t) == 0;
+#else
+    entry.valid = localtime_r(&t, &tm_buf) != nullptr;
+#endif
+    if (!entry.valid)
+        return &entry;
+
+    string& text = entry.text;
+    for (const Op& op : ops) {
+        switch (op.kind) {
+            case Op::Text: text += op.text; break;
+            case Op::Year: appendNumber(&text, tm_buf.tm_year + 1900, 1, '0'); break;
+            case Op::Year2: appendNumber(&text, (tm_buf.tm_year + 1900) % 100, 2, '0'); break;
+            case Op::Month: appendNumber(&text, tm_buf.tm_mon + 1, 2, '0'); break;
+            case Op::Day: appendNumber(&text, tm_buf.tm_mday, 2, '0'); break;
+            case Op::DaySpace: appendNumber(&text, tm_buf.tm_mday, 2, ' '); break;
+            case Op::Hour: appendNumber(&text, tm_buf.tm_hour, 2, '0'); break;
+            case Op::Hour12: appendNumber(&text, (tm_buf.tm_hour + 11) % 12 + 1, 2, '0'); break;
+            case Op::Minute: appendNumber(&text, tm_buf.tm_min, 2, '0'); break;
+            case Op::Second: appendNumber(&text, tm_buf.tm_sec, 2, '0'); break;
+            case Op::DayOfYear: appendNumber(&text, tm_buf.tm_yday + 1, 3, '0'); break;
+            case Op::Strftime: {
+                char buf[128];
+                text.append(buf, strftime(buf, sizeof(buf), op.text.c_str(), &tm_buf));
+                break;
+            }
+            case Op::Millis:
+            case Op::Micros:
+            case Op::Nanos:
+                entry.inserts.emplace_back(text.size(), op.kind);
+                break;
+        }
+    }
+    return &entry;
+}
+
+//
+// Write - second's text into buffer with the sub-second digits of ns
+//
+size_t TimeFormatter::Write(const SecondText& second, int64_t ns, char* buffer, size_t size) const
+{
+    size_t length = 0;
+    auto put = [&](const char* text, size_t count) {
+        if (length + 1 < size)
+            memcpy(buffer + length, text, min(count, size - 1 - length));
+        length += count;
+    };
+
+    size_t from = 0;
+    for (auto [at, kind] : second.inserts) {
+        put(second.text.data() + from, at - from);
+        from = at;
+        int count = kind == Op::Millis ? 3 : kind == Op::Micros ? 6 : 9;
+        int64_t value = ns;
+        for (int i = count; i < 9; ++i)
+            value /= 10;
+        char digits[9];
+        for (int i = count - 1; i >= 0; --i, value /= 10)
+            digits[i] = static_cast<char>('0' + value % 10);
+        put(digits, count);
+    }
+    put(second.text.data() + from, second.text.size() - from);
+    if (size != 0)
+        buffer[min(length, size - 1)] = 0;
+    return length;
+}
+
+//
+// Format
+//
+size_t TimeFormatter::Format(chrono::system_clock::time_point when, char* buffer, size_t size) const
+{
+    int64_t ns = chrono::duration_cast<chrono::nanoseconds>(when.time_since_epoch()).count();
+    int64_t second = ns / 1'000'000'000;
+    ns %= 1'000'000'000;
+    if (ns < 0) {
+        ns += 1'000'000'000;
+        --second;
+    }
+    const SecondText* text = Render(second);
+    if (!text->valid) {
+        if (size != 0)
+            buffer[0] = 0;
+        return 0;
+    }
+    return Write(*text, ns, buffer, size);
+}
+
+size_t TimeFormatter::Format(time_t t, char* buffer, size_t size) const
+{
+    const SecondText* text = Render(static_cast<int64_t>(t));
+    if (!text->valid) {
+        if (size != 0)
+            buffer[0] = 0;
+        return 0;
+    }
+    return Write(*text, 0, buffer, size);
+}
+
+//
+// FormatNow
+//
+size_t TimeFormatter::FormatNow(char* buffer, size_t size, bool coarse) const
+{
+    return Format(CurrentTimeAsTime_point(coarse), buffer, size);
+}
+
+//
+// Format - to a string
+//
+string TimeFormatter::Format(chrono::system_clock::time_point when) const
+{
+    char buf[256];
+    size_t length = Format(when, buf, sizeof(buf));
+    if (length < sizeof(buf))
+        return string(buf, length);
+    string text(length, '\0');
+    Format(when, text.data(), length + 1);
+    return text;
+}
+
+string TimeFormatter::Format(time_t t) const
+{
+    char buf[256];
+    size_t length = Format(t, buf, sizeof(buf));
+    if (length < sizeof(buf))
+        return string(buf, length);
+    string text(length, '\0');
+    Format(t, text.data(), length + 1);
+    return text;
+}
+
+string TimeFormatter::FormatNow(bool coarse) const
+{
+    return Format(CurrentTimeAsTime_point(coarse));
+}
+
+//
+// StringToTime_t
+// parses a local time with the same strftime style format used by Time_t_ToString
+//
+bool StringToTime_t(const string& str, time_t* t, const string& format)
+{
+    struct tm tm_buf {};
+    istringstream in(str);
+    in >> get_time(&tm_buf, (format != "") ? format.c_str() : "%a %b %d %H:%M:%S %Y");
+    if (in.fail())
+        return false;
+    in >> ws;
+    if (!in.eof())
+        return false;       // extra text after the time
+
+    tm_buf.tm_isdst = -1;   // let mktime work out daylight saving time
+    time_t result = mktime(&tm_buf);
+    if (result == -1)
+        return false;
+    *t = result;
+    return true;
+}
+
                 //*******************************
                 //           Sleep
                 //*******************************
@@ -99,4 +395,240 @@ void Sleep_MicroSeconds(int delay) {
     this_thread::sleep_for(chrono::microseconds(delay));
 }
 
+//
+// Sleep_Until
+//
+void Sleep_Until(chrono::steady_clock::time_point deadline) {
+    thread_local PreciseSleeper sleeper;
+    sleeper.SleepUntil(deadline);
+}
+
+                //*******************************
+                //           PreciseSleeper
+                //*******************************
+
+// tell the CPU this is a spin wait
+static inline void cpuPause()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    __yield();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+//
+// PreciseSleeper
+//
+PreciseSleeper::PreciseSleeper()
+    : overshootMean(500'000.0), overshootVariance(250'000.0 * 250'000.0)       // a 1ms margin until it's measured
+{
+#if defined(_WIN32)
+    waitTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (waitTimer == nullptr)   // before Windows 10 1803
+        waitTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+#endif
+}
+
+PreciseSleeper::~PreciseSleeper()
+{
+#if defined(_WIN32)
+    if (waitTimer != nullptr)
+        CloseHandle(waitTimer);
+#endif
+}
+
+//
+// Margin - the overshoot's mean plus 2 standard deviations
+//
+chrono::nanoseconds PreciseSleeper::Margin() const
+{
+    double margin = overshootMean + 2.0 * sqrt(overshootVariance);
+    return chrono::nanoseconds(margin > 0.0 ? llround(margin) : 0);
+}
+
+//
+// SleepUntil - sleep to the margin before deadline, measuring how late each sleep wakes, then spin
+//
+void PreciseSleeper::SleepUntil(chrono::steady_clock::time_point deadline)
+{
+    auto now = chrono::steady_clock::now();
+    auto start = now;
+    for (;;) {
+        int64_t margin = Margin().count();
+        int64_t request = chrono::duration_cast<chrono::nanoseconds>(deadline - now).count() - margin;
+        if (request <= 0)
+            break;
+        SleepOs(request);
+        auto woke = chrono::steady_clock::now();
+
+        // a sleep preempted for a whole time slice would widen the margin for a long while, so it's only
+        // counted as twice the margin.  the margin still grows quickly to a timer that's always coarse.
+        double overshoot = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(woke - now).count() - request);
+        overshoot = min(overshoot, static_cast<double>(max<int64_t>(2 * margin, 2'000'000)));
+        double delta = overshoot - overshootMean;
+        overshootMean += delta / 16.0;
+        overshootVariance = (overshootVariance + delta * delta / 16.0) * 15.0 / 16.0;
+        now = woke;
+    }
+
+    auto spinStart = now;
+    while (now < deadline) {
+        cpuPause();
+        now = chrono::steady_clock::now();
+    }
+    sleptNs += chrono::duration_cast<chrono::nanoseconds>(spinStart - start).count();
+    spunNs += chrono::duration_cast<chrono::nanoseconds>(now - spinStart).count();
+}
+
+//
+// SleepOs
+//
+void PreciseSleeper::SleepOs(int64_t ns)
+{
+#if defined(_WIN32)
+    if (waitTimer != nullptr) {
+        LARGE_INTEGER due;
+        due.QuadPart = -max<int64_t>(ns / 100, 1);     // relative, in 100ns
+        if (SetWaitableTimer(waitTimer, &due, 0, nullptr, nullptr, FALSE)) {
+            WaitForSingleObject(waitTimer, INFINITE);
+            return;
+        }
+    }
+#endif
+    this_thread::sleep_for(chrono::nanoseconds(ns));
+}
+
+                //*******************************
+                //           FramePacer
+                //*******************************
+
+//
+// FramePacer
+//
+FramePacer::FramePacer(double _rateHz)
+    : recent(recentSize, 0.0f)
+{
+    SetRate(_rateHz);
+}
+
+//
+// SetRate
+//
+void FramePacer::SetRate(double _rateHz)
+{
+    rateHz = _rateHz > 0.0 ? _rateHz : 0.0;
+    periodNs = rateHz > 0.0 ? llround(1e9 / rateHz) : 0;
+    started = false;
+}
+
+//
+// Wait
+//
+void FramePacer::Wait()
+{
+    auto now = chrono::steady_clock::now();
+    if (started && periodNs != 0) {
+        if (now < deadline) {
+            sleeper.SleepUntil(deadline);
+            now = chrono::steady_clock::now();
+        } else {
+            ++missed;
+        }
+        int64_t late = chrono::duration_cast<chrono::nanoseconds>(now - deadline).count();
+        lateTotalNs += late;
+        lateMaxNs = max(lateMaxNs, late);
+        ++waits;
+        // a period after the deadline, not after now, unless it's so late there's no catching up
+        deadline = late > periodNs ? now + chrono::nanoseconds(periodNs) : deadline + chrono::nanoseconds(periodNs);
+    }
+
+    if (started) {
+        int64_t frameNs = chrono::duration_cast<chrono::nanoseconds>(now - lastFrame).count();
+        frameTimes.Record(static_cast<uint64_t>(frameNs));
+        frameSquares += static_cast<double>(frameNs) * static_cast<double>(frameNs);
+        recent[recentNext] = static_cast<float>(frameNs / 1e6);
+        recentNext = (recentNext + 1) % recentSize;
+    } else {
+        started = true;
+        deadline = now + chrono::nanoseconds(periodNs);
+    }
+    lastFrame = now;
+}
+
+//
+// Stats
+//
+FrameStats FramePacer::Stats() const
+{
+    FrameStats stats;
+    stats.frames = frameTimes.Count();
+    stats.missed = missed;
+    stats.rateHz = rateHz;
+    if (stats.frames != 0) {
+        double mean = frameTimes.Mean();
+        stats.meanMs = mean / 1e6;
+        stats.minMs = frameTimes.Min() / 1e6;
+        stats.maxMs = frameTimes.Max() / 1e6;
+        stats.p50Ms = frameTimes.Percentile(50) / 1e6;
+        stats.p99Ms = frameTimes.Percentile(99) / 1e6;
+        stats.jitterMs = sqrt(max(frameSquares / static_cast<double>(stats.frames) - mean * mean, 0.0)) / 1e6;
+    }
+    if (waits != 0) {
+        stats.lateMeanMs = static_cast<double>(lateTotalNs) / static_cast<double>(waits) / 1e6;
+        stats.lateMaxMs = lateMaxNs / 1e6;
+    }
+    stats.marginMs = sleeper.Margin().count() / 1e6;
+    int64_t waited = sleeper.Slept().count() + sleeper.Spun().count();
+    stats.spinFraction = waited != 0 ? static_cast<double>(sleeper.Spun().count()) / static_cast<double>(waited) : 0.0;
+    return stats;
+}
+
+//
+// RecentFrameTimes
+//
+vector<float> FramePacer::RecentFrameTimes() const
+{
+    size_t count = static_cast<size_t>(min<uint64_t>(frameTimes.Count(), recentSize));
+    vector<float> times;
+    times.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        times.push_back(recent[(recentNext + recentSize - count + i) % recentSize]);
+    return times;
+}
+
+//
+// StatsText
+//
+string FramePacer::StatsText() const
+{
+    FrameStats stats = Stats();
+    string text = stats.rateHz > 0.0 ? format("{:.1f} Hz", stats.rateHz) : string("unpaced");
+    text += format("  frames {}  missed {}  mean {:.3f}ms  min {:.3f}  p50 {:.3f}  p99 {:.3f}  max {:.3f}  jitter {:.3f}ms",
+                   stats.frames, stats.missed, stats.meanMs, stats.minMs, stats.p50Ms, stats.p99Ms, stats.maxMs, stats.jitterMs);
+    if (stats.rateHz > 0.0)
+        text += format("  late {:.3f}ms mean {:.3f} max  margin {:.3f}ms  spin {:.1f}%",
+                       stats.lateMeanMs, stats.lateMaxMs, stats.marginMs, stats.spinFraction * 100.0);
+    return text;
+}
+
+//
+// ResetStats
+//
+void FramePacer::ResetStats()
+{
+    frameTimes.Reset();
+    frameSquares = 0.0;
+    missed = 0;
+    waits = 0;
+    lateTotalNs = 0;
+    lateMaxNs = 0;
+    fill(recent.begin(), recent.end(), 0.0f);
+    recentNext = 0;
+}
+
 }
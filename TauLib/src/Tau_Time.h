@@ -7,23 +7,206 @@
 
 #include <thread>
 #include <chrono>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <ctime>
+#include "Tau_Histogram.h"
 
 namespace Tau {
 
-// get current time
+// get current time.  coarse reads the clock the kernel updates each tick (CLOCK_REALTIME_COARSE through the vDSO on
+// Linux, GetSystemTimeAsFileTime on Windows): a few ms resolution at a fraction of the cost.
 time_t CurrentTimeAsTime_t();
-std::chrono::system_clock::time_point CurrentTimeAsTime_point();
+std::chrono::system_clock::time_point CurrentTimeAsTime_point(bool coarse=false);
 
-// time to string
+// time to string.  format is a strftime format, "" is the default ctime() format.  uses TimeFormatter.
 std::string Time_t_ToString(time_t t=0, const std::string& format="");
 std::string CurrentTime_ToString(const std::string& format="");
 
-// delay routines
+///
+/// @brief TimeFormatter - formats local times quickly, for stamping log lines and CSV rows
+/// @remark The strftime format is compiled once into a list of ops.  The numbers (%Y %m %d %H %M %S and the like)
+///         are written directly, the locale dependent conversions (%a %b %p %c %Z ...) are passed to strftime.
+///         %L, %f and %N add the milliseconds, microseconds and nanoseconds, which strftime can't.
+/// @remark Each thread keeps the text of the last second each formatter formatted, so stamping the current time
+///         is a copy plus the sub-second digits.  localtime_r (localtime_s on Windows) is only called when the second
+///         changes.  A change of time zone while running isn't seen until the next second.
+/// @remark Thread safe.  The Format() that take a buffer don't allocate.
+/// @code
+///     TimeFormatter stamp("%Y-%m-%d %H:%M:%S.%L ");
+///     char line[256];
+///     size_t length = stamp.FormatNow(line, sizeof(line), true);
+/// @endcode
+///
+class TimeFormatter {
+public:
+    explicit TimeFormatter(const std::string& format = "");
+
+    /// @brief write the text and a 0 to buffer, cut to fit
+    /// @return the length of the whole text, like snprintf.  size or more means it was cut.  0 if the time couldn't
+    ///         be converted to local time.
+    size_t Format(std::chrono::system_clock::time_point when, char* buffer, size_t size) const;
+    size_t Format(time_t t, char* buffer, size_t size) const;
+    size_t FormatNow(char* buffer, size_t size, bool coarse = false) const;
+
+    std::string Format(std::chrono::system_clock::time_point when) const;
+    std::string Format(time_t t) const;
+    std::string FormatNow(bool coarse = false) const;
+
+    const std::string& FormatString() const { return format; }
+
+private:
+    struct Op {
+        enum Kind : uint8_t { Text, Year, Year2, Month, Day, DaySpace, Hour, Hour12, Minute, Second, DayOfYear,
+                              Strftime, Millis, Micros, Nanos };
+        Kind kind;
+        std::string text;           // Text's text, Strftime's conversion
+    };
+    struct SecondText;
+
+    const SecondText* Render(int64_t second) const;
+    size_t Write(const SecondText& second, int64_t ns, char* buffer, size_t size) const;
+
+    std::string format;
+    std::vector<Op> ops;
+    uint64_t id;                    // the formatter the thread's cached text is for
+};
+
+// string to time.  the inverse of Time_t_ToString.  format "" is the default ctime() format.
+// returns false if the whole string doesn't match the format.
+bool StringToTime_t(const std::string& str, time_t* t, const std::string& format="");
+
+// delay routines.  they block the thread.  for timeouts that shouldn't, see TimerWheel (Tau_TimerWheel.h).
+// they wake when the scheduler gets round to it: up to a ms late on Linux, 1 to 15ms on Windows.
 void Sleep_Minutes(int delay);
 void Sleep_Seconds(int delay);
 void Sleep_MilliSeconds(int delay);
 void Sleep_MicroSeconds(int delay);
+
+// sleep until deadline, waking within a few us of it.  uses the thread's PreciseSleeper.
+void Sleep_Until(std::chrono::steady_clock::time_point deadline);
+
+///
+/// @brief PreciseSleeper - sleeps until a deadline, then spins the last bit so it wakes within a few us
+/// @remark The OS wakes a sleep late by its timer slack and the scheduler's latency.  Each sleep's overshoot is
+///         measured, and a running mean plus 2 standard deviations of it kept.  A wait sleeps until that margin before
+///         the deadline, then spins (with a pause instruction, easy on the other hyperthread) the rest of the way.
+///         The margin follows the machine: a quiet Linux box needs ~60us, Windows ~500us with the high resolution
+///         waitable timer (Windows 10 1803 and later), a loaded one more.
+/// @remark Not thread safe.  Use one per thread.
+///
+class PreciseSleeper {
+public:
+    PreciseSleeper();
+    ~PreciseSleeper();
+
+    PreciseSleeper(const PreciseSleeper&) = delete;
+    PreciseSleeper& operator = (const PreciseSleeper&) = delete;
+
+    void SleepUntil(std::chrono::steady_clock::time_point deadline);
+    template <class Rep, class Period>
+    void SleepFor(std::chrono::duration<Rep, Period> delay) {
+        SleepUntil(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay));
+    }
+
+    /// @brief how long before a deadline the sleeping stops and the spinning starts
+    std::chrono::nanoseconds Margin() const;
+    /// @brief the time spent sleeping and spinning so far.  spinning is the CPU burnt.
+    std::chrono::nanoseconds Slept() const { return std::chrono::nanoseconds(sleptNs); }
+    std::chrono::nanoseconds Spun() const { return std::chrono::nanoseconds(spunNs); }
+
+private:
+    void SleepOs(int64_t ns);
+
+    double overshootMean;           // ns
+    double overshootVariance;
+    int64_t sleptNs {0};
+    int64_t spunNs {0};
+#if defined(_WIN32)
+    void* waitTimer {nullptr};
+#endif
+};
+
+///
+/// @brief the frame times of a FramePacer.  times in ms.
+///
+struct FrameStats {
+    uint64_t frames {0};            ///< frames measured
+    uint64_t missed {0};            ///< frames that ended after their deadline
+    double rateHz {0.0};            ///< the rate paced to.  0 is unpaced.
+    double meanMs {0.0};            ///< frame to frame
+    double minMs {0.0};
+    double maxMs {0.0};
+    double p50Ms {0.0};
+    double p99Ms {0.0};
+    double jitterMs {0.0};          ///< the standard deviation of the frame times
+    double lateMeanMs {0.0};        ///< how late Wait() returned after the deadline
+    double lateMaxMs {0.0};
+    double marginMs {0.0};          ///< the sleeper's spin margin
+    double spinFraction {0.0};      ///< of the time waited, how much was spun
+};
+
+///
+/// @brief FramePacer - holds a render loop to a steady frame rate
+/// @remark Call Wait() once a frame, just before presenting it.  It waits for the frame's deadline with a
+///         PreciseSleeper, so the frames are the period apart to within a few us, without vsync and without
+///         spinning the whole wait.  The deadlines are a period apart, not a period after Wait() returned, so they
+///         don't drift.  A frame over its deadline counts as missed and the next deadline is still the period after
+///         it, so a slow frame is caught up on.  A frame more than a period late starts the deadlines again from now.
+/// @remark A rate of 0 doesn't wait, only measures: for a loop paced by vsync.  Don't pace a vsync'd renderer as
+///         well; the two clocks drift apart and a frame is dropped each time they cross.
+/// @remark The frame times go into a histogram and the last 240 into a ring, for Stats() and plotting.
+/// @code
+///     FramePacer pacer(win.RefreshRate() != 0 ? win.RefreshRate() : 60);
+///     while (!done) {
+///         ... events, ImGui_NewFrame, build the frame ...
+///         ImGui_Render(win.window, win.renderer, &pacer);     // calls pacer.Wait() before SDL_RenderPresent
+///     }
+///     FrameStats stats = pacer.Stats();
+/// @endcode
+///
+class FramePacer {
+public:
+    explicit FramePacer(double rateHz = 60.0);
+
+    /// @brief frames a second.  0 doesn't wait.
+    void SetRate(double rateHz);
+    double Rate() const { return rateHz; }
+    std::chrono::nanoseconds Period() const { return std::chrono::nanoseconds(periodNs); }
+
+    /// @brief wait until the current frame's deadline, and measure it
+    void Wait();
+    /// @brief start the deadlines again from the next Wait(), after a pause say
+    void Restart() { started = false; }
+
+    FrameStats Stats() const;
+    /// @brief the frame times as a histogram, in ns
+    const HistogramCounts& FrameTimes() const { return frameTimes; }
+    /// @brief the last frame times, oldest first, in ms.  for ImGui::PlotLines.
+    std::vector<float> RecentFrameTimes() const;
+    /// @brief the stats on a line
+    std::string StatsText() const;
+    void ResetStats();
+
+private:
+    static constexpr size_t recentSize = 240;
+
+    double rateHz {0.0};
+    int64_t periodNs {0};
+    bool started {false};
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point lastFrame;
+    PreciseSleeper sleeper;
+
+    // stats
+    HistogramCounts frameTimes;
+    double frameSquares {0.0};      // ns^2, for the jitter
+    uint64_t missed {0};
+    uint64_t waits {0};
+    int64_t lateTotalNs {0};
+    int64_t lateMaxNs {0};
+    std::vector<float> recent;
+    size_t recentNext {0};
+};
 }
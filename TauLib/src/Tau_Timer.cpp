@@ -1,12 +1,11 @@
 // from https://www.youtube.com/watch?v=oEx5vGNFrLk and modified
 
 #include "Tau_Timer.h"
+#include <format>
 #include <iostream>
 
 using namespace std;
 
-using namespace std::literals::chrono_literals;
-
 //
 // To time an event, create a Tau_Timer object at the start of the event, and it will print the duration when it goes out of scope.
 // To time an function put Tau_Timer timer(__FUNCTION__) at the start of the function.
@@ -14,28 +13,72 @@ using namespace std::literals::chrono_literals;
 // Or put Timer timer("some other text"); anywhere you want.
 //
 
-int Tau_Timer::nesting_level {0};
+thread_local int Tau_Timer::nesting_level {0};
+
+// the profiler zone for a timer.  none while the profiler is off.  the last one is kept per thread so a timer in a
+// loop doesn't go to the registry (a lock and a map lookup) every time.
+static uint32_t timerZone(string_view text, string_view filename, int lineNum)
+{
+    if (!TAU_PROFILER_ENABLED || !Tau::Profiler::IsEnabled())
+        return Tau::ProfileScope::noZone;
+    thread_local string lastText, lastFilename;
+    thread_local int lastLineNum {-1};
+    thread_local uint32_t lastZone {0};
+    if (lineNum == lastLineNum && text == lastText && filename == lastFilename)
+        return lastZone;
+    lastZone = Tau::Profiler::RegisterZone(text.empty() ? string("Tau_Timer") : string(text), string(filename), lineNum);
+    lastText = text;
+    lastFilename = filename;
+    lastLineNum = lineNum;
+    return lastZone;
+}
 
 // start the timer
-Tau_Timer::Tau_Timer(const string& _text, const string& _filename, int _lineNum) 
-         : text { _text }, filename{_filename}, lineNum{_lineNum} {
-#ifdef _DEBUG
+Tau_Timer::Tau_Timer(string_view _text, string_view _filename, int _lineNum)
+         : Tau_Timer(timerZone(_text, _filename, _lineNum), _text, _filename, _lineNum)
+{
+}
+
+// start the timer with its profiler zone already registered (TAU_TIMER)
+Tau_Timer::Tau_Timer(uint32_t zone, string_view _text, string_view _filename, int _lineNum)
+#if TAU_PROFILER_ENABLED
+         : scope(zone)
+#endif
+{
+    (void)zone;
     start = std::chrono::steady_clock::now();
     last = start;
 
+#ifdef _DEBUG
+    text = _text;
+    filename = _filename;
+    lineNum = _lineNum;
     string indent(nesting_level * 2, ' ');
-    auto [duration_ms, delta_ms] = GetDurationAndDelta();
     if (filename != "")
         std::cout << indent << text << " START" << " file = " << filename << " line " << lineNum << std::endl;
     else
         std::cout << indent << text << " START" << std::endl;
 
     ++nesting_level;
+#else
+    (void)_text;
+    (void)_filename;
+    (void)_lineNum;
 #endif
   }
 
+// start the timer, and record its duration into histogram too.  named after the histogram if there's no text.
+Tau_Timer::Tau_Timer(Tau::Histogram& _histogram, string_view _text, string_view _filename, int _lineNum)
+         : Tau_Timer(_text.empty() ? string_view(_histogram.Name()) : _text, _filename, _lineNum)
+{
+    histogram = &_histogram;
+}
+
 // output the duration of the timer object
 Tau_Timer::~Tau_Timer() {
+    if (histogram != nullptr)
+        histogram->RecordDuration(std::chrono::steady_clock::now() - start);
+
 #ifdef _DEBUG
     --nesting_level;
 
@@ -51,7 +94,6 @@ Tau_Timer::~Tau_Timer() {
 // return the current duration in milliseconds
 pair<float, float> Tau_Timer::GetDurationAndDelta() {
 #ifdef _DEBUG
-    string indent(nesting_level * 2, ' ');
     auto now = std::chrono::steady_clock::now();
     auto duration = now - start;
     auto delta = now - last;
@@ -75,31 +117,3 @@ void Tau_Timer::printDurationNow(const string& _text, const string& _filename, i
         std::cout << format("{}{} duration = {:g} ms delta = {:g} ms", indent, _text, duration_ms, delta_ms) << std::endl;
 #endif
 }
-
-#if 0
-void Function2() {
-    Tau_Timer timer(__FUNCTION__);
-    std::this_thread::sleep_for(2s);
-    // dtor should output approx 2 seconds
-}
-
-void Function1() {
-   Tau_Timer timer(__FUNCTION__);
-    Function2();
-    std::this_thread::sleep_for(1s);
-    // dtor should output approx 3 seconds
-}
-
-
-void Tau_TimerTest() {
-    Tau_Timer timer(__FUNCTION__);
-    Function1();
-    std::this_thread::sleep_for(5s);
-    timer.printDurationNow("should be 8");
-    std::this_thread::sleep_for(500ms);
-    timer.printDurationNow("should be 8.5");
-    std::this_thread::sleep_for(500ms);
-    // dtor should output approx 8 seconds
-}
-#endif
-
@@ -4,26 +4,53 @@
 
 #include <chrono>
 #include <string>
+#include <string_view>
 #include <iostream>
+#include "Tau_Histogram.h"
+#include "Tau_Profiler.h"
 
 //
 // To time an event, create a Tau_Timer object at the start of the event, and it will print the duration when it goes out of scope.
 // To time an function put Tau_Timer timer(__FUNCTION__) at the start of the function.
 // Or put Tau_Timer timer(__FUNCTION__, __FILE__, __LINE__) at the start of the function.
 // Or put Timer timer("some other text"); anywhere you want.
+// In _DEBUG builds it prints.  In every build it's also recorded as a Tau::Profiler zone named text (see
+// Tau_Profiler.h), looked up only while the profiler is enabled and not again for the same timer twice in a row on a
+// thread.  Or put TAU_TIMER("text") where the cost matters: the zone is looked up once for that line, like
+// TAU_PROFILE_ZONE.
+// Or put Tau_Timer timer(histogram) to also record the duration in ns into a Tau::Histogram (see Tau_Histogram.h),
+// to get percentiles over many runs.
+// TauLib_Bench has a benchmark of Tau_Timer (see Tau_Bench.h).
 //
 struct Tau_Timer {
     std::chrono::time_point<std::chrono::steady_clock> start, last;
-    std::string text, filename;
-    int lineNum;
-    static int nesting_level;
+#ifdef _DEBUG
+    std::string text, filename;         // only kept where they're printed
+    int lineNum {0};
+#endif
+    Tau::Histogram* histogram {nullptr};
+    static thread_local int nesting_level;
+#if TAU_PROFILER_ENABLED
+    Tau::ProfileScope scope;
+#endif
 
-    Tau_Timer(const std::string& _text="", const std::string& _filename = "", int _lineNum = 0);
+    Tau_Timer(std::string_view _text="", std::string_view _filename = "", int _lineNum = 0);
+    /// @brief with its Tau::Profiler zone already registered.  see TAU_TIMER.
+    Tau_Timer(uint32_t zone, std::string_view _text, std::string_view _filename = "", int _lineNum = 0);
+    Tau_Timer(Tau::Histogram& _histogram, std::string_view _text="", std::string_view _filename = "", int _lineNum = 0);
     ~Tau_Timer();
 
     std::pair<float, float> GetDurationAndDelta();
     void printDurationNow(const std::string& _text="", const std::string& _filename = "", int _lineNum = 0);
 };
 
-void Tau_TimerTest();
-
+//
+// TAU_TIMER - a Tau_Timer for the rest of the scope named text, its profiler zone registered once for the line
+//
+#if TAU_PROFILER_ENABLED
+#define TAU_TIMER(text) \
+    static const uint32_t TAU_PROFILE_CONCAT(tauTimerZone, __LINE__) = ::Tau::Profiler::RegisterZone(text, __FILE__, __LINE__); \
+    Tau_Timer TAU_PROFILE_CONCAT(tauTimer, __LINE__)(TAU_PROFILE_CONCAT(tauTimerZone, __LINE__), text, __FILE__, __LINE__)
+#else
+#define TAU_TIMER(text) Tau_Timer TAU_PROFILE_CONCAT(tauTimer, __LINE__)(text, __FILE__, __LINE__)
+#endif
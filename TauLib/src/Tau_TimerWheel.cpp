@@ -0,0 +1,375 @@
+///
+/// @file
+/// @brief CPP file for TimerWheel, many timeouts run from one thread in a hierarchical timer wheel.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_TimerWheel.h"
+#include "Tau_ThreadPool.h"
+#include <algorithm>
+#include <bit>
+
+#if defined(_WIN32)
+#include "windows.h"
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#if defined(__linux__)
+#include <sys/prctl.h>
+#endif
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+//
+// TimerWheel
+//
+TimerWheel::TimerWheel(ThreadPool* _executor, chrono::microseconds tick)
+    : executor(_executor),
+      tickNs(max<int64_t>(chrono::duration_cast<chrono::nanoseconds>(tick).count(), 1000)),
+      origin(chrono::steady_clock::now())
+{
+    heads.fill(none);
+#if defined(_WIN32)
+    waitTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (waitTimer == nullptr)   // before Windows 10 1803
+        waitTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    wakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#else
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    thread = std::thread(&TimerWheel::Run, this);
+}
+
+TimerWheel::~TimerWheel()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    Wake();
+    thread.join();
+#if defined(_WIN32)
+    CloseHandle(waitTimer);
+    CloseHandle(wakeEvent);
+#else
+    close(timerFd);
+    close(wakeFd);
+#endif
+}
+
+                //*******************************
+                // Timers
+                //*******************************
+
+//
+// Add
+//
+TimerId TimerWheel::Add(chrono::steady_clock::time_point when, chrono::nanoseconds period, Callback callback)
+{
+    lock_guard<mutex> guard(lock);
+    uint32_t index = freeList;
+    if (index != none) {
+        freeList = timers[index].next;
+    } else {
+        index = static_cast<uint32_t>(timers.size());
+        timers.emplace_back();
+    }
+    Timer& timer = timers[index];
+    timer.callback = make_shared<Callback>(move(callback));
+    timer.expiry = TickOf(when, true);
+    timer.periodTicks = period.count() > 0 ? max<uint64_t>((period.count() + tickNs - 1) / tickNs, 1) : 0;
+    Place(index);
+    ++pending;
+
+    // wake the thread if it's waiting for a later tick
+    if (timer.expiry < wakeTick)
+        Wake();
+    return (static_cast<uint64_t>(timer.generation) << 32) | index;
+}
+
+//
+// Cancel
+//
+bool TimerWheel::Cancel(TimerId id)
+{
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    lock_guard<mutex> guard(lock);
+    if (index >= timers.size() || timers[index].generation != generation || timers[index].list == none)
+        return false;
+    Unlink(index);
+    Free(index);
+    --pending;
+    return true;
+}
+
+//
+// Pending
+//
+size_t TimerWheel::Pending() const
+{
+    lock_guard<mutex> guard(lock);
+    return pending;
+}
+
+//
+// TickOf - the wheel tick a time is in, or the first at or after it
+//
+uint64_t TimerWheel::TickOf(chrono::steady_clock::time_point when, bool roundUp) const
+{
+    int64_t ns = chrono::duration_cast<chrono::nanoseconds>(when - origin).count();
+    if (ns <= 0)
+        return 0;
+    return static_cast<uint64_t>(roundUp ? (ns + tickNs - 1) / tickNs : ns / tickNs);
+}
+
+//
+// Place - put a timer in the lowest wheel whose slots above it agree with current's
+//
+void TimerWheel::Place(uint32_t index)
+{
+    Timer& timer = timers[index];
+    timer.expiry = max(timer.expiry, current);
+    for (int level = 0; level < levels; ++level) {
+        int shift = slotBits * level;
+        if (((timer.expiry ^ current) >> (shift + slotBits)) == 0) {
+            Link(index, level * slots + static_cast<uint32_t>((timer.expiry >> shift) & (slots - 1)));
+            return;
+        }
+    }
+    Link(index, overflow);
+}
+
+//
+// Link - to the front of a slot's list
+//
+void TimerWheel::Link(uint32_t index, uint32_t list)
+{
+    Timer& timer = timers[index];
+    timer.list = list;
+    timer.prev = none;
+    timer.next = heads[list];
+    if (timer.next != none)
+        timers[timer.next].prev = index;
+    heads[list] = index;
+    if (list < overflow)
+        occupied[list / 64] |= uint64_t(1) << (list % 64);
+}
+
+//
+// Unlink
+//
+void TimerWheel::Unlink(uint32_t index)
+{
+    Timer& timer = timers[index];
+    if (timer.prev != none)
+        timers[timer.prev].next = timer.next;
+    else
+        heads[timer.list] = timer.next;
+    if (timer.next != none)
+        timers[timer.next].prev = timer.prev;
+    if (heads[timer.list] == none && timer.list < overflow)
+        occupied[timer.list / 64] &= ~(uint64_t(1) << (timer.list % 64));
+    timer.list = none;
+    timer.prev = none;
+    timer.next = none;
+}
+
+//
+// Free - back on the free list.  the new generation makes its old id stale.
+//
+void TimerWheel::Free(uint32_t index)
+{
+    Timer& timer = timers[index];
+    timer.callback.reset();
+    if (++timer.generation == 0)
+        timer.generation = 1;
+    timer.next = freeList;
+    freeList = index;
+}
+
+//
+// NextWorkTick - the first tick from current that runs timers or moves them down a wheel.  UINT64_MAX if none.
+//
+uint64_t TimerWheel::NextWorkTick() const
+{
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < levels; ++level) {
+        int shift = slotBits * level;
+        uint32_t position = static_cast<uint32_t>((current >> shift) & (slots - 1));
+        // a higher wheel's slot at current was moved down when current reached it, unless current is its first tick
+        bool atSlotStart = (current & ((uint64_t(1) << shift) - 1)) == 0;
+        uint32_t from = level == 0 || atSlotStart ? position : position + 1;
+        for (uint32_t slot = from; slot < slots; ) {
+            uint32_t bit = level * slots + slot;
+            uint64_t word = occupied[bit / 64] >> (bit % 64);
+            if (word == 0) {
+                slot = (slot | 63) + 1;
+                continue;
+            }
+            slot += static_cast<uint32_t>(countr_zero(word));
+            uint64_t wheelStart = (current >> (shift + slotBits)) << (shift + slotBits);
+            next = min(next, wheelStart | (static_cast<uint64_t>(slot) << shift));
+            break;
+        }
+    }
+    if (heads[overflow] != none) {
+        // the next time the top wheel comes round, which may be current
+        int shift = slotBits * levels;
+        next = min(next, ((current + (uint64_t(1) << shift) - 1) >> shift) << shift);
+    }
+    return next;
+}
+
+//
+// RunTick - move the timers in the slots starting at tick down a wheel, then take the timers due in it
+//
+void TimerWheel::RunTick(uint64_t tick, uint64_t nowTick, vector<shared_ptr<Callback>>* due)
+{
+    auto detach = [&](uint32_t list) {
+        uint32_t index = heads[list];
+        heads[list] = none;
+        if (list < overflow)
+            occupied[list / 64] &= ~(uint64_t(1) << (list % 64));
+        return index;
+    };
+
+    // highest first, so a timer can move down more than one wheel at once
+    for (int level = levels; level > 0; --level) {
+        int shift = slotBits * level;
+        if ((tick & ((uint64_t(1) << shift) - 1)) != 0)
+            continue;
+        uint32_t list = level == levels ? overflow : (level * slots + static_cast<uint32_t>((tick >> shift) & (slots - 1)));
+        for (uint32_t index = detach(list); index != none; ) {
+            uint32_t next = timers[index].next;
+            Place(index);
+            index = next;
+        }
+    }
+
+    for (uint32_t index = detach(static_cast<uint32_t>(tick & (slots - 1))); index != none; ) {
+        Timer& timer = timers[index];
+        uint32_t next = timer.next;
+        timer.list = none;
+        due->push_back(timer.callback);
+        if (timer.periodTicks != 0) {
+            timer.expiry += timer.periodTicks;
+            if (timer.expiry <= nowTick)
+                timer.expiry += ((nowTick - timer.expiry) / timer.periodTicks + 1) * timer.periodTicks;
+            Place(index);
+        } else {
+            Free(index);
+            --pending;
+        }
+        index = next;
+    }
+}
+
+                //*******************************
+                // Thread
+                //*******************************
+
+//
+// Run
+//
+void TimerWheel::Run()
+{
+#if defined(__linux__)
+    prctl(PR_SET_TIMERSLACK, 1UL);      // the default 50us slack would be half the tick
+#endif
+    vector<shared_ptr<Callback>> due;
+    unique_lock<mutex> guard(lock);
+    while (!stopping) {
+        uint64_t nowTick = TickOf(chrono::steady_clock::now(), false);
+        for (uint64_t tick = NextWorkTick(); tick <= nowTick; tick = NextWorkTick()) {
+            current = tick;
+            RunTick(tick, nowTick, &due);
+            current = tick + 1;
+        }
+        // nothing to do up to now
+        current = max(current, nowTick + 1);
+
+        if (!due.empty()) {
+            guard.unlock();
+            for (auto& callback : due) {
+                if (executor != nullptr)
+                    executor->Post([callback] { (*callback)(); });
+                else
+                    (*callback)();
+            }
+            due.clear();
+            guard.lock();
+            continue;
+        }
+
+        wakeTick = NextWorkTick();
+        uint64_t until = wakeTick;
+        guard.unlock();
+        WaitUntil(until);
+        guard.lock();
+        wakeTick = 0;       // awake.  Add() needn't wake it, it looks again before waiting.
+    }
+}
+
+//
+// Wake
+//
+void TimerWheel::Wake()
+{
+#if defined(_WIN32)
+    SetEvent(wakeEvent);
+#else
+    uint64_t one = 1;
+    (void)!write(wakeFd, &one, sizeof(one));
+#endif
+}
+
+//
+// WaitUntil - the start of tick, or Wake()
+//
+void TimerWheel::WaitUntil(uint64_t tick)
+{
+    chrono::steady_clock::time_point deadline = origin + chrono::nanoseconds(static_cast<int64_t>(tick) * tickNs);
+#if defined(_WIN32)
+    if (tick == UINT64_MAX) {
+        WaitForSingleObject(wakeEvent, INFINITE);
+        return;
+    }
+    int64_t wait = chrono::duration_cast<chrono::nanoseconds>(deadline - chrono::steady_clock::now()).count();
+    if (wait <= 0)
+        return;
+    LARGE_INTEGER due;
+    due.QuadPart = -max<int64_t>(wait / 100, 1);       // relative, in 100ns
+    SetWaitableTimer(waitTimer, &due, 0, nullptr, nullptr, FALSE);
+    HANDLE handles[2] = { wakeEvent, waitTimer };
+    WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+#else
+    // steady_clock is CLOCK_MONOTONIC, so the deadline can be set as an absolute time
+    itimerspec spec {};
+    if (tick != UINT64_MAX) {
+        int64_t ns = max<int64_t>(chrono::duration_cast<chrono::nanoseconds>(deadline.time_since_epoch()).count(), 1);
+        spec.it_value.tv_sec = static_cast<time_t>(ns / 1'000'000'000);
+        spec.it_value.tv_nsec = static_cast<long>(ns % 1'000'000'000);
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+    pollfd fds[2] = { { timerFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+    if (poll(fds, 2, -1) > 0) {
+        uint64_t value;
+        if (fds[0].revents != 0)
+            (void)!read(timerFd, &value, sizeof(value));
+        if (fds[1].revents != 0)
+            (void)!read(wakeFd, &value, sizeof(value));
+    }
+#endif
+}
+
+} // end namespace Tau
@@ -0,0 +1,146 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for TimerWheel, many timeouts run from one thread in a hierarchical timer wheel.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+class ThreadPool;
+
+///
+/// @brief a timer's id, for Cancel().  0 is never a timer.
+///
+using TimerId = uint64_t;
+
+///
+/// @brief TimerWheel - runs callbacks after a delay, or every period, with thousands of timers pending at once
+/// @remark The timers are kept in 4 wheels of 256 slots, each slot a list.  A timer goes in the lowest wheel its
+///         time fits in: the first wheel's slots are a tick each, the second's 256 ticks and so on, so at the default
+///         100us tick they cover 25.6ms, 6.5s, 28 minutes and 5 days.  Later timers wait in an overflow list.
+///         Adding and cancelling are O(1).  As time reaches a slot of a higher wheel its timers move down a wheel.
+/// @remark One thread waits (timerfd on Linux, a high resolution waitable timer on Windows) for the next tick with
+///         anything to do, and doesn't wake while nothing is due.  A timer runs in the tick after its time, so
+///         it's late by up to a tick plus the time to wake the thread: about 100us at the default tick.
+/// @remark Callbacks are posted to the executor if there is one, else called on the wheel's thread, where they
+///         should be quick.  They're called without the wheel's lock held, so they may add and cancel timers.
+///         A callback that throws ends the program, the same as a std::thread.
+/// @remark The destructor drops the timers still pending.  Callbacks already posted to the executor still run.
+/// @code
+///     ThreadPool pool;
+///     TimerWheel timers(&pool);
+///     TimerId retry = timers.After(chrono::milliseconds(250), [&] { Download(url); });
+///     TimerId blink = timers.Every(chrono::milliseconds(500), [&] { cursorOn = !cursorOn; });
+///     ...
+///     timers.Cancel(retry);
+/// @endcode
+///
+class TimerWheel {
+public:
+    using Callback = std::function<void ()>;
+
+    /// @param executor runs the callbacks.  nullptr runs them on the wheel's thread.
+    /// @param tick the wheel's resolution
+    explicit TimerWheel(ThreadPool* executor = nullptr, std::chrono::microseconds tick = std::chrono::microseconds(100));
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator = (const TimerWheel&) = delete;
+
+    /// @brief run callback once, delay from now
+    template <class Rep, class Period>
+    TimerId After(std::chrono::duration<Rep, Period> delay, Callback callback) {
+        return Add(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay),
+                   std::chrono::nanoseconds(0), std::move(callback));
+    }
+
+    /// @brief run callback once, at when
+    TimerId At(std::chrono::steady_clock::time_point when, Callback callback) {
+        return Add(when, std::chrono::nanoseconds(0), std::move(callback));
+    }
+
+    /// @brief run callback every period, the first time period from now.  the times don't drift: each is a period
+    ///        after the last was due, not after it ran.  if the wheel falls behind, the periods missed are skipped.
+    template <class Rep, class Period>
+    TimerId Every(std::chrono::duration<Rep, Period> period, Callback callback) {
+        auto step = std::chrono::duration_cast<std::chrono::nanoseconds>(period);
+        return Add(std::chrono::steady_clock::now() + step, step, std::move(callback));
+    }
+
+    /// @brief stop a timer
+    /// @return false if it isn't pending: it has run (a once timer), was cancelled, or never was
+    bool Cancel(TimerId timer);
+
+    /// @brief timers waiting to run
+    size_t Pending() const;
+
+    std::chrono::nanoseconds Tick() const { return std::chrono::nanoseconds(tickNs); }
+
+private:
+    static constexpr int levels = 4;
+    static constexpr int slotBits = 8;
+    static constexpr uint32_t slots = 1 << slotBits;
+    static constexpr uint32_t overflow = levels * slots;        // the list after the wheels' slots
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Timer {
+        std::shared_ptr<Callback> callback;     // shared so a repeating timer's callback isn't copied each time
+        uint64_t expiry {0};                    // the tick it's due in
+        uint64_t periodTicks {0};               // 0 == once
+        uint32_t prev {none};
+        uint32_t next {none};
+        uint32_t list {none};                   // the slot it's in.  none == free.
+        uint32_t generation {1};
+    };
+
+    TimerId Add(std::chrono::steady_clock::time_point when, std::chrono::nanoseconds period, Callback callback);
+    uint64_t TickOf(std::chrono::steady_clock::time_point when, bool roundUp) const;
+    void Place(uint32_t index);
+    void Link(uint32_t index, uint32_t list);
+    void Unlink(uint32_t index);
+    void Free(uint32_t index);
+    uint64_t NextWorkTick() const;
+    void RunTick(uint64_t tick, uint64_t nowTick, std::vector<std::shared_ptr<Callback>>* due);
+    void Run();
+    void Wake();
+    void WaitUntil(uint64_t tick);
+
+    ThreadPool* executor;
+    int64_t tickNs;
+    std::chrono::steady_clock::time_point origin;
+
+    // guarded by lock
+    std::vector<Timer> timers;
+    uint32_t freeList {none};
+    size_t pending {0};
+    std::array<uint32_t, overflow + 1> heads;
+    std::array<uint64_t, levels * slots / 64> occupied {};     // a bit per slot with timers
+    uint64_t current {0};                       // the next tick to run
+    uint64_t wakeTick {UINT64_MAX};             // the tick the thread is waiting for
+    bool stopping {false};
+    mutable std::mutex lock;
+
+    std::thread thread;
+#if defined(_WIN32)
+    void* waitTimer {nullptr};
+    void* wakeEvent {nullptr};
+#else
+    int timerFd {-1};
+    int wakeFd {-1};
+#endif
+};
+
+} // end namespace Tau
@@ -0,0 +1,432 @@
+///
+/// @file
+/// @brief CPP file for TraceExporter, streams Profiler zones and counters to a Chrome JSON or Perfetto trace file.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "Tau_TraceExport.h"
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace Tau {
+
+//
+// Sink - hands what Collect() drains to the exporter
+//
+struct TraceExporter::Sink : ProfileSink {
+    TraceExporter* exporter;
+    explicit Sink(TraceExporter* _exporter) : exporter(_exporter) {}
+    void Consume(const vector<ProfileEvent>& events) override { exporter->Queue(events); }
+};
+
+                //*******************************
+                // Chrome JSON
+                //*******************************
+
+//
+// jsonString - text in double quotes with JSON escapes
+//
+static void jsonString(string* out, string_view text)
+{
+    out->push_back('"');
+    for (char ch : text) {
+        switch (ch) {
+        case '"':  out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20)
+                out->append(format("\\u{:04x}", static_cast<int>(ch)));
+            else
+                out->push_back(ch);
+        }
+    }
+    out->push_back('"');
+}
+
+                //*******************************
+                // Perfetto protobuf
+                //*******************************
+
+// field numbers from perfetto/protos/perfetto/trace
+enum : uint32_t {
+    tracePacket = 1,                                            // Trace
+    packetTimestamp = 8, packetSequenceId = 10, packetTrackEvent = 11, packetSequenceFlags = 13,
+    packetTrackDescriptor = 60,                                 // TracePacket
+    eventType = 9, eventTrackUuid = 11, eventName = 23, eventDoubleCounterValue = 44,   // TrackEvent
+    trackUuid = 1, trackName = 2, trackProcess = 3, trackThread = 4, trackParentUuid = 5, trackCounter = 8,
+    processPid = 1,                                             // ProcessDescriptor
+    threadPid = 1, threadTid = 2, threadName = 5,               // ThreadDescriptor
+};
+enum : uint64_t { sliceBegin = 1, sliceEnd = 2, counterEvent = 4 };     // TrackEvent.Type
+enum : uint64_t { incrementalStateCleared = 1 };                        // TracePacket.SequenceFlags
+static constexpr uint64_t sequenceId = 1;
+
+static void varint(string* out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+static void varintField(string* out, uint32_t field, uint64_t value)
+{
+    varint(out, (field << 3) | 0);
+    varint(out, value);
+}
+
+static void bytesField(string* out, uint32_t field, string_view bytes)
+{
+    varint(out, (field << 3) | 2);
+    varint(out, bytes.size());
+    out->append(bytes);
+}
+
+static void doubleField(string* out, uint32_t field, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    varint(out, (field << 3) | 1);
+    for (int i = 0; i < 8; ++i)
+        out->push_back(static_cast<char>(bits >> (i * 8)));
+}
+
+// the uuids of the tracks
+static uint64_t processTrack(uint64_t pid) { return 0x7461750000000000ULL | (pid << 24); }
+static uint64_t threadTrack(uint64_t pid, uint32_t thread) { return processTrack(pid) + 1 + thread; }
+static uint64_t counterTrack(uint64_t pid, uint32_t counter) { return processTrack(pid) + 0x800000 + counter; }
+
+                //*******************************
+                // TraceExporter
+                //*******************************
+
+//
+// Open
+//
+bool TraceExporter::Open(const string& filePath, TraceFormat _format, chrono::milliseconds _collectInterval,
+                         size_t _maxQueued)
+{
+    Close();
+    if (!file.Open(filePath))
+        return false;
+    format = _format;
+    collectInterval = _collectInterval;
+    maxQueued = max<size_t>(_maxQueued, 1);
+    stopping = false;
+    written = 0;
+    dropped = 0;
+    counterIds.clear();
+    counterNames.clear();
+    zoneNames.clear();
+    threads.clear();
+    counterTracks.clear();
+    firstEvent = true;
+#if defined(_WIN32)
+    pid = static_cast<uint64_t>(_getpid());
+#else
+    pid = static_cast<uint64_t>(getpid());
+#endif
+
+    WriteHeader();
+    sink = make_shared<Sink>(this);
+    Profiler::AddSink(sink);
+    writer = thread(&TraceExporter::Run, this);
+    return true;
+}
+
+//
+// Close
+//
+bool TraceExporter::Close()
+{
+    if (!file.IsOpen())
+        return true;
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+
+    Profiler::Collect();
+    Profiler::RemoveSink(sink);
+    sink.reset();
+    WriteQueued();
+    if (format == TraceFormat::ChromeJson)
+        file.Write("\n]}\n");
+    return file.Close();
+}
+
+//
+// Counter
+//
+void TraceExporter::Counter(const string& name, double value)
+{
+    uint64_t timeNs = Profiler::TicksToNs(Profiler::Now());
+    {
+        lock_guard<mutex> guard(lock);
+        if (stopping)
+            return;
+        if (queuedEvents.size() + queuedSamples.size() >= maxQueued) {
+            ++dropped;
+            return;
+        }
+        auto found = counterIds.find(name);
+        if (found == counterIds.end()) {
+            found = counterIds.emplace(name, static_cast<uint32_t>(counterNames.size())).first;
+            counterNames.push_back(name);
+        }
+        queuedSamples.push_back({ timeNs, found->second, value });
+    }
+    if (collectInterval.count() == 0)
+        wake.notify_all();
+}
+
+//
+// EventsWritten
+//
+uint64_t TraceExporter::EventsWritten() const
+{
+    lock_guard<mutex> guard(lock);
+    return written;
+}
+
+//
+// EventsDropped
+//
+uint64_t TraceExporter::EventsDropped() const
+{
+    lock_guard<mutex> guard(lock);
+    return dropped;
+}
+
+//
+// Queue - from Collect(), on whichever thread called it
+//
+void TraceExporter::Queue(const vector<ProfileEvent>& events)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        size_t queued = queuedEvents.size() + queuedSamples.size();
+        size_t room = (queued < maxQueued) ? maxQueued - queued : 0;
+        size_t taken = min(room, events.size());
+        queuedEvents.insert(queuedEvents.end(), events.begin(), events.begin() + taken);
+        dropped += events.size() - taken;
+    }
+    if (collectInterval.count() == 0)
+        wake.notify_all();
+}
+
+//
+// Run - the writer thread
+//
+void TraceExporter::Run()
+{
+    unique_lock<mutex> guard(lock);
+    while (!stopping) {
+        if (collectInterval.count() > 0)
+            wake.wait_for(guard, collectInterval, [this] { return stopping; });
+        else
+            wake.wait(guard, [this] { return stopping || !queuedEvents.empty() || !queuedSamples.empty(); });
+        guard.unlock();
+        if (collectInterval.count() > 0)
+            Profiler::Collect();
+        WriteQueued();
+        guard.lock();
+    }
+}
+
+//
+// WriteQueued - take what's queued and write it
+//
+void TraceExporter::WriteQueued()
+{
+    vector<ProfileEvent> events;
+    vector<CounterSample> samples;
+    vector<string> newCounters;
+    {
+        lock_guard<mutex> guard(lock);
+        events.swap(queuedEvents);
+        samples.swap(queuedSamples);
+        newCounters.assign(counterNames.begin() + counterTracks.size(), counterNames.end());
+    }
+
+    WriteThreads();
+    // counter tracks
+    for (const string& name : newCounters) {
+        if (format == TraceFormat::Perfetto) {
+            string descriptor, packet;
+            varintField(&descriptor, trackUuid, counterTrack(pid, static_cast<uint32_t>(counterTracks.size())));
+            varintField(&descriptor, trackParentUuid, processTrack(pid));
+            bytesField(&descriptor, trackName, name);
+            bytesField(&descriptor, trackCounter, "");
+            bytesField(&packet, packetTrackDescriptor, descriptor);
+            bytesField(&out, tracePacket, packet);
+        }
+        counterTracks.push_back(name);
+    }
+    if (!events.empty() || !samples.empty())
+        WriteEvents(events, samples);
+
+    if (!out.empty()) {
+        file.Write(out);
+        out.clear();
+    }
+    lock_guard<mutex> guard(lock);
+    written += events.size() + samples.size();
+}
+
+//
+// WriteHeader
+//
+void TraceExporter::WriteHeader()
+{
+    if (format == TraceFormat::ChromeJson) {
+        file.Write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        return;
+    }
+    // the process track, and the start of the sequence the events are on
+    string process, descriptor, packet;
+    varintField(&process, processPid, pid);
+    varintField(&descriptor, trackUuid, processTrack(pid));
+    bytesField(&descriptor, trackProcess, process);
+    varintField(&packet, packetSequenceId, sequenceId);
+    varintField(&packet, packetSequenceFlags, incrementalStateCleared);
+    bytesField(&packet, packetTrackDescriptor, descriptor);
+    bytesField(&out, tracePacket, packet);
+    file.Write(out);
+    out.clear();
+}
+
+//
+// WriteThreads - describe the threads that are new or have been named
+//
+void TraceExporter::WriteThreads()
+{
+    vector<ProfileThreadInfo> now = Profiler::Threads();
+    for (const ProfileThreadInfo& thread : now) {
+        if (thread.index < threads.size() && threads[thread.index].name == thread.name)
+            continue;
+        if (format == TraceFormat::ChromeJson) {
+            if (thread.name.empty())
+                continue;
+            out.append(firstEvent ? "" : ",\n");
+            firstEvent = false;
+            out.append(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":",
+                                   pid, thread.osId));
+            jsonString(&out, thread.name);
+            out.append("}}");
+        } else {
+            string threadDescriptor, descriptor, packet;
+            varintField(&threadDescriptor, threadPid, pid);
+            varintField(&threadDescriptor, threadTid, thread.osId);
+            if (!thread.name.empty())
+                bytesField(&threadDescriptor, threadName, thread.name);
+            varintField(&descriptor, trackUuid, threadTrack(pid, thread.index));
+            varintField(&descriptor, trackParentUuid, processTrack(pid));
+            bytesField(&descriptor, trackThread, threadDescriptor);
+            bytesField(&packet, packetTrackDescriptor, descriptor);
+            bytesField(&out, tracePacket, packet);
+        }
+    }
+    threads = move(now);
+}
+
+//
+// ZoneName
+//
+const string& TraceExporter::ZoneName(uint32_t zone)
+{
+    while (zoneNames.size() <= zone)
+        zoneNames.push_back(Profiler::Zone(static_cast<uint32_t>(zoneNames.size())).name);
+    return zoneNames[zone];
+}
+
+//
+// WriteEvents
+//
+void TraceExporter::WriteEvents(const vector<ProfileEvent>& events, const vector<CounterSample>& samples)
+{
+    auto threadId = [this](uint32_t thread) { return (thread < threads.size()) ? threads[thread].osId : thread; };
+
+    if (format == TraceFormat::ChromeJson) {
+        // complete events, ts and dur in microseconds
+        for (const ProfileEvent& event : events) {
+            out.append(firstEvent ? "{\"name\":" : ",\n{\"name\":");
+            firstEvent = false;
+            jsonString(&out, ZoneName(event.zone));
+            out.append(std::format(",\"cat\":\"tau\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+                                   event.startNs / 1000.0, event.durationNs / 1000.0, pid, threadId(event.thread)));
+        }
+        for (const CounterSample& sample : samples) {
+            out.append(firstEvent ? "{\"name\":" : ",\n{\"name\":");
+            firstEvent = false;
+            jsonString(&out, counterTracks[sample.counter]);
+            out.append(std::format(",\"ph\":\"C\",\"ts\":{:.3f},\"pid\":{},\"args\":{{\"value\":{}}}}}",
+                                   sample.timeNs / 1000.0, pid, sample.value));
+        }
+        return;
+    }
+
+    // each zone is a begin and an end on its thread's track.  in time order, with the outer zone's begin first and
+    // its end last when the times are the same.
+    struct Mark {
+        uint64_t timeNs;
+        const ProfileEvent* event;
+        bool end;
+    };
+    vector<Mark> marks;
+    marks.reserve(events.size() * 2);
+    for (const ProfileEvent& event : events) {
+        marks.push_back({ event.startNs, &event, false });
+        marks.push_back({ event.startNs + event.durationNs, &event, true });
+    }
+    sort(marks.begin(), marks.end(), [](const Mark& a, const Mark& b) {
+        if (a.timeNs != b.timeNs)
+            return a.timeNs < b.timeNs;
+        if (a.end != b.end)
+            return a.end;
+        return a.end ? a.event->depth > b.event->depth : a.event->depth < b.event->depth;
+    });
+
+    string trackEvent, packet;
+    for (const Mark& mark : marks) {
+        trackEvent.clear();
+        packet.clear();
+        varintField(&trackEvent, eventType, mark.end ? sliceEnd : sliceBegin);
+        varintField(&trackEvent, eventTrackUuid, threadTrack(pid, mark.event->thread));
+        if (!mark.end)
+            bytesField(&trackEvent, eventName, ZoneName(mark.event->zone));
+        varintField(&packet, packetTimestamp, mark.timeNs);
+        varintField(&packet, packetSequenceId, sequenceId);
+        bytesField(&packet, packetTrackEvent, trackEvent);
+        bytesField(&out, tracePacket, packet);
+    }
+    for (const CounterSample& sample : samples) {
+        trackEvent.clear();
+        packet.clear();
+        varintField(&trackEvent, eventType, counterEvent);
+        varintField(&trackEvent, eventTrackUuid, counterTrack(pid, sample.counter));
+        doubleField(&trackEvent, eventDoubleCounterValue, sample.value);
+        varintField(&packet, packetTimestamp, sample.timeNs);
+        varintField(&packet, packetSequenceId, sequenceId);
+        bytesField(&packet, packetTrackEvent, trackEvent);
+        bytesField(&out, tracePacket, packet);
+    }
+}
+
+} // end namespace Tau
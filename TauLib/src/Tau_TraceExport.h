@@ -0,0 +1,119 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for TraceExporter, streams Profiler zones and counters to a Chrome JSON or Perfetto trace file.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Tau_Profiler.h"
+#include "TextFileWriter.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief the trace file format
+///
+enum class TraceFormat {
+    ChromeJson,     ///< Trace Event JSON for chrome://tracing, Perfetto UI and speedscope
+    Perfetto,       ///< Perfetto protobuf (TracePacket / TrackEvent) for ui.perfetto.dev and trace_processor
+};
+
+///
+/// @brief TraceExporter - writes what the Profiler records to a trace file as it goes
+/// @remark A background thread calls Profiler::Collect() every collectInterval and writes the zones to the file, so a
+///         long capture's memory use stays flat.  If the disk can't keep up more than maxQueued events, the newest are
+///         dropped and counted.  A collectInterval of 0 leaves Collect() to the program (once a frame, say).
+/// @remark Each thread is a track named by Profiler::SetThreadName().  Zones nest by time on their thread's track.
+///         Counter() adds a sample to a counter track of that name.
+/// @remark A Chrome JSON file that wasn't closed is still readable, the viewers don't need the closing ].
+/// @code
+///     TraceExporter trace;
+///     trace.Open("startup.json");
+///     LoadEverything();
+///     trace.Counter("games", games.size());
+///     trace.Close();
+/// @endcode
+///
+class TraceExporter {
+public:
+    TraceExporter() {}
+    ~TraceExporter() { Close(); }
+
+    TraceExporter(const TraceExporter&) = delete;
+    TraceExporter& operator = (const TraceExporter&) = delete;
+
+    /// @brief create the file and start the capture
+    bool Open(const std::string& filePath, TraceFormat format = TraceFormat::ChromeJson,
+              std::chrono::milliseconds collectInterval = std::chrono::milliseconds(100), size_t maxQueued = 1 << 20);
+
+    /// @brief collect a last time, write what's left and close the file
+    /// @return false if a write failed
+    bool Close();
+
+    bool IsOpen() const { return file.IsOpen(); }
+
+    /// @brief a counter sample at the current time.  any thread.
+    void Counter(const std::string& name, double value);
+
+    /// @brief zones and counter samples written so far
+    uint64_t EventsWritten() const;
+    /// @brief zones and counter samples lost because the writer fell behind
+    uint64_t EventsDropped() const;
+
+private:
+    struct CounterSample {
+        uint64_t timeNs;
+        uint32_t counter;
+        double value;
+    };
+    struct Sink;
+    friend struct Sink;
+
+    void Queue(const std::vector<ProfileEvent>& events);
+    void Run();
+    void WriteQueued();
+    void WriteHeader();
+    void WriteThreads();
+    void WriteEvents(const std::vector<ProfileEvent>& events, const std::vector<CounterSample>& samples);
+    const std::string& ZoneName(uint32_t zone);
+
+    TraceFormat format {TraceFormat::ChromeJson};
+    std::chrono::milliseconds collectInterval {0};
+    size_t maxQueued {0};
+    TextFileWriter file;
+    std::shared_ptr<Sink> sink;
+    std::thread writer;
+    bool stopping {true};                       // also while closed
+
+    // queued by Collect() and Counter(), taken by the writer
+    std::vector<ProfileEvent> queuedEvents;
+    std::vector<CounterSample> queuedSamples;
+    std::unordered_map<std::string, uint32_t> counterIds;
+    std::vector<std::string> counterNames;
+    uint64_t written {0};
+    uint64_t dropped {0};
+    mutable std::mutex lock;
+    std::condition_variable wake;
+
+    // the writer thread's own
+    uint64_t pid {0};
+    std::vector<std::string> zoneNames;
+    std::vector<ProfileThreadInfo> threads;     // as last written, by Profiler thread index
+    std::vector<std::string> counterTracks;     // counterNames written so far
+    std::string out;
+    bool firstEvent {true};
+};
+
+} // end namespace Tau
@@ -0,0 +1,382 @@
+///
+/// @file
+/// @brief CPP file for TempFile, TempDirectory and ScratchPool, temporary files that clean up after themselves.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "TempFile.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <direct.h>
+#include <share.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#include <cstdlib>
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+                //*******************************
+                // Temp paths
+                //*******************************
+
+//
+// TempDirPath
+//
+const string& TempDirPath(TempLocation where)
+{
+    static const string diskDir = []() {
+        error_code ec;
+        string dir = fs::temp_directory_path(ec).string();
+        if (ec || dir.empty())
+            dir = ".";
+        // fs::temp_directory_path() ends with a separator on Windows
+        while (dir.size() > 1 && (dir.back() == '/' || dir.back() == '\\'))
+            dir.pop_back();
+        return dir;
+    }();
+#if defined(__linux__)
+    static const string memoryDir = []() {
+        error_code ec;
+        if (fs::is_directory("/dev/shm", ec) && access("/dev/shm", W_OK | X_OK) == 0)
+            return string("/dev/shm");
+        return diskDir;
+    }();
+    if (where == TempLocation::Memory)
+        return memoryDir;
+#else
+    (void)where;
+#endif
+    return diskDir;
+}
+
+//
+// randomName - 12 characters from a per thread generator
+//
+static string randomName()
+{
+    static atomic<uint64_t> counter {0};
+    thread_local mt19937_64 generator([]() {
+        random_device device;
+        uint64_t seed = (static_cast<uint64_t>(device()) << 32) ^ device();
+        seed ^= static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+#if defined(_WIN32)
+        seed ^= static_cast<uint64_t>(_getpid()) << 40;
+#else
+        seed ^= static_cast<uint64_t>(getpid()) << 40;
+#endif
+        return seed ^ (counter.fetch_add(1) * 0x9E3779B97F4A7C15ULL);
+    }());
+
+    static const char chars[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    uint64_t bits = generator();
+    string name(12, '0');
+    for (char& ch : name) {
+        ch = chars[bits % 62];
+        bits /= 62;
+    }
+    return name;
+}
+
+//
+// UniqueTempPath
+//
+string UniqueTempPath(const string& prefix, const string& suffix, TempLocation where)
+{
+    return (fs::path(TempDirPath(where)) / (prefix + randomName() + suffix)).string();
+}
+
+                //*******************************
+                // TempFile
+                //*******************************
+
+//
+// operator = (TempFile&&)
+//
+TempFile& TempFile::operator = (TempFile&& other) noexcept
+{
+    if (this != &other) {
+        Remove();
+        fd = other.fd;
+        path = move(other.path);
+        other.fd = -1;
+        other.path.clear();
+    }
+    return *this;
+}
+
+//
+// Create
+//
+bool TempFile::Create(const string& prefix, const string& suffix, TempLocation where)
+{
+    Remove();
+#if defined(_WIN32)
+    int flags = _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY | _O_NOINHERIT;
+    if (where == TempLocation::Memory)
+        flags |= _O_SHORT_LIVED;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        string name = UniqueTempPath(prefix, suffix, where);
+        if (_sopen_s(&fd, name.c_str(), flags, _SH_DENYNO, _S_IREAD | _S_IWRITE) == 0) {
+            path = name;
+            return true;
+        }
+        fd = -1;
+        if (errno != EEXIST)
+            break;
+    }
+    return false;
+#else
+    string name = (fs::path(TempDirPath(where)) / (prefix + "XXXXXX" + suffix)).string();
+    fd = mkostemps(name.data(), static_cast<int>(suffix.size()), O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    path = name;
+    return true;
+#endif
+}
+
+//
+// CreateAnonymous
+//
+bool TempFile::CreateAnonymous(TempLocation where)
+{
+    Remove();
+#if defined(_WIN32)
+    int flags = _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY | _O_NOINHERIT | _O_TEMPORARY;
+    if (where == TempLocation::Memory)
+        flags |= _O_SHORT_LIVED;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        if (_sopen_s(&fd, UniqueTempPath("tau", "", where).c_str(), flags, _SH_DENYNO, _S_IREAD | _S_IWRITE) == 0)
+            return true;
+        fd = -1;
+        if (errno != EEXIST)
+            break;
+    }
+    return false;
+#else
+#if defined(O_TMPFILE)
+    fd = open(TempDirPath(where).c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd >= 0)
+        return true;
+#endif
+    // the file system doesn't support O_TMPFILE
+    if (!Create("tau", "", where))
+        return false;
+    unlink(path.c_str());
+    path.clear();
+    return true;
+#endif
+}
+
+//
+// CloseFd
+//
+void TempFile::CloseFd()
+{
+    if (fd >= 0) {
+#if defined(_WIN32)
+        _close(fd);
+#else
+        close(fd);
+#endif
+        fd = -1;
+    }
+}
+
+//
+// Release
+//
+string TempFile::Release()
+{
+    CloseFd();
+    string kept = move(path);
+    path.clear();
+    return kept;
+}
+
+//
+// Remove
+//
+void TempFile::Remove()
+{
+    CloseFd();
+    if (!path.empty()) {
+        error_code ec;
+        fs::remove(path, ec);
+        path.clear();
+    }
+}
+
+                //*******************************
+                // TempDirectory
+                //*******************************
+
+//
+// operator = (TempDirectory&&)
+//
+TempDirectory& TempDirectory::operator = (TempDirectory&& other) noexcept
+{
+    if (this != &other) {
+        Remove();
+        path = move(other.path);
+        other.path.clear();
+    }
+    return *this;
+}
+
+//
+// Create
+//
+bool TempDirectory::Create(const string& prefix, TempLocation where)
+{
+    Remove();
+#if defined(_WIN32)
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        string name = UniqueTempPath(prefix, "", where);
+        if (_mkdir(name.c_str()) == 0) {
+            path = name;
+            return true;
+        }
+        if (errno != EEXIST)
+            break;
+    }
+    return false;
+#else
+    string name = (fs::path(TempDirPath(where)) / (prefix + "XXXXXX")).string();
+    if (mkdtemp(name.data()) == nullptr)
+        return false;
+    path = name;
+    return true;
+#endif
+}
+
+//
+// Release
+//
+string TempDirectory::Release()
+{
+    string kept = move(path);
+    path.clear();
+    return kept;
+}
+
+//
+// Remove
+//
+void TempDirectory::Remove()
+{
+    if (!path.empty()) {
+        error_code ec;
+        fs::remove_all(path, ec);
+        path.clear();
+    }
+}
+
+                //*******************************
+                // ScratchPool
+                //*******************************
+
+//
+// ~ScratchFile
+//
+ScratchFile::~ScratchFile()
+{
+    if (pool != nullptr && file.IsOpen())
+        pool->GiveBack(move(file));
+}
+
+//
+// operator = (ScratchFile&&)
+//
+ScratchFile& ScratchFile::operator = (ScratchFile&& other) noexcept
+{
+    if (this != &other) {
+        if (pool != nullptr && file.IsOpen())
+            pool->GiveBack(move(file));
+        pool = other.pool;
+        file = move(other.file);
+        other.pool = nullptr;
+    }
+    return *this;
+}
+
+//
+// ScratchPool
+//
+ScratchPool::ScratchPool(const string& _prefix, TempLocation _where, size_t _maxIdle)
+    : prefix(_prefix), where(_where), maxIdle(_maxIdle)
+{
+}
+
+//
+// Acquire
+//
+ScratchFile ScratchPool::Acquire()
+{
+    ScratchFile scratch;
+    scratch.pool = this;
+    {
+        lock_guard<mutex> guard(lock);
+        if (!idle.empty()) {
+            scratch.file = move(idle.back());
+            idle.pop_back();
+            return scratch;
+        }
+    }
+    if (scratch.file.Create(prefix, "", where)) {
+        lock_guard<mutex> guard(lock);
+        ++created;
+    }
+    return scratch;
+}
+
+//
+// GiveBack - empty the file for the next Acquire(), or delete it if enough are idle
+//
+void ScratchPool::GiveBack(TempFile&& file)
+{
+#if defined(_WIN32)
+    bool emptied = _chsize_s(file.Fd(), 0) == 0 && _lseeki64(file.Fd(), 0, SEEK_SET) == 0;
+#else
+    bool emptied = ftruncate(file.Fd(), 0) == 0 && lseek(file.Fd(), 0, SEEK_SET) == 0;
+#endif
+    lock_guard<mutex> guard(lock);
+    if (emptied && idle.size() < maxIdle)
+        idle.push_back(move(file));
+    else
+        file.Remove();
+}
+
+//
+// IdleCount
+//
+size_t ScratchPool::IdleCount() const
+{
+    lock_guard<mutex> guard(lock);
+    return idle.size();
+}
+
+//
+// CreatedCount
+//
+size_t ScratchPool::CreatedCount() const
+{
+    lock_guard<mutex> guard(lock);
+    return created;
+}
+
+} // end namespace Tau
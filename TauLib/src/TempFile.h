@@ -0,0 +1,182 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for TempFile, TempDirectory and ScratchPool, temporary files that clean up after themselves.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief where temporary files go
+///
+enum class TempLocation {
+    Disk,       ///< the system temp directory
+    Memory,     ///< /dev/shm (tmpfs) on Linux when it's there.  on Windows the file is marked short lived so it
+                ///< stays in the cache.  otherwise the same as Disk.
+};
+
+///
+/// @brief TempDirPath - the directory temporary files go in.  looked up once and cached.
+///
+const std::string& TempDirPath(TempLocation where = TempLocation::Disk);
+
+///
+/// @brief UniqueTempPath - a full path in the temp directory that nothing has, without touching the disk
+/// @remark The name has 60 random bits.  Use TempFile or TempDirectory to create it safely.
+///
+std::string UniqueTempPath(const std::string& prefix = "tau", const std::string& suffix = "",
+                           TempLocation where = TempLocation::Disk);
+
+///
+/// @brief TempFile - a new file only this process has, deleted when the object goes away
+/// @remark Created with mkostemps (Linux) or an exclusive create (Windows) so another process can't get in first
+///         with a file or symlink of the same name.  The file is readable and writable by the user only.
+/// @code
+///     TempFile temp;
+///     if (temp.Create("export", ".csv")) {
+///         WriteStringsToTextFile(lines, temp.Path(), true);
+///         ...
+///     }   // deleted
+/// @endcode
+///
+class TempFile {
+public:
+    TempFile() {}
+    ~TempFile() { Remove(); }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator = (const TempFile&) = delete;
+    TempFile(TempFile&& other) noexcept { *this = std::move(other); }
+    TempFile& operator = (TempFile&& other) noexcept;
+
+    /// @brief create a file named prefix, random characters, suffix.  open for reading and writing.
+    bool Create(const std::string& prefix = "tau", const std::string& suffix = "",
+                TempLocation where = TempLocation::Disk);
+
+    /// @brief create a file with no name (O_TMPFILE) that's gone when closed.  Path() is empty.
+    /// @remark Where O_TMPFILE isn't supported the file is created and unlinked.  On Windows it has a name but
+    ///         is deleted when closed.
+    bool CreateAnonymous(TempLocation where = TempLocation::Disk);
+
+    bool IsOpen() const { return fd >= 0; }
+    int Fd() const { return fd; }
+    const std::string& Path() const { return path; }
+
+    /// @brief close the file but keep it until Remove(), for opening it by name (needed on Windows)
+    void CloseFd();
+    /// @brief close the file and keep it.  returns its path.
+    std::string Release();
+    /// @brief close and delete the file
+    void Remove();
+
+private:
+    int fd {-1};
+    std::string path;
+};
+
+///
+/// @brief TempDirectory - a new directory only this user can use, deleted with everything in it when the object goes away
+///
+class TempDirectory {
+public:
+    TempDirectory() {}
+    ~TempDirectory() { Remove(); }
+
+    TempDirectory(const TempDirectory&) = delete;
+    TempDirectory& operator = (const TempDirectory&) = delete;
+    TempDirectory(TempDirectory&& other) noexcept { *this = std::move(other); }
+    TempDirectory& operator = (TempDirectory&& other) noexcept;
+
+    /// @brief create a directory named prefix and random characters (mkdtemp)
+    bool Create(const std::string& prefix = "tau", TempLocation where = TempLocation::Disk);
+
+    bool IsCreated() const { return !path.empty(); }
+    const std::string& Path() const { return path; }
+
+    /// @brief keep the directory.  returns its path.
+    std::string Release();
+    /// @brief delete the directory and everything in it
+    void Remove();
+
+private:
+    std::string path;
+};
+
+class ScratchPool;
+
+///
+/// @brief ScratchFile - a temp file on loan from a ScratchPool.  empty when it's handed out, handed back when the
+/// object goes away.
+///
+class ScratchFile {
+public:
+    ScratchFile() {}
+    ~ScratchFile();
+
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile& operator = (const ScratchFile&) = delete;
+    ScratchFile(ScratchFile&& other) noexcept { *this = std::move(other); }
+    ScratchFile& operator = (ScratchFile&& other) noexcept;
+
+    bool IsOpen() const { return file.IsOpen(); }
+    int Fd() const { return file.Fd(); }
+    const std::string& Path() const { return file.Path(); }
+
+private:
+    friend class ScratchPool;
+    ScratchPool* pool {nullptr};
+    TempFile file;
+};
+
+///
+/// @brief ScratchPool - temp files reused instead of created and deleted, for loops that need many short lived files
+/// @remark A file handed back is truncated and kept open for the next Acquire(), up to maxIdle files.  The pool
+///         must outlive its ScratchFiles.  Acquire() can be called from any thread.
+/// @code
+///     ScratchPool pool("thumb");
+///     for (const string& image : images) {
+///         ScratchFile scratch = pool.Acquire();
+///         ConvertImage(image, scratch.Path());
+///         ...
+///     }
+/// @endcode
+///
+class ScratchPool {
+public:
+    explicit ScratchPool(const std::string& prefix = "scratch", TempLocation where = TempLocation::Memory,
+                         size_t maxIdle = 16);
+    ~ScratchPool() {}
+
+    ScratchPool(const ScratchPool&) = delete;
+    ScratchPool& operator = (const ScratchPool&) = delete;
+
+    /// @brief an empty file open for reading and writing.  IsOpen() is false if one couldn't be created.
+    ScratchFile Acquire();
+
+    /// @brief files waiting to be reused
+    size_t IdleCount() const;
+    /// @brief files created over the life of the pool
+    size_t CreatedCount() const;
+
+private:
+    friend class ScratchFile;
+    void GiveBack(TempFile&& file);
+
+    std::string prefix;
+    TempLocation where;
+    size_t maxIdle;
+    std::vector<TempFile> idle;
+    size_t created {0};
+    mutable std::mutex lock;
+};
+
+} // end namespace Tau
@@ -0,0 +1,383 @@
+///
+/// @file
+/// @brief CPP file for TextFileWriter, buffered text file writes with fsync and atomic replace options.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include "TextFileWriter.h"
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace Tau {
+
+                //*******************************
+                // File descriptors
+                //*******************************
+
+#if defined(_WIN32)
+
+static int openFile(const string& path, bool append)
+{
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC), _S_IREAD | _S_IWRITE);
+}
+
+// a new file next to path that nothing else has open
+static int openTempFile(const string& path, string* tempPath)
+{
+    for (int i = 0; i < 1000; ++i) {
+        *tempPath = path + ".tmp" + to_string(i);
+        int fd = _open(tempPath->c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if (fd >= 0 || errno != EEXIST)
+            return fd;
+    }
+    return -1;
+}
+
+static int writeSome(int fd, const char* data, size_t length)
+{
+    return _write(fd, data, static_cast<unsigned int>(min<size_t>(length, INT_MAX)));
+}
+
+static bool syncFd(int fd) { return _commit(fd) == 0; }
+static bool closeFd(int fd) { return _close(fd) == 0; }
+static void syncDir(const string&) {}
+
+#else
+
+static int openFile(const string& path, bool append)
+{
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0666);
+}
+
+// a new file next to path that nothing else has open.  it gets the permissions of the file it will replace, or
+// mkostemp's (owner read and write) if there isn't one.
+static int openTempFile(const string& path, string* tempPath)
+{
+    string name = path + ".XXXXXX";
+    int fd = mkostemp(name.data(), O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    *tempPath = name;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0)
+        fchmod(fd, st.st_mode & 07777);
+    return fd;
+}
+
+static int writeSome(int fd, const char* data, size_t length)
+{
+    ssize_t written = write(fd, data, min<size_t>(length, INT_MAX));
+    return static_cast<int>(written);
+}
+
+static bool syncFd(int fd) { return fdatasync(fd) == 0; }
+static bool closeFd(int fd) { return close(fd) == 0; }
+
+// sync the directory so a rename into it survives a crash
+static void syncDir(const string& filePath)
+{
+    string dirPath = fs::path(filePath).parent_path().string();
+    int dirFd = open(dirPath.empty() ? "." : dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+}
+
+#endif
+
+                //*******************************
+                // TextFileWriter
+                //*******************************
+
+//
+// Open
+//
+bool TextFileWriter::Open(const string& _filePath, bool append)
+{
+    lock_guard<mutex> guard(lock);
+    Finish(true);
+
+    filePath = _filePath;
+    writeFailed = false;
+    lastWasCR = false;
+    bytesWritten = 0;
+    buffer.clear();
+    buffer.reserve(options.bufferSize);
+    lastSync = chrono::steady_clock::now();
+
+    if (options.atomicReplace && !append)
+        fd = openTempFile(filePath, &tempPath);
+    else
+        fd = openFile(filePath, append);
+    return fd >= 0;
+}
+
+//
+// Close
+//
+bool TextFileWriter::Close()
+{
+    lock_guard<mutex> guard(lock);
+    return Finish(true);
+}
+
+//
+// Discard
+//
+void TextFileWriter::Discard()
+{
+    lock_guard<mutex> guard(lock);
+    Finish(tempPath.empty());
+}
+
+//
+// Finish - close the file.  keep = false drops a temporary file instead of renaming it into place.
+//
+bool TextFileWriter::Finish(bool keep)
+{
+    if (fd < 0)
+        return !writeFailed;
+
+    // a temporary file is always synced: renamed over the original unsynced, a crash can leave neither
+    bool sync = options.sync != SyncPolicy::None || !tempPath.empty();
+    if (keep) {
+        FlushBuffer();
+        if (sync && !writeFailed)
+            SyncFile();
+    }
+    if (!closeFd(fd))
+        writeFailed = true;
+    fd = -1;
+    buffer.clear();
+
+    if (!tempPath.empty()) {
+        error_code ec;
+        if (keep && !writeFailed) {
+            fs::rename(tempPath, filePath, ec);
+            if (ec)
+                writeFailed = true;
+            else if (sync)
+                syncDir(filePath);
+        }
+        if (!keep || writeFailed)
+            fs::remove(tempPath, ec);
+        tempPath.clear();
+    }
+    return !writeFailed;
+}
+
+//
+// Write
+//
+bool TextFileWriter::Write(string_view text)
+{
+    lock_guard<mutex> guard(lock);
+    Append(text);
+    if (options.autoFlush)
+        FlushBuffer();
+    return !writeFailed;
+}
+
+//
+// WriteLine
+//
+bool TextFileWriter::WriteLine(string_view line)
+{
+    lock_guard<mutex> guard(lock);
+    Append(line);
+    Append(options.lineEnding);
+    if (options.autoFlush)
+        FlushBuffer();
+    return !writeFailed;
+}
+
+//
+// WriteLines
+// more than a buffer's worth goes to writev() from the strings themselves, up to IOV_MAX pieces a call.
+//
+bool TextFileWriter::WriteLines(const Strings& lines, bool appendLineEnding)
+{
+    lock_guard<mutex> guard(lock);
+
+#if !defined(_WIN32)
+    size_t total = 0;
+    for (const string& line : lines)
+        total += line.size() + (appendLineEnding ? options.lineEnding.size() : 0);
+
+    if (total >= options.bufferSize && fd >= 0 && !options.translateNewlines) {
+        FlushBuffer();
+        vector<iovec> pieces;
+        pieces.reserve(IOV_MAX);
+        auto writePieces = [&]() {
+            size_t first = 0;
+            while (first < pieces.size() && !writeFailed) {
+                ssize_t written = writev(fd, pieces.data() + first, static_cast<int>(pieces.size() - first));
+                if (written <= 0) {
+                    if (written == 0 || errno != EINTR)
+                        writeFailed = true;
+                    continue;
+                }
+                // skip what was written, part of a piece after a short write
+                size_t left = static_cast<size_t>(written);
+                while (first < pieces.size() && left >= pieces[first].iov_len)
+                    left -= pieces[first++].iov_len;
+                if (left > 0) {
+                    pieces[first].iov_base = static_cast<char*>(pieces[first].iov_base) + left;
+                    pieces[first].iov_len -= left;
+                }
+            }
+            pieces.clear();
+        };
+        for (const string& line : lines) {
+            if (!line.empty())
+                pieces.push_back({ const_cast<char*>(line.data()), line.size() });
+            if (appendLineEnding && !options.lineEnding.empty())
+                pieces.push_back({ options.lineEnding.data(), options.lineEnding.size() });
+            if (pieces.size() + 2 > IOV_MAX)
+                writePieces();
+        }
+        writePieces();
+        bytesWritten += total;
+        if (options.sync == SyncPolicy::Periodic && !writeFailed &&
+            chrono::steady_clock::now() - lastSync >= options.syncInterval)
+            SyncFile();
+        return !writeFailed;
+    }
+#endif
+
+    for (const string& line : lines) {
+        Append(line);
+        if (appendLineEnding)
+            Append(options.lineEnding);
+    }
+    if (options.autoFlush)
+        FlushBuffer();
+    return !writeFailed;
+}
+
+//
+// Flush
+//
+bool TextFileWriter::Flush()
+{
+    lock_guard<mutex> guard(lock);
+    return FlushBuffer();
+}
+
+//
+// Sync
+//
+bool TextFileWriter::Sync()
+{
+    lock_guard<mutex> guard(lock);
+    return FlushBuffer() && SyncFile();
+}
+
+//
+// Append - with translateNewlines, a '\n' not after a '\r' goes out as "\r\n"
+//
+bool TextFileWriter::Append(string_view text)
+{
+    if (!options.translateNewlines)
+        return AppendRaw(text);
+
+    size_t start = 0;
+    for (size_t i = text.find('\n'); i != string_view::npos; i = text.find('\n', i + 1)) {
+        bool afterCR = i > 0 ? text[i - 1] == '\r' : lastWasCR;
+        if (!afterCR) {
+            AppendRaw(text.substr(start, i - start));
+            AppendRaw("\r\n");
+            start = i + 1;
+        }
+    }
+    if (!text.empty())
+        lastWasCR = text.back() == '\r';
+    return AppendRaw(text.substr(start));
+}
+
+//
+// AppendRaw - to the buffer, writing it when it's full.  text as big as the buffer is written from where it is.
+//
+bool TextFileWriter::AppendRaw(string_view text)
+{
+    if (fd < 0) {
+        writeFailed = true;
+        return false;
+    }
+    bytesWritten += text.size();
+    if (buffer.size() + text.size() > options.bufferSize)
+        FlushBuffer();
+    if (text.size() >= options.bufferSize)
+        return WriteAll(text.data(), text.size());
+    buffer.append(text);
+    return true;
+}
+
+//
+// FlushBuffer
+//
+bool TextFileWriter::FlushBuffer()
+{
+    if (buffer.empty() || fd < 0)
+        return !writeFailed;
+    WriteAll(buffer.data(), buffer.size());
+    buffer.clear();
+    return !writeFailed;
+}
+
+//
+// WriteAll - to the file, then a periodic sync if one is due
+//
+bool TextFileWriter::WriteAll(const char* data, size_t length)
+{
+    while (length > 0 && !writeFailed) {
+        int written = writeSome(fd, data, length);
+        if (written <= 0) {
+#if !defined(_WIN32)
+            if (written < 0 && errno == EINTR)
+                continue;
+#endif
+            writeFailed = true;
+            break;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    if (options.sync == SyncPolicy::Periodic && !writeFailed &&
+        chrono::steady_clock::now() - lastSync >= options.syncInterval)
+        SyncFile();
+    return !writeFailed;
+}
+
+//
+// SyncFile
+//
+bool TextFileWriter::SyncFile()
+{
+    if (fd < 0)
+        return false;
+    if (!syncFd(fd))
+        writeFailed = true;
+    lastSync = chrono::steady_clock::now();
+    return !writeFailed;
+}
+
+} // end namespace Tau
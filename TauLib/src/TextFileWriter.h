@@ -0,0 +1,123 @@
+#pragma once
+///
+/// @file
+/// @brief Header file for TextFileWriter, buffered text file writes with fsync and atomic replace options.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+#include "Str.h"
+#include "sep.h"
+
+///
+/// @brief namespace Tau - avoid conflict with other libraries
+///
+namespace Tau { // to avoid conflict with other libraries
+
+///
+/// @brief TextFileWriter - writes a text file through a buffer, a full buffer at a time
+/// @remark Lines are copied into the buffer.  WriteLines() of more than a buffer's worth writes the lines from
+///         where they are with writev() (Linux), without copying them.
+/// @remark With atomicReplace the file is written under a temporary name in the same directory and renamed over
+///         the original by Close(), so a crash leaves the old file or the new one, never part of one.  The
+///         temporary file is synced before the rename whatever the sync policy, or a crash could leave the new
+///         name on an empty file.  Discard() drops the new contents.  The new file gets the permissions of the one
+///         it replaces, or only the owner's read and write if there wasn't one.
+/// @remark The file is written in binary.  translateNewlines (the default on Windows) writes a '\n' in the text
+///         that isn't already after a '\r' as "\r\n", as a text mode stream would.
+/// @remark Open with append for a log: the file stays open between writes, each write goes to the end (O_APPEND),
+///         and autoFlush hands each call's text to the OS before it returns.  Calls are serialized by a lock so
+///         threads can share a writer.
+/// @code
+///     TextFileWriter::Options options;
+///     options.atomicReplace = true;
+///     options.sync = TextFileWriter::SyncPolicy::OnClose;
+///     TextFileWriter writer(options);
+///     if (writer.Open(settingsPath)) {
+///         writer.WriteLines(lines);
+///         ok = writer.Close();
+///     }
+/// @endcode
+///
+class TextFileWriter {
+public:
+    ///
+    /// @brief when the file is flushed to the disk (fsync), not just to the OS
+    ///
+    enum class SyncPolicy {
+        None,       ///< left to the OS
+        OnClose,    ///< once, by Close()
+        Periodic,   ///< by any write syncInterval or more after the last, and by Close()
+    };
+
+    ///
+    /// @brief TextFileWriter options
+    ///
+    struct Options {
+        size_t bufferSize {256 * 1024};     ///< bytes held before they are written to the file
+        SyncPolicy sync {SyncPolicy::None};
+        std::chrono::milliseconds syncInterval {1000};
+        bool atomicReplace {false};         ///< write a temporary file and rename it over the file on Close()
+        bool autoFlush {false};             ///< flush at the end of every Write call (for logs)
+        std::string lineEnding {Tau::lineEnding};     ///< after each WriteLine.  the OS's, see sep.h.
+#if defined(_WIN32)
+        bool translateNewlines {true};      ///< '\n' in the text is written as "\r\n"
+#else
+        bool translateNewlines {false};     ///< '\n' in the text is written as "\r\n"
+#endif
+    };
+
+    TextFileWriter() {}
+    TextFileWriter(const Options& _options) : options(_options) {}
+    ~TextFileWriter() { Close(); }
+
+    TextFileWriter(const TextFileWriter&) = delete;
+    TextFileWriter& operator = (const TextFileWriter&) = delete;
+
+    /// @brief Open the file.  append = true writes after the existing contents (atomicReplace is ignored).
+    bool Open(const std::string& filePath, bool append = false);
+    /// @brief Flush, sync by the policy and close.  with atomicReplace, renames the file into place.
+    /// @return false if any write failed.  with atomicReplace the original file is then left alone.
+    bool Close();
+    /// @brief close without keeping what was written with atomicReplace.  otherwise the same as Close().
+    void Discard();
+    bool IsOpen() const { return fd >= 0; }
+
+    bool Write(std::string_view text);
+    bool WriteLine(std::string_view line);
+    /// @param appendLineEnding false to write the strings as they are
+    bool WriteLines(const Strings& lines, bool appendLineEnding = true);
+
+    /// @brief write anything that is buffered to the file
+    bool Flush();
+    /// @brief Flush() and fsync
+    bool Sync();
+
+    /// @brief bytes written since Open(), buffered or not
+    uintmax_t BytesWritten() const { return bytesWritten; }
+
+private:
+    bool Append(std::string_view text);
+    bool AppendRaw(std::string_view text);
+    bool FlushBuffer();
+    bool WriteAll(const char* data, size_t length);
+    bool SyncFile();
+    bool Finish(bool keep);
+
+    Options options;
+    std::string filePath;
+    std::string tempPath;       // with atomicReplace
+    int fd {-1};
+    std::string buffer;
+    uintmax_t bytesWritten {0};
+    bool writeFailed {false};
+    bool lastWasCR {false};     // with translateNewlines, the last character appended was '\r'
+    std::chrono::steady_clock::time_point lastSync;
+    mutable std::mutex lock;
+};
+
+} // end namespace Tau
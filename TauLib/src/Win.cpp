@@ -89,6 +89,14 @@ int Win::FindDisplayIndexOfX(int x) {
     return -1;
 }
 
+// returns 0 if SDL doesn't know
+int Win::RefreshRate() {
+    SDL_DisplayMode mode;
+    if (window == nullptr || SDL_GetWindowDisplayMode(window, &mode) != 0)
+        return 0;
+    return mode.refresh_rate;
+}
+
 #if 0
 //
 // CreateCenteredWin - Creates a centered Window.
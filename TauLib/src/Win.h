@@ -112,6 +112,10 @@ struct Win : public DrawArea
     /// @return display index.  -1 on error.
     int FindDisplayIndexOfX(int x);
 
+    /// @brief RefreshRate - the refresh rate of the display the window is on, for a FramePacer.
+    /// @return Hz.  0 if SDL doesn't know.
+    int RefreshRate();
+
 #if 0
     ///
     /// @brief CreateCenteredWin - Creates a centered Window.
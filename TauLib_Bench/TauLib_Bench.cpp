@@ -0,0 +1,206 @@
+///
+/// @file
+/// @brief TauLib_Bench - benchmarks TauLib and compares the results to a baseline.
+/// @author Steve Simpson, steve@iterator.com, a.k.a. Axanar (AutoBleem project)
+///
+/// TauLib_Bench [options]
+///     --list                  list the benchmarks
+///     --filter TEXT           only run the benchmarks with names containing TEXT
+///     --samples N             samples per benchmark (25)
+///     --sample-ms N           ms per sample (20)
+///     --warmup-ms N           ms of warmup per benchmark (200)
+///     --outlier-mads X        drop samples more than X median absolute deviations out, 0 to keep them (3)
+///     --pin CPU               run on CPU only
+///     --json FILE             write the results as JSON
+///     --save-baseline FILE    write the results as the new baseline
+///     --baseline FILE         compare to a baseline
+///     --threshold PERCENT     a benchmark this much slower than the baseline is a regression (10)
+///
+/// Exits 0 if nothing regressed, 1 if something did, 2 on a bad argument or a baseline that can't be read.
+///
+
+#include <iostream>
+#include <fstream>
+#include <future>
+#include <string>
+#include "Tau_Bench.h"
+#include "Tau_Hash.h"
+#include "Tau_Histogram.h"
+#include "Tau_Profiler.h"
+#include "Tau_ThreadPool.h"
+#include "Tau_Timer.h"
+#include "Str.h"
+
+using namespace std;
+using namespace Tau;
+
+                //*******************************
+                // Benchmarks
+                //*******************************
+
+TAU_BENCH("Str trim", iterations) {
+    string text = "   some text with spaces around it   ";
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(trim(text));
+}
+
+TAU_BENCH("Str lowerCase 64 chars", iterations) {
+    string text(64, 'A');
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(lowerCase(text));
+}
+
+TAU_BENCH("Str icompareInt", iterations) {
+    string a = "Super Mario Bros. 3";
+    string b = "super mario bros. 3";
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(icompareInt(a, b));
+}
+
+TAU_BENCH("Str SplitStringAtCommas 16 fields", iterations) {
+    string line = "one, two, three, four, five, six, seven, eight, nine, ten, eleven, twelve, 13, 14, 15, 16";
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(SplitStringAtCommas(line));
+}
+
+TAU_BENCH("Hash XXHash64 64 bytes", iterations) {
+    string data(64, 'x');
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(XXHash64(data, i));
+}
+
+TAU_BENCH("Hash XXHash64 64KB", iterations) {
+    string data(64 * 1024, 'x');
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(XXHash64(data, i));
+}
+
+TAU_BENCH("Histogram Record", iterations) {
+    Histogram histogram("bench");
+    for (uint64_t i = 0; i < iterations; ++i)
+        histogram.Record(i * 7919);
+    DoNotOptimize(histogram.Snapshot().Count());
+}
+
+TAU_BENCH("Profiler zone", iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+        TAU_PROFILE_ZONE("bench zone");
+        DoNotOptimize(i);
+    }
+    Profiler::Collect();
+}
+
+TAU_BENCH("Tau_Timer scope", iterations) {
+    Histogram histogram("Tau_Timer scope");
+    for (uint64_t i = 0; i < iterations; ++i) {
+        Tau_Timer timer(histogram);
+        DoNotOptimize(i);
+    }
+    Profiler::Collect();
+}
+
+TAU_BENCH("TAU_TIMER scope", iterations) {
+    for (uint64_t i = 0; i < iterations; ++i) {
+        TAU_TIMER("bench timer");
+        DoNotOptimize(i);
+    }
+    Profiler::Collect();
+}
+
+TAU_BENCH("ThreadPool Submit and get", iterations) {
+    ThreadPool pool(2);
+    for (uint64_t i = 0; i < iterations; ++i)
+        DoNotOptimize(pool.Submit([i] { return i; }).get());
+}
+
+                //*******************************
+                // main
+                //*******************************
+
+static int usage(const string& error)
+{
+    cerr << "TauLib_Bench: " << error << "\n"
+         << "usage: TauLib_Bench [--list] [--filter TEXT] [--samples N] [--sample-ms N] [--warmup-ms N]\n"
+         << "                    [--outlier-mads X] [--pin CPU] [--json FILE] [--save-baseline FILE]\n"
+         << "                    [--baseline FILE] [--threshold PERCENT]\n";
+    return 2;
+}
+
+int main(int argc, char* argv[])
+{
+    Bench bench;
+    BenchOptions& options = bench.Options();
+    bool list = false;
+    string jsonPath, saveBaselinePath, baselinePath;
+    double thresholdPercent = 10.0;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--list") {
+            list = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h")
+            return usage("benchmarks TauLib");
+        if (i + 1 >= argc)
+            return usage("a value is missing after " + arg);
+        string value = argv[++i];
+        try {
+            if (arg == "--filter")
+                options.filter = value;
+            else if (arg == "--samples")
+                options.samples = stoi(value);
+            else if (arg == "--sample-ms")
+                options.sampleTime = chrono::milliseconds(stoi(value));
+            else if (arg == "--warmup-ms")
+                options.warmup = chrono::milliseconds(stoi(value));
+            else if (arg == "--outlier-mads")
+                options.outlierMads = stod(value);
+            else if (arg == "--pin")
+                options.pinCpu = stoi(value);
+            else if (arg == "--json")
+                jsonPath = value;
+            else if (arg == "--save-baseline")
+                saveBaselinePath = value;
+            else if (arg == "--baseline")
+                baselinePath = value;
+            else if (arg == "--threshold")
+                thresholdPercent = stod(value);
+            else
+                return usage("unknown option " + arg);
+        }
+        catch (const exception&) {
+            return usage("bad value " + value + " for " + arg);
+        }
+    }
+
+    bench.AddRegistered();
+    if (list) {
+        for (const string& name : bench.Names())
+            cout << name << "\n";
+        return 0;
+    }
+
+    bench.Run(&cout);
+
+    if (!jsonPath.empty()) {
+        ofstream file(jsonPath, ios::binary | ios::trunc);
+        file << bench.ToJson() << "\n";
+        if (!file)
+            cerr << "TauLib_Bench: can't write " << jsonPath << "\n";
+    }
+    if (!saveBaselinePath.empty() && !bench.SaveBaseline(saveBaselinePath))
+        cerr << "TauLib_Bench: can't write " << saveBaselinePath << "\n";
+
+    if (baselinePath.empty())
+        return 0;
+    bool ok = false;
+    vector<BenchComparison> comparisons = bench.Compare(baselinePath, thresholdPercent / 100.0, &ok);
+    if (comparisons.empty() && !ok) {
+        cerr << "TauLib_Bench: can't read the baseline " << baselinePath << "\n";
+        return 2;
+    }
+    cout << "\n" << Bench::ComparisonText(comparisons);
+    cout << (ok ? "no regressions\n" : "REGRESSED\n");
+    return ok ? 0 : 1;
+}
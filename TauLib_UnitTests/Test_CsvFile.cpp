@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "CsvFile.h"
+#include "CsvWriter.h"
+#include "CsvCache.h"
+#include "CsvQuery.h"
+#include "Tau_Time.h"
+#include "DirFile.h"
+#include <thread>
+
+using namespace std;
+using namespace Tau;
+
+//
+// test CsvFile sorting.
+//
+TEST(TestCsvFile, TestCsvFile_Sort) {
+    CsvFile csv;
+    csv.AddString("b, 10, Track10");
+    csv.AddString("a, 9, track2");
+    csv.AddString("C, 100, Track1");
+    csv.AddString("a");                 // short row
+
+    // numeric column, descending
+    csv.Sort({ CsvSortKey { 1, false, CsvSortType::Numeric } });
+    EXPECT_EQ(csv.rows[0][1], "100");
+    EXPECT_EQ(csv.rows[1][1], "10");
+    EXPECT_EQ(csv.rows[2][1], "9");
+    EXPECT_EQ(csv.rows[3].size(), 1);  // the missing cell isn't a number so it sorts first ascending, last descending
+
+    // natural sort doesn't move the rows
+    auto order = csv.SortedOrder({ CsvSortKey { 2, true, CsvSortType::Natural } });
+    EXPECT_EQ(order.size(), 4);
+    EXPECT_EQ(order[0], 3);     // "" (short row)
+    EXPECT_EQ(csv.rows[order[1]][2], "Track1");
+    EXPECT_EQ(csv.rows[order[2]][2], "track2");
+    EXPECT_EQ(csv.rows[order[3]][2], "Track10");
+
+    // multiple keys: case insensitive column 0, then numeric column 1.  stable for equal keys.
+    csv.Sort({ CsvSortKey { 0, true, CsvSortType::CaseInsensitive }, CsvSortKey { 1, true, CsvSortType::Numeric } });
+    EXPECT_EQ(csv.rows[0].size(), 1);
+    EXPECT_EQ(csv.rows[1][1], "9");
+    EXPECT_EQ(csv.rows[2][0], "b");
+    EXPECT_EQ(csv.rows[3][0], "C");
+
+    // the original lexical single column sort
+    csv.Sort(0);
+    EXPECT_EQ(csv.rows[0][0], "C");
+    EXPECT_EQ(csv.rows[3][0], "b");
+}
+
+//
+// test CsvFile save, quoting, append and CsvWriter.
+//
+TEST(TestCsvFile, TestCsvFile_Write) {
+    string filePath = GetATempFilename();
+
+    CsvFile csv;
+    csv.AddRow({ "plain", "with, comma", "say \"hi\"" });
+    csv.AddRow({ "", " padded ", ";not a comment" });
+    csv.AddRow({ "multi\nline", "x" });
+    EXPECT_TRUE(csv.SaveAs(filePath));
+
+    CsvFile reloaded(filePath);
+    EXPECT_EQ(reloaded.rows, csv.rows);
+
+    // append without rewriting the file
+    EXPECT_TRUE(reloaded.Append({ { "appended", "row" } }));
+    EXPECT_EQ(reloaded.rows.size(), 4);
+    CsvFile appended(filePath);
+    EXPECT_EQ(appended.rows, reloaded.rows);
+
+    // a cell at a time, numbers with to_chars
+    {
+        CsvWriter writer(filePath);
+        writer.Cell("a").Cell(42).Cell(0.5).EndRow();
+        writer.Cell(int64_t(-7)).EndRow();
+    }
+    CsvFile numbers(filePath);
+    EXPECT_EQ(numbers.rows.size(), 2);
+    EXPECT_EQ(numbers.rows[0], Strings({ "a", "42", "0.5" }));
+    EXPECT_EQ(numbers.rows[1], Strings({ "-7" }));
+
+    DeleteFile(filePath);
+}
+
+//
+// test the CsvFile binary cache.
+//
+TEST(TestCsvFile, TestCsvFile_Cache) {
+    string filePath = GetATempFilename();
+    string cachePath = CsvCache::DefaultPath(filePath);
+
+    CsvFile csv;
+    for (int i = 0; i < 100; ++i)
+        csv.AddRow({ to_string(i), (i % 2) ? "odd" : "even", to_string(i) + ".5", "text " + to_string(i * 7) });
+    csv.AddRow({ "-1" });                               // short row
+    csv.AddRow({ "5", "x", "2.5", "007", "1e5" });      // not canonical numbers.  must come back as the same text.
+    EXPECT_TRUE(csv.SaveAs(filePath));
+
+    CsvFile cold;
+    EXPECT_TRUE(cold.LoadCached(filePath));     // parses the csv and writes the cache
+    EXPECT_TRUE(FileExists(cachePath));
+
+    CsvFile warm;
+    EXPECT_TRUE(CsvCache::Load(&warm, filePath, cachePath));
+    EXPECT_EQ(warm.rows, cold.rows);
+    EXPECT_EQ(warm.rows, csv.rows);
+
+    // the typed and dictionary columns straight from the mapped cache
+    CsvCacheView view;
+    EXPECT_TRUE(view.Open(filePath));
+    EXPECT_EQ(view.RowCount(), 102);
+    EXPECT_EQ(view.ColumnCount(), 5);
+    EXPECT_EQ(view.Encoding(0), CsvCacheEncoding::Int64);
+    EXPECT_EQ(view.Int64Column(0)[3], 3);
+    EXPECT_EQ(view.Int64Column(0)[100], -1);
+    EXPECT_TRUE(view.Int64Column(1).empty());
+    EXPECT_EQ(view.Encoding(1), CsvCacheEncoding::Dictionary);
+    EXPECT_EQ(view.DictionaryString(1, view.DictionaryCodes(1)[0]), "even");
+    EXPECT_EQ(view.Text(1, 1), "odd");
+    EXPECT_EQ(view.Encoding(2), CsvCacheEncoding::Double);
+    EXPECT_EQ(view.DoubleColumn(2)[1], 1.5);
+    EXPECT_EQ(view.Text(5, 3), "text 35");
+    EXPECT_EQ(view.Cell(101, 3), "007");
+    EXPECT_EQ(view.Cell(101, 4), "1e5");
+    EXPECT_EQ(view.RowLength(100), 1);
+    EXPECT_EQ(view.Cell(100, 1), "");
+    for (size_t row = 0; row < view.RowCount(); ++row) {
+        for (unsigned int col = 0; col < view.RowLength(row); ++col)
+            EXPECT_EQ(view.Cell(row, col), csv.rows[row][col]);
+    }
+    view.Close();
+
+    // a changed csv file doesn't use the cache
+    cold.Append({ { "new", "row" } });
+    CsvFile changed;
+    EXPECT_FALSE(CsvCache::Load(&changed, filePath, cachePath));
+    EXPECT_FALSE(view.Open(filePath));
+    EXPECT_TRUE(changed.LoadCached(filePath));
+    EXPECT_EQ(changed.rows, cold.rows);
+
+    DeleteFile(filePath);
+    DeleteFile(cachePath);
+}
+
+//
+// test CsvQuery filters and aggregates.
+//
+TEST(TestCsvFile, TestCsvFile_Query) {
+    CsvFile csv;
+    csv.AddString("Mario, snes, 1990, 8");
+    csv.AddString("Zelda, nes, 1986, 9");
+    csv.AddString("Metroid, nes, 1986, 7");
+    csv.AddString("Tetris, gb, 1989, 10");
+    csv.AddString("Doom, pc, 1993, n/a");
+    csv.AddString("Short");                     // short row
+
+    CsvQuery query(csv);
+    query.minRowsPerThread = 2;                 // spread even a small file over threads
+    EXPECT_EQ(query.Count(), 6u);
+
+    query.WhereIn(1, { "nes", "snes" });
+    EXPECT_EQ(query.Rows(), (vector<size_t> { 0, 1, 2 }));
+    query.WhereRange(2, 1980, 1988);
+    EXPECT_EQ(query.Select({ 0, 3 }), (vector<Strings> { { "Zelda", "9" }, { "Metroid", "7" } }));
+
+    query.ClearFilters().WhereRegex(0, "^[MD]");
+    EXPECT_EQ(query.Rows(), (vector<size_t> { 0, 2, 4 }));
+    CsvAggregate agg = query.Aggregate(3);
+    EXPECT_EQ(agg.count, 3u);
+    EXPECT_EQ(agg.numericCount, 2u);            // "n/a" isn't a number
+    EXPECT_EQ(agg.sum, 15.0);
+    EXPECT_EQ(agg.min, 7.0);
+    EXPECT_EQ(agg.max, 8.0);
+
+    query.ClearFilters();
+    vector<CsvGroup> groups = query.GroupBy(1, 3);
+    ASSERT_EQ(groups.size(), 5u);
+    EXPECT_EQ(groups[0].keys, (Strings { "" }));    // the short row
+    EXPECT_EQ(groups[2].keys, (Strings { "nes" }));
+    EXPECT_EQ(groups[2].values.count, 2u);
+    EXPECT_EQ(groups[2].values.Avg(), 8.0);
+
+    // cells holding the old key separator don't merge groups
+    CsvFile separators;
+    separators.AddRow({ "a\x1f" "b", "c", "1" });
+    separators.AddRow({ "a", "b\x1f" "c", "2" });
+    vector<CsvGroup> separated = CsvQuery(separators).GroupBy({ 0, 1 }, 2);
+    ASSERT_EQ(separated.size(), 2u);
+    EXPECT_EQ(separated[0].keys, (Strings { "a", "b\x1f" "c" }));
+    EXPECT_EQ(separated[1].values.sum, 1.0);
+
+    EXPECT_EQ(query.TopK(3, 2), (vector<size_t> { 3, 1 }));
+    EXPECT_EQ(query.TopK(2, 3, false), (vector<size_t> { 1, 2, 3 }));    // tie goes to the earlier row
+    EXPECT_EQ(query.WhereEquals(1, "pc").Count(), 1u);
+}
+
+//
+// test CsvFile schema inference and typed columns.
+//
+TEST(TestCsvFile, TestCsvFile_Schema) {
+    CsvFile csv;
+    csv.AddString("1, 2.5, yes, 2020-03-04 05:06:07, one");
+    csv.AddString("-7, 3, No, 2021-12-31 23:59:59, two");
+    csv.AddString(", , , , ");                                  // empty cells don't change the types
+    csv.AddString("42");                                        // short row
+
+    const CsvSchema& schema = csv.Schema();
+    ASSERT_EQ(schema.columns.size(), 5u);
+    EXPECT_EQ(schema.columns[0].type, CsvColumnType::Int64);
+    EXPECT_EQ(schema.columns[1].type, CsvColumnType::Double);
+    EXPECT_EQ(schema.columns[2].type, CsvColumnType::Bool);
+    EXPECT_EQ(schema.columns[3].type, CsvColumnType::Time);
+    EXPECT_EQ(schema.columns[4].type, CsvColumnType::String);
+
+    EXPECT_EQ(csv.GetInt64(1, 0), -7);
+    EXPECT_EQ(csv.GetInt64(3, 0), 42);
+    EXPECT_EQ(csv.GetDouble(0, 1), 2.5);
+    EXPECT_NE(csv.GetDouble(3, 1), csv.GetDouble(3, 1));     // NaN
+    EXPECT_FALSE(csv.IsValid(2, 1));
+    EXPECT_TRUE(csv.GetBool(0, 2));
+    EXPECT_FALSE(csv.GetBool(1, 2));
+    time_t t = 0;
+    EXPECT_TRUE(StringToTime_t("2021-12-31 23:59:59", &t, "%Y-%m-%d %H:%M:%S"));
+    EXPECT_EQ(csv.GetTime(1, 3), t);
+    EXPECT_EQ(Time_t_ToString(csv.GetTime(0, 3), "%Y-%m-%d %H:%M:%S"), "2020-03-04 05:06:07");
+    EXPECT_EQ(csv.ColumnSpan<int64_t>(0).size(), 4u);
+    EXPECT_TRUE(csv.ColumnSpan<double>(4).empty());
+
+    // changing the rows parses them again
+    csv.AddString("x, 1, yes");
+    EXPECT_EQ(csv.Schema().columns[0].type, CsvColumnType::String);
+
+    // explicit schema
+    CsvSchema explicitSchema;
+    explicitSchema.SetColumn(1, CsvColumnType::Int64);
+    csv.SetSchema(explicitSchema);
+    EXPECT_EQ(csv.Schema(), explicitSchema);
+    EXPECT_EQ(csv.GetInt64(1, 1), 3);
+    EXPECT_FALSE(csv.IsValid(0, 1));        // 2.5 isn't an Int64
+    EXPECT_EQ(csv.GetInt64(0, 0), 0);       // String column
+
+    // queries use the typed numbers
+    CsvQuery query(csv);
+    EXPECT_EQ(query.Aggregate(1).sum, 4.0);
+
+    // the same whether or not a typed value was asked for first
+    for (bool typedFirst : { false, true }) {
+        CsvFile bools;
+        bools.AddString("1,true");
+        bools.AddString("2,false");
+        bools.AddString("3,true");
+        if (typedFirst)
+            EXPECT_TRUE(bools.GetBool(0, 1));
+        EXPECT_EQ(CsvQuery(bools).WhereRange(1, 1, 1).Count(), 2u);
+    }
+
+    // times read in every format the same as StringToTime_t, from threads at once on a fresh file
+    CsvFile times;
+    Strings cells { "2020-03-08 01:59:59", "2020-03-08 03:00:00", "2020-11-01 01:30:00", "2021-12-31 23:59:59",
+                    "1999-01-02 3:04:05", "2020-02-29 12:00:00" };
+    for (const string& cell : cells)
+        times.AddRow({ cell, "Sun Mar  8 03:00:00 2020" });
+    vector<thread> threads;
+    vector<time_t> parsed(cells.size() * 4);
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&, i] {
+            for (size_t row = 0; row < cells.size(); ++row)
+                parsed[i * cells.size() + row] = times.GetTime(row, 0);
+        });
+    }
+    for (thread& worker : threads)
+        worker.join();
+    for (size_t i = 0; i < parsed.size(); ++i) {
+        EXPECT_TRUE(StringToTime_t(cells[i % cells.size()], &t, "%Y-%m-%d %H:%M:%S"));
+        EXPECT_EQ(parsed[i], t) << cells[i % cells.size()];
+    }
+    EXPECT_EQ(times.Schema().columns[1].timeFormat, "");
+    EXPECT_TRUE(StringToTime_t("Sun Mar  8 03:00:00 2020", &t));
+    EXPECT_EQ(times.GetTime(0, 1), t);
+    EXPECT_EQ(CsvQuery(times).Aggregate(0).min, static_cast<double>(times.GetTime(4, 0)));
+}
@@ -1,8 +1,18 @@
 #include "pch.h"
 #include "DirFile.h"
+#include "DirWalk.h"
+#include "DirIndex.h"
+#include "DirEntries.h"
+#include "FileCopy.h"
+#include "HashTree.h"
+#include "AsyncFile.h"
+#include "TextFileWriter.h"
+#include "TempFile.h"
 #include <filesystem>
 #include "Sep.h"
 #include <fstream>
+#include <chrono>
+#include <thread>
 
 using namespace std;
 using namespace Tau;
@@ -92,3 +102,428 @@ TEST(TestDirFile, TestDirFile) {
     DeleteFile(filePath);
 }
 
+
+//
+// test the recursive directory routines.
+//
+TEST(TestDirFile, TestDirFile_Walk) {
+    string testDir { "DirWalkTestArea" };
+    DeleteDir(testDir);
+    CreateDir(testDir + sep + "b" + sep + "c");
+    CreateDir(testDir + sep + "a");
+    ofstream(testDir + sep + "z.dat").put('a');
+    ofstream(testDir + sep + "a" + sep + "x.DAT").put('a');
+    ofstream(testDir + sep + "b" + sep + "c" + sep + "y.txt").put('a');
+
+    DirWalkOptions options;
+    options.sorted = true;
+    Strings all = DirWalk(testDir, [] (const DirWalkEntry&) { return true; },
+                                   [] (const DirWalkEntry& e) { return e.RelativePath(); }, options);
+    EXPECT_EQ(all, (Strings { "a", "b", "z.dat", "a" + sep + "x.DAT", "b" + sep + "c", "b" + sep + "c" + sep + "y.txt" }));
+
+    options.maxDepth = 0;
+    EXPECT_EQ(DirWalk(testDir, [] (const DirWalkEntry& e) { return e.IsFile(); },
+                               [] (const DirWalkEntry& e) { return string(e.name); }, options).size(), 1u);
+
+    // the _Recursive routines are in sorted walk order
+    Strings files = GetFileFullPathsInDir_Recursive(testDir);
+    EXPECT_EQ(files, (Strings { testDir + sep + "z.dat", testDir + sep + "a" + sep + "x.DAT", testDir + sep + "b" + sep + "c" + sep + "y.txt" }));
+
+    Strings dirs = GetSubDirPathsInDir_Recursive(testDir);
+    EXPECT_EQ(dirs, (Strings { "a", "b", "b" + sep + "c" }));
+    EXPECT_EQ(GetSubDirFullPathsInDir_Recursive(testDir).size(), 3u);
+
+    EXPECT_EQ(GetFileFullPathsWithExtInDir_Recursive(testDir, "dat").size(), 2u);
+    EXPECT_EQ(GetFileFullPathsWithTheseExtsInDir_Recursive(testDir, { ".txt", "DAT" }).size(), 3u);
+    EXPECT_EQ(GetFileFullPathsMatchingInDir_Recursive(testDir, { "[xy].*" }).size(), 2u);
+    EXPECT_EQ(GetFileNamesMatchingInDir(testDir, { "*.DAT" }), (Strings { "z.dat" }));
+
+    FileNameMatcher matcher({ "cue", ".verylongext" }, { "track??.wav", "[!a-c]*.iso" });
+    EXPECT_TRUE(matcher.Matches("Game.CUE"));
+    EXPECT_TRUE(matcher.Matches("x.VeryLongExt"));
+    EXPECT_FALSE(matcher.Matches(".cue"));          // a dot file has no extension
+    EXPECT_TRUE(matcher.Matches("Track01.wav"));
+    EXPECT_FALSE(matcher.Matches("track1.wav"));
+    EXPECT_TRUE(matcher.Matches("doom.iso"));
+    EXPECT_FALSE(matcher.Matches("Blue.iso"));
+    // the caller's lambdas are only called on the calling thread
+    thread::id caller = this_thread::get_id();
+    bool otherThread = false;
+    Strings names = GetDirectoryContents(testDir, [&] (fs::directory_entry& entry) {
+        otherThread |= this_thread::get_id() != caller;
+        return is_file(entry);
+    }, get_name, true);
+    EXPECT_FALSE(otherThread);
+    EXPECT_EQ(names, (Strings { "z.dat", "x.DAT", "y.txt" }));
+    // a separator on the end of the root isn't doubled in the paths
+    EXPECT_EQ(GetDirectoryContents(testDir + "/", is_file, get_fullpath, true), files);
+
+    // lazy enumeration, depth first, stopping early
+    Strings lazy;
+    for (const DirEntry& entry : DirEntries(testDir, options = DirWalkOptions { true, false, true })) {
+        lazy.push_back(entry.RelativePath());
+        if (entry.IsFile())
+            EXPECT_EQ(entry.Size(), 1u);
+        EXPECT_GT(entry.LastWriteTime(), 0);
+    }
+    EXPECT_EQ(lazy, (Strings { "a", "a" + sep + "x.DAT", "b", "b" + sep + "c", "b" + sep + "c" + sep + "y.txt", "z.dat" }));
+    string found;
+    for (const DirEntry& entry : DirEntries(testDir, true)) {
+        if (entry.IsFile()) {
+            found = entry.FullPath();
+            break;
+        }
+    }
+    EXPECT_TRUE(FileExists(found));
+    EXPECT_EQ(GetDirNamesInDir(testDir).size(), 2u);
+
+    DeleteDir(testDir);
+}
+
+//
+// test CopyTree.
+//
+TEST(TestDirFile, TestDirFile_Copy) {
+    string srcDir { "CopyTreeTestSrc" };
+    string destDir { "CopyTreeTestDest" };
+    DeleteDir(srcDir);
+    DeleteDir(destDir);
+    CreateDir(srcDir + sep + "a" + sep + "b");
+    ofstream(srcDir + sep + "small.txt") << "small";
+    {
+        ofstream big(srcDir + sep + "a" + sep + "big.bin", ios::binary);
+        for (int i = 0; i < 900000; ++i)
+            big.write(reinterpret_cast<const char*>(&i), sizeof(i));     // 3.6MB
+    }
+    ofstream(srcDir + sep + "a" + sep + "b" + sep + "empty.txt");
+    fs::last_write_time(srcDir + sep + "small.txt", fs::file_time_type::clock::now() - chrono::hours(24));
+
+    CopyOptions options;
+    options.preserveTimes = true;
+    options.largeFileSize = 1024 * 1024;        // big.bin goes in chunks
+    options.chunkSize = 1024 * 1024;
+    CopyProgress last;
+    options.progress = [&] (const CopyProgress& progress) { last = progress; };
+    CopyResult result;
+    EXPECT_TRUE(CopyTree(srcDir, destDir, options, &result));
+    EXPECT_EQ(result.filesCopied, 3u);
+    EXPECT_EQ(result.dirsCreated, 3u);
+    EXPECT_EQ(result.bytesCopied, 5u + 3600000u);
+    EXPECT_EQ(last.filesDone, 3u);
+    EXPECT_EQ(last.bytesDone, last.bytesTotal);
+    EXPECT_TRUE(CompareFiles(srcDir + sep + "a" + sep + "big.bin", destDir + sep + "a" + sep + "big.bin"));
+    EXPECT_TRUE(FileExists(destDir + sep + "a" + sep + "b" + sep + "empty.txt"));
+    EXPECT_EQ(fs::last_write_time(destDir + sep + "small.txt"), fs::last_write_time(srcDir + sep + "small.txt"));
+
+    // skip existing
+    ofstream(destDir + sep + "small.txt") << "changed";
+    options.overwriteExisting = false;
+    EXPECT_TRUE(CopyTree(srcDir, destDir, options, &result));
+    EXPECT_EQ(result.filesSkipped, 3u);
+    EXPECT_EQ(GetFileSize(destDir + sep + "small.txt"), 7u);
+    EXPECT_TRUE(CopyDir(srcDir, destDir));
+    EXPECT_EQ(GetFileSize(destDir + sep + "small.txt"), 5u);
+
+    DeleteDir(srcDir);
+    DeleteDir(destDir);
+}
+
+//
+// test CompareFiles.
+//
+TEST(TestDirFile, TestDirFile_Compare) {
+    string file1 = GetATempFilename();
+    string file2 = GetATempFilename();
+    ofstream(file1, ios::binary) << "one\r\ntwo\r\nthree\r\n";
+    ofstream(file2, ios::binary) << "one\ntwo\nthree";
+
+    EXPECT_TRUE(CompareFiles(file1, file1));
+    EXPECT_FALSE(CompareFiles(file1, file2));
+    EXPECT_TRUE(CompareFiles(file1, file2, true));
+
+    FileCompareResult result;
+    EXPECT_FALSE(CompareFiles(file1, file2, false, &result));
+    EXPECT_EQ(result.offset1, 3u);
+    EXPECT_EQ(result.line, 1u);
+
+    ofstream(file2, ios::binary) << "one\ntwo\nthr33\n";
+    EXPECT_FALSE(CompareFiles(file1, file2, true, &result));
+    EXPECT_EQ(result.offset1, 13u);
+    EXPECT_EQ(result.offset2, 11u);
+    EXPECT_EQ(result.line, 3u);
+
+    // only the line ending at the end of the last line is ignored
+    auto sameIgnoringCRLF = [&] (const char* text1, const char* text2) {
+        ofstream(file1, ios::binary | ios::trunc) << text1;
+        ofstream(file2, ios::binary | ios::trunc) << text2;
+        return CompareFiles(file1, file2, true);
+    };
+    EXPECT_TRUE(sameIgnoringCRLF("a\r\n", "a"));
+    EXPECT_TRUE(sameIgnoringCRLF("\r\n", "\n"));
+    EXPECT_FALSE(sameIgnoringCRLF("a\n\n", "a\n"));
+    EXPECT_FALSE(sameIgnoringCRLF("a\r\n\r\n", "a"));
+    EXPECT_FALSE(sameIgnoringCRLF("", "\n"));
+    EXPECT_FALSE(sameIgnoringCRLF("\n\n", "\n"));
+    EXPECT_FALSE(sameIgnoringCRLF("a\r", "a"));
+    EXPECT_FALSE(sameIgnoringCRLF("a\n\r", "a"));
+
+    EXPECT_FALSE(CompareFiles(file1, file1 + ".missing", false, &result));
+    EXPECT_TRUE(result.openFailed);
+
+    // a missing file compares the same as an empty one, as the line by line compare did
+    EXPECT_TRUE(CompareFiles(file1 + ".missing", file2 + ".missing"));
+    ofstream(file2, ios::binary | ios::trunc).flush();
+    EXPECT_TRUE(CompareFiles(file1 + ".missing", file2));
+    EXPECT_FALSE(CompareFileContents(file1 + ".missing", file2 + ".missing"));
+
+    DeleteFile(file1);
+    DeleteFile(file2);
+}
+
+//
+// test HashTree.
+//
+TEST(TestDirFile, TestDirFile_HashTree) {
+    string testDir { "HashTreeTestArea" };
+    DeleteDir(testDir);
+    CreateDir(testDir + sep + "a");
+    CreateDir(testDir + sep + "b");
+    string big(200000, 'x');
+    ofstream(testDir + sep + "a" + sep + "one.bin") << big;
+    ofstream(testDir + sep + "b" + sep + "copy.bin") << big;
+    big.back() = 'y';
+    ofstream(testDir + sep + "b" + sep + "last.bin") << big;     // same size and first block
+    big.back() = 'z';
+    ofstream(testDir + sep + "a" + sep + "unique.txt") << "only one this size";
+    ofstream(testDir + sep + "a" + sep + "small1.txt") << "abc";
+    ofstream(testDir + sep + "b" + sep + "small2.txt") << "abc";
+
+    HashTree hasher;
+    vector<Strings> duplicates = hasher.FindDuplicates({ testDir });
+    ASSERT_EQ(duplicates.size(), 2u);
+    EXPECT_EQ(duplicates[0], (Strings { testDir + sep + "a" + sep + "one.bin", testDir + sep + "b" + sep + "copy.bin" }));
+    EXPECT_EQ(duplicates[1], (Strings { testDir + sep + "a" + sep + "small1.txt", testDir + sep + "b" + sep + "small2.txt" }));
+    EXPECT_EQ(hasher.LastStats().partialHashes, 5u);       // not unique.txt
+    EXPECT_EQ(hasher.LastStats().fullHashes, 3u);          // the big ones
+
+    // a second scan comes from the cache, also after a save and load
+    string cachePath = GetATempFilename();
+    EXPECT_TRUE(hasher.SaveCache(cachePath));
+    HashTree loaded;
+    EXPECT_TRUE(loaded.LoadCache(cachePath));
+    EXPECT_EQ(loaded.CacheSize(), hasher.CacheSize());
+    EXPECT_EQ(loaded.FindDuplicates({ testDir }), duplicates);
+    EXPECT_EQ(loaded.LastStats().bytesRead, 0u);
+    DeleteFile(cachePath);
+
+    vector<HashedFile> before = loaded.Scan(testDir);
+    EXPECT_EQ(before.size(), 6u);
+    ofstream(testDir + sep + "a" + sep + "small1.txt") << "abd";
+    DeleteFile(testDir + sep + "a" + sep + "unique.txt");
+    ofstream(testDir + sep + "new.txt") << "new";
+    HashTreeChanges changes = HashTree::Diff(before, loaded.Scan(testDir));
+    EXPECT_EQ(changes.changed, (Strings { "a" + sep + "small1.txt" }));
+    EXPECT_EQ(changes.removed, (Strings { "a" + sep + "unique.txt" }));
+    EXPECT_EQ(changes.added, (Strings { "new.txt" }));
+
+    CopyDir(testDir + sep + "b", testDir + sep + "c");
+    ofstream(testDir + sep + "c" + sep + "last.bin") << big;      // same size and first block, different end
+    changes = loaded.CompareTrees(testDir + sep + "b", testDir + sep + "c");
+    EXPECT_EQ(changes.changed, (Strings { "last.bin" }));
+    EXPECT_TRUE(changes.added.empty() && changes.removed.empty());
+
+    DeleteDir(testDir);
+}
+
+//
+// test DirIndex.
+//
+TEST(TestDirFile, TestDirFile_AsyncFile) {
+    AsyncFile io;
+    Strings paths = { GetATempFilename(), GetATempFilename(), GetATempFilename() };
+    Strings contents = { "first", "", string(100000, 'x') };
+
+    for (auto& written : io.WriteFiles(paths, contents))
+        EXPECT_TRUE(written.get());
+
+    auto stats = io.StatFiles(paths);
+    auto reads = io.ReadFiles(paths);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        AsyncFileStat stat = stats[i].get();
+        AsyncFileData read = reads[i].get();
+        EXPECT_TRUE(stat.ok);
+        EXPECT_EQ(stat.size, contents[i].size());
+        EXPECT_TRUE(read.ok);
+        EXPECT_EQ(read.data, contents[i]);
+    }
+
+    EXPECT_EQ(io.ReadFileRange(paths[0], 1, 3).get().data, "irs");
+    EXPECT_EQ(io.ReadFileRange(paths[0], 3, 100).get().data, "st");
+    EXPECT_FALSE(io.ReadFile(paths[0] + ".missing").get().ok);
+    EXPECT_FALSE(io.Stat(paths[0] + ".missing").get().ok);
+
+    for (const string& path : paths)
+        DeleteFile(path);
+}
+
+TEST(TestDirFile, TestDirFile_TextFileWriter) {
+    string path = GetATempFilename();
+    EXPECT_TRUE(WriteStringsToTextFile({ "one", "two" }, path, true));
+    EXPECT_TRUE(AppendStringsToTextFile({ "three" }, path, true));
+    EXPECT_EQ(ReadTextFileAsAStringArray(path, true), Strings({ "one", "two", "three" }));
+
+    // atomic replace.  the old contents stay until Close()
+    TextFileWriter::Options options;
+    options.atomicReplace = true;
+    options.bufferSize = 64;
+    options.sync = TextFileWriter::SyncPolicy::OnClose;
+    TextFileWriter writer(options);
+    EXPECT_TRUE(writer.Open(path));
+    Strings lines;
+    for (int i = 0; i < 1000; ++i)
+        lines.push_back("line " + to_string(i));
+    EXPECT_TRUE(writer.WriteLines(lines));
+    EXPECT_EQ(ReadTextFileAsAStringArray(path, true).size(), 3u);
+    EXPECT_TRUE(writer.Close());
+    EXPECT_EQ(ReadTextFileAsAStringArray(path, true), lines);
+
+    EXPECT_TRUE(writer.Open(path));
+    writer.WriteLine("dropped");
+    writer.Discard();
+    EXPECT_EQ(ReadTextFileAsAStringArray(path, true), lines);
+
+#if !defined(_WIN32)
+    // the replacement keeps the permissions of the file it replaces
+    fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+    EXPECT_TRUE(writer.Open(path));
+    writer.WriteLine("replaced");
+    EXPECT_TRUE(writer.Close());
+    EXPECT_EQ(fs::status(path).permissions(), fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+    EXPECT_TRUE(writer.Open(path));
+    EXPECT_TRUE(writer.WriteLines(lines));
+    EXPECT_TRUE(writer.Close());
+#endif
+
+    // a log kept open
+    TextFileWriter::Options logOptions;
+    logOptions.autoFlush = true;
+    TextFileWriter log(logOptions);
+    EXPECT_TRUE(log.Open(path, /*append*/ true));
+    log.WriteLine("logged");
+    EXPECT_EQ(ReadTextFileAsAStringArray(path, true).back(), "logged");
+    EXPECT_TRUE(log.Close());
+
+    // '\n' in the text as "\r\n", one already after a '\r' left alone, even across writes
+    TextFileWriter::Options crlfOptions;
+    crlfOptions.translateNewlines = true;
+    crlfOptions.lineEnding = "\r\n";
+    TextFileWriter crlf(crlfOptions);
+    EXPECT_TRUE(crlf.Open(path));
+    crlf.Write("a\nb\r");
+    crlf.Write("\nc");
+    crlf.WriteLine("d");
+    EXPECT_TRUE(crlf.Close());
+    ifstream written(path, ios::binary);
+    EXPECT_EQ(string(istreambuf_iterator<char>(written), {}), "a\r\nb\r\ncd\r\n");
+    written.close();
+
+    DeleteFile(path);
+}
+
+TEST(TestDirFile, TestDirFile_TempFile) {
+    EXPECT_NE(GetATempFilename(), GetATempFilename());
+    EXPECT_TRUE(DirExists(GetTempDir()));
+
+    string path;
+    {
+        TempFile temp;
+        EXPECT_TRUE(temp.Create("test", ".txt", TempLocation::Memory));
+        path = temp.Path();
+        EXPECT_TRUE(FileExists(path));
+        EXPECT_EQ(path.substr(path.size() - 4), ".txt");
+    }
+    EXPECT_FALSE(FileExists(path));
+
+    TempFile anonymous;
+    EXPECT_TRUE(anonymous.CreateAnonymous());
+    EXPECT_TRUE(anonymous.IsOpen());
+
+    string dirPath;
+    {
+        TempDirectory dir;
+        EXPECT_TRUE(dir.Create());
+        dirPath = dir.Path();
+        WriteStringsToTextFile({ "x" }, dirPath + sep + "file.txt", true);
+    }
+    EXPECT_FALSE(DirExists(dirPath));
+
+    // files are reused
+    ScratchPool pool("test");
+    for (int i = 0; i < 10; ++i) {
+        ScratchFile scratch = pool.Acquire();
+        EXPECT_TRUE(scratch.IsOpen());
+        EXPECT_EQ(GetFileSize(scratch.Path()), 0u);
+        AppendStringsToTextFile({ "scratch" }, scratch.Path(), true);
+    }
+    EXPECT_EQ(pool.CreatedCount(), 1u);
+    EXPECT_EQ(pool.IdleCount(), 1u);
+}
+
+TEST(TestDirFile, TestDirFile_Index) {
+    string testDir { "DirIndexTestArea" };
+    DeleteDir(testDir);
+    CreateDir(testDir + sep + "a" + sep + "b");
+    ofstream(testDir + sep + "one.txt") << "12345";
+    ofstream(testDir + sep + "a" + sep + "two.txt") << "12";
+
+    DirIndex index;
+    ASSERT_TRUE(index.Build(testDir));
+    EXPECT_EQ(index.DirCount(), 3u);
+    EXPECT_TRUE(index.FileExists(testDir + sep + "one.txt"));
+    EXPECT_TRUE(index.FileExists("a" + sep + "two.txt"));      // relative to the root
+    EXPECT_FALSE(index.FileExists(testDir + sep + "a"));
+    EXPECT_TRUE(index.DirExists(testDir + sep + "a" + sep + "b"));
+    EXPECT_EQ(index.GetFileSize(testDir + sep + "one.txt"), 5u);
+    EXPECT_EQ(index.GetDirNamesInDir(testDir), (Strings { "a" }));
+    EXPECT_EQ(index.GetFileNamesInDir(testDir + sep + "a"), (Strings { "two.txt" }));
+
+    // a snapshot loads back the same
+    string snapshot = GetATempFilename();
+    EXPECT_TRUE(index.Save(snapshot));
+    DirIndex loaded;
+    EXPECT_TRUE(loaded.Load(snapshot));
+    EXPECT_EQ(loaded.EntryCount(), index.EntryCount());
+    EXPECT_EQ(loaded.GetFileSize("one.txt"), 5u);
+    DeleteFile(snapshot);
+
+    // refresh by directory times
+    EXPECT_EQ(loaded.Refresh(), 0u);
+    DeleteDir(testDir + sep + "a");
+    CreateDir(testDir + sep + "c" + sep + "d");
+    EXPECT_GT(loaded.Refresh(), 0u);
+    EXPECT_FALSE(loaded.DirExists("a"));
+    EXPECT_FALSE(loaded.FileExists("a" + sep + "two.txt"));
+    EXPECT_TRUE(loaded.DirExists("c" + sep + "d"));
+    EXPECT_EQ(loaded.DirCount(), 3u);
+
+    // refresh by inotify events
+    if (index.Watch()) {
+        ofstream(testDir + sep + "one.txt") << "1234567";
+        EXPECT_GT(index.Refresh(), 0u);
+        EXPECT_EQ(index.GetFileSize("one.txt"), 7u);
+        EXPECT_TRUE(index.DirExists("c" + sep + "d"));
+        EXPECT_FALSE(index.DirExists("a"));
+        EXPECT_EQ(index.Refresh(), 0u);
+
+        // a directory removed and made again between refreshes is watched again
+        DeleteDir(testDir + sep + "c" + sep + "d");
+        CreateDir(testDir + sep + "c" + sep + "d");
+        EXPECT_GT(index.Refresh(), 0u);
+        ofstream(testDir + sep + "c" + sep + "d" + sep + "f2") << "1";
+        EXPECT_GT(index.Refresh(), 0u);
+        EXPECT_TRUE(index.FileExists("c" + sep + "d" + sep + "f2"));
+        EXPECT_TRUE(index.IsWatching());
+    }
+
+    DeleteDir(testDir);
+}
@@ -0,0 +1,345 @@
+#include "pch.h"
+#include "Tau_Process.h"
+#include "Tau_ProcessPool.h"
+#include "Tau_Exec.h"
+#include "DirFile.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace Tau;
+namespace fs = std::filesystem;
+
+//
+// run a line in the shell
+//
+static ProcessResult runShell(const string& line, const ProcessOptions& options = {}) {
+#if defined(_WIN32)
+    return Process::Run("cmd", { "/c", line }, options);
+#else
+    return Process::Run("/bin/sh", { "-c", line }, options);
+#endif
+}
+
+static bool startShell(Process* process, const string& line, const ProcessOptions& options = {}) {
+#if defined(_WIN32)
+    return process->Start("cmd", { "/c", line }, options);
+#else
+    return process->Start("/bin/sh", { "-c", line }, options);
+#endif
+}
+
+static ProcessJob shellJob(const string& line) {
+#if defined(_WIN32)
+    return ProcessJob { "cmd", { "/c", line } };
+#else
+    return ProcessJob { "/bin/sh", { "-c", line } };
+#endif
+}
+
+#if defined(_WIN32)
+static const string sleepFiveSeconds = "ping -n 6 127.0.0.1 > nul";
+static const string sleepOneSecond = "ping -n 2 127.0.0.1 > nul";
+#else
+static const string sleepFiveSeconds = "sleep 5";
+static const string sleepOneSecond = "sleep 1";
+#endif
+
+//
+// test the exit code, and stdout and stderr captured apart and merged.
+//
+TEST(TestProcess, TestProcess_Output) {
+    ProcessResult result = runShell("exit 3");
+    EXPECT_TRUE(result.started);
+    EXPECT_EQ(result.exitCode, 3);
+    EXPECT_EQ(result.output, "");
+
+    ProcessOptions options;
+    options.captureOutput = true;
+    options.captureErrors = true;
+    result = runShell("echo out&& echo err 1>&2", options);
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_EQ(trim(result.output), "out");
+    EXPECT_EQ(trim(result.errors), "err");
+
+    options.mergeErrors = true;
+    result = runShell("echo out&& echo err 1>&2", options);
+    EXPECT_NE(result.output.find("out"), string::npos);
+    EXPECT_NE(result.output.find("err"), string::npos);
+    EXPECT_EQ(result.errors, "");
+}
+
+//
+// test stdin much bigger than a pipe's buffer, echoed back while it's written.
+//
+TEST(TestProcess, TestProcess_Input) {
+    ProcessOptions options;
+    options.pipeInput = true;
+    options.captureOutput = true;
+    for (int i = 0; i < 50000; ++i)
+        options.input += "line " + to_string(i) + "\r\n";
+
+#if defined(_WIN32)
+    ProcessResult result = Process::Run("findstr", { "^" }, options);
+#else
+    ProcessResult result = Process::Run("cat", {}, options);
+#endif
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_EQ(result.output.size(), options.input.size());
+    EXPECT_TRUE(result.output == options.input);
+}
+
+//
+// test WaitFor timing out, then Kill.
+//
+TEST(TestProcess, TestProcess_Kill) {
+    Process process;
+    EXPECT_TRUE(startShell(&process, sleepFiveSeconds));
+    EXPECT_TRUE(process.IsRunning());
+
+    ProcessResult result;
+    auto start = chrono::steady_clock::now();
+    EXPECT_FALSE(process.WaitFor(chrono::milliseconds(50), &result));
+    EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(50));
+    EXPECT_TRUE(process.IsRunning());
+
+    EXPECT_TRUE(process.Kill());
+    result = process.Wait();
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(4));
+    EXPECT_TRUE(result.started);
+#if defined(_WIN32)
+    EXPECT_EQ(result.exitCode, 1);
+#else
+    EXPECT_EQ(result.signal, 9);
+    EXPECT_EQ(result.exitCode, 128 + 9);
+#endif
+    EXPECT_FALSE(process.IsRunning());
+    EXPECT_FALSE(process.Kill());
+
+    // WaitFor with the time to finish
+    EXPECT_TRUE(startShell(&process, "exit 4"));
+    EXPECT_TRUE(process.WaitFor(chrono::seconds(10), &result));
+    EXPECT_EQ(result.exitCode, 4);
+}
+
+//
+// test a program that doesn't exist.
+//
+TEST(TestProcess, TestProcess_Missing) {
+    Process process;
+    EXPECT_FALSE(process.Start("no_such_program_tau_test"));
+    EXPECT_FALSE(process.IsRunning());
+
+    ProcessResult result = Process::Run(GetATempFilename());
+    EXPECT_FALSE(result.started);
+    EXPECT_EQ(result.exitCode, -1);
+}
+
+//
+// test workingDir, and a relative command found from it.
+//
+TEST(TestProcess, TestProcess_WorkingDir) {
+    fs::path ours = fs::current_path();
+    fs::path dir = GetATempFilename();
+    fs::create_directory(dir);
+
+    ProcessOptions options;
+    options.captureOutput = true;
+    options.workingDir = dir.string();
+#if defined(_WIN32)
+    ProcessResult result = runShell("cd", options);
+#else
+    ProcessResult result = runShell("pwd", options);
+#endif
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_TRUE(fs::equivalent(fs::path(trim(result.output)), dir));
+    EXPECT_EQ(fs::current_path(), ours);
+
+#if !defined(_WIN32)
+    {
+        ofstream script(dir / "tau_test.sh");
+        script << "#!/bin/sh\necho relative\n";
+    }
+    fs::permissions(dir / "tau_test.sh", fs::perms::owner_all);
+    options.searchPath = false;
+    result = Process::Run("./tau_test.sh", {}, options);
+    EXPECT_EQ(result.exitCode, 0);
+    EXPECT_EQ(trim(result.output), "relative");
+#endif
+
+    error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+//
+// test programs started from many threads at once, each in its own directory.  each sees the end of its own output
+// (no other child holds the pipe open) and its own working directory (ours is never changed).
+//
+TEST(TestProcess, TestProcess_ConcurrentLaunch) {
+    const int threadCount = 8;
+    const int runsPerThread = 4;
+    vector<fs::path> dirs;
+    for (int i = 0; i < threadCount; ++i) {
+        dirs.push_back(GetATempFilename());
+        fs::create_directory(dirs.back());
+    }
+
+    vector<Strings> outputs(threadCount);
+    vector<vector<int>> exitCodes(threadCount);
+    vector<thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&, i] {
+            ProcessOptions options;
+            options.captureOutput = true;
+            options.pipeInput = true;
+            options.input = "unread";
+            options.workingDir = dirs[i].string();
+            for (int run = 0; run < runsPerThread; ++run) {
+#if defined(_WIN32)
+                outputs[i].push_back(trim(runShell("cd", options).output));
+                exitCodes[i].push_back(ExecuteInPassedDir(dirs[i].string(), "cmd", true, { "/c", "exit 7" }));
+#else
+                outputs[i].push_back(trim(runShell("pwd", options).output));
+                exitCodes[i].push_back(ExecuteInPassedDir(dirs[i].string(), "/bin/sh", true, { "-c", "exit 7" }));
+#endif
+            }
+        });
+    }
+    for (thread& worker : threads)
+        worker.join();
+
+    error_code ec;
+    for (int i = 0; i < threadCount; ++i) {
+        ASSERT_EQ(outputs[i].size(), size_t(runsPerThread));
+        for (const string& output : outputs[i])
+            EXPECT_TRUE(fs::equivalent(fs::path(output), dirs[i], ec)) << output;
+        EXPECT_EQ(exitCodes[i], vector<int>(runsPerThread, 7));
+    }
+
+    for (const fs::path& dir : dirs)
+        fs::remove_all(dir, ec);
+}
+
+//
+// test ProcessPool running jobs in parallel, and streaming their output.
+//
+TEST(TestProcess, TestProcess_Pool) {
+    ProcessPool pool(4);
+    EXPECT_EQ(pool.MaxParallel(), 4u);
+
+    auto start = chrono::steady_clock::now();
+    vector<future<ProcessJobResult>> results;
+    for (int i = 0; i < 4; ++i)
+        results.push_back(pool.Submit(shellJob(sleepOneSecond)));
+    pool.Wait();
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(3));     // not one after another
+    EXPECT_EQ(pool.Pending(), 0u);
+    for (future<ProcessJobResult>& result : results) {
+        ProcessJobResult done = result.get();
+        EXPECT_TRUE(done.process.started);
+        EXPECT_EQ(done.process.exitCode, 0);
+        EXPECT_FALSE(done.timedOut);
+        EXPECT_FALSE(done.cancelled);
+    }
+
+    string output, errors;
+    ProcessJob job = shellJob("echo out&& echo err 1>&2&& exit 2");
+    job.onOutput = [&](string_view text) { output += text; };
+    job.onErrors = [&](string_view text) { errors += text; };
+    ProcessJobResult streamed = pool.Submit(job).get();
+    EXPECT_EQ(streamed.process.exitCode, 2);
+    EXPECT_EQ(trim(output), "out");
+    EXPECT_EQ(trim(errors), "err");
+    EXPECT_EQ(streamed.process.output, "");     // what's passed isn't kept
+
+    // a program that can't be started
+    ProcessJobResult missing = pool.Submit(ProcessJob { "no_such_program_tau_test" }).get();
+    EXPECT_FALSE(missing.process.started);
+}
+
+//
+// test ProcessPool timeouts, and cancelling queued and running jobs.
+//
+TEST(TestProcess, TestProcess_PoolCancel) {
+    ProcessPool pool(1);
+
+    auto start = chrono::steady_clock::now();
+    ProcessJob slow = shellJob(sleepFiveSeconds);
+    slow.timeout = chrono::milliseconds(100);
+    ProcessJobResult timedOut = pool.Submit(slow).get();
+    EXPECT_TRUE(timedOut.process.started);
+    EXPECT_TRUE(timedOut.timedOut);
+    EXPECT_FALSE(timedOut.cancelled);
+    EXPECT_NE(timedOut.process.exitCode, 0);
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(4));
+
+    // one running, one queued behind it
+    uint64_t runningId = 0, queuedId = 0;
+    future<ProcessJobResult> running = pool.Submit(shellJob(sleepFiveSeconds), &runningId);
+    future<ProcessJobResult> queued = pool.Submit(shellJob(sleepFiveSeconds), &queuedId);
+    this_thread::sleep_for(chrono::milliseconds(200));
+    start = chrono::steady_clock::now();
+    EXPECT_TRUE(pool.Cancel(queuedId));
+    ProcessJobResult notStarted = queued.get();
+    EXPECT_TRUE(notStarted.cancelled);
+    EXPECT_FALSE(notStarted.process.started);
+    EXPECT_TRUE(pool.Cancel(runningId));
+    ProcessJobResult killed = running.get();
+    EXPECT_TRUE(killed.cancelled);
+    EXPECT_TRUE(killed.process.started);
+    EXPECT_FALSE(killed.timedOut);
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(4));
+    EXPECT_FALSE(pool.Cancel(runningId));       // finished
+
+    // CancelAll: the running job is killed and the queued ones never start
+    vector<future<ProcessJobResult>> results;
+    for (int i = 0; i < 3; ++i)
+        results.push_back(pool.Submit(shellJob(sleepFiveSeconds)));
+    this_thread::sleep_for(chrono::milliseconds(200));
+    start = chrono::steady_clock::now();
+    pool.CancelAll();
+    pool.Wait();
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::seconds(4));
+    ProcessJobResult first = results[0].get();
+    EXPECT_TRUE(first.cancelled);
+    EXPECT_TRUE(first.process.started);
+    for (size_t i = 1; i < results.size(); ++i) {
+        ProcessJobResult rest = results[i].get();
+        EXPECT_TRUE(rest.cancelled);
+        EXPECT_FALSE(rest.process.started);
+    }
+}
+
+#if !defined(_WIN32)
+//
+// test a ProcessPool that can't make its descriptors: its jobs fail instead of hanging.
+//
+TEST(TestProcess, TestProcess_PoolNoDescriptors) {
+    rlimit limit;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+    rlimit lowered = limit;
+    lowered.rlim_cur = 256;
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+    vector<int> used;
+    for (int fd; (fd = dup(0)) >= 0; )
+        used.push_back(fd);
+
+    {
+        ProcessPool pool(2);
+        ProcessJobResult result = pool.Submit(shellJob("exit 0")).get();
+        EXPECT_TRUE(result.failed);
+        EXPECT_FALSE(result.process.started);
+        pool.Wait();
+        EXPECT_EQ(pool.Pending(), 0u);
+    }
+
+    for (int fd : used)
+        close(fd);
+    setrlimit(RLIMIT_NOFILE, &limit);
+}
+#endif
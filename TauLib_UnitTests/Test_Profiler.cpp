@@ -0,0 +1,626 @@
+#include "pch.h"
+#include "Tau_Profiler.h"
+#include "Tau_Timer.h"
+#include "Tau_TraceExport.h"
+#include "Tau_Histogram.h"
+#include "Tau_Bench.h"
+#include "DirFile.h"
+#include "ThirdParty/json.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+using namespace std;
+using namespace Tau;
+using json = nlohmann::json;
+
+//
+// the report's node for a zone name.  nullptr if it isn't there.
+//
+static const ProfileNodeStats* findNode(const vector<ProfileNodeStats>& report, const string& name) {
+    auto found = find_if(report.begin(), report.end(), [&](const ProfileNodeStats& stats) { return stats.name == name; });
+    return (found != report.end()) ? &*found : nullptr;
+}
+
+//
+// ProfileCounter - counts the events a sink is given
+//
+class ProfileCounter : public ProfileSink {
+public:
+    void Consume(const vector<ProfileEvent>& events) override { count += events.size(); }
+    size_t count {0};
+};
+
+static void profiledInner() {
+    TAU_PROFILE_ZONE("TestProfiler inner");
+}
+
+static void profiledOuter() {
+    TAU_PROFILE_ZONE("TestProfiler outer");
+    profiledInner();
+    profiledInner();
+}
+
+//
+// test nested zones, Collect and Report counts, sinks and Reset.
+//
+TEST(TestProfiler, TestProfiler_Zones) {
+    Profiler::Collect();
+    Profiler::Reset();
+    auto counter = make_shared<ProfileCounter>();
+    Profiler::AddSink(counter);
+
+    for (int i = 0; i < 3; ++i)
+        profiledOuter();
+    EXPECT_EQ(Profiler::Collect(), 9u);
+    EXPECT_EQ(counter->count, 9u);
+
+    vector<ProfileNodeStats> report = Profiler::Report();
+    const ProfileNodeStats* outer = findNode(report, "TestProfiler outer");
+    const ProfileNodeStats* inner = findNode(report, "TestProfiler inner");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(outer->count, 3u);
+    EXPECT_EQ(inner->count, 6u);
+    EXPECT_EQ(inner->depth, outer->depth + 1);
+    EXPECT_EQ(inner, outer + 1);                    // under it, depth first
+    EXPECT_GE(outer->totalNs, inner->totalNs);
+    EXPECT_LE(outer->minNs, outer->p50Ns);
+    EXPECT_LE(outer->p50Ns, outer->maxNs);
+    EXPECT_EQ(Profiler::Zone(outer->zone).name, "TestProfiler outer");
+    EXPECT_EQ(Profiler::Zone(outer->zone).file, __FILE__);
+    EXPECT_NE(Profiler::ReportText().find("  TestProfiler inner"), string::npos);
+    uint32_t outerZone = outer->zone;
+
+    // a Tau_Timer is a zone too, nothing is recorded while the profiler is off
+    {
+        Tau_Timer timer("TestProfiler timer");
+    }
+    Profiler::SetEnabled(false);
+    profiledOuter();
+    {
+        Tau_Timer timer("TestProfiler timer");
+    }
+    Profiler::SetEnabled(true);
+    report = Profiler::Report();
+    ASSERT_NE(findNode(report, "TestProfiler timer"), nullptr);
+    EXPECT_EQ(findNode(report, "TestProfiler timer")->count, 1u);
+    EXPECT_EQ(findNode(report, "TestProfiler outer")->count, 3u);
+    EXPECT_EQ(counter->count, 10u);
+
+    // the same name, file and line is the same zone
+    EXPECT_EQ(Profiler::RegisterZone("TestProfiler outer", __FILE__, Profiler::Zone(outerZone).line), outerZone);
+
+    Profiler::Reset();
+    report = Profiler::Report();
+    EXPECT_EQ(findNode(report, "TestProfiler outer"), nullptr);
+    EXPECT_EQ(findNode(report, "TestProfiler timer"), nullptr);
+
+    Profiler::RemoveSink(counter);
+    profiledOuter();
+    Profiler::Collect();
+    EXPECT_EQ(counter->count, 10u);
+    Profiler::Reset();
+}
+
+//
+// test zones collected while the zone they're in is still open: they go under it, the same as once it has ended.
+//
+TEST(TestProfiler, TestProfiler_OpenZone) {
+    Profiler::Collect();
+    Profiler::Reset();
+    {
+        TAU_PROFILE_ZONE("TestProfiler open");
+        profiledOuter();
+        EXPECT_EQ(Profiler::Collect(), 3u);
+        vector<ProfileNodeStats> report = Profiler::Report();
+        const ProfileNodeStats* open = findNode(report, "TestProfiler open");
+        ASSERT_NE(open, nullptr);
+        EXPECT_EQ(open->count, 0u);
+        EXPECT_EQ(open + 1, findNode(report, "TestProfiler outer"));
+        EXPECT_EQ(open + 2, findNode(report, "TestProfiler inner"));
+        profiledInner();
+    }
+    vector<ProfileNodeStats> report = Profiler::Report();
+    const ProfileNodeStats* open = findNode(report, "TestProfiler open");
+    ASSERT_NE(open, nullptr);
+    EXPECT_EQ(open->count, 1u);
+    ASSERT_EQ(report.end() - report.begin() - (open - report.data()), 4);
+    EXPECT_EQ(open[1].name, "TestProfiler outer");
+    EXPECT_EQ(open[1].depth, open->depth + 1);
+    EXPECT_EQ(open[2].name, "TestProfiler inner");
+    EXPECT_EQ(open[2].count, 2u);
+    EXPECT_EQ(open[3].name, "TestProfiler inner");      // the one right under the open zone
+    EXPECT_EQ(open[3].depth, open->depth + 1);
+    EXPECT_EQ(open[3].count, 1u);
+    Profiler::Reset();
+}
+
+//
+// test a ring that fills up before it's collected: what doesn't fit is counted in Dropped().
+//
+TEST(TestProfiler, TestProfiler_Dropped) {
+    Profiler::Collect();
+    uint64_t droppedBefore = Profiler::Dropped();
+
+    // 100 zones are 100 records, in a new thread's 64 record ring
+    Profiler::SetRingCapacity(64);
+    thread worker([] {
+        Profiler::SetThreadName("TestProfiler worker");
+        for (int i = 0; i < 100; ++i)
+            profiledInner();
+    });
+    worker.join();
+    Profiler::SetRingCapacity(16384);
+
+    vector<ProfileThreadInfo> threads = Profiler::Threads();
+    EXPECT_TRUE(any_of(threads.begin(), threads.end(),
+                       [](const ProfileThreadInfo& info) { return info.name == "TestProfiler worker"; }));
+    EXPECT_EQ(Profiler::Dropped() - droppedBefore, 100u - 64u);
+    EXPECT_EQ(Profiler::Collect(), 64u);            // the 64 records that fit
+    EXPECT_EQ(Profiler::Dropped() - droppedBefore, 100u - 64u);     // still counted once the thread's ring is gone
+    Profiler::Reset();
+}
+
+//
+// a file's bytes
+//
+static string readBinaryFile(const string& path) {
+    ifstream file(path, ios::binary);
+    return string(istreambuf_iterator<char>(file), {});
+}
+
+//
+// test a Chrome JSON trace: it parses, zones are complete events nested on their thread, counters and thread names.
+//
+TEST(TestProfiler, TestProfiler_TraceChromeJson) {
+    string path = GetATempFilename();
+    Profiler::Collect();
+    Profiler::SetThreadName("TestProfiler main");
+
+    TraceExporter trace;
+    ASSERT_TRUE(trace.Open(path, TraceFormat::ChromeJson, chrono::milliseconds(0)));
+    EXPECT_TRUE(trace.IsOpen());
+    for (int i = 0; i < 2; ++i)
+        profiledOuter();
+    trace.Counter("TestProfiler \"games\"", 42);
+    Profiler::Collect();
+    EXPECT_TRUE(trace.Close());
+    EXPECT_FALSE(trace.IsOpen());
+    EXPECT_GE(trace.EventsWritten(), 7u);
+    EXPECT_EQ(trace.EventsDropped(), 0u);
+
+    json parsed = json::parse(readBinaryFile(path));
+    ASSERT_TRUE(parsed["traceEvents"].is_array());
+    vector<json> outers, inners;
+    bool counter = false, threadName = false;
+    for (const json& event : parsed["traceEvents"]) {
+        if (event["ph"] == "X" && event["name"] == "TestProfiler outer")
+            outers.push_back(event);
+        else if (event["ph"] == "X" && event["name"] == "TestProfiler inner")
+            inners.push_back(event);
+        else if (event["ph"] == "C" && event["name"] == "TestProfiler \"games\"")
+            counter = event["args"]["value"] == 42;
+        else if (event["ph"] == "M" && event["args"]["name"] == "TestProfiler main")
+            threadName = true;
+    }
+    ASSERT_EQ(outers.size(), 2u);
+    ASSERT_EQ(inners.size(), 4u);
+    EXPECT_TRUE(counter);
+    EXPECT_TRUE(threadName);
+    for (const json& inner : inners) {
+        auto outer = find_if(outers.begin(), outers.end(), [&](const json& outer) {
+            return outer["tid"] == inner["tid"] && outer["ts"].get<double>() <= inner["ts"].get<double>() + 0.001 &&
+                   inner["ts"].get<double>() + inner["dur"].get<double>() <=
+                   outer["ts"].get<double>() + outer["dur"].get<double>() + 0.002;
+        });
+        EXPECT_NE(outer, outers.end());
+    }
+    DeleteFile(path);
+}
+
+//
+// ProtoField - a protobuf field as read back from a trace
+//
+struct ProtoField {
+    uint32_t field {0};
+    uint64_t value {0};         // varint and fixed
+    string bytes;               // length delimited
+};
+
+static bool readVarint(const string& in, size_t* at, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *at < in.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[(*at)++]);
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+//
+// the fields of a message.  false if the framing is broken anywhere.
+//
+static bool readFields(const string& in, vector<ProtoField>* fields) {
+    size_t at = 0;
+    while (at < in.size()) {
+        uint64_t tag;
+        if (!readVarint(in, &at, &tag))
+            return false;
+        ProtoField field;
+        field.field = static_cast<uint32_t>(tag >> 3);
+        switch (tag & 7) {
+        case 0:
+            if (!readVarint(in, &at, &field.value))
+                return false;
+            break;
+        case 1:
+            if (in.size() - at < 8)
+                return false;
+            memcpy(&field.value, in.data() + at, 8);
+            at += 8;
+            break;
+        case 2: {
+            uint64_t length;
+            if (!readVarint(in, &at, &length) || length > in.size() - at)
+                return false;
+            field.bytes = in.substr(at, static_cast<size_t>(length));
+            at += static_cast<size_t>(length);
+            break;
+        }
+        default:
+            return false;
+        }
+        fields->push_back(move(field));
+    }
+    return true;
+}
+
+//
+// test a Perfetto trace's framing: a run of TracePackets (field 1) to the end of the file, each a valid message, with
+// a begin and end for every zone and the counter's value.
+//
+TEST(TestProfiler, TestProfiler_TracePerfetto) {
+    string path = GetATempFilename();
+    Profiler::Collect();
+
+    TraceExporter trace;
+    ASSERT_TRUE(trace.Open(path, TraceFormat::Perfetto, chrono::milliseconds(0)));
+    for (int i = 0; i < 2; ++i)
+        profiledOuter();
+    trace.Counter("TestProfiler counter", 2.5);
+    EXPECT_TRUE(trace.Close());
+
+    vector<ProtoField> packets;
+    ASSERT_TRUE(readFields(readBinaryFile(path), &packets));
+    ASSERT_FALSE(packets.empty());
+    int begins = 0, ends = 0, outerBegins = 0, descriptors = 0;
+    double counterValue = 0;
+    for (const ProtoField& packet : packets) {
+        EXPECT_EQ(packet.field, 1u);
+        vector<ProtoField> fields;
+        ASSERT_TRUE(readFields(packet.bytes, &fields));
+        for (const ProtoField& field : fields) {
+            if (field.field == 60)
+                ++descriptors;
+            if (field.field != 11)
+                continue;
+            vector<ProtoField> trackEvent;
+            ASSERT_TRUE(readFields(field.bytes, &trackEvent));
+            uint64_t type = 0;
+            string name;
+            double value = 0;
+            for (const ProtoField& eventField : trackEvent) {
+                if (eventField.field == 9)
+                    type = eventField.value;
+                else if (eventField.field == 23)
+                    name = eventField.bytes;
+                else if (eventField.field == 44)
+                    memcpy(&value, &eventField.value, sizeof(value));
+            }
+            if (type == 1)
+                ++begins;
+            else if (type == 2)
+                ++ends;
+            else if (type == 4)
+                counterValue = value;
+            if (type == 1 && name == "TestProfiler outer")
+                ++outerBegins;
+        }
+    }
+    EXPECT_GE(descriptors, 3);          // the process, this thread and the counter
+    EXPECT_EQ(outerBegins, 2);
+    EXPECT_GE(begins, 6);
+    EXPECT_EQ(begins, ends);
+    EXPECT_EQ(counterValue, 2.5);
+    DeleteFile(path);
+}
+
+//
+// test BucketOf and BucketValue: a value comes back within 1 / 2^(subBucketBits-1) of itself, exactly below
+// 2^subBucketBits, over the whole uint64_t range.
+//
+TEST(TestProfiler, TestProfiler_HistogramBuckets) {
+    mt19937_64 random(12345);
+    for (int bits : { 5, 7 }) {
+        vector<uint64_t> values;
+        for (uint64_t value = 0; value < 1000; ++value)
+            values.push_back(value);
+        for (int power = 1; power < 64; ++power) {
+            values.push_back((uint64_t(1) << power) - 1);
+            values.push_back(uint64_t(1) << power);
+            values.push_back((uint64_t(1) << power) + 1);
+        }
+        for (int i = 0; i < 10000; ++i)
+            values.push_back(random() >> (random() % 64));
+        values.push_back(UINT64_MAX);
+
+        size_t lastBucket = 0;
+        uint64_t lastValue = 0;
+        sort(values.begin(), values.end());
+        for (uint64_t value : values) {
+            size_t bucket = HistogramCounts::BucketOf(value, bits);
+            ASSERT_LT(bucket, HistogramCounts::BucketCount(bits));
+            EXPECT_GE(bucket, lastBucket) << value;         // in order
+            uint64_t back = HistogramCounts::BucketValue(bucket, bits);
+            uint64_t error = (back > value) ? back - value : value - back;
+            if (value < (uint64_t(1) << bits))
+                EXPECT_EQ(back, value);
+            else
+                EXPECT_LE(error, value >> (bits - 1)) << value;
+            EXPECT_EQ(HistogramCounts::BucketOf(back, bits), bucket);
+            lastBucket = bucket;
+            lastValue = value;
+        }
+        EXPECT_EQ(lastValue, UINT64_MAX);
+    }
+}
+
+//
+// test percentiles of known distributions, and Merge.
+//
+TEST(TestProfiler, TestProfiler_HistogramPercentiles) {
+    HistogramCounts empty;
+    EXPECT_EQ(empty.Percentile(50), 0u);
+    EXPECT_EQ(empty.Min(), 0u);
+
+    // 1 to 1000 once each.  within 1.6% at 7 bits.
+    HistogramCounts uniform;
+    for (uint64_t value = 1; value <= 1000; ++value)
+        uniform.Record(value);
+    EXPECT_EQ(uniform.Count(), 1000u);
+    EXPECT_EQ(uniform.Total(), 500500u);
+    EXPECT_EQ(uniform.Min(), 1u);
+    EXPECT_EQ(uniform.Max(), 1000u);
+    EXPECT_DOUBLE_EQ(uniform.Mean(), 500.5);
+    EXPECT_EQ(uniform.Percentile(0), 1u);
+    EXPECT_EQ(uniform.Percentile(10), 100u);       // exact below 128
+    EXPECT_NEAR(double(uniform.Percentile(50)), 500.0, 500.0 / 64);
+    EXPECT_NEAR(double(uniform.Percentile(90)), 900.0, 900.0 / 64);
+    EXPECT_NEAR(double(uniform.Percentile(99)), 990.0, 990.0 / 64);
+    EXPECT_EQ(uniform.Percentile(100), 1000u);
+
+    // one value
+    HistogramCounts constant;
+    constant.Record(42, 100);
+    for (double percent : { 0.0, 50.0, 99.9, 100.0 })
+        EXPECT_EQ(constant.Percentile(percent), 42u);
+
+    // two clusters
+    HistogramCounts bimodal;
+    bimodal.Record(10, 90);
+    bimodal.Record(10000, 10);
+    EXPECT_EQ(bimodal.Percentile(50), 10u);
+    EXPECT_EQ(bimodal.Percentile(90), 10u);
+    EXPECT_NEAR(double(bimodal.Percentile(95)), 10000.0, 10000.0 / 64);
+    EXPECT_LE(bimodal.Percentile(95), 10000u);
+
+    // halves merged are the whole
+    HistogramCounts low, high;
+    for (uint64_t value = 1; value <= 500; ++value)
+        low.Record(value);
+    for (uint64_t value = 501; value <= 1000; ++value)
+        high.Record(value);
+    EXPECT_TRUE(low.Merge(high));
+    EXPECT_EQ(low.Count(), uniform.Count());
+    EXPECT_EQ(low.Total(), uniform.Total());
+    EXPECT_EQ(low.Min(), uniform.Min());
+    EXPECT_EQ(low.Max(), uniform.Max());
+    for (double percent : { 1.0, 50.0, 90.0, 99.9 })
+        EXPECT_EQ(low.Percentile(percent), uniform.Percentile(percent));
+    EXPECT_TRUE(low.Merge(empty));
+    EXPECT_EQ(low.Count(), 1000u);
+    EXPECT_FALSE(low.Merge(HistogramCounts(5)));
+
+    low.Reset();
+    EXPECT_EQ(low.Count(), 0u);
+    EXPECT_EQ(low.Percentile(50), 0u);
+}
+
+//
+// test Record from many threads while another takes SnapshotAndReset: nothing is lost or counted twice.
+//
+TEST(TestProfiler, TestProfiler_HistogramThreads) {
+    Histogram histogram("TestProfiler threads", "ns");
+    const int threadCount = 8;
+    const uint64_t perThread = 100000;
+    atomic<bool> recording {true};
+    uint64_t snapshotCount = 0, snapshotTotal = 0;
+    thread snapshotter([&] {
+        while (recording) {
+            HistogramCounts counts = histogram.SnapshotAndReset();
+            snapshotCount += counts.Count();
+            snapshotTotal += counts.Total();
+        }
+    });
+
+    vector<thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&] {
+            for (uint64_t value = 1; value <= perThread; ++value)
+                histogram.Record(value);
+        });
+    }
+    for (thread& worker : threads)
+        worker.join();
+    recording = false;
+    snapshotter.join();
+
+    HistogramCounts rest = histogram.SnapshotAndReset();
+    EXPECT_EQ(snapshotCount + rest.Count(), threadCount * perThread);
+    EXPECT_EQ(snapshotTotal + rest.Total(), threadCount * (perThread * (perThread + 1) / 2));
+    EXPECT_EQ(histogram.Snapshot().Count(), 0u);
+}
+
+//
+// test the JSON and text output.
+//
+TEST(TestProfiler, TestProfiler_HistogramJson) {
+    Histogram histogram("Test \"frame\"", "ns");
+    for (uint64_t value = 1; value <= 1000; ++value)
+        histogram.Record(value * 1000);
+    histogram.RecordDuration(chrono::microseconds(2));
+
+    json parsed = json::parse(histogram.ToJson());
+    EXPECT_EQ(parsed["name"], "Test \"frame\"");
+    EXPECT_EQ(parsed["unit"], "ns");
+    EXPECT_EQ(parsed["count"], 1001);
+    EXPECT_EQ(parsed["min"], 1000);
+    EXPECT_EQ(parsed["max"], 1000000);
+    EXPECT_EQ(parsed["percentiles"]["50"].get<uint64_t>(), histogram.Snapshot().Percentile(50));
+    EXPECT_TRUE(parsed["percentiles"].contains("99.9"));
+    uint64_t bucketCounts = 0;
+    uint64_t lastValue = 0;
+    for (const json& bucket : parsed["buckets"]) {
+        EXPECT_GT(bucket[0].get<uint64_t>(), lastValue);
+        lastValue = bucket[0].get<uint64_t>();
+        bucketCounts += bucket[1].get<uint64_t>();
+    }
+    EXPECT_EQ(bucketCounts, 1001u);
+
+    string text = histogram.ToText();
+    EXPECT_EQ(text.find("Test \"frame\": count=1001 min=1000 ns"), 0u);
+    EXPECT_NE(text.find("99.99"), string::npos);
+}
+
+//
+// busy for a while, steadier than a sleep
+//
+static void spinFor(chrono::microseconds time) {
+    auto end = chrono::steady_clock::now() + time;
+    while (chrono::steady_clock::now() < end)
+        ;
+}
+
+//
+// options for benchmarks that run in a few ms
+//
+static BenchOptions quickBenchOptions() {
+    BenchOptions options;
+    options.warmup = chrono::milliseconds(0);
+    options.sampleTime = chrono::milliseconds(1);
+    options.samples = 5;
+    return options;
+}
+
+//
+// test RunOne, and a sample far off the median dropped as an outlier.
+//
+TEST(TestProfiler, TestProfiler_BenchRunOne) {
+    BenchOptions options = quickBenchOptions();
+    BenchResult result = Bench::RunOne("TestBench loop", [](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i)
+            DoNotOptimize(i * 3);
+    }, options);
+    EXPECT_EQ(result.name, "TestBench loop");
+    EXPECT_GE(result.iterations, 1u);
+    EXPECT_EQ(result.samples + result.rejected, options.samples);
+    EXPECT_LE(result.minNs, result.medianNs);
+    EXPECT_LE(result.medianNs, result.maxNs);
+    EXPECT_GE(result.meanNs, result.minNs);
+    EXPECT_LE(result.meanNs, result.maxNs);
+
+    // one iteration a sample, 100us each but for one sample of 5ms.  the warm up and sizing runs are the first two calls.
+    options.minIterations = 1;
+    options.maxIterations = 1;
+    options.samples = 9;
+    int calls = 0;
+    auto spiky = [&](uint64_t) { spinFor(chrono::microseconds(++calls == 6 ? 5000 : 100)); };
+    result = Bench::RunOne("TestBench spiky", spiky, options);
+    EXPECT_EQ(result.iterations, 1u);
+    EXPECT_EQ(calls, 11);
+    EXPECT_GE(result.rejected, 1);
+    EXPECT_EQ(result.samples + result.rejected, 9);
+    EXPECT_LT(result.maxNs, 2'000'000.0);
+    EXPECT_GE(result.minNs, 100'000.0);
+
+    // kept with outlier rejection off
+    options.outlierMads = 0.0;
+    calls = 0;
+    result = Bench::RunOne("TestBench spiky", spiky, options);
+    EXPECT_EQ(result.rejected, 0);
+    EXPECT_EQ(result.samples, 9);
+    EXPECT_GE(result.maxNs, 5'000'000.0);
+}
+
+//
+// test Run, SaveBaseline and Compare against the saved baseline, and against one edited to show a regression.
+//
+TEST(TestProfiler, TestProfiler_BenchCompare) {
+    Bench bench(quickBenchOptions());
+    bench.AddLoop("TestBench fast", [](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i)
+            DoNotOptimize(i);
+    });
+    bench.Add("TestBench op", [] { spinFor(chrono::microseconds(1)); });
+    EXPECT_EQ(bench.Names(), vector<string>({ "TestBench fast", "TestBench op" }));
+    ASSERT_EQ(bench.Run().size(), 2u);
+    EXPECT_EQ(json::parse(bench.ToJson())["results"].size(), 2u);
+    EXPECT_NE(bench.ToText().find("TestBench op"), string::npos);
+
+    string path = GetATempFilename();
+    ASSERT_TRUE(bench.SaveBaseline(path));
+    bool ok = false;
+    vector<BenchComparison> comparisons = bench.Compare(path, 0.10, &ok);
+    EXPECT_TRUE(ok);
+    ASSERT_EQ(comparisons.size(), 2u);
+    for (size_t i = 0; i < comparisons.size(); ++i) {
+        EXPECT_EQ(comparisons[i].name, bench.Results()[i].name);
+        EXPECT_FALSE(comparisons[i].missing);
+        EXPECT_FALSE(comparisons[i].regressed);
+        EXPECT_DOUBLE_EQ(comparisons[i].baselineNs, bench.Results()[i].medianNs);
+        EXPECT_NEAR(comparisons[i].change, 0.0, 1e-9);
+    }
+
+    // the baseline twice as fast, and with a benchmark that's no longer run
+    json baseline = json::parse(readBinaryFile(path));
+    baseline["results"][1]["medianNs"] = baseline["results"][1]["medianNs"].get<double>() / 2;
+    baseline["results"].push_back({ { "name", "TestBench gone" }, { "medianNs", 1.0 } });
+    {
+        ofstream file(path, ios::binary);
+        file << baseline.dump();
+    }
+    comparisons = bench.Compare(path, 0.10, &ok);
+    EXPECT_FALSE(ok);
+    ASSERT_EQ(comparisons.size(), 3u);
+    EXPECT_FALSE(comparisons[0].regressed);
+    EXPECT_TRUE(comparisons[1].regressed);
+    EXPECT_NEAR(comparisons[1].change, 1.0, 1e-6);
+    EXPECT_EQ(comparisons[2].name, "TestBench gone");
+    EXPECT_TRUE(comparisons[2].missing);
+    EXPECT_NE(Bench::ComparisonText(comparisons).find("TestBench gone"), string::npos);
+
+    // what the filter skips isn't missing
+    bench.Options().filter = "fast";
+    ASSERT_EQ(bench.Run().size(), 1u);
+    comparisons = bench.Compare(path, 0.10, &ok);
+    ASSERT_EQ(comparisons.size(), 1u);
+    EXPECT_EQ(comparisons[0].name, "TestBench fast");
+
+    DeleteFile(path);
+    EXPECT_TRUE(bench.Compare(path, 0.10, &ok).empty());
+    EXPECT_FALSE(ok);
+}
@@ -0,0 +1,470 @@
+#include "pch.h"
+#include "Tau_TimerWheel.h"
+#include "Tau_ThreadPool.h"
+#include "Tau_Time.h"
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace std;
+using namespace Tau;
+
+//
+// FireLog - when timers ran, and a wait for a count of them
+//
+struct FireLog {
+    mutex lock;
+    condition_variable changed;
+    vector<pair<int, chrono::steady_clock::time_point>> fired;
+
+    void Fire(int id) {
+        lock_guard<mutex> guard(lock);
+        fired.emplace_back(id, chrono::steady_clock::now());
+        changed.notify_all();
+    }
+    bool WaitFor(size_t count, chrono::milliseconds timeout) {
+        unique_lock<mutex> guard(lock);
+        return changed.wait_for(guard, timeout, [&] { return fired.size() >= count; });
+    }
+    size_t Count() {
+        lock_guard<mutex> guard(lock);
+        return fired.size();
+    }
+};
+
+//
+// test timers at random times in the first two wheels never run before their time, and all run.
+//
+TEST(TestTime, TestTime_TimerWheelNotEarly) {
+    TimerWheel wheel;
+    EXPECT_EQ(wheel.Tick(), chrono::microseconds(100));
+    FireLog log;
+    mt19937 random(4321);
+    vector<chrono::steady_clock::time_point> due;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 200; ++i) {
+        due.push_back(start + chrono::microseconds(random() % 60000));
+        wheel.At(due.back(), [&log, i] { log.Fire(i); });
+    }
+    ASSERT_TRUE(log.WaitFor(due.size(), chrono::seconds(5)));
+    EXPECT_EQ(wheel.Pending(), 0u);
+    for (auto& [id, when] : log.fired) {
+        EXPECT_GE(when, due[id]) << id;
+        EXPECT_LT(when - due[id], chrono::milliseconds(50)) << id;
+    }
+
+    // a time already past runs at once
+    wheel.At(start, [&log] { log.Fire(0); });
+    EXPECT_TRUE(log.WaitFor(due.size() + 1, chrono::seconds(1)));
+}
+
+//
+// test Cancel, and ids that are stale: run, cancelled, or their slot reused.
+//
+TEST(TestTime, TestTime_TimerWheelCancel) {
+    TimerWheel wheel;
+    FireLog log;
+
+    TimerId cancelled = wheel.After(chrono::milliseconds(30), [&log] { log.Fire(1); });
+    EXPECT_NE(cancelled, 0u);
+    EXPECT_EQ(wheel.Pending(), 1u);
+    EXPECT_TRUE(wheel.Cancel(cancelled));
+    EXPECT_FALSE(wheel.Cancel(cancelled));
+    EXPECT_EQ(wheel.Pending(), 0u);
+
+    TimerId ran = wheel.After(chrono::milliseconds(1), [&log] { log.Fire(2); });
+    ASSERT_TRUE(log.WaitFor(1, chrono::seconds(1)));
+    EXPECT_FALSE(wheel.Cancel(ran));
+    EXPECT_FALSE(wheel.Cancel(0));
+    EXPECT_FALSE(wheel.Cancel(0x12345678));
+
+    // a new timer reuses the slot.  the old ids don't cancel it.
+    TimerId reused = wheel.After(chrono::seconds(10), [&log] { log.Fire(3); });
+    EXPECT_EQ(static_cast<uint32_t>(reused), static_cast<uint32_t>(ran));
+    EXPECT_FALSE(wheel.Cancel(ran));
+    EXPECT_FALSE(wheel.Cancel(cancelled));
+    EXPECT_EQ(wheel.Pending(), 1u);
+    EXPECT_TRUE(wheel.Cancel(reused));
+
+    // a repeating timer cancelled from its own callback
+    TimerId repeating = 0;
+    mutex idLock;
+    {
+        lock_guard<mutex> guard(idLock);
+        repeating = wheel.Every(chrono::milliseconds(2), [&] {
+            log.Fire(4);
+            lock_guard<mutex> guard(idLock);
+            wheel.Cancel(repeating);
+        });
+    }
+    this_thread::sleep_for(chrono::milliseconds(50));
+    EXPECT_EQ(log.Count(), 2u);
+    EXPECT_EQ(wheel.Pending(), 0u);
+    EXPECT_EQ(log.fired[0].first, 2);
+    EXPECT_EQ(log.fired[1].first, 4);
+}
+
+//
+// test Every: each run is a period after the last was due, so a slow callback doesn't push the later ones back.
+//
+TEST(TestTime, TestTime_TimerWheelEvery) {
+    TimerWheel wheel;
+    FireLog log;
+    const auto period = chrono::milliseconds(10);
+    const size_t runs = 20;
+    auto start = chrono::steady_clock::now();
+    TimerId every = wheel.Every(period, [&log] {
+        log.Fire(0);
+        this_thread::sleep_for(chrono::milliseconds(2));
+    });
+    ASSERT_TRUE(log.WaitFor(runs, chrono::seconds(5)));
+    EXPECT_TRUE(wheel.Cancel(every));
+
+    lock_guard<mutex> guard(log.lock);
+    for (size_t run = 0; run < runs; ++run)
+        EXPECT_GE(log.fired[run].second, start + period * (run + 1)) << run;
+    // 20 runs 2ms late each would be 40ms
+    EXPECT_LT(log.fired[runs - 1].second - (start + period * runs), chrono::milliseconds(25));
+}
+
+//
+// test timers that start in a higher wheel and move down as time reaches them: past the first wheel (25.6ms) at the
+// default tick, and past the second (6.5s at the default tick) with a 10us tick, where it's 655ms.
+//
+TEST(TestTime, TestTime_TimerWheelCascade) {
+    for (chrono::microseconds tick : { chrono::microseconds(100), chrono::microseconds(10) }) {
+        TimerWheel wheel(nullptr, tick);
+        FireLog log;
+        uint64_t firstWheel = 256 * tick.count();
+        uint64_t secondWheel = 256 * firstWheel;
+        vector<chrono::microseconds> delays = {
+            chrono::microseconds(firstWheel - 100), chrono::microseconds(firstWheel + 100),
+            chrono::microseconds(firstWheel * 3 + 50) };
+        if (tick == chrono::microseconds(10)) {
+            delays.push_back(chrono::microseconds(secondWheel - 1000));
+            delays.push_back(chrono::microseconds(secondWheel + 1000));
+            delays.push_back(chrono::microseconds(secondWheel + firstWheel * 5 + 30));
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < delays.size(); ++i)
+            wheel.At(start + delays[i], [&log, i] { log.Fire(static_cast<int>(i)); });
+        ASSERT_TRUE(log.WaitFor(delays.size(), chrono::seconds(5)));
+        for (auto& [id, when] : log.fired) {
+            EXPECT_GE(when, start + delays[id]) << id;
+            EXPECT_LT(when - (start + delays[id]), chrono::milliseconds(20)) << id;
+        }
+        // in order of their times
+        for (size_t i = 0; i < log.fired.size(); ++i)
+            EXPECT_EQ(log.fired[i].first, static_cast<int>(i));
+    }
+}
+
+//
+// test callbacks going to the executor: one blocks a pool thread until another, run later, lets it go.  on the
+// wheel's own thread the second would never run.
+//
+TEST(TestTime, TestTime_TimerWheelExecutor) {
+    ThreadPool pool(2);
+    TimerWheel wheel(&pool);
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    promise<bool> firstResult;
+    promise<thread::id> secondThread;
+
+    wheel.After(chrono::milliseconds(1), [&] {
+        firstResult.set_value(released.wait_for(chrono::seconds(2)) == future_status::ready);
+    });
+    wheel.After(chrono::milliseconds(20), [&] {
+        secondThread.set_value(this_thread::get_id());
+        release.set_value();
+    });
+    EXPECT_TRUE(firstResult.get_future().get());
+    EXPECT_NE(secondThread.get_future().get(), this_thread::get_id());
+}
+
+//
+// strftime of the local time, the reference for TimeFormatter
+//
+static string strftimeLocal(time_t t, const string& format) {
+    tm local {};
+#if defined(_WIN32)
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    char buffer[256];
+    size_t length = strftime(buffer, sizeof(buffer), format.c_str(), &local);
+    return string(buffer, length);
+}
+
+//
+// test TimeFormatter against strftime at random times, for the conversions it writes itself and mixed with those
+// it passes to strftime.
+//
+TEST(TestTime, TestTime_TimeFormatter) {
+    const vector<string> formats = {
+        "%Y-%m-%d %H:%M:%S", "%y %e %I %j", "%F %T", "%R %D", "100%% %n%t", "%a %b %p %Y", "%H%M%S%%%d", "plain", "",
+    };
+    mt19937 random(9876);
+    for (const string& format : formats) {
+        TimeFormatter formatter(format);
+        EXPECT_EQ(formatter.FormatString(), format);
+        string expectedFormat = format.empty() ? "%a %b %e %H:%M:%S %Y\n" : format;     // ctime()'s
+        for (int i = 0; i < 500; ++i) {
+            time_t t = static_cast<time_t>(random() % 2'000'000'000);
+            EXPECT_EQ(formatter.Format(t), strftimeLocal(t, expectedFormat)) << format << " " << t;
+        }
+        // the same second twice, then the next, as a log stamps them
+        time_t t = 1'700'000'000;
+        for (time_t second : { t, t, t + 1, t + 61 })
+            EXPECT_EQ(formatter.Format(chrono::system_clock::from_time_t(second)), strftimeLocal(second, expectedFormat));
+    }
+    EXPECT_EQ(Time_t_ToString(1'700'000'000, "%F %T"), strftimeLocal(1'700'000'000, "%F %T"));
+    EXPECT_EQ(Time_t_ToString(1'700'000'000), strftimeLocal(1'700'000'000, "%a %b %e %H:%M:%S %Y\n"));
+
+#if !defined(_WIN32)
+    // a zone with daylight saving time
+    const char* zone = getenv("TZ");
+    string oldZone = (zone != nullptr) ? zone : "";
+    setenv("TZ", "America/New_York", 1);
+    tzset();
+    TimeFormatter local("%F %T %j %I");
+    for (int i = 0; i < 500; ++i) {
+        time_t t = static_cast<time_t>(random() % 2'000'000'000);
+        EXPECT_EQ(local.Format(t), strftimeLocal(t, "%F %T %j %I")) << t;
+    }
+    if (zone != nullptr)
+        setenv("TZ", oldZone.c_str(), 1);
+    else
+        unsetenv("TZ");
+    tzset();
+#endif
+}
+
+//
+// test %L, %f and %N, the fraction of the second strftime can't write.
+//
+TEST(TestTime, TestTime_TimeFormatterFraction) {
+    time_t t = 1'700'000'000;
+    auto when = chrono::system_clock::from_time_t(t) +
+                chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(123'456'700));
+    string seconds = strftimeLocal(t, "%S");
+    EXPECT_EQ(TimeFormatter("%S.%L").Format(when), seconds + ".123");
+    EXPECT_EQ(TimeFormatter("%S.%f").Format(when), seconds + ".123456");
+    EXPECT_EQ(TimeFormatter("%S.%N").Format(when), seconds + ".123456700");
+
+    // another time in the same second keeps the second's text but not its fraction
+    TimeFormatter millis("%T.%L");
+    EXPECT_EQ(millis.Format(when), strftimeLocal(t, "%T") + ".123");
+    EXPECT_EQ(millis.Format(chrono::system_clock::from_time_t(t) + chrono::milliseconds(7)), strftimeLocal(t, "%T") + ".007");
+    EXPECT_EQ(millis.Format(t), strftimeLocal(t, "%T") + ".000");
+
+    // now, coarse or not
+    string now = TimeFormatter("%Y.%L").FormatNow(true);
+    EXPECT_EQ(now.size(), 8u);
+    EXPECT_EQ(now[4], '.');
+}
+
+//
+// test the buffer Format: the length of the whole text is returned, like snprintf, and what fits is written with a 0.
+//
+TEST(TestTime, TestTime_TimeFormatterBuffer) {
+    TimeFormatter formatter("%F %T.%L");
+    time_t t = 1'700'000'000;
+    string whole = formatter.Format(t);
+    ASSERT_EQ(whole.size(), 23u);
+
+    char buffer[64];
+    EXPECT_EQ(formatter.Format(t, buffer, sizeof(buffer)), 23u);
+    EXPECT_EQ(string(buffer), whole);
+
+    // cut
+    memset(buffer, 'x', sizeof(buffer));
+    EXPECT_EQ(formatter.Format(t, buffer, 11), 23u);
+    EXPECT_EQ(string(buffer), whole.substr(0, 10));
+    EXPECT_EQ(buffer[11], 'x');
+
+    // exactly the text, with no room for the 0
+    memset(buffer, 'x', sizeof(buffer));
+    EXPECT_EQ(formatter.Format(t, buffer, 23), 23u);
+    EXPECT_EQ(string(buffer), whole.substr(0, 22));
+
+    // room for the 0 alone, and none at all
+    memset(buffer, 'x', sizeof(buffer));
+    EXPECT_EQ(formatter.Format(t, buffer, 1), 23u);
+    EXPECT_EQ(buffer[0], '\0');
+    EXPECT_EQ(buffer[1], 'x');
+    EXPECT_EQ(formatter.Format(t, nullptr, 0), 23u);
+
+    // passed to strftime and cut
+    TimeFormatter named("%A %B");
+    string name = named.Format(t);
+    EXPECT_EQ(named.Format(t, buffer, 4), name.size());
+    EXPECT_EQ(string(buffer), name.substr(0, 3));
+}
+
+//
+// test PreciseSleeper never waking before the deadline, for deadlines near and far, past and now.
+//
+TEST(TestTime, TestTime_PreciseSleeper) {
+    PreciseSleeper sleeper;
+    EXPECT_GT(sleeper.Margin().count(), 0);
+
+    mt19937 random(42);
+    uniform_int_distribution<int> delayUs(0, 3000);
+    for (int i = 0; i < 200; ++i) {
+        auto deadline = chrono::steady_clock::now() + chrono::microseconds(delayUs(random));
+        sleeper.SleepUntil(deadline);
+        auto now = chrono::steady_clock::now();
+        EXPECT_GE(now, deadline) << "sleep " << i << " woke early";
+        EXPECT_LT(now - deadline, chrono::milliseconds(50));
+    }
+    EXPECT_GT(sleeper.Slept().count() + sleeper.Spun().count(), 0);
+    EXPECT_GT(sleeper.Margin().count(), 0);
+
+    // a deadline gone by returns at once
+    auto start = chrono::steady_clock::now();
+    sleeper.SleepUntil(start - chrono::milliseconds(5));
+    sleeper.SleepUntil(start);
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(5));
+
+    start = chrono::steady_clock::now();
+    sleeper.SleepFor(chrono::milliseconds(2));
+    EXPECT_GE(chrono::steady_clock::now() - start, chrono::milliseconds(2));
+
+    // the thread's own sleeper
+    for (int i = 0; i < 20; ++i) {
+        auto deadline = chrono::steady_clock::now() + chrono::microseconds(delayUs(random));
+        Sleep_Until(deadline);
+        EXPECT_GE(chrono::steady_clock::now(), deadline);
+    }
+}
+
+//
+// test FramePacer holding the frames a period apart: Wait() never returns before a deadline, and the deadlines
+// don't drift.
+//
+TEST(TestTime, TestTime_FramePacer) {
+    FramePacer pacer(100.0);
+    EXPECT_EQ(pacer.Rate(), 100.0);
+    EXPECT_EQ(pacer.Period(), chrono::milliseconds(10));
+
+    const int frames = 20;
+    auto start = chrono::steady_clock::now();
+    pacer.Wait();                                               // the first sets the deadlines going
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(5));
+    for (int i = 1; i <= frames; ++i) {
+        pacer.Wait();
+        EXPECT_GE(chrono::steady_clock::now(), start + i * pacer.Period()) << "frame " << i << " early";
+    }
+    auto elapsed = chrono::steady_clock::now() - start;
+
+    FrameStats stats = pacer.Stats();
+    EXPECT_EQ(stats.frames, uint64_t(frames));
+    EXPECT_EQ(stats.missed, 0u);
+    EXPECT_EQ(stats.rateHz, 100.0);
+    EXPECT_GE(stats.meanMs, 9.5);
+    // no drift: late by the worst wake, not by every frame's
+    auto lateMax = chrono::duration_cast<chrono::nanoseconds>(chrono::duration<double, milli>(stats.lateMaxMs));
+    EXPECT_LT(elapsed, frames * pacer.Period() + lateMax + 2 * pacer.Period());
+    EXPECT_GE(stats.minMs, 0.0);
+    EXPECT_GE(stats.lateMeanMs, 0.0);
+    EXPECT_LE(stats.lateMeanMs, stats.lateMaxMs);
+    EXPECT_GE(stats.spinFraction, 0.0);
+    EXPECT_LE(stats.spinFraction, 1.0);
+
+    vector<float> recent = pacer.RecentFrameTimes();
+    ASSERT_EQ(recent.size(), size_t(frames));
+    EXPECT_GT(recent.back(), 0.0f);
+    EXPECT_EQ(pacer.FrameTimes().Count(), uint64_t(frames));
+    EXPECT_NE(pacer.StatsText().find("100.0 Hz"), string::npos);
+    EXPECT_NE(pacer.StatsText().find("missed 0"), string::npos);
+
+    pacer.ResetStats();
+    EXPECT_EQ(pacer.Stats().frames, 0u);
+    EXPECT_EQ(pacer.RecentFrameTimes().size(), 0u);
+}
+
+//
+// test a frame over its deadline: under a period late it's missed and the next deadline stays on the schedule, so
+// it's caught up on.  more than a period late it's missed and the deadlines start again from then, so the frames
+// after it aren't bunched up.
+//
+TEST(TestTime, TestTime_FramePacerMissed) {
+    FramePacer pacer(100.0);
+    auto period = pacer.Period();
+    auto start = chrono::steady_clock::now();
+    pacer.Wait();
+    pacer.Wait();                                               // the first deadline, start + a period
+    EXPECT_EQ(pacer.Stats().missed, 0u);
+
+    // half a period late
+    this_thread::sleep_for(period + period / 2);
+    auto before = chrono::steady_clock::now();
+    pacer.Wait();
+    auto late = chrono::steady_clock::now();
+    EXPECT_LT(late - before, chrono::milliseconds(2));          // no wait for a deadline gone by
+    EXPECT_EQ(pacer.Stats().missed, 1u);
+    pacer.Wait();
+    auto caughtUp = chrono::steady_clock::now();
+    EXPECT_GE(caughtUp, start + 3 * period);                    // the schedule's next deadline
+    EXPECT_LT(caughtUp, before + period);                       // not a period after the late frame
+    EXPECT_EQ(pacer.Stats().missed, 1u);
+
+    // three periods late
+    this_thread::sleep_for(3 * period);
+    before = chrono::steady_clock::now();
+    pacer.Wait();
+    late = chrono::steady_clock::now();
+    EXPECT_LT(late - before, chrono::milliseconds(2));
+    EXPECT_EQ(pacer.Stats().missed, 2u);
+    for (int i = 1; i <= 5; ++i) {
+        pacer.Wait();
+        EXPECT_GE(chrono::steady_clock::now(), before + i * period) << "frame " << i << " after the restart early";
+    }
+    EXPECT_EQ(pacer.Stats().missed, 2u);                        // none bunched up to catch up
+    EXPECT_GE(pacer.Stats().lateMaxMs, 2.0 * period.count() / 1e6);
+
+    // Restart after a pause isn't missed
+    this_thread::sleep_for(3 * period);
+    pacer.Restart();
+    before = chrono::steady_clock::now();
+    pacer.Wait();
+    pacer.Wait();
+    EXPECT_GE(chrono::steady_clock::now(), before + period);
+    EXPECT_EQ(pacer.Stats().missed, 2u);
+}
+
+//
+// test a rate of 0 measuring without waiting.
+//
+TEST(TestTime, TestTime_FramePacerUnpaced) {
+    FramePacer pacer(0.0);
+    EXPECT_EQ(pacer.Rate(), 0.0);
+    EXPECT_EQ(pacer.Period().count(), 0);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < 100; ++i)
+        pacer.Wait();
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(10));
+
+    FrameStats stats = pacer.Stats();
+    EXPECT_EQ(stats.frames, 99u);
+    EXPECT_EQ(stats.missed, 0u);
+    EXPECT_EQ(stats.rateHz, 0.0);
+    EXPECT_NE(pacer.StatsText().find("unpaced"), string::npos);
+
+    // paced from the next Wait()
+    pacer.SetRate(200.0);
+    EXPECT_EQ(pacer.Period(), chrono::milliseconds(5));
+    start = chrono::steady_clock::now();
+    pacer.Wait();
+    pacer.Wait();
+    EXPECT_GE(chrono::steady_clock::now(), start + pacer.Period());
+    EXPECT_EQ(pacer.Stats().missed, 0u);
+}